@@ -42,6 +42,12 @@ namespace ToolKit
       m_renderer = new Renderer();
       m_renderer->m_windowWidth = windowWidth;
       m_renderer->m_windowHeight = windowHeight;
+
+      // Merged static entities are drawn by the batch.
+      m_framePipeline.m_skipFn = [this](Entity* ntt) -> bool
+      {
+        return ntt->m_static && m_scene.m_staticBatch.Contains(ntt->m_id);
+      };
     }
 
     App::~App()
@@ -54,6 +60,9 @@ namespace ToolKit
 
     void App::Init()
     {
+      // Triangle accurate picking for the meshes that are flushed after loading.
+      GetMeshManager()->m_buildTriangleBVH = true;
+
 #ifdef TK_SAMPLE_SCENE
       m_suzanne = new Drawable();
       m_suzanne->m_node->SetTranslation({ 0.0f, 0.0f, -5.0f });
@@ -193,8 +202,10 @@ namespace ToolKit
 
       SafeDel(Viewport::m_overlayMods);
       SafeDel(Viewport::m_overlayOptions);
+      SafeDel(Viewport::m_overlayStats);
 
       m_scene.Destroy();
+      m_targetPool.Clear();
 
       // Editor objects.
       SafeDel(m_grid);
@@ -208,6 +219,12 @@ namespace ToolKit
       assert(m_sceneLights.size() == 3);
       m_sceneLights.clear();
 
+      for (Light* light : m_pointLights)
+      {
+        SafeDel(light);
+      }
+      m_pointLights.clear();
+
       GetAnimationPlayer()->m_records.clear();
 
       ModManager::GetInstance()->UnInit();
@@ -216,8 +233,7 @@ namespace ToolKit
 
     void App::Frame(float deltaTime)
     {
-      // Update animations.
-      GetAnimationPlayer()->Update(MilisecToSec(deltaTime));
+      m_renderer->BeginFrame();
 
       // Update Mods.
       ModManager::GetInstance()->Update(deltaTime);
@@ -227,7 +243,15 @@ namespace ToolKit
         wnd->DispatchSignals();
       }
 
+      // Instances added since the last frame get their parts.
+      m_scene.ExpandPrefabs();
+
+      // Merged geometry is dropped once a static entity is edited.
+      m_scene.ValidateStaticBatch();
+
       // Update Viewports.
+      std::vector<Viewport*> viewports;
+      std::vector<FramePipeline::View> views;
       for (Window* wnd : m_windows)
       {
         if (wnd->GetType() != Window::Type::Viewport)
@@ -240,34 +264,83 @@ namespace ToolKit
         Viewport* vp = static_cast<Viewport*> (wnd);
         vp->Update(deltaTime);
 
+        FramePipeline::View view;
+        view.camera = vp->m_camera;
+        view.frustumCulling = m_frustumCulling;
+        viewports.push_back(vp);
+        views.push_back(view);
+      }
+
+      // Animations, transforms, bounds and render lists of all viewports.
+      m_framePipeline.Run(MilisecToSec(deltaTime), m_scene.GetEntities(), views);
+
+      for (size_t i = 0; i < viewports.size(); i++)
+      {
+        Viewport* vp = viewports[i];
+        std::vector<Drawable*>& drawables = views[i].renderList;
+
         // Adjust scene lights.
         Camera* cam = vp->m_camera;
         m_lightMaster->OrphanSelf();
         cam->m_node->AddChild(m_lightMaster);
 
         m_renderer->SetRenderTarget(vp->m_viewportImage);
+        m_renderer->BeginPass(vp->m_name);
+
+        if (m_clusteredLighting)
+        {
+          LightRawPtrArray lights = m_sceneLights;
+          lights.insert(lights.end(), m_pointLights.begin(), m_pointLights.end());
+          m_renderer->SetClusteredLights(cam, lights);
+        }
+
+        for (Drawable* drawable : drawables)
+        {
+          if (drawable->GetType() == EntityType::Entity_Billboard)
+          {
+            Billboard* billboard = static_cast<Billboard*> (drawable);
+            billboard->LookAt(cam, vp->m_height);
+          }
+        }
 
-        for (Entity* ntt : m_scene.GetEntities())
+        if (m_occlusionCulling)
         {
-          if (ntt->IsDrawable())
+          m_occlusionCuller.Begin(cam);
+          for (Drawable* drawable : drawables)
           {
-            if (ntt->GetType() == EntityType::Entity_Billboard)
+            if (drawable->m_occluder)
             {
-              Billboard* billboard = static_cast<Billboard*> (ntt);
-              billboard->LookAt(cam, vp->m_height);
+              m_occlusionCuller.AddOccluder(drawable);
             }
+          }
+          m_occlusionCuller.Rasterize();
+        }
 
-            m_renderer->Render(static_cast<Drawable*> (ntt), cam, m_sceneLights);
+        for (Drawable* drawable : drawables)
+        {
+          if (m_occlusionCulling && !drawable->m_occluder && !drawable->m_mesh->IsSkinned())
+          {
+            const BoundingBox& local = drawable->m_mesh->m_aabb;
+            if (local.min.x <= local.max.x && !m_occlusionCuller.IsVisible(drawable->GetAABB(true)))
+            {
+              continue;
+            }
           }
+
+          m_renderer->Render(drawable, cam, m_sceneLights);
         }
 
+        m_scene.m_staticBatch.Render(m_renderer, cam, m_sceneLights);
+
         RenderSelected(vp);
 
+        // Editor objects are small, merge them where possible.
+        m_renderer->BeginBatch(cam);
         if (!m_perFrameDebugObjects.empty())
         {
           for (Drawable* d : m_perFrameDebugObjects)
           {
-            m_renderer->Render(d, cam);
+            m_renderer->AddToBatch(d);
             SafeDel(d);
           }
           m_perFrameDebugObjects.clear();
@@ -288,9 +361,11 @@ namespace ToolKit
         m_renderer->Render(m_grid, cam);
 
         m_origin->LookAt(cam, vp->m_height);
-        m_renderer->Render(m_origin, cam);
+        m_renderer->AddToBatch(m_origin);
+        m_renderer->EndBatch();
 
         // Only draw gizmo in active viewport.
+        m_renderer->BeginBatch(cam);
         if (m_gizmo != nullptr && vp->IsActive())
         {
           m_gizmo->LookAt(cam, vp->m_height);
@@ -301,7 +376,7 @@ namespace ToolKit
           }
           else
           {
-            m_renderer->Render(m_gizmo, cam);
+            m_renderer->AddToBatch(m_gizmo);
           }
         }
 
@@ -312,13 +387,21 @@ namespace ToolKit
           orthScl = 1.6f;
         }
         m_cursor->LookAt(cam, vp->m_height * orthScl);
-        m_renderer->Render(m_cursor, cam);
+        m_renderer->AddToBatch(m_cursor);
+        m_renderer->EndBatch();
+        m_renderer->ClearClusteredLights();
+        m_renderer->EndPass();
       }
 
       m_renderer->SetRenderTarget(nullptr);
 
       // Render UI.
+      m_renderer->BeginPass("UI");
       UI::ShowUI();
+      m_renderer->EndPass();
+
+      m_renderer->EndFrame();
+      m_targetPool.NextFrame();
     }
 
     void App::OnResize(int width, int height)
@@ -719,40 +802,52 @@ namespace ToolKit
         return;
       }
 
-      auto RenderFn = [this, vp](const EntityRawPtrArray& selection, const Vec3& color)
+      // Each outline renders the selection into a transient stencil mask, then dilates the mask over the viewport.
+      // Masks don't overlap in time, so both share a single pooled target.
+      FrameGraph graph(&m_targetPool);
+      FrameGraph::ResourceId viewportImage = graph.ImportTarget("Viewport", vp->m_viewportImage);
+
+      auto AddOutlineFn = [this, vp, &graph, viewportImage](const EntityRawPtrArray& selection, const Vec3& color, const String& name)
       {
-        glEnable(GL_STENCIL_TEST);
-        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        FrameGraph::ResourceId mask = graph.CreateTarget(name + " Mask", (uint)vp->m_width, (uint)vp->m_height);
 
-        RenderTarget stencilMask((int)vp->m_width, (int)vp->m_height);
-        stencilMask.Init();
+        auto MaskFn = [this, vp, &graph, mask, selection]() -> void
+        {
+          glEnable(GL_STENCIL_TEST);
+          glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+          glStencilFunc(GL_ALWAYS, 1, 0xFF);
+          glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-        m_renderer->SetRenderTarget(&stencilMask);
+          m_renderer->SetRenderTarget(graph.GetTarget(mask));
 
-        for (Entity* ntt : selection)
-        {
-          if (ntt->IsDrawable())
+          for (Entity* ntt : selection)
           {
-            m_renderer->Render(static_cast<Drawable*> (ntt), vp->m_camera);
+            if (ntt->IsDrawable())
+            {
+              m_renderer->Render(static_cast<Drawable*> (ntt), vp->m_camera);
+            }
           }
-        }
 
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+          glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-        glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-        ShaderPtr solidColor = GetShaderManager()->Create(ShaderPath("unlitColorFrag.shader"));
-        m_renderer->DrawFullQuad(solidColor);
-        glDisable(GL_STENCIL_TEST);
+          glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+          ShaderPtr solidColor = GetShaderManager()->Create(ShaderPath("unlitColorFrag.shader"));
+          m_renderer->DrawFullQuad(solidColor);
+          glDisable(GL_STENCIL_TEST);
+        };
 
-        m_renderer->SetRenderTarget(vp->m_viewportImage, false);
+        auto DilateFn = [this, vp, &graph, mask, color]() -> void
+        {
+          m_renderer->SetRenderTarget(vp->m_viewportImage, false);
 
-        // Dilate.
-        glBindTexture(GL_TEXTURE_2D, stencilMask.m_textureId);
-        ShaderPtr dilate = GetShaderManager()->Create(ShaderPath("dilateFrag.shader"));
-        dilate->SetShaderParameter("Color", color);
-        m_renderer->DrawFullQuad(dilate);
+          glBindTexture(GL_TEXTURE_2D, graph.GetTarget(mask)->m_textureId);
+          ShaderPtr dilate = GetShaderManager()->Create(ShaderPath("dilateFrag.shader"));
+          dilate->SetShaderParameter("Color", color);
+          m_renderer->DrawFullQuad(dilate);
+        };
+
+        graph.AddPass(name + " Mask", {}, { mask }, MaskFn);
+        graph.AddPass(name + " Dilate", { mask }, { viewportImage }, DilateFn);
       };
 
       EntityRawPtrArray selecteds;
@@ -760,11 +855,16 @@ namespace ToolKit
       Entity* primary = selecteds.back();
 
       selecteds.pop_back();
-      RenderFn(selecteds, g_selectHighLightSecondaryColor);
+      if (!selecteds.empty())
+      {
+        AddOutlineFn(selecteds, g_selectHighLightSecondaryColor, "Secondary");
+      }
 
       selecteds.clear();
       selecteds.push_back(primary);
-      RenderFn(selecteds, g_selectHighLightPrimaryColor);
+      AddOutlineFn(selecteds, g_selectHighLightPrimaryColor, "Primary");
+
+      graph.Execute();
     }
 
   }
@@ -74,10 +74,14 @@ namespace ToolKit
       Cursor* m_cursor;
       Gizmo* m_gizmo = nullptr;
       std::vector<Drawable*> m_perFrameDebugObjects;
+      OcclusionCuller m_occlusionCuller;
+      RenderTargetPool m_targetPool; // Transient targets of the editor passes.
+      FramePipeline m_framePipeline; // Scene updates and render lists of the viewports.
 
       // 3 point lighting system.
       Node* m_lightMaster;
       LightRawPtrArray m_sceneLights; // { 0:key 1:fill, 2:back }
+      LightRawPtrArray m_pointLights; // Lights the scene, spawned from the console.
 
       // Editor states.
       int m_fps = 0;
@@ -85,6 +89,10 @@ namespace ToolKit
       bool m_showStateTransitionsDebug = false;
       bool m_showOverlayUI = true;
       bool m_showOverlayUIAlways = true;
+      bool m_showRenderStats = false;
+      bool m_frustumCulling = true;
+      bool m_occlusionCulling = false;
+      bool m_clusteredLighting = true;
       bool m_importSlient = false;
       TransformationSpace m_transformSpace = TransformationSpace::TS_WORLD;
 
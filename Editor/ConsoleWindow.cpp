@@ -8,6 +8,8 @@
 #include "Node.h"
 #include "Directional.h"
 #include "Viewport.h"
+#include "TextureAtlas.h"
+#include <random>
 #include "DebugNew.h"
 #include "TransformMod.h"
 
@@ -402,9 +404,9 @@ namespace ToolKit
       }
     }
 
-    void ApplyTransformToMesh(TagArgArray tagArgs)
+    void ApplyTransformToMesh(TagArgArray)
     {
-      // Caviate: A reload is neded since hardware buffers are not updated.
+      // Caviate: Hardware buffers are updated only for meshes that keep their client side arrays.
       // After refreshing hardware buffers, transforms of the entity can be set to identity.
       if (Drawable* e = dynamic_cast<Drawable*> (g_app->m_scene.GetCurrentSelection()))
       {
@@ -415,6 +417,7 @@ namespace ToolKit
         {
           m->ApplyTransform(ts);
         }
+        e->m_mesh->CalculateAABoundingBox();
       }
       else
       {
@@ -459,6 +462,489 @@ namespace ToolKit
       }
     }
 
+    void ShowRenderStatsExec(TagArgArray tagArgs)
+    {
+      BoolCheck(tagArgs, &g_app->m_showRenderStats);
+    }
+
+    void PrintRenderStatsExec(TagArgArray)
+    {
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      const RenderStats& stats = g_app->m_renderer->GetFrameStats();
+
+      cwnd->AddLog("Draw calls: " + std::to_string(stats.drawCalls));
+      cwnd->AddLog("Triangles: " + std::to_string(stats.triangles));
+      cwnd->AddLog("Program binds: " + std::to_string(stats.programBinds));
+      cwnd->AddLog("Texture binds: " + std::to_string(stats.textureBinds));
+      cwnd->AddLog("Buffer uploads: " + std::to_string(stats.bufferUploads) + " (" + std::to_string(stats.uploadedBytes) + " bytes)");
+      cwnd->AddLog("Batched meshes: " + std::to_string(stats.batchedMeshes) + ", draws saved: " + std::to_string(stats.drawsSaved));
+      cwnd->AddLog("Triangles saved by lods: " + std::to_string(stats.trianglesSaved));
+
+      const LightClusters::Stats& clusterStats = g_app->m_renderer->m_lightClusters->GetStats();
+      cwnd->AddLog("Light clusters: " + std::to_string(clusterStats.pointLights) + " point lights, " + std::to_string(clusterStats.indices) + " indices, max " + std::to_string(clusterStats.maxPerCluster) + " per cluster, binned in " + std::to_string(clusterStats.binMs) + " ms");
+
+      RenderTargetPool::Stats poolStats = g_app->m_targetPool.GetStats();
+      cwnd->AddLog("Pooled render targets: " + std::to_string(poolStats.free) + " free, " + std::to_string(poolStats.acquired) + " acquired, " + std::to_string(poolStats.created) + " created in total");
+
+      if (!g_app->m_renderer->IsGpuTimerSupported())
+      {
+        cwnd->AddLog("Gpu timers are not supported.", ConsoleWindow::LogType::Warning);
+        return;
+      }
+
+      for (const PassTiming& timing : g_app->m_renderer->GetPassTimings())
+      {
+        cwnd->AddLog(timing.name + ": " + std::to_string(timing.gpuTimeMs) + " ms");
+      }
+    }
+
+    void SetBatchingExec(TagArgArray tagArgs)
+    {
+      BatchSettings& settings = g_app->m_renderer->m_batchSettings;
+
+      TagArgCIt enabledTag = GetTag("e", tagArgs);
+      if (enabledTag != tagArgs.end() && !enabledTag->second.empty())
+      {
+        settings.enabled = enabledTag->second.front() == "1";
+      }
+
+      TagArgCIt meshTag = GetTag("mv", tagArgs);
+      if (meshTag != tagArgs.end() && !meshTag->second.empty())
+      {
+        settings.maxMeshVertexCount = (uint)std::atoi(meshTag->second.front().c_str());
+      }
+
+      TagArgCIt batchTag = GetTag("bv", tagArgs);
+      if (batchTag != tagArgs.end() && !batchTag->second.empty())
+      {
+        settings.maxBatchVertexCount = (uint)std::atoi(batchTag->second.front().c_str());
+      }
+
+      String str = "Batching: " + std::to_string(settings.enabled) + ", max mesh vertices: " + std::to_string(settings.maxMeshVertexCount);
+      str += ", max batch vertices: " + std::to_string(settings.maxBatchVertexCount);
+      g_app->GetConsole()->AddLog(str);
+    }
+
+    void BuildStaticBatchExec(TagArgArray)
+    {
+      g_app->m_scene.BuildStaticBatch();
+
+      const StaticBatch& batch = g_app->m_scene.m_staticBatch;
+      uint merged = 0;
+      for (Entity* ntt : g_app->m_scene.GetEntities())
+      {
+        if (batch.Contains(ntt->m_id))
+        {
+          merged++;
+        }
+      }
+
+      String str = "Static batch: " + std::to_string(merged) + " entities merged into " + std::to_string(batch.m_chunks.size()) + " chunks.";
+      g_app->GetConsole()->AddLog(str);
+    }
+
+    void ClearStaticBatchExec(TagArgArray)
+    {
+      g_app->m_scene.ClearStaticBatch();
+    }
+
+    void GenerateLodsExec(TagArgArray tagArgs)
+    {
+      Drawable* e = dynamic_cast<Drawable*> (g_app->m_scene.GetCurrentSelection());
+      if (e == nullptr)
+      {
+        g_app->GetConsole()->AddLog(g_noValidEntity, ConsoleWindow::LogType::Error);
+        return;
+      }
+
+      uint levels = 3;
+      TagArgCIt levelTag = GetTag("l", tagArgs);
+      if (levelTag != tagArgs.end() && !levelTag->second.empty())
+      {
+        levels = (uint)std::atoi(levelTag->second.front().c_str());
+      }
+
+      float reduction = 0.5f;
+      TagArgCIt reductionTag = GetTag("r", tagArgs);
+      if (reductionTag != tagArgs.end() && !reductionTag->second.empty())
+      {
+        reduction = (float)std::atof(reductionTag->second.front().c_str());
+      }
+
+      e->m_mesh->GenerateLods(levels, reduction);
+
+      MeshRawPtrArray meshes;
+      e->m_mesh->GetAllMeshes(meshes);
+      for (Mesh* mesh : meshes)
+      {
+        String str = "Lods: " + std::to_string(mesh->m_clientSideIndices.size() / 3);
+        for (MeshPtr lod : mesh->m_lods)
+        {
+          str += " > " + std::to_string(lod->m_indexCount / 3);
+        }
+        g_app->GetConsole()->AddLog(str + " triangles");
+      }
+    }
+
+    void SetFrustumCullingExec(TagArgArray tagArgs)
+    {
+      BoolCheck(tagArgs, &g_app->m_frustumCulling);
+    }
+
+    void SetOcclusionCullingExec(TagArgArray tagArgs)
+    {
+      BoolCheck(tagArgs, &g_app->m_occlusionCulling);
+    }
+
+    void PrintOcclusionStatsExec(TagArgArray)
+    {
+      // Stats belong to the last viewport that is culled.
+      const OcclusionCuller::Stats& stats = g_app->m_occlusionCuller.m_stats;
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      cwnd->AddLog("Occluders: " + std::to_string(stats.occluders) + " (" + std::to_string(stats.occluderTriangles) + " triangles)");
+      cwnd->AddLog("Tested: " + std::to_string(stats.tested) + ", culled: " + std::to_string(stats.culled));
+      cwnd->AddLog("Rasterize: " + std::to_string(stats.rasterizeMs) + " ms");
+    }
+
+    void SetClusteredLightingExec(TagArgArray tagArgs)
+    {
+      BoolCheck(tagArgs, &g_app->m_clusteredLighting);
+    }
+
+    void SpawnPointLightsExec(TagArgArray tagArgs)
+    {
+      // Replaces the previously spawned lights. Scattered over a square area around the origin.
+      uint count = 64;
+      float radius = 4.0f;
+      float area = 40.0f;
+
+      TagArgCIt countTag = GetTag("n", tagArgs);
+      if (countTag != tagArgs.end() && !countTag->second.empty())
+      {
+        count = (uint)std::atoi(countTag->second.front().c_str());
+      }
+
+      TagArgCIt radiusTag = GetTag("r", tagArgs);
+      if (radiusTag != tagArgs.end() && !radiusTag->second.empty())
+      {
+        radius = (float)std::atof(radiusTag->second.front().c_str());
+      }
+
+      TagArgCIt areaTag = GetTag("a", tagArgs);
+      if (areaTag != tagArgs.end() && !areaTag->second.empty())
+      {
+        area = (float)std::atof(areaTag->second.front().c_str());
+      }
+
+      for (Light* light : g_app->m_pointLights)
+      {
+        SafeDel(light);
+      }
+      g_app->m_pointLights.clear();
+
+      std::mt19937 generator(count);
+      std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+      for (uint i = 0; i < count; i++)
+      {
+        Light* light = new Light();
+        light->m_radius = radius;
+        light->m_color = Vec3(unit(generator), unit(generator), unit(generator));
+        light->m_node->SetTranslation(Vec3((unit(generator) - 0.5f) * area, radius * 0.25f, (unit(generator) - 0.5f) * area));
+        g_app->m_pointLights.push_back(light);
+      }
+
+      g_app->GetConsole()->AddLog(std::to_string(count) + " point lights.");
+    }
+
+    void BuildTextureAtlasExec(TagArgArray tagArgs)
+    {
+      // Pages are held by the materials.
+      TextureAtlas atlas;
+
+      TagArgCIt sizeTag = GetTag("size", tagArgs);
+      if (sizeTag != tagArgs.end() && !sizeTag->second.empty())
+      {
+        atlas.m_pageSize = std::atoi(sizeTag->second.front().c_str());
+      }
+
+      TagArgCIt maxTag = GetTag("max", tagArgs);
+      if (maxTag != tagArgs.end() && !maxTag->second.empty())
+      {
+        atlas.m_maxTextureSize = std::atoi(maxTag->second.front().c_str());
+      }
+
+      atlas.Build(g_app->m_scene.GetEntities());
+
+      const TextureAtlas::Stats& stats = atlas.GetStats();
+      String str = "Texture atlas: " + std::to_string(stats.packed) + " textures packed into " + std::to_string(atlas.m_pages.size());
+      str += " pages, " + std::to_string((int)(stats.fill * 100.0f)) + "% filled. " + std::to_string(stats.materials) + " materials remapped, ";
+      str += std::to_string(stats.skipped) + " textures skipped.";
+      g_app->GetConsole()->AddLog(str);
+      g_app->GetConsole()->AddLog("Atlas is runtime only, it is not saved with the scene and must be rebuilt after loading.", ConsoleWindow::LogType::Warning);
+
+      if (g_app->m_scene.m_staticBatch.IsBuilt())
+      {
+        g_app->GetConsole()->AddLog("Static batch is built with the old materials, rebuild it.", ConsoleWindow::LogType::Warning);
+      }
+    }
+
+    void CaptureFrameExec([[maybe_unused]] TagArgArray tagArgs)
+    {
+#ifdef TK_GL_CAPTURE
+      String file = "frame.tkgl";
+      TagArgCIt fileTag = GetTag("file", tagArgs);
+      if (fileTag != tagArgs.end() && !fileTag->second.empty())
+      {
+        file = fileTag->second.front();
+      }
+
+      GlCapture::GetInstance()->RequestCapture(file);
+      g_app->GetConsole()->AddLog("Next frame will be captured to " + file + ". Replay with --replay " + file);
+#else
+      g_app->GetConsole()->AddLog("Gl capture is not compiled in, build with TK_GL_CAPTURE defined.", ConsoleWindow::LogType::Error);
+#endif
+    }
+
+    void PrintPoolStatsExec(TagArgArray)
+    {
+      std::vector<PoolStats> stats;
+      ObjectPool::GetAllStats(stats);
+
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      for (const PoolStats& pool : stats)
+      {
+        cwnd->AddLog(pool.name + ": " + std::to_string(pool.live) + " live, " + std::to_string(pool.peak) + " peak, " + std::to_string(pool.allocations) + " allocations, " + std::to_string(pool.used / 1024) + " / " + std::to_string(pool.reserved / 1024) + " KB used in " + std::to_string(pool.slabs) + " slabs");
+      }
+    }
+
+    void SetSingleThreadedJobsExec(TagArgArray tagArgs)
+    {
+      // Jobs run in a fixed order on the main thread, for debugging.
+      bool singleThreaded = GetJobSystem()->IsSingleThreaded();
+      BoolCheck(tagArgs, &singleThreaded);
+      GetJobSystem()->SetSingleThreaded(singleThreaded);
+      g_app->GetConsole()->AddLog("Jobs run on " + std::to_string(GetJobSystem()->GetThreadCount()) + " threads.");
+    }
+
+    void PrintPipelineStatsExec(TagArgArray)
+    {
+      const FramePipeline::Stats& stats = g_app->m_framePipeline.GetStats();
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      cwnd->AddLog("Drawables: " + std::to_string(stats.drawables) + " in " + std::to_string(stats.hierarchies) + " hierarchies, visible: " + std::to_string(stats.visible) + ", threads: " + std::to_string(stats.threads));
+      cwnd->AddLog("Animation: " + std::to_string(stats.animationMs) + " ms, gather: " + std::to_string(stats.gatherMs) + " ms");
+      cwnd->AddLog("Transforms: " + std::to_string(stats.transformMs) + " ms, bounds: " + std::to_string(stats.boundsMs) + " ms, visibility: " + std::to_string(stats.visibilityMs) + " ms");
+      cwnd->AddLog("Total: " + std::to_string(stats.totalMs) + " ms");
+    }
+
+    void SavePrefabExec(TagArgArray tagArgs)
+    {
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      Entity* root = g_app->m_scene.GetCurrentSelection();
+      if (root == nullptr)
+      {
+        cwnd->AddLog(g_noValidEntity, ConsoleWindow::LogType::Error);
+        return;
+      }
+
+      if (tagArgs.empty() || tagArgs.front().second.empty())
+      {
+        cwnd->AddLog("Prefab needs a name.", ConsoleWindow::LogType::Error);
+        return;
+      }
+      String name = tagArgs.front().second.front();
+
+      // The current selection and the entities below it.
+      EntityRawPtrArray entities = { root };
+      for (size_t i = 0; i < entities.size(); i++)
+      {
+        Entity* ntt = entities[i];
+        if (ntt->GetType() == EntityType::Entity_Prefab || g_app->m_scene.GetPrefabInstance(ntt->m_id) != nullptr)
+        {
+          cwnd->AddLog("Prefabs can't be nested.", ConsoleWindow::LogType::Error);
+          return;
+        }
+
+        for (Node* child : ntt->m_node->m_children)
+        {
+          if (child->m_entity != nullptr && g_app->m_scene.GetEntity(child->m_entity->m_id) != nullptr)
+          {
+            entities.push_back(child->m_entity);
+          }
+        }
+      }
+
+      String file = PrefabPath(name + ".prefab");
+      if (!Prefab::Save(file, entities))
+      {
+        cwnd->AddLog("Can't write " + file, ConsoleWindow::LogType::Error);
+        return;
+      }
+
+      // Instances of an earlier save keep the old prefab.
+      GetPrefabManager()->m_storage.erase(file);
+
+      // The entities are replaced by an instance at the same place.
+      PrefabInstance* instance = new PrefabInstance(GetPrefabManager()->Create(file));
+      instance->m_name = name;
+      if (Node* parent = root->m_node->m_parent)
+      {
+        parent->AddChild(instance->m_node);
+      }
+
+      ActionManager::GetInstance()->BeginActionGroup();
+      for (auto nttIt = entities.rbegin(); nttIt != entities.rend(); nttIt++)
+      {
+        ActionManager::GetInstance()->AddAction(new DeleteAction(*nttIt));
+      }
+      ActionManager::GetInstance()->AddAction(new CreateAction(instance));
+      ActionManager::GetInstance()->GroupLastActions((int)entities.size() + 1);
+
+      cwnd->AddLog("Prefab: " + file + " saved.");
+    }
+
+    void AddPrefabExec(TagArgArray tagArgs)
+    {
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      if (tagArgs.empty() || tagArgs.front().second.empty())
+      {
+        cwnd->AddLog("Prefab needs a name.", ConsoleWindow::LogType::Error);
+        return;
+      }
+
+      String name = tagArgs.front().second.front();
+      String file = PrefabPath(name + ".prefab");
+      if (!CheckFile(file))
+      {
+        cwnd->AddLog("Missing: " + file, ConsoleWindow::LogType::Error);
+        return;
+      }
+
+      PrefabInstance* instance = new PrefabInstance(GetPrefabManager()->Create(file));
+      instance->m_name = name;
+      ActionManager::GetInstance()->AddAction(new CreateAction(instance));
+    }
+
+    void BenchmarkAnimationExec(TagArgArray tagArgs)
+    {
+      AnimationBenchmark bench;
+      TagArgCIt bonesTag = GetTag("b", tagArgs);
+      if (bonesTag != tagArgs.end() && !bonesTag->second.empty())
+      {
+        bench.m_bones = (uint)std::atoi(bonesTag->second.front().c_str());
+      }
+
+      TagArgCIt samplesTag = GetTag("s", tagArgs);
+      if (samplesTag != tagArgs.end() && !samplesTag->second.empty())
+      {
+        bench.m_samples = (uint)std::atoi(samplesTag->second.front().c_str());
+      }
+
+      std::vector<AnimationBenchmark::Timing> timings = bench.Run();
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      for (const AnimationBenchmark::Timing& timing : timings)
+      {
+        cwnd->AddLog("Keys: " + std::to_string(timing.keys) + ", linear: " + std::to_string(timing.linearNs) + " ns, search: " + std::to_string(timing.searchNs) + " ns, cursor: " + std::to_string(timing.cursorNs) + " ns, compressed: " + std::to_string(timing.compressedNs) + " ns per bone");
+      }
+    }
+
+    void CompressAnimationsExec(TagArgArray tagArgs)
+    {
+      AnimationCompressionSettings settings;
+      TagArgCIt translationTag = GetTag("t", tagArgs);
+      if (translationTag != tagArgs.end() && !translationTag->second.empty())
+      {
+        settings.translationTolerance = (float)std::atof(translationTag->second.front().c_str());
+      }
+
+      TagArgCIt rotationTag = GetTag("r", tagArgs);
+      if (rotationTag != tagArgs.end() && !rotationTag->second.empty())
+      {
+        settings.rotationTolerance = (float)std::atof(rotationTag->second.front().c_str());
+      }
+
+      TagArgCIt scaleTag = GetTag("s", tagArgs);
+      if (scaleTag != tagArgs.end() && !scaleTag->second.empty())
+      {
+        settings.scaleTolerance = (float)std::atof(scaleTag->second.front().c_str());
+      }
+
+      // Animations in use are compressed in place, players sample the tracks from the next frame on.
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      for (auto& entry : GetAnimationManager()->m_storage)
+      {
+        Animation* anim = entry.second.get();
+        if (anim->IsCompressed())
+        {
+          continue;
+        }
+
+        AnimationCompressionReport report = anim->Compress(settings);
+        cwnd->AddLog(entry.first + ": " + report.ToString());
+      }
+    }
+
+    void CheckOcclusionCullingExec(TagArgArray)
+    {
+      OcclusionCullingCheck::Result result = OcclusionCullingCheck().Run();
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      for (const String& failure : result.failures)
+      {
+        cwnd->AddLog("Occlusion culling: " + failure, ConsoleWindow::LogType::Error);
+      }
+
+      cwnd->AddLog("Occlusion culling: " + std::to_string(result.checks - result.failures.size()) + " / " + std::to_string(result.checks) + " checks passed.");
+    }
+
+    void BenchmarkTransformsExec(TagArgArray tagArgs)
+    {
+      TransformBenchmark bench;
+      TagArgCIt nodesTag = GetTag("n", tagArgs);
+      if (nodesTag != tagArgs.end() && !nodesTag->second.empty())
+      {
+        bench.m_nodes = (uint)std::atoi(nodesTag->second.front().c_str());
+      }
+
+      TagArgCIt hierarchiesTag = GetTag("h", tagArgs);
+      if (hierarchiesTag != tagArgs.end() && !hierarchiesTag->second.empty())
+      {
+        bench.m_hierarchies = (uint)std::atoi(hierarchiesTag->second.front().c_str());
+      }
+
+      std::vector<TransformBenchmark::Timing> timings = bench.Run();
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      for (const TransformBenchmark::Timing& timing : timings)
+      {
+        cwnd->AddLog("Moved " + timing.moved + ", node walk: " + std::to_string(timing.walkMs) + " ms, transform system: " + std::to_string(timing.flatMs) + " ms");
+        if (timing.maxError > 1e-3f)
+        {
+          cwnd->AddLog("World matrices differ by up to " + std::to_string(timing.maxError), ConsoleWindow::LogType::Error);
+        }
+      }
+    }
+
+    void BenchmarkBatchMathExec(TagArgArray tagArgs)
+    {
+      BatchMathBenchmark bench;
+      TagArgCIt boxesTag = GetTag("n", tagArgs);
+      if (boxesTag != tagArgs.end() && !boxesTag->second.empty())
+      {
+        bench.m_boxes = (uint)std::atoi(boxesTag->second.front().c_str());
+      }
+
+      BatchMathBenchmark::Result result = bench.Run();
+      ConsoleWindow* cwnd = g_app->GetConsole();
+      cwnd->AddLog("TransformAABBs: " + std::to_string(result.transformNs) + " ns, scalar: " + std::to_string(result.transformScalarNs) + " ns per box");
+      cwnd->AddLog("FrustumBoxesVisible: " + std::to_string(result.cullNs) + " ns, scalar: " + std::to_string(result.cullScalarNs) + " ns per box, " + std::to_string(result.visible) + " visible");
+      if (result.maskMismatches > 0 || result.boxMismatches > 0)
+      {
+        cwnd->AddLog("Vectorized results differ from the scalar ones, masks: " + std::to_string(result.maskMismatches) + ", boxes: " + std::to_string(result.boxMismatches) + " (max relative error " + std::to_string(result.maxBoxError) + ")", ConsoleWindow::LogType::Error);
+      }
+      else
+      {
+        cwnd->AddLog("Vectorized results match the scalar ones.");
+      }
+    }
+
     // ImGui ripoff. Portable helpers.
     static int Stricmp(const char* str1, const char* str2) { int d; while ((d = toupper(*str2) - toupper(*str1)) == 0 && *str1) { str1++; str2++; } return d; }
     static int Strnicmp(const char* str1, const char* str2, int n) { int d = 0; while (n > 0 && (d = toupper(*str2) - toupper(*str1)) == 0 && *str1) { str1++; str2++; n--; } return d; }
@@ -481,6 +967,29 @@ namespace ToolKit
       CreateCommand(g_lookAt, LookAt);
       CreateCommand(g_applyTransformToMesh, ApplyTransformToMesh);
       CreateCommand(g_saveMesh, SaveMesh);
+      CreateCommand(g_showRenderStatsCmd, ShowRenderStatsExec);
+      CreateCommand(g_printRenderStatsCmd, PrintRenderStatsExec);
+      CreateCommand(g_setBatchingCmd, SetBatchingExec);
+      CreateCommand(g_buildStaticBatchCmd, BuildStaticBatchExec);
+      CreateCommand(g_clearStaticBatchCmd, ClearStaticBatchExec);
+      CreateCommand(g_generateLodsCmd, GenerateLodsExec);
+      CreateCommand(g_setFrustumCullingCmd, SetFrustumCullingExec);
+      CreateCommand(g_setOcclusionCullingCmd, SetOcclusionCullingExec);
+      CreateCommand(g_printOcclusionStatsCmd, PrintOcclusionStatsExec);
+      CreateCommand(g_setClusteredLightingCmd, SetClusteredLightingExec);
+      CreateCommand(g_spawnPointLightsCmd, SpawnPointLightsExec);
+      CreateCommand(g_buildTextureAtlasCmd, BuildTextureAtlasExec);
+      CreateCommand(g_captureFrameCmd, CaptureFrameExec);
+      CreateCommand(g_printPoolStatsCmd, PrintPoolStatsExec);
+      CreateCommand(g_setSingleThreadedJobsCmd, SetSingleThreadedJobsExec);
+      CreateCommand(g_printPipelineStatsCmd, PrintPipelineStatsExec);
+      CreateCommand(g_savePrefabCmd, SavePrefabExec);
+      CreateCommand(g_addPrefabCmd, AddPrefabExec);
+      CreateCommand(g_benchmarkAnimationCmd, BenchmarkAnimationExec);
+      CreateCommand(g_compressAnimationsCmd, CompressAnimationsExec);
+      CreateCommand(g_checkOcclusionCullingCmd, CheckOcclusionCullingExec);
+      CreateCommand(g_benchmarkTransformsCmd, BenchmarkTransformsExec);
+      CreateCommand(g_benchmarkBatchMathCmd, BenchmarkBatchMathExec);
     }
 
     ConsoleWindow::~ConsoleWindow()
@@ -736,7 +1245,6 @@ namespace ToolKit
       Split(args, "--", splits);
 
       // Preserve all spaces in text.
-      const char spaceSub = (char)26;
       for (String& arg : splits)
       {
         StringArray values;
@@ -864,7 +1372,7 @@ namespace ToolKit
         {
           if (m_historyPos != -1)
           {
-            if (++m_historyPos >= m_history.size())
+            if (++m_historyPos >= (int)m_history.size())
             {
               m_historyPos = -1;
             }
@@ -57,6 +57,75 @@ namespace ToolKit
     const String g_saveMesh("SaveMesh");
     void SaveMesh(TagArgArray tagArgs);
 
+    const String g_showRenderStatsCmd("ShowRenderStats");
+    void ShowRenderStatsExec(TagArgArray tagArgs);
+
+    const String g_printRenderStatsCmd("PrintRenderStats");
+    void PrintRenderStatsExec(TagArgArray tagArgs);
+
+    const String g_setBatchingCmd("SetBatching");
+    void SetBatchingExec(TagArgArray tagArgs);
+
+    const String g_buildStaticBatchCmd("BuildStaticBatch");
+    void BuildStaticBatchExec(TagArgArray tagArgs);
+
+    const String g_clearStaticBatchCmd("ClearStaticBatch");
+    void ClearStaticBatchExec(TagArgArray tagArgs);
+
+    const String g_generateLodsCmd("GenerateLods");
+    void GenerateLodsExec(TagArgArray tagArgs);
+
+    const String g_setFrustumCullingCmd("SetFrustumCulling");
+    void SetFrustumCullingExec(TagArgArray tagArgs);
+
+    const String g_setOcclusionCullingCmd("SetOcclusionCulling");
+    void SetOcclusionCullingExec(TagArgArray tagArgs);
+
+    const String g_printOcclusionStatsCmd("PrintOcclusionStats");
+    void PrintOcclusionStatsExec(TagArgArray tagArgs);
+
+    const String g_setClusteredLightingCmd("SetClusteredLighting");
+    void SetClusteredLightingExec(TagArgArray tagArgs);
+
+    const String g_spawnPointLightsCmd("SpawnPointLights");
+    void SpawnPointLightsExec(TagArgArray tagArgs);
+
+    const String g_buildTextureAtlasCmd("BuildTextureAtlas");
+    void BuildTextureAtlasExec(TagArgArray tagArgs);
+
+    const String g_captureFrameCmd("CaptureFrame");
+    void CaptureFrameExec(TagArgArray tagArgs);
+
+    const String g_printPoolStatsCmd("PrintPoolStats");
+    void PrintPoolStatsExec(TagArgArray tagArgs);
+
+    const String g_setSingleThreadedJobsCmd("SetSingleThreadedJobs");
+    void SetSingleThreadedJobsExec(TagArgArray tagArgs);
+
+    const String g_printPipelineStatsCmd("PrintPipelineStats");
+    void PrintPipelineStatsExec(TagArgArray tagArgs);
+
+    const String g_savePrefabCmd("SavePrefab");
+    void SavePrefabExec(TagArgArray tagArgs);
+
+    const String g_addPrefabCmd("AddPrefab");
+    void AddPrefabExec(TagArgArray tagArgs);
+
+    const String g_benchmarkAnimationCmd("BenchmarkAnimation");
+    void BenchmarkAnimationExec(TagArgArray tagArgs);
+
+    const String g_compressAnimationsCmd("CompressAnimations");
+    void CompressAnimationsExec(TagArgArray tagArgs);
+
+    const String g_checkOcclusionCullingCmd("CheckOcclusionCulling");
+    void CheckOcclusionCullingExec(TagArgArray tagArgs);
+
+    const String g_benchmarkTransformsCmd("BenchmarkTransforms");
+    void BenchmarkTransformsExec(TagArgArray tagArgs);
+
+    const String g_benchmarkBatchMathCmd("BenchmarkBatchMath");
+    void BenchmarkBatchMathExec(TagArgArray tagArgs);
+
     // Command errors
     const String g_noValidEntity("No valid entity");
 
@@ -276,11 +276,20 @@ namespace ToolKit
         cam.m_node->SetTranslation(eye);
         cam.LookAt(geoCenter);
 
-        RenderTarget* thumb = new RenderTarget((uint)m_thumbnailSize.x, (uint)m_thumbnailSize.y);
+        // Render with a pooled depth target, keep only a color copy.
+        uint width = (uint)m_thumbnailSize.x;
+        uint height = (uint)m_thumbnailSize.y;
+        RenderTarget* target = g_app->m_targetPool.Acquire(width, height);
+        RenderTarget* thumb = new RenderTarget(width, height, false);
         thumb->Init();
-        g_app->m_renderer->SwapRenderTarget(&thumb);
+
+        RenderTarget* current = target;
+        g_app->m_renderer->SwapRenderTarget(&current);
         g_app->m_renderer->Render(&dw, &cam, g_app->m_sceneLights);
-        g_app->m_renderer->SwapRenderTarget(&thumb, false);
+        g_app->m_renderer->CopyRenderTarget(target, thumb);
+        g_app->m_renderer->SwapRenderTarget(&current, false);
+
+        g_app->m_targetPool.Release(target);
         entry.m_thumbNail = RenderTargetPtr(thumb);
       }
     }
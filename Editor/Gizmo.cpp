@@ -172,6 +172,7 @@ namespace ToolKit
       }
 
       MeshPtr m = m_mesh->m_subMeshes.back();
+      m->m_dynamic = true; // Handles are regenerated every frame.
       for (Vertex& v : m->m_clientSideVertices)
       {
         v.pos.y += params.toeTip.y;
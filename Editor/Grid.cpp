@@ -61,6 +61,7 @@ namespace ToolKit
         }
 
         mesh->m_material = m_material;
+        mesh->m_dynamic = true; // Resized every frame.
         if (i == 0)
         {
           m_mesh = mesh;
@@ -95,6 +96,7 @@ namespace ToolKit
           mesh->m_clientSideVertices[j].pos = (mesh->m_clientSideVertices[j].pos * ls).xzy;
         }
         mesh->m_material = solidMat;
+        mesh->m_dynamic = true;
         m_mesh->m_subMeshes.push_back(mesh);
       }
 
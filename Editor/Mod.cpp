@@ -757,10 +757,29 @@ namespace ToolKit
       return StateType::Null;
     }
 
+    // Parts of a prefab instance are deleted and duplicated with their instance.
+    static void GetSelectedOwners(EntityRawPtrArray& entities)
+    {
+      EntityRawPtrArray selecteds;
+      g_app->m_scene.GetSelectedEntities(selecteds);
+      for (Entity* ntt : selecteds)
+      {
+        if (PrefabInstance* instance = g_app->m_scene.GetPrefabInstance(ntt->m_id))
+        {
+          ntt = instance;
+        }
+
+        if (!IsInArray(entities, ntt))
+        {
+          entities.push_back(ntt);
+        }
+      }
+    }
+
     void StateDeletePick::Update(float deltaTime)
     {
       EntityRawPtrArray deleteList;
-      g_app->m_scene.GetSelectedEntities(deleteList);
+      GetSelectedOwners(deleteList);
       if (!deleteList.empty())
       {
         if (deleteList.size() > 1)
@@ -784,7 +803,7 @@ namespace ToolKit
     void StateDuplicate::TransitionIn(State* prevState)
     {
       EntityRawPtrArray selecteds;
-      g_app->m_scene.GetSelectedEntities(selecteds);
+      GetSelectedOwners(selecteds);
       if (!selecteds.empty())
       {
         g_app->m_scene.ClearSelection();
@@ -448,5 +448,61 @@ namespace ToolKit
 
     }
 
+    // OverlayRenderStats
+    //////////////////////////////////////////////////////////////////////////
+
+    OverlayRenderStats::OverlayRenderStats(Viewport* owner)
+      : OverlayUI(owner)
+    {
+    }
+
+    void OverlayRenderStats::Show()
+    {
+      assert(m_owner);
+      if (m_owner == nullptr)
+      {
+        return;
+      }
+
+      Renderer* renderer = g_app->m_renderer;
+      const RenderStats& stats = renderer->GetFrameStats();
+
+      ImVec2 overlaySize(260, 0);
+      const float padding = 5.0f;
+      ImVec2 window_pos = ImVec2(m_owner->m_wndPos.x + m_owner->m_width - overlaySize.x - padding, m_owner->m_wndPos.y + padding + 30.0f);
+      ImGui::SetNextWindowPos(window_pos);
+      ImGui::SetNextWindowBgAlpha(0.65f);
+      if (ImGui::BeginChildFrame(ImGui::GetID("RenderStats"), overlaySize, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
+      {
+        SetOwnerState();
+
+        ImGui::Text("Draw calls: %u", stats.drawCalls);
+        ImGui::Text("Triangles: %u", stats.triangles);
+        ImGui::Text("Program binds: %u", stats.programBinds);
+        ImGui::Text("Texture binds: %u", stats.textureBinds);
+        ImGui::Text("Buffer uploads: %u (%u bytes)", stats.bufferUploads, stats.uploadedBytes);
+        ImGui::Text("Batched meshes: %u, draws saved: %u", stats.batchedMeshes, stats.drawsSaved);
+        ImGui::Text("Triangles saved by lods: %u", stats.trianglesSaved);
+
+        ImVec2 graphSize(overlaySize.x - 2.0f * padding, 40.0f);
+        ImGui::PlotLines("##DrawCalls", renderer->m_drawCallHistory, (int)Renderer::m_statHistorySize, (int)renderer->m_statHistoryIndex, "Draw calls", 0.0f, FLT_MAX, graphSize);
+
+        if (renderer->IsGpuTimerSupported())
+        {
+          for (const PassTiming& timing : renderer->GetPassTimings())
+          {
+            ImGui::Text("%s: %.3f ms", timing.name.c_str(), timing.gpuTimeMs);
+          }
+          ImGui::PlotLines("##GpuTime", renderer->m_gpuTimeHistory, (int)Renderer::m_statHistorySize, (int)renderer->m_statHistoryIndex, "Gpu ms", 0.0f, FLT_MAX, graphSize);
+        }
+        else
+        {
+          ImGui::Text("Gpu timers are not supported.");
+        }
+
+        ImGui::EndChildFrame();
+      }
+    }
+
   }
 }
@@ -36,5 +36,12 @@ namespace ToolKit
       virtual void Show() override;
     };
 
+    class OverlayRenderStats : public OverlayUI
+    {
+    public:
+      OverlayRenderStats(Viewport* owner);
+      virtual void Show() override;
+    };
+
   }
 }
@@ -32,7 +32,16 @@ namespace ToolKit
         if (ImGui::CollapsingHeader("Basics"))
         {
           ImGui::InputText("Name", &curr->m_name);
-          ImGui::InputText("Tag", &curr->m_tag);
+          String tag = curr->m_tag;
+          if (ImGui::InputText("Tag", &tag))
+          {
+            g_app->m_scene.SetTag(curr, tag);
+          }
+          ImGui::Checkbox("Static", &curr->m_static);
+          if (Drawable* drawable = dynamic_cast<Drawable*> (curr))
+          {
+            ImGui::Checkbox("Occluder", &drawable->m_occluder);
+          }
         }
 
         if (ImGui::CollapsingHeader("Transforms"))
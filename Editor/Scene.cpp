@@ -10,10 +10,21 @@ namespace ToolKit
     {
       m_name = "NewScene";
       m_newScene = true;
+
+      m_bvhNodeChanges = std::make_shared<NodeChangeList>();
+      m_geometryHook = Mesh::AddGeometryHook
+      (
+        [this](Mesh* mesh) -> void
+        {
+          std::lock_guard<std::mutex> lock(m_bvhMeshLock);
+          m_bvhMeshChanges.insert(mesh);
+        }
+      );
     }
 
     Scene::~Scene()
     {
+      Mesh::RemoveGeometryHook(m_geometryHook);
       Destroy();
     }
 
@@ -22,17 +33,12 @@ namespace ToolKit
       PickData pd;
       pd.pickPos = ray.position + ray.direction * 5.0f;
 
-      float closestPickedDistance = FLT_MAX;
-      for (Entity* e : m_entitites)
+      UpdateBVH();
+      auto HitFn = [&ray, &ignoreList](Entity* e, float& dist) -> bool
       {
-        if (!e->IsDrawable())
-        {
-          continue;
-        }
-
         if (std::find(ignoreList.begin(), ignoreList.end(), e->m_id) != ignoreList.end())
         {
-          continue;
+          return false;
         }
 
         Ray rayInObjectSpace = ray;
@@ -41,31 +47,32 @@ namespace ToolKit
         rayInObjectSpace.position = its * Vec4(ray.position, 1.0f);
         rayInObjectSpace.direction = its * Vec4(ray.direction, 0.0f);
 
-        float dist = 0;
         Drawable* dw = static_cast<Drawable*>(e);
-        if (RayBoxIntersection(rayInObjectSpace, dw->GetAABB(), dist))
+        if (!RayBoxIntersection(rayInObjectSpace, dw->GetAABB(), dist))
         {
-          bool hit = true;
-          if (dw->m_mesh->m_clientSideVertices.size() == dw->m_mesh->m_vertexCount)
-          {
-            // Per polygon check if data exist.
-            float meshDist = 0.0f;
-            hit = RayMeshIntersection(dw->m_mesh.get(), rayInObjectSpace, meshDist);
-            if (hit)
-            {
-              dist = meshDist;
-            }
-          }
-          if (hit)
+          return false;
+        }
+
+        if (dw->m_mesh->GetTriangleBVH() != nullptr)
+        {
+          // Per polygon check if data exist.
+          float meshDist = 0.0f;
+          if (!RayMeshIntersection(dw->m_mesh.get(), rayInObjectSpace, meshDist))
           {
-            if (dist < closestPickedDistance && dist > 0.0f)
-            {
-              pd.entity = e;
-              pd.pickPos = ray.position + ray.direction * dist;
-              closestPickedDistance = dist;
-            }
+            return false;
           }
+          dist = meshDist;
         }
+
+        return true;
+      };
+
+      // Distances are the same in object space, the direction is not normalized.
+      float dist = 0.0f;
+      if (Entity* e = m_bvh.RayCast(ray, HitFn, dist))
+      {
+        pd.entity = e;
+        pd.pickPos = ray.position + ray.direction * dist;
       }
 
       return pd;
@@ -73,49 +80,52 @@ namespace ToolKit
 
     void Scene::PickObject(const Frustum& frustum, std::vector<PickData>& pickedObjects, const EntityIdArray& ignoreList, bool pickPartiallyInside) const
     {
-      for (Entity* e : m_entitites)
+      UpdateBVH();
+      size_t first = pickedObjects.size();
+      auto PickFn = [&pickedObjects, &ignoreList, pickPartiallyInside](Entity* e, IntersectResult res) -> bool
       {
-        if (!e->IsDrawable())
-        {
-          continue;
-        }
-
         if (std::find(ignoreList.begin(), ignoreList.end(), e->m_id) != ignoreList.end())
         {
-          continue;
+          return true;
         }
 
-        BoundingBox bb = e->GetAABB(true);
-        IntersectResult res = FrustumBoxIntersection(frustum, bb);
-        if (res != IntersectResult::Outside)
+        if (res == IntersectResult::Inside || pickPartiallyInside)
         {
+          BoundingBox bb = e->GetAABB(true);
           PickData pd;
           pd.pickPos = (bb.max + bb.min) * 0.5f;
           pd.entity = e;
+          pickedObjects.push_back(pd);
+        }
 
-          if (res == IntersectResult::Inside)
-          {
-            pickedObjects.push_back(pd);
-          }
-          else if (pickPartiallyInside)
-          {
-            pickedObjects.push_back(pd);
-          }
+        return true;
+      };
+
+      m_bvh.FrustumQuery(frustum, PickFn);
+
+      std::sort
+      (
+        pickedObjects.begin() + first,
+        pickedObjects.end(),
+        [this](const PickData& a, const PickData& b) -> bool
+        {
+          return m_bvhEntries[a.entity].order < m_bvhEntries[b.entity].order;
         }
-      }
+      );
     }
 
     bool Scene::IsSelected(EntityId id) const
     {
-      return std::find(m_selectedEntities.begin(), m_selectedEntities.end(), id) != m_selectedEntities.end();
+      return m_selectionIndex.find(id) != m_selectionIndex.end();
     }
 
     void Scene::RemoveFromSelection(EntityId id)
     {
-      auto nttIt = std::find(m_selectedEntities.begin(), m_selectedEntities.end(), id);
-      if (nttIt != m_selectedEntities.end())
+      auto nttIt = m_selectionIndex.find(id);
+      if (nttIt != m_selectionIndex.end())
       {
-        m_selectedEntities.erase(nttIt);
+        m_selectedEntities.erase(nttIt->second);
+        m_selectionIndex.erase(nttIt);
       }
     }
 
@@ -124,9 +134,9 @@ namespace ToolKit
       assert(!IsSelected(id));
       if (!additive)
       {
-        m_selectedEntities.clear();
+        ClearSelection();
       }
-      m_selectedEntities.push_back(id);
+      m_selectionIndex[id] = m_selectedEntities.insert(m_selectedEntities.end(), id);
     }
 
     void Scene::AddToSelection(const EntityIdArray& entities, bool additive)
@@ -207,6 +217,7 @@ namespace ToolKit
     void Scene::ClearSelection()
     {
       m_selectedEntities.clear();
+      m_selectionIndex.clear();
     }
 
     bool Scene::IsCurrentSelection(EntityId id) const
@@ -221,16 +232,21 @@ namespace ToolKit
 
     void Scene::MakeCurrentSelection(EntityId id, bool ifExist)
     {
-      EntityIdArray::iterator itr = std::find(m_selectedEntities.begin(), m_selectedEntities.end(), id);
-      if (itr != m_selectedEntities.end())
+      auto itr = m_selectionIndex.find(id);
+      if (itr != m_selectionIndex.end())
       {
-        std::iter_swap(itr, m_selectedEntities.end() - 1);
+        // Swaps places with the current selection.
+        std::list<EntityId>::iterator last = std::prev(m_selectedEntities.end());
+        std::list<EntityId>::iterator curr = itr->second;
+        std::iter_swap(curr, last);
+        m_selectionIndex[*curr] = curr;
+        m_selectionIndex[*last] = last;
       }
       else
       {
         if (!ifExist)
         {
-          m_selectedEntities.push_back(id);
+          AddToSelection(id, true);
         }
       }
     }
@@ -252,40 +268,120 @@ namespace ToolKit
 
     Entity* Scene::GetEntity(EntityId id) const
     {
-      for (Entity* e : m_entitites)
+      auto ntt = m_entityIndex.find(id);
+      if (ntt == m_entityIndex.end())
       {
-        if (e->m_id == id)
-        {
-          return e;
-        }
+        return nullptr;
       }
 
-      return nullptr;
+      return ntt->second;
     }
 
     void Scene::AddEntity(Entity* entity)
     {
       assert(GetEntity(entity->m_id) == nullptr && "Entity is already in the scene.");
       m_entitites.push_back(entity);
+      AddToIndex(entity);
     }
 
     Entity* Scene::RemoveEntity(EntityId id)
     {
-      Entity* removed = nullptr;
-      for (int i = (int)m_entitites.size() - 1; i >= 0; i--)
+      Entity* removed = GetEntity(id);
+      if (removed == nullptr)
+      {
+        return nullptr;
+      }
+
+      if (GetPrefabInstance(id) != nullptr)
       {
-        if (m_entitites[i]->m_id == id)
+        assert(false && "Prefab parts are removed with their instance.");
+        return nullptr;
+      }
+
+      RemoveFromIndex(removed);
+      if (removed->GetType() == EntityType::Entity_Prefab)
+      {
+        PrefabInstance* instance = static_cast<PrefabInstance*> (removed);
+        auto pendingIt = std::find(m_pendingPrefabs.begin(), m_pendingPrefabs.end(), instance);
+        if (pendingIt != m_pendingPrefabs.end())
         {
-          removed = m_entitites[i];
-          m_entitites.erase(m_entitites.begin() + i);
-          RemoveFromSelection(id);
-          break;
+          m_pendingPrefabs.erase(pendingIt);
+        }
+
+        for (Entity* part : instance->GetParts())
+        {
+          m_prefabParts.erase(part->m_id);
+          RemoveFromIndex(part);
         }
       }
 
       return removed;
     }
 
+    PrefabInstance* Scene::GetPrefabInstance(EntityId part) const
+    {
+      auto instance = m_prefabParts.find(part);
+      if (instance == m_prefabParts.end())
+      {
+        return nullptr;
+      }
+
+      return instance->second;
+    }
+
+    void Scene::ExpandPrefabs()
+    {
+      std::vector<PrefabInstance*> pending;
+      pending.swap(m_pendingPrefabs);
+      for (PrefabInstance* instance : pending)
+      {
+        instance->Expand();
+        AddPrefabParts(instance);
+      }
+    }
+
+    void Scene::RemoveFromIndex(Entity* removed)
+    {
+      EntityId id = removed->m_id;
+
+      // Recently added entities are removed most, search from the back.
+      auto nttIt = std::find(m_entitites.rbegin(), m_entitites.rend(), removed);
+      assert(nttIt != m_entitites.rend());
+      m_entitites.erase(std::next(nttIt).base());
+      m_entityIndex.erase(id);
+
+      auto range = m_tagIndex.equal_range(removed->m_tag);
+      for (auto tagIt = range.first; tagIt != range.second; tagIt++)
+      {
+        if (tagIt->second.entity == removed)
+        {
+          m_tagIndex.erase(tagIt);
+          break;
+        }
+      }
+
+      auto bvhIt = m_bvhEntries.find(removed);
+      if (bvhIt != m_bvhEntries.end())
+      {
+        if (bvhIt->second.proxy != BVH::InvalidProxy)
+        {
+          m_bvh.Remove(bvhIt->second.proxy);
+          RemoveMeshUser(bvhIt->second.mesh, removed);
+        }
+        else
+        {
+          m_bvhPending.erase(std::find(m_bvhPending.begin(), m_bvhPending.end(), removed));
+        }
+        m_bvhEntries.erase(bvhIt);
+      }
+
+      RemoveFromSelection(id);
+      if (m_staticBatch.Contains(id))
+      {
+        ClearStaticBatch();
+      }
+    }
+
     const EntityRawPtrArray& Scene::GetEntities() const
     {
       return m_entitites;
@@ -304,28 +400,94 @@ namespace ToolKit
 
     void Scene::GetSelectedEntities(EntityIdArray& entities) const
     {
-      entities = m_selectedEntities;
+      entities.assign(m_selectedEntities.begin(), m_selectedEntities.end());
     }
 
     void Scene::Destroy()
     {
+      // Parts are deleted by their instance.
       for (Entity* ntt : m_entitites)
       {
-        SafeDel(ntt);
+        if (m_prefabParts.find(ntt->m_id) == m_prefabParts.end())
+        {
+          SafeDel(ntt);
+        }
       }
       m_entitites.clear();
-      m_selectedEntities.clear();
+      m_prefabParts.clear();
+      m_pendingPrefabs.clear();
+      m_entityIndex.clear();
+      m_tagIndex.clear();
+      m_bvh.Clear();
+      m_bvhEntries.clear();
+      m_bvhPending.clear();
+      m_bvhMeshUsers.clear();
+      ClearSelection();
+      m_staticBatch.Clear();
+
+      if (m_arena != nullptr)
+      {
+        m_arena->Release();
+        m_arena = nullptr;
+      }
+    }
+
+    void Scene::BuildStaticBatch()
+    {
+      m_staticBatch.Build(m_entitites);
+    }
+
+    void Scene::ClearStaticBatch()
+    {
+      m_staticBatch.Clear();
+    }
+
+    void Scene::ValidateStaticBatch()
+    {
+      if (!m_staticBatch.IsBuilt())
+      {
+        return;
+      }
+
+      // Every merged entity is checked, moving a parent moves the children without selecting them. World transforms are
+      // cached, so this is a lookup and a compare per entity.
+      for (const auto& source : m_staticBatch.GetSources())
+      {
+        Entity* ntt = GetEntity(source.first);
+        if (ntt == nullptr || !ntt->m_static || m_staticBatch.IsModified(ntt))
+        {
+          ClearStaticBatch();
+          return;
+        }
+      }
     }
 
     EntityRawPtrArray Scene::GetByTag(const String& tag)
     {
-      EntityRawPtrArray arrayByTag;
-      for (Entity* e : m_entitites)
+      auto range = m_tagIndex.equal_range(tag);
+      std::vector<TagEntry> entries;
+      for (auto tagIt = range.first; tagIt != range.second; tagIt++)
       {
-        if (e->m_tag == tag)
+        assert(tagIt->second.entity->m_tag == tag && "Tag changed without SetTag.");
+        entries.push_back(tagIt->second);
+      }
+
+      // Entities are appended to the list as they are added, so insertion order is the list order.
+      std::sort
+      (
+        entries.begin(),
+        entries.end(),
+        [](const TagEntry& a, const TagEntry& b) -> bool
         {
-          arrayByTag.push_back(e);
+          return a.order < b.order;
         }
+      );
+
+      EntityRawPtrArray arrayByTag;
+      arrayByTag.reserve(entries.size());
+      for (const TagEntry& entry : entries)
+      {
+        arrayByTag.push_back(entry.entity);
       }
 
       return arrayByTag;
@@ -336,6 +498,172 @@ namespace ToolKit
       AddToSelection(GetByTag(tag), false);
     }
 
+    void Scene::SetTag(Entity* entity, const String& tag)
+    {
+      if (entity->m_tag == tag)
+      {
+        return;
+      }
+
+      auto range = m_tagIndex.equal_range(entity->m_tag);
+      for (auto tagIt = range.first; tagIt != range.second; tagIt++)
+      {
+        if (tagIt->second.entity == entity)
+        {
+          TagEntry entry = tagIt->second;
+          m_tagIndex.erase(tagIt);
+          m_tagIndex.insert({ tag, entry });
+          break;
+        }
+      }
+
+      entity->m_tag = tag;
+    }
+
+    void Scene::AddToIndex(Entity* entity)
+    {
+      uint order = m_nextOrder++;
+      m_entityIndex[entity->m_id] = entity;
+      m_tagIndex.insert({ entity->m_tag, { entity, order } });
+
+      if (entity->IsDrawable())
+      {
+        BVHEntry& entry = m_bvhEntries[entity];
+        entry.order = order;
+        m_bvhPending.push_back(entity);
+        entity->m_node->GetRoot()->Watch(m_bvhNodeChanges);
+      }
+
+      if (entity->GetType() == EntityType::Entity_Prefab)
+      {
+        AddPrefabParts(static_cast<PrefabInstance*> (entity));
+      }
+    }
+
+    void Scene::AddPrefabParts(PrefabInstance* instance)
+    {
+      // Instances are expanded on the next frame.
+      if (!instance->IsExpanded())
+      {
+        m_pendingPrefabs.push_back(instance);
+        return;
+      }
+
+      for (Entity* part : instance->GetParts())
+      {
+        m_prefabParts[part->m_id] = instance;
+        m_entitites.push_back(part);
+        AddToIndex(part);
+      }
+    }
+
+    void Scene::UpdateBVH() const
+    {
+      for (int i = (int)m_bvhPending.size() - 1; i >= 0; i--)
+      {
+        Entity* ntt = m_bvhPending[i];
+        BoundingBox localBox = ntt->GetAABB();
+        if (localBox.min.x > localBox.max.x)
+        {
+          continue;
+        }
+
+        BVHEntry& entry = m_bvhEntries[ntt];
+        entry.worldVersion = ntt->m_node->GetWorldVersion();
+        entry.localBox = localBox;
+        entry.mesh = static_cast<Drawable*> (ntt)->m_mesh.get();
+        entry.proxy = m_bvh.Insert(ntt, ntt->GetAABB(true));
+        m_bvhMeshUsers.insert({ entry.mesh, ntt });
+        m_bvhPending.erase(m_bvhPending.begin() + i);
+      }
+
+      // Changes made after the epochs are read are in the lists, or seen by the next update.
+      if (m_bvhEpoch != Node::GetEpoch() || m_bvhGeometryEpoch != Mesh::GetGeometryEpoch())
+      {
+        m_bvhEpoch = Node::GetEpoch();
+        m_bvhGeometryEpoch = Mesh::GetGeometryEpoch();
+
+        // A moved node moves the drawables in its subtree.
+        EntityRawPtrArray dirty;
+        std::vector<Node*> nodes;
+        m_bvhNodeChanges->Take(nodes);
+        while (!nodes.empty())
+        {
+          Node* node = nodes.back();
+          nodes.pop_back();
+          if (node->m_entity != nullptr)
+          {
+            dirty.push_back(node->m_entity);
+          }
+          nodes.insert(nodes.end(), node->m_children.begin(), node->m_children.end());
+        }
+
+        // Meshes can be changed in place, by applying a transform to their vertices for example.
+        std::unordered_set<Mesh*> meshes;
+        {
+          std::lock_guard<std::mutex> lock(m_bvhMeshLock);
+          meshes.swap(m_bvhMeshChanges);
+        }
+
+        for (Mesh* mesh : meshes)
+        {
+          auto users = m_bvhMeshUsers.equal_range(mesh);
+          for (auto user = users.first; user != users.second; user++)
+          {
+            dirty.push_back(user->second);
+          }
+        }
+
+        // Drawables reached twice are up to date on the second visit.
+        for (Entity* ntt : dirty)
+        {
+          auto nttEntry = m_bvhEntries.find(ntt);
+          if (nttEntry == m_bvhEntries.end() || nttEntry->second.proxy == BVH::InvalidProxy)
+          {
+            continue;
+          }
+
+          BVHEntry& entry = nttEntry->second;
+          uint worldVersion = ntt->m_node->GetWorldVersion();
+          BoundingBox localBox = ntt->GetAABB();
+          if
+          (
+            worldVersion != entry.worldVersion ||
+            localBox.min != entry.localBox.min ||
+            localBox.max != entry.localBox.max
+          )
+          {
+            entry.worldVersion = worldVersion;
+            entry.localBox = localBox;
+            m_bvh.Refit(entry.proxy, ntt->GetAABB(true));
+          }
+
+          Mesh* mesh = static_cast<Drawable*> (ntt)->m_mesh.get();
+          if (mesh != entry.mesh)
+          {
+            RemoveMeshUser(entry.mesh, ntt);
+            entry.mesh = mesh;
+            m_bvhMeshUsers.insert({ mesh, ntt });
+          }
+        }
+      }
+
+      m_bvh.RebuildIfDegraded();
+    }
+
+    void Scene::RemoveMeshUser(Mesh* mesh, Entity* ntt) const
+    {
+      auto users = m_bvhMeshUsers.equal_range(mesh);
+      for (auto user = users.first; user != users.second; user++)
+      {
+        if (user->second == ntt)
+        {
+          m_bvhMeshUsers.erase(user);
+          break;
+        }
+      }
+    }
+
     void Scene::Serialize(XmlDocument* doc, XmlNode* parent) const
     {
       std::ofstream file;
@@ -355,9 +683,13 @@ namespace ToolKit
           doc->append_node(scene);
         }
 
+        // Parts are saved as the overrides of their instance.
         for (Entity* ntt : m_entitites)
         {
-          ntt->Serialize(doc, scene);
+          if (m_prefabParts.find(ntt->m_id) == m_prefabParts.end())
+          {
+            ntt->Serialize(doc, scene);
+          }
         }
 
         std::string xml;
@@ -381,54 +713,26 @@ namespace ToolKit
         root = doc->first_node(XmlSceneElement.c_str());
       }
 
+      if (m_arena == nullptr)
+      {
+        m_arena = PoolArena::Create("Scene");
+      }
+      PoolArena::Scope arenaScope(m_arena);
+
       XmlNode* node = nullptr;
       for (node = root->first_node(XmlEntityElement.c_str()); node; node = node->next_sibling(XmlEntityElement.c_str()))
       {
         XmlAttribute* typeAttr = node->first_attribute(XmlEntityTypeAttr.c_str());
         EntityType et = (EntityType)std::atoi(typeAttr->value());
-        Entity* ntt = nullptr;
-        switch (et)
+        Entity* ntt = Entity::CreateByType(et);
+        if (ntt == nullptr)
         {
-        case EntityType::Entity_Base:
-        case EntityType::Entity_AudioSource:
-          continue;
-        case EntityType::Entity_Billboard:
-          break;
-        case EntityType::Entity_Cube:
-          ntt = new Cube(false);
-          break;
-        case EntityType::Entity_Quad:
-          ntt = new Quad(false);
-          break;
-        case EntityType::Entity_Sphere:
-          ntt = new Sphere(false);
-          break;
-        case EntityType::Etity_Arrow:
-          ntt = new Arrow2d(false);
-          break;
-        case EntityType::Entity_LineBatch:
-          break;
-        case EntityType::Entity_Cone:
-          ntt = new Cone(false);
-          break;
-        case EntityType::Entity_Drawable:
-          ntt = new Drawable();
-          break;
-        case EntityType::Entity_SpriteAnim:
-        case EntityType::Entity_Surface:
-          continue;
-        case EntityType::Entity_Light:
-          break;
-        case EntityType::Entity_Camera:
-          break;
-        case EntityType::Entity_Directional:
-          continue;
-        default:
           continue;
         }
 
         ntt->DeSerialize(doc, node);
         m_entitites.push_back(ntt);
+        AddToIndex(ntt);
       }
 
       // Update parent - child relation for entities.
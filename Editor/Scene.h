@@ -1,6 +1,9 @@
 #pragma once
 
 #include "ToolKit.h"
+#include <list>
+#include <mutex>
+#include <unordered_set>
 
 namespace ToolKit
 {
@@ -43,8 +46,18 @@ namespace ToolKit
       void GetSelectedEntities(EntityIdArray& entities) const;
       void Destroy();
 
-      EntityRawPtrArray GetByTag(const String& tag);
+      // Prefabs.
+      PrefabInstance* GetPrefabInstance(EntityId part) const; // Owner of a part, null for the other entities.
+      void ExpandPrefabs(); // Expands the instances added since the last call.
+
+      // Static geometry.
+      void BuildStaticBatch();
+      void ClearStaticBatch();
+      void ValidateStaticBatch(); // Drops the build if a merged entity is moved, removed or no longer static.
+
+      EntityRawPtrArray GetByTag(const String& tag); // In the order of addition to the scene.
       void SelectByTag(const String& tag);
+      void SetTag(Entity* entity, const String& tag); // Tags of the scene's entities must be changed with this.
 
       virtual void Serialize(XmlDocument* doc, XmlNode* parent) const;
       virtual void DeSerialize(XmlDocument* doc, XmlNode* parent);
@@ -52,10 +65,62 @@ namespace ToolKit
     public:
       String m_name;
       bool m_newScene; // Indicates if this is created via new scene. That is not saved on the disk.
+      StaticBatch m_staticBatch;
+
+    private:
+      void AddToIndex(Entity* entity);
+      void RemoveFromIndex(Entity* entity);
+      void AddPrefabParts(PrefabInstance* instance);
+      void UpdateBVH() const; // Brings the bounds of the moved drawables up to date.
+      void RemoveMeshUser(Mesh* mesh, Entity* ntt) const;
 
     private:
       EntityRawPtrArray m_entitites;
-      EntityIdArray m_selectedEntities;
+      std::unordered_map<EntityId, Entity*> m_entityIndex;
+
+      // Tag queries are returned in the order the entities are added to the scene.
+      struct TagEntry
+      {
+        Entity* entity;
+        uint order;
+      };
+      std::unordered_multimap<String, TagEntry> m_tagIndex;
+
+      // Parts of the expanded instances are in the scene while their instance is. They can't be removed on their own.
+      std::unordered_map<EntityId, PrefabInstance*> m_prefabParts;
+      std::vector<PrefabInstance*> m_pendingPrefabs;
+
+      // Selection order, the current selection is the last. Indexed for O(1) membership and removal.
+      std::list<EntityId> m_selectedEntities;
+      std::unordered_map<EntityId, std::list<EntityId>::iterator> m_selectionIndex;
+
+      // Drawables are picked through the bvh. It is updated lazily by the queries, only when a transform or a mesh changed
+      // since the last update. The changed nodes and meshes are collected as they change, only the drawables below those
+      // nodes or using those meshes are compared against their node's world version and their mesh's bounds then.
+      struct BVHEntry
+      {
+        BVH::Proxy proxy = BVH::InvalidProxy; // Invalid until the mesh has bounds.
+        uint worldVersion = 0;
+        BoundingBox localBox;
+        Mesh* mesh = nullptr; // Key in m_bvhMeshUsers.
+        uint order = 0; // Position among the added entities, picks are reported in this order.
+      };
+
+      mutable BVH m_bvh;
+      mutable std::unordered_map<Entity*, BVHEntry> m_bvhEntries;
+      mutable EntityRawPtrArray m_bvhPending; // Entities without bounds yet.
+      mutable std::unordered_multimap<Mesh*, Entity*> m_bvhMeshUsers;
+      mutable uint m_bvhEpoch = 0; // Nothing moved while it matches the node epoch.
+      mutable uint m_bvhGeometryEpoch = 0;
+      NodeChangeListPtr m_bvhNodeChanges; // Watches the hierarchies of the drawables.
+      mutable std::mutex m_bvhMeshLock;
+      mutable std::unordered_set<Mesh*> m_bvhMeshChanges; // Filled by the geometry hook, on any thread.
+      uint m_geometryHook = 0;
+      uint m_nextOrder = 0; // Insertion order of the entities.
+
+      // Entities and nodes loaded from the file come from the arena. It is released with the scene and its memory goes
+      // back at once when the last of them is deleted.
+      PoolArena* m_arena = nullptr;
     };
   }
 }
\ No newline at end of file
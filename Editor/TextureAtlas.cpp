@@ -0,0 +1,283 @@
+#include "stdafx.h"
+#include "TextureAtlas.h"
+
+// ImGui compiles its packer as static, this unit needs its own copy.
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "ImGui/imstb_rectpack.h"
+
+#include <unordered_set>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+  namespace Editor
+  {
+
+    static const Vec4 g_identityUvTransform = Vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    void TextureAtlas::Build(const EntityRawPtrArray& entities)
+    {
+      Clear();
+
+      // Diffuse texture files, the meshes using them and the ones sampled outside of [0, 1].
+      std::unordered_map<String, std::unordered_set<Mesh*>> users;
+      std::unordered_set<String> wrapping;
+
+      // Flushed meshes are read back from their files, once per file.
+      std::unordered_map<String, MeshPtr> fileCache;
+
+      for (Entity* ntt : entities)
+      {
+        if (!ntt->IsDrawable())
+        {
+          continue;
+        }
+
+        Drawable* drawable = static_cast<Drawable*> (ntt);
+        if (drawable->m_mesh == nullptr)
+        {
+          continue;
+        }
+
+        MeshRawPtrArray meshes;
+        drawable->m_mesh->GetAllMeshes(meshes);
+
+        MeshRawPtrArray sources = meshes;
+        bool flushed = false;
+        for (Mesh* mesh : meshes)
+        {
+          flushed |= mesh->m_vertexCount > 0 && mesh->m_clientSideVertices.empty();
+        }
+
+        if (flushed && !drawable->m_mesh->m_file.empty())
+        {
+          MeshPtr& cached = fileCache[drawable->m_mesh->m_file];
+          if (cached == nullptr)
+          {
+            cached = MeshPtr(new Mesh(drawable->m_mesh->m_file));
+            cached->Load();
+          }
+
+          sources.clear();
+          cached->GetAllMeshes(sources);
+        }
+
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+          Material* material = meshes[i]->m_material.get();
+          if (material == nullptr || material->m_diffuseTexture == nullptr || material->m_diffuseTexture->m_file.empty())
+          {
+            continue;
+          }
+
+          // Already placed in an atlas.
+          if (material->m_uvTransform != g_identityUvTransform)
+          {
+            continue;
+          }
+
+          const String& file = material->m_diffuseTexture->m_file;
+          users[file].insert(meshes[i]);
+
+          // Uvs that can't be inspected are assumed to wrap.
+          if (sources.size() != meshes.size() || sources[i]->m_clientSideVertices.empty())
+          {
+            wrapping.insert(file);
+            continue;
+          }
+
+          const float eps = 0.001f;
+          for (const Vertex& v : sources[i]->m_clientSideVertices)
+          {
+            if (v.tex.x < -eps || v.tex.y < -eps || v.tex.x > 1.0f + eps || v.tex.y > 1.0f + eps)
+            {
+              wrapping.insert(file);
+              break;
+            }
+          }
+        }
+      }
+
+      // Read back the pixels, textures flush them after the upload.
+      std::vector<std::unique_ptr<Texture>> images;
+      std::vector<stbrp_rect> rects;
+      for (auto& user : users)
+      {
+        if (wrapping.find(user.first) != wrapping.end())
+        {
+          m_stats.skipped++;
+          continue;
+        }
+
+        std::unique_ptr<Texture> image(new Texture(user.first));
+        image->Load();
+        if (!image->m_loaded || image->m_width > m_maxTextureSize || image->m_height > m_maxTextureSize)
+        {
+          m_stats.skipped++;
+          continue;
+        }
+
+        stbrp_rect rect = {};
+        rect.id = (int)images.size();
+        rect.w = (stbrp_coord)(image->m_width + m_padding * 2);
+        rect.h = (stbrp_coord)(image->m_height + m_padding * 2);
+        rects.push_back(rect);
+        images.push_back(std::move(image));
+      }
+
+      // Fill pages until everything is placed.
+      std::vector<stbrp_node> nodes(m_pageSize);
+      float usedTexels = 0.0f;
+      float pageTexels = 0.0f;
+      while (!rects.empty())
+      {
+        stbrp_context context;
+        stbrp_init_target(&context, m_pageSize, m_pageSize, nodes.data(), (int)nodes.size());
+        stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+
+        std::vector<stbrp_rect> packed;
+        std::vector<stbrp_rect> remaining;
+        for (const stbrp_rect& rect : rects)
+        {
+          if (rect.was_packed)
+          {
+            packed.push_back(rect);
+          }
+          else
+          {
+            remaining.push_back(rect);
+          }
+        }
+
+        // Only possible if a padded texture is larger than the page.
+        if (packed.empty())
+        {
+          m_stats.skipped += (uint)remaining.size();
+          break;
+        }
+
+        // Unused rows are trimmed, height is kept a power of two.
+        int usedHeight = 0;
+        for (const stbrp_rect& rect : packed)
+        {
+          usedHeight = glm::max(usedHeight, rect.y + rect.h);
+        }
+
+        int pageHeight = 1;
+        while (pageHeight < usedHeight)
+        {
+          pageHeight *= 2;
+        }
+
+        // Released by Texture::Clear with stbi_image_free.
+        uint8* pixels = (uint8*)malloc(m_pageSize * pageHeight * 4);
+        memset(pixels, 0, m_pageSize * pageHeight * 4);
+
+        for (const stbrp_rect& rect : packed)
+        {
+          Texture* image = images[rect.id].get();
+          int w = image->m_width;
+          int h = image->m_height;
+          for (int y = -m_padding; y < h + m_padding; y++)
+          {
+            int sy = glm::clamp(y, 0, h - 1);
+            for (int x = -m_padding; x < w + m_padding; x++)
+            {
+              int sx = glm::clamp(x, 0, w - 1);
+              uint8* dst = pixels + ((rect.y + m_padding + y) * m_pageSize + rect.x + m_padding + x) * 4;
+              memcpy(dst, image->m_image + (sy * w + sx) * 4, 4);
+            }
+          }
+
+          Entry entry;
+          entry.page = (uint)m_pages.size();
+          entry.uvTransform = Vec4
+          (
+            (float)(rect.x + m_padding) / (float)m_pageSize,
+            (float)(rect.y + m_padding) / (float)pageHeight,
+            (float)w / (float)m_pageSize,
+            (float)h / (float)pageHeight
+          );
+          m_entries[image->m_file] = entry;
+          usedTexels += (float)(w * h);
+        }
+
+        TexturePtr page = std::make_shared<Texture>();
+        page->m_image = pixels;
+        page->m_width = m_pageSize;
+        page->m_height = pageHeight;
+        page->m_bytePP = 4;
+        page->m_loaded = true;
+        page->Init();
+        m_pages.push_back(page);
+
+        pageTexels += (float)(m_pageSize * pageHeight);
+        m_stats.packed += (uint)packed.size();
+        rects.swap(remaining);
+      }
+
+      if (pageTexels > 0.0f)
+      {
+        m_stats.fill = usedTexels / pageTexels;
+      }
+
+      for (auto& user : users)
+      {
+        for (Mesh* mesh : user.second)
+        {
+          // Materials may be shared with meshes outside of the scene through the material cache.
+          if (GetEntry(user.first) != nullptr && Apply(mesh->GetUniqueMaterial().get()))
+          {
+            m_stats.materials++;
+          }
+        }
+      }
+    }
+
+    bool TextureAtlas::Apply(Material* material) const
+    {
+      if (material->m_diffuseTexture == nullptr)
+      {
+        return false;
+      }
+
+      const Entry* entry = GetEntry(material->m_diffuseTexture->m_file);
+      if (entry == nullptr)
+      {
+        return false;
+      }
+
+      material->m_diffuseTexture = m_pages[entry->page];
+      material->m_uvTransform = entry->uvTransform;
+      return true;
+    }
+
+    const TextureAtlas::Entry* TextureAtlas::GetEntry(const String& file) const
+    {
+      auto entry = m_entries.find(file);
+      if (entry == m_entries.end())
+      {
+        return nullptr;
+      }
+
+      return &entry->second;
+    }
+
+    void TextureAtlas::Clear()
+    {
+      m_pages.clear();
+      m_entries.clear();
+      m_stats = Stats();
+    }
+
+    const TextureAtlas::Stats& TextureAtlas::GetStats() const
+    {
+      return m_stats;
+    }
+
+  }
+}
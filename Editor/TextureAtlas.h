@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ToolKit.h"
+
+namespace ToolKit
+{
+
+  namespace Editor
+  {
+    // Packs small diffuse textures into shared pages. Materials are pointed to their page and given a uv transform, so
+    // materials sharing a page differ only by the transform and batch together. Textures sampled outside of [0, 1]
+    // rely on wrapping, they are left as they are. Meshes get their own copy of the material before the change. Pages
+    // and the remapped materials live in memory only, nothing is saved with the scene.
+    class TextureAtlas
+    {
+    public:
+      struct Entry
+      {
+        uint page;
+        Vec4 uvTransform; // Offset in xy, scale in zw.
+      };
+
+      struct Stats
+      {
+        uint packed = 0;
+        uint skipped = 0; // Too large, wrapping or failed to fit.
+        uint materials = 0;
+        float fill = 0.0f; // Used texel ratio over all pages.
+      };
+
+    public:
+      void Build(const EntityRawPtrArray& entities); // Packs the textures of the drawables and applies to copies of their materials.
+      bool Apply(Material* material) const; // False if the material's texture is not in the atlas.
+      const Entry* GetEntry(const String& file) const;
+      void Clear();
+      const Stats& GetStats() const;
+
+    public:
+      int m_pageSize = 2048;
+      int m_maxTextureSize = 256; // Larger textures don't gain much from packing.
+      int m_padding = 2; // Edge texels are repeated into the padding to limit bleeding with filtering.
+      std::vector<TexturePtr> m_pages;
+
+    private:
+      std::unordered_map<String, Entry> m_entries;
+      Stats m_stats;
+    };
+  }
+
+}
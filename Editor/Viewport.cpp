@@ -24,6 +24,7 @@ namespace ToolKit
     uint Viewport::m_nextId = 1;
     OverlayMods* Viewport::m_overlayMods = nullptr;
     OverlayViewportOptions* Viewport::m_overlayOptions = nullptr;
+    OverlayRenderStats* Viewport::m_overlayStats = nullptr;
 
     Viewport::Viewport(float width, float height)
       : m_width(width), m_height(height)
@@ -43,6 +44,11 @@ namespace ToolKit
       {
         m_overlayOptions = new OverlayViewportOptions(this);
       }
+
+      if (m_overlayStats == nullptr)
+      {
+        m_overlayStats = new OverlayRenderStats(this);
+      }
     }
 
     Viewport::~Viewport()
@@ -129,6 +135,15 @@ namespace ToolKit
           }
         }
 
+        if (g_app->m_showRenderStats && IsActive())
+        {
+          if (m_overlayStats != nullptr)
+          {
+            m_overlayStats->m_owner = this;
+            m_overlayStats->Show();
+          }
+        }
+
         m_mouseHover = ImGui::IsWindowHovered();
 
         ImVec2 pos = GLM2IMVEC(m_wndPos);
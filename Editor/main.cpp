@@ -6,10 +6,13 @@
 #include "Mod.h"
 #include "UI.h"
 #include "ImGui/imgui_impl_sdl.h"
+#include "Headless.h"
+#include "Benchmark.h"
 #include "DebugNew.h"
 
 #include <stdio.h>
 #include <chrono>
+#include <iostream>
 
 // #define TK_PROFILE
 
@@ -147,10 +150,188 @@ namespace ToolKit
       }
     }
 
+    // "--name value" pairs of the headless runs.
+    class CommandLineOptions
+    {
+    public:
+      CommandLineOptions(int argc, char* argv[])
+      {
+        for (int i = 1; i < argc; i++)
+        {
+          String arg = argv[i];
+          if (arg.rfind("--", 0) == 0 && i + 1 < argc)
+          {
+            m_values[arg.substr(2)] = argv[++i];
+          }
+        }
+      }
+
+      bool Has(const String& name) const
+      {
+        return m_values.find(name) != m_values.end();
+      }
+
+      String Get(const String& name) const
+      {
+        auto value = m_values.find(name);
+        return value == m_values.end() ? String() : value->second;
+      }
+
+      uint GetUint(const String& name, uint defaultVal) const
+      {
+        auto value = m_values.find(name);
+        return value == m_values.end() ? defaultVal : (uint)std::atoi(value->second.c_str());
+      }
+
+    private:
+      std::unordered_map<String, String> m_values;
+    };
+
+    // Renders a scene offscreen without the editor and prints frame time percentiles. Usage:
+    // --benchmark <scene> [--frames n] [--width w] [--height h] [--path cameraPath.xml] [--capture dir] [--captureEvery n]
+    int Benchmark_Main(int argc, char* argv[])
+    {
+      CommandLineOptions options(argc, argv);
+      String sceneFile = options.Get("benchmark");
+
+      if (!CheckFile(sceneFile))
+      {
+        std::cerr << "Scene not found: " << sceneFile << std::endl;
+        return 1;
+      }
+
+      HeadlessContext context;
+      if (!context.Init())
+      {
+        std::cerr << "Can't create a gl context: " << context.m_error << std::endl;
+        return 1;
+      }
+
+      int result = 0;
+      {
+        Scene scene;
+        XmlFile file(sceneFile.c_str());
+        XmlDocument doc;
+        doc.parse<0>(file.data());
+        scene.DeSerialize(&doc, nullptr);
+
+        // Same rig as the editor's, fixed in the world.
+        LightRawPtrArray lights;
+        float yaws[] = { -45.0f, 60.0f, -140.0f };
+        float intensities[] = { 1.0f, 0.5f, 0.3f };
+        for (int i = 0; i < 3; i++)
+        {
+          Light* light = new Light();
+          light->m_intensity = intensities[i];
+          light->Pitch(glm::radians(-30.0f));
+          light->Yaw(glm::radians(yaws[i]));
+          lights.push_back(light);
+        }
+
+        Renderer renderer;
+        BenchmarkRunner runner(&renderer, options.GetUint("width", 1280), options.GetUint("height", 720));
+        runner.m_frames = glm::max(options.GetUint("frames", runner.m_frames), 1u);
+        runner.m_captureEvery = options.GetUint("captureEvery", runner.m_captureEvery);
+        if (options.Has("capture"))
+        {
+          runner.m_captureDir = options.Get("capture");
+        }
+
+        if (options.Has("path"))
+        {
+          if (!runner.LoadPath(options.Get("path")))
+          {
+            std::cerr << "Can't read the camera path: " << options.Get("path") << std::endl;
+            result = 1;
+          }
+        }
+        else
+        {
+          BoundingBox sceneBox;
+          for (Entity* ntt : scene.GetEntities())
+          {
+            if (ntt->IsDrawable())
+            {
+              BoundingBox box = ntt->GetAABB(true);
+              sceneBox.min = glm::min(sceneBox.min, box.min);
+              sceneBox.max = glm::max(sceneBox.max, box.max);
+            }
+          }
+
+          if (sceneBox.min.x > sceneBox.max.x)
+          {
+            sceneBox.min = Vec3(-1.0f);
+            sceneBox.max = Vec3(1.0f);
+          }
+          runner.OrbitPath(sceneBox, 10.0f);
+        }
+
+        if (result == 0)
+        {
+          BenchmarkRunner::Report report = runner.Run(scene.GetEntities(), lights);
+          std::cout << sceneFile << "\n" << BenchmarkRunner::ToString(report);
+        }
+
+        for (Light* light : lights)
+        {
+          SafeDel(light);
+        }
+      }
+
+      context.UnInit();
+      return result;
+    }
+
+    // Re-issues a frame recorded with the CaptureFrame command and prints its timings. Usage:
+    // --replay <file> [--iterations n]
+    int Replay_Main(int argc, char* argv[])
+    {
+      CommandLineOptions options(argc, argv);
+
+      HeadlessContext context;
+      if (!context.Init())
+      {
+        std::cerr << "Can't create a gl context: " << context.m_error << std::endl;
+        return 1;
+      }
+
+      int result = 0;
+      {
+        // Draws to the default framebuffer land on the context's pbuffer.
+        GlReplay replay;
+        if (replay.Load(options.Get("replay")))
+        {
+          GlReplay::Report report = replay.Run(glm::max(options.GetUint("iterations", 100), 1u));
+          std::cout << options.Get("replay") << "\n" << GlReplay::ToString(report);
+        }
+        else
+        {
+          std::cerr << replay.m_error << std::endl;
+          result = 1;
+        }
+      }
+
+      context.UnInit();
+      return result;
+    }
+
     int ToolKit_Main(int argc, char* argv[])
     {
       _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 
+      for (int i = 1; i < argc; i++)
+      {
+        if (String("--benchmark").compare(argv[i]) == 0)
+        {
+          return Benchmark_Main(argc, argv);
+        }
+
+        if (String("--replay").compare(argv[i]) == 0)
+        {
+          return Replay_Main(argc, argv);
+        }
+      }
+
       Init();
 
       // Continue with editor.
@@ -23,9 +23,25 @@
 			vec3 dir;
 		};
 
+		// Clustered lights, used when enabled instead of LightData.
+		struct _ClusterData
+		{
+			int enabled;
+			ivec3 dims; // Tiles x, tiles y, depth slices.
+			vec2 viewport;
+			vec2 depthRange;
+			int linear;
+			int globalCount;
+			int indexWidth;
+		};
+
 		uniform _LightData LightData;
 		uniform _CamData CamData;
+		uniform _ClusterData Clusters;
 		uniform sampler2D s_texture;
+		uniform highp sampler2D LightTexture; // Per light: position & radius, direction, color & intensity.
+		uniform highp usampler2D ClusterTexture; // Offset & count.
+		uniform highp usampler2D LightIndexTexture;
 
 		in vec3 v_pos;
 		in vec3 v_normal;
@@ -33,31 +49,90 @@
 
 		out vec4 fragColor;
 
-		void main()
+		vec3 Shade(vec3 n, vec3 e, vec3 l, vec3 color, float intensity)
 		{
-			vec3 n = normalize(v_normal);
-			vec3 e = normalize(CamData.pos - v_pos);
+			// ambient
+			float ambientStrength = 0.1;
+			vec3 ambient = ambientStrength * color;
+
+			// diffuse 
+			float diff = max(dot(n, l), 0.0);
+			vec3 diffuse = diff * color;
+
+			// specular
+			float specularStrength = 0.5;
+			vec3 reflectDir = reflect(-l, n);
+			float spec = pow(max(dot(e, reflectDir), 0.0), 32.0);
+			vec3 specular = specularStrength * spec * color;
+
+			return (ambient + diffuse + specular) * intensity;
+		}
+
+		vec3 ShadeClusterLight(int i, vec3 n, vec3 e)
+		{
+			vec4 posRadius = texelFetch(LightTexture, ivec2(0, i), 0);
+			vec4 colorIntensity = texelFetch(LightTexture, ivec2(2, i), 0);
+
+			if (posRadius.w <= 0.0)
+			{
+				vec3 dir = texelFetch(LightTexture, ivec2(1, i), 0).xyz;
+				return Shade(n, e, -dir, colorIntensity.rgb, colorIntensity.a);
+			}
+
+			vec3 toLight = posRadius.xyz - v_pos;
+			float dist = length(toLight);
+			float falloff = clamp(1.0 - (dist * dist) / (posRadius.w * posRadius.w), 0.0, 1.0);
+			return Shade(n, e, toLight / max(dist, 0.0001), colorIntensity.rgb, colorIntensity.a) * falloff * falloff;
+		}
 
+		vec3 ClusteredIrradiance(vec3 n, vec3 e)
+		{
 			vec3 irradiance = vec3(0.0);
-			for (int i = 0; i < LightData.activeCount; i++)
+			for (int i = 0; i < Clusters.globalCount; i++)
 			{
-				vec3 l = -LightData.dir[i];
+				irradiance += ShadeClusterLight(i, n, e);
+			}
 
-				// ambient
-				float ambientStrength = 0.1;
-				vec3 ambient = ambientStrength * LightData.color[i];
+			float depth = dot(v_pos - CamData.pos, normalize(CamData.dir));
+			float zNear = Clusters.depthRange.x;
+			float zFar = Clusters.depthRange.y;
+			float t = Clusters.linear == 1 ? (depth - zNear) / (zFar - zNear) : log(depth / zNear) / log(zFar / zNear);
+			if (t < 0.0 || t > 1.0)
+			{
+				return irradiance;
+			}
 
-				// diffuse 
-				float diff = max(dot(n, l), 0.0);
-				vec3 diffuse = diff * LightData.color[i];
+			ivec2 tile = ivec2(gl_FragCoord.xy / Clusters.viewport * vec2(Clusters.dims.xy));
+			tile = clamp(tile, ivec2(0), Clusters.dims.xy - 1);
+			int slice = min(int(t * float(Clusters.dims.z)), Clusters.dims.z - 1);
 
-				// specular
-				float specularStrength = 0.5;
-				vec3 reflectDir = reflect(-l, n);
-				float spec = pow(max(dot(e, reflectDir), 0.0), 32.0);
-				vec3 specular = specularStrength * spec * LightData.color[i];
+			uvec2 cluster = texelFetch(ClusterTexture, ivec2(tile.y * Clusters.dims.x + tile.x, slice), 0).xy;
+			for (int i = 0; i < int(cluster.y); i++)
+			{
+				int index = int(cluster.x) + i;
+				int light = int(texelFetch(LightIndexTexture, ivec2(index % Clusters.indexWidth, index / Clusters.indexWidth), 0).r);
+				irradiance += ShadeClusterLight(light, n, e);
+			}
+
+			return irradiance;
+		}
 
-				irradiance += (ambient + diffuse + specular) * LightData.intensity[i];
+		void main()
+		{
+			vec3 n = normalize(v_normal);
+			vec3 e = normalize(CamData.pos - v_pos);
+
+			vec3 irradiance = vec3(0.0);
+			if (Clusters.enabled == 1)
+			{
+				irradiance = ClusteredIrradiance(n, e);
+			}
+			else
+			{
+				for (int i = 0; i < LightData.activeCount; i++)
+				{
+					irradiance += Shade(n, e, -LightData.dir[i], LightData.color[i], LightData.intensity[i]);
+				}
 			}
 
 			vec4 objectColor = texture(s_texture, v_texture);
@@ -3,6 +3,7 @@
 	<uniform name = "ProjectViewModel" />
 	<uniform name = "InverseTransModel" />
 	<uniform name = "Model" />
+	<uniform name = "UvTransform" />
 	<source>
 	<!--
 		#version 300 es
@@ -17,6 +18,7 @@
 		uniform mat4 ProjectViewModel;
 		uniform mat4 InverseTransModel;
 		uniform mat4 Model;
+		uniform vec4 UvTransform; // Atlas placement of the texture.
 
 		out vec3 v_pos;
 		out vec3 v_normal;
@@ -26,7 +28,7 @@
 		{
 		  v_pos = (Model * vec4(vPosition, 1.0)).xyz;
 		  v_normal = (InverseTransModel * vec4(vNormal, 1.0)).xyz;
-		  v_texture = vTexture;
+		  v_texture = vTexture * UvTransform.zw + UvTransform.xy;
 
 		  gl_Position = ProjectViewModel * vec4(vPosition, 1.0);
 		}
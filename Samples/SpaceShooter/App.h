@@ -21,6 +21,7 @@
 #include "DebugNew.h"
 
 #include <algorithm>
+#include <unordered_set>
 
 using namespace ToolKit;
 
@@ -64,6 +65,7 @@ public:
 
     m_spaceShip = new Ship();
     m_spaceShip->m_node->Translate(Vec3(4, 0, 4));
+    m_meteorManager.m_broadphase = &m_broadphase;
 
     m_crosshair = new Surface(TexturePath("crosshair.png"), glm::vec2(0.5f, 0.5f));
     m_crosshair->m_mesh->Init();
@@ -120,43 +122,53 @@ public:
 
   void CheckProjectileMeteorCollision()
   {
-    for (int i = (int)m_meteorManager.m_meteors.size() - 1; i > -1; i--)
+    std::unordered_set<Entity*> hits;
+    std::vector<SpatialHash::Proxy> nearby;
+    for (int j = (int)m_projectileManager.m_projectiles.size() - 1; j > -1; j--)
     {
-      bool markForDel = false;
-      for (int j = (int)m_projectileManager.m_projectiles.size() - 1; j > -1; j--)
+      Vec3 pos = m_projectileManager.m_projectiles[j]->m_node->GetTranslation(TransformationSpace::TS_WORLD);
+
+      nearby.clear();
+      m_broadphase.QueryRadius(pos, 0.0f, nearby);
+      for (SpatialHash::Proxy proxy : nearby)
       {
-        if (
-          SpherePointIntersection
-          (
-            m_meteorManager.m_meteors[i]->m_node->GetTranslation(),
-            m_meteorManager.m_meteors[i]->m_collisionRadius,
-            m_projectileManager.m_projectiles[j]->m_node->GetTranslation(TransformationSpace::TS_WORLD)
-          )
-          )
+        const SpatialHash::Item& item = m_broadphase.GetItem(proxy);
+        if (SpherePointIntersection(item.center, item.radius, pos))
         {
+          hits.insert(item.entity);
           SafeDel(m_projectileManager.m_projectiles[j]);
           m_projectileManager.m_projectiles.erase(m_projectileManager.m_projectiles.begin() + j);
-          markForDel = true;
+          break;
         }
       }
-      if (markForDel)
+    }
+
+    if (hits.empty())
+    {
+      return;
+    }
+
+    for (int i = (int)m_meteorManager.m_meteors.size() - 1; i > -1; i--)
+    {
+      Meteor* meteor = m_meteorManager.m_meteors[i];
+      if (hits.find(meteor) == hits.end())
       {
-        Node* meteorNode = m_meteorManager.m_meteors[i]->m_node;
-        m_explotionManager.SpawnMeteorExplosion(GetSSP(meteorNode->GetTransform()));
+        continue;
+      }
 
-        if (m_meteorManager.m_meteors[i]->m_speed > 0.3f)
-        {
-          m_score += 30;
-        }
-        else
-        {
-          m_score++;
-        }
+      m_explotionManager.SpawnMeteorExplosion(GetSSP(meteor->m_node->GetTransform()));
 
-        SafeDel(m_meteorManager.m_meteors[i]);
-        m_meteorManager.m_meteors.erase(m_meteorManager.m_meteors.begin() + i);
-        AudioPlayer::Play(&m_explosionSource);
+      if (meteor->m_speed > 0.3f)
+      {
+        m_score += 30;
       }
+      else
+      {
+        m_score++;
+      }
+
+      m_meteorManager.Remove(i);
+      AudioPlayer::Play(&m_explosionSource);
     }
   }
 
@@ -245,34 +257,39 @@ public:
 
   void SpeedyMeteorMeteorCollisionCheck()
   {
-    std::vector<int> removeList;
-    for (int i = (int)m_meteorManager.m_meteors.size() - 1; i > -1; i--)
+    std::vector<std::pair<SpatialHash::Proxy, SpatialHash::Proxy>> pairs;
+    m_broadphase.GetPairs(pairs);
+
+    // Of a colliding pair, the one spawned earlier breaks if it is a slow one. A meteor may be in several pairs.
+    std::unordered_set<Entity*> removeSet;
+    for (const auto& pair : pairs)
     {
-      for (int j = 0; j < i; j++)
+      const SpatialHash::Item& itemA = m_broadphase.GetItem(pair.first);
+      const SpatialHash::Item& itemB = m_broadphase.GetItem(pair.second);
+      if (!SphereSphereIntersection(itemA.center, itemA.radius, itemB.center, itemB.radius))
       {
-        Meteor* a = m_meteorManager.m_meteors[i];
-        Meteor* b = m_meteorManager.m_meteors[j];
-        if (
-          SphereSphereIntersection
-          (
-            a->m_node->GetTranslation(), a->m_collisionRadius,
-            b->m_node->GetTranslation(), b->m_collisionRadius
-          )
-          )
-        {
-          if (glm::abs(b->m_speed - 0.3f) < 0.01)
-          {
-            removeList.push_back(j);
-          }
-        }
+        continue;
+      }
+
+      Meteor* b = static_cast<Meteor*>(itemA.entity);
+      if (itemB.entity->m_id < b->m_id)
+      {
+        b = static_cast<Meteor*>(itemB.entity);
+      }
+
+      if (glm::abs(b->m_speed - 0.3f) < 0.01)
+      {
+        removeSet.insert(b);
       }
     }
 
-    std::sort(removeList.begin(), removeList.end());
-    std::reverse(removeList.begin(), removeList.end());
-    for (int i = 0; i < (int)removeList.size(); i++)
+    for (int i = (int)m_meteorManager.m_meteors.size() - 1; i > -1; i--)
     {
-      Meteor* meteor = m_meteorManager.m_meteors[removeList[i]];
+      Meteor* meteor = m_meteorManager.m_meteors[i];
+      if (removeSet.find(meteor) == removeSet.end())
+      {
+        continue;
+      }
 
       if (meteor->m_node->GetTranslation().z >= -10.0f)
       {
@@ -282,9 +299,8 @@ public:
         }
       }
 
-      m_meteorManager.m_meteors.erase(m_meteorManager.m_meteors.begin() + removeList[i]);
       m_explotionManager.SpawnMeteorExplosion(GetSSP(meteor->m_node->GetTransform(TransformationSpace::TS_WORLD)));
-      SafeDel(meteor);
+      m_meteorManager.Remove(i);
     }
   }
 
@@ -342,9 +358,13 @@ public:
 
   void CheckShipMeteorCollision()
   {
-    for (auto meteor : m_meteorManager.m_meteors)
+    // Vertex tests only for the meteors around the ship.
+    std::vector<SpatialHash::Proxy> nearby;
+    m_broadphase.QueryBox(m_spaceShip->GetAABB(true), nearby);
+    for (SpatialHash::Proxy proxy : nearby)
     {
-      if (m_spaceShip->CheckShipSphereCollision(meteor->m_node->GetTranslation(), meteor->m_collisionRadius))
+      const SpatialHash::Item& meteor = m_broadphase.GetItem(proxy);
+      if (m_spaceShip->CheckShipSphereCollision(meteor.center, meteor.radius))
       {
         m_shipGone = true;
         glm::ivec2 explosionPoint = GetSSP(m_spaceShip->m_node->GetTransform(TransformationSpace::TS_WORLD));
@@ -363,6 +383,7 @@ public:
     for (auto entry : m_meteorManager.m_meteors)
       SafeDel(entry);
     m_meteorManager.m_meteors.clear();
+    m_broadphase.Clear();
 
     for (auto entry : m_explotionManager.m_sprites)
       SafeDel(entry);
@@ -386,6 +407,7 @@ public:
   Surface* m_crosshair = nullptr;
   glm::ivec2 m_sscp;
   bool m_shipGone = false;
+  SpatialHash m_broadphase;
   ProjectileManager m_projectileManager;
   MeteorManager m_meteorManager;
   ExplosionManager m_explotionManager;
@@ -19,6 +19,7 @@ public:
 
   float m_collisionRadius = 1.3f;
   float m_speed = 0.3f;
+  SpatialHash::Proxy m_proxy = SpatialHash::InvalidProxy;
 };
 
 class MeteorManager
@@ -46,44 +47,56 @@ public:
     Quaternion wo = glm::angleAxis(glm::linearRand(-90.0f, 90.0f), glm::sphericalRand(1.0f));
     meteor->m_node->SetOrientation(wo, TransformationSpace::TS_WORLD);
 
-    for (auto entry : m_meteors)
+    // Only the meteors around the spawn point are tested, their bounds are within the spacing.
+    std::vector<SpatialHash::Proxy> nearby;
+    m_broadphase->QueryRadius(wt, meteor->m_collisionRadius + 1, nearby);
+    for (SpatialHash::Proxy proxy : nearby)
     {
-      if (
-        SphereSphereIntersection
-        (
-          entry->m_node->GetTranslation(TransformationSpace::TS_WORLD),
-          entry->m_collisionRadius + 1,
-          meteor->m_node->GetTranslation(TransformationSpace::TS_WORLD),
-          meteor->m_collisionRadius
-        )
-        )
+      const SpatialHash::Item& entry = m_broadphase->GetItem(proxy);
+      if (SphereSphereIntersection(entry.center, entry.radius + 1, wt, meteor->m_collisionRadius))
       {
         SafeDel(meteor);
         return;
       }
     }
 
+    meteor->m_proxy = m_broadphase->InsertSphere(meteor, wt, meteor->m_collisionRadius);
     m_meteors.push_back(meteor);
   }
 
+  void Remove(int index)
+  {
+    Meteor* meteor = m_meteors[index];
+    m_broadphase->Remove(meteor->m_proxy);
+    m_meteors.erase(m_meteors.begin() + index);
+    SafeDel(meteor);
+  }
+
   void Update(int& score)
   {
     for (int i = (int)m_meteors.size() - 1; i > -1; i--)
     {
-      m_meteors[i]->m_node->Translate({ 0.0f, 0.0f, m_meteors[i]->m_speed });
-      m_meteors[i]->m_node->Rotate(glm::angleAxis(glm::radians(glm::linearRand(0.1f, 1.5f)), Z_AXIS), TransformationSpace::TS_LOCAL);
-      if (m_meteors[i]->m_node->GetTranslation(TransformationSpace::TS_WORLD).z > 20)
+      Meteor* meteor = m_meteors[i];
+      meteor->m_node->Translate({ 0.0f, 0.0f, meteor->m_speed });
+      meteor->m_node->Rotate(glm::angleAxis(glm::radians(glm::linearRand(0.1f, 1.5f)), Z_AXIS), TransformationSpace::TS_LOCAL);
+
+      Vec3 pos = meteor->m_node->GetTranslation(TransformationSpace::TS_WORLD);
+      if (pos.z > 20)
       {
-        SafeDel(m_meteors[i]);
-        m_meteors.erase(m_meteors.begin() + i);
+        Remove(i);
         score -= 10;
         if (score < 0)
         {
           score = 0;
         }
       }
+      else
+      {
+        m_broadphase->MoveSphere(meteor->m_proxy, pos);
+      }
     }
   }
 
   std::vector<Meteor*> m_meteors;
+  SpatialHash* m_broadphase = nullptr; // Meteor collision spheres, kept in sync with the positions by Spawn and Update.
 };
\ No newline at end of file
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "DebugNew.h"
 #include "ToolKit.h"
 #include "Drawable.h"
 #include "Texture.h"
@@ -8,6 +7,7 @@
 #include "Material.h"
 #include "Ship.h"
 #include "glm\gtc\random.hpp"
+#include "DebugNew.h"
 
 using namespace ToolKit;
 
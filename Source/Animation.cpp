@@ -6,6 +6,11 @@
 #include "rapidxml_utils.hpp"
 #include "Util.h"
 #include "Skeleton.h"
+#include "Drawable.h"
+#include "Mesh.h"
+#include "ToolKit.h"
+#include "Logger.h"
+#include <unordered_map>
 #include "DebugNew.h"
 
 namespace ToolKit
@@ -25,71 +30,80 @@ namespace ToolKit
     UnInit();
   }
 
-  void Animation::GetCurrentPose(Node* node)
+  void Animation::GetCurrentPose(Node* node, KeyCursor* cursor)
   {
-    if (m_keys.empty())
+    if (m_keys.empty() && m_tracks.empty())
     {
       return;
     }
 
-    float ratio;
-    int key1, key2;
-    std::vector<Key>& keys = m_keys.begin()->second;
-    GetNearestKeys(keys, key1, key2, ratio);
+    int* keyCursor = nullptr;
+    if (cursor != nullptr)
+    {
+      cursor->resize(1);
+      keyCursor = &cursor->front();
+    }
 
-    if ((int)keys.size() <= key1)
+    Vec3 translation, scale;
+    Quaternion rotation;
+    bool sampled = false;
+    if (IsCompressed())
     {
-      return;
+      sampled = m_tracks.begin()->second.Sample(m_currentTime, keyCursor, translation, rotation, scale);
+    }
+    else
+    {
+      sampled = SampleKeys(m_keys.begin()->second, keyCursor, translation, rotation, scale);
     }
 
-    if ((int)keys.size() <= key2)
+    if (!sampled)
     {
       return;
     }
 
-    Key k1 = keys[key1];
-    Key k2 = keys[key2];
-    node->m_translation = Interpolate(k1.m_position, k2.m_position, ratio);
-    node->m_orientation = glm::slerp(k1.m_rotation, k2.m_rotation, ratio);
-    node->m_scale = Interpolate(k1.m_scale, k2.m_scale, ratio), TransformationSpace::TS_LOCAL;
-    node->SetChildrenDirty();
+    node->m_translation = translation;
+    node->m_orientation = rotation;
+    node->m_scale = scale;
+    node->SetLocalDirty();
   }
 
-  void Animation::GetCurrentPose(Skeleton* skeleton)
+  void Animation::GetCurrentPose(Skeleton* skeleton, KeyCursor* cursor)
   {
-    if (m_keys.empty())
+    if (m_keys.empty() && m_tracks.empty())
       return;
 
-    float ratio;
-    int key1, key2;
-    for (auto bone : skeleton->m_bones)
+    if (cursor != nullptr)
     {
-      auto entry = m_keys.find(bone->m_name);
-      if (entry == m_keys.end())
+      cursor->resize(skeleton->m_bones.size());
+    }
+
+    Vec3 translation, scale;
+    Quaternion rotation;
+    for (size_t i = 0; i < skeleton->m_bones.size(); i++)
+    {
+      Bone* bone = skeleton->m_bones[i];
+      int* keyCursor = cursor ? &(*cursor)[i] : nullptr;
+      bool sampled = false;
+      if (IsCompressed())
       {
-        continue;
+        auto entry = m_tracks.find(bone->m_name);
+        sampled = entry != m_tracks.end() && entry->second.Sample(m_currentTime, keyCursor, translation, rotation, scale);
       }
-
-      GetNearestKeys(entry->second, key1, key2, ratio);
-
-      // Sanity checks
-      int keySize = (int)entry->second.size();
-      if (keySize <= key1 || keySize <= key2)
+      else
       {
-        continue;
+        auto entry = m_keys.find(bone->m_name);
+        sampled = entry != m_keys.end() && SampleKeys(entry->second, keyCursor, translation, rotation, scale);
       }
 
-      if (key1 == -1 || key2 == -1)
+      if (!sampled)
       {
         continue;
       }
 
-      Key k1 = entry->second[key1];
-      Key k2 = entry->second[key2];
-      bone->m_node->m_translation = Interpolate(k1.m_position, k2.m_position, ratio);
-      bone->m_node->m_orientation = glm::slerp(k1.m_rotation, k2.m_rotation, ratio);
-      bone->m_node->m_scale = Interpolate(k1.m_scale, k2.m_scale, ratio), TransformationSpace::TS_LOCAL;
-      bone->m_node->SetChildrenDirty();
+      bone->m_node->m_translation = translation;
+      bone->m_node->m_orientation = rotation;
+      bone->m_node->m_scale = scale;
+      bone->m_node->SetLocalDirty();
     }
   }
 
@@ -98,6 +112,23 @@ namespace ToolKit
     return m_duration;
   }
 
+  AnimationCompressionReport Animation::Compress(const AnimationCompressionSettings& settings)
+  {
+    AnimationCompressionReport report;
+    for (auto& entry : m_keys)
+    {
+      m_tracks[entry.first] = CompressTrack(entry.second, settings, report);
+    }
+    m_keys.clear();
+
+    return report;
+  }
+
+  bool Animation::IsCompressed() const
+  {
+    return !m_tracks.empty();
+  }
+
   void Animation::Load()
   {
     XmlFile file(m_file.c_str());
@@ -126,6 +157,7 @@ namespace ToolKit
         Key key;
         attr = keyNode->first_attribute("frame");
         key.m_frame = std::atoi(attr->value());
+        key.m_time = key.m_frame / m_fps;
 
         XmlNode* subNode = keyNode->first_node("translation");
         ReadVec(subNode, key.m_position);
@@ -140,6 +172,18 @@ namespace ToolKit
       }
     }
 
+    // Written by the importer along with all the keys. Keys are reduced here only, so the errors are against the source.
+    attr = node->first_attribute("tolerance");
+    if (attr != nullptr)
+    {
+      AnimationCompressionSettings settings;
+      settings.translationTolerance = (float)std::atof(attr->value());
+      settings.rotationTolerance = settings.translationTolerance;
+      settings.scaleTolerance = settings.translationTolerance;
+      AnimationCompressionReport report = Compress(settings);
+      Logger::GetInstance()->Log(m_file + " compressed, " + report.ToString());
+    }
+
     m_loaded = true;
   }
 
@@ -157,26 +201,26 @@ namespace ToolKit
     return new Animation(*this);
   }
 
-  void Animation::GetNearestKeys(const std::vector<Key>& keys, int& key1, int& key2, float& ratio)
+  bool Animation::SampleKeys(const std::vector<Key>& keys, int* cursor, Vec3& translation, Quaternion& rotation, Vec3& scale) const
   {
-    // Find nearset keys.
-    key1 = -1;
-    key2 = -1;
-    ratio = 0;
-
-    for (int i = 1; i < (int)keys.size(); i++)
+    auto KeyTimeFn = [](const Key& key) -> float
     {
-      float keyTime2 = keys[i].m_frame * 1.0f / m_fps;
-      float keyTime1 = keys[i - 1].m_frame * 1.0f / m_fps;
+      return key.m_time;
+    };
 
-      if (m_currentTime >= keyTime1 && keyTime2 >= m_currentTime)
-      {
-        ratio = (m_currentTime - keyTime1) / (keyTime2 - keyTime1);
-        key1 = i - 1;
-        key2 = i;
-        return;
-      }
+    int key1;
+    float ratio;
+    if (!FindKeys(keys, KeyTimeFn, m_currentTime, cursor, key1, ratio))
+    {
+      return false;
     }
+
+    const Key& k1 = keys[key1];
+    const Key& k2 = keys[key1 + 1];
+    translation = Interpolate(k1.m_position, k2.m_position, ratio);
+    rotation = glm::slerp(k1.m_rotation, k2.m_rotation, ratio);
+    scale = Interpolate(k1.m_scale, k2.m_scale, ratio);
+    return true;
   }
 
   void AnimationPlayer::AddRecord(Entity* entity, Animation* anim)
@@ -193,15 +237,17 @@ namespace ToolKit
     if (indx != -1)
     {
       m_records.erase(m_records.begin() + indx);
+      m_cursors.erase({ entity, anim });
     }
   }
 
   void AnimationPlayer::Update(float deltaTimeSec)
   {
-    int index = 0;
     std::vector<int> removeList;
-    for (auto record : m_records)
+    std::vector<int> posed;
+    for (int index = 0; index < (int)m_records.size(); index++)
     {
+      AnimRecord& record = m_records[index];
       if (record.second->m_state == Animation::State::Pause)
       {
         continue;
@@ -238,7 +284,7 @@ namespace ToolKit
         record.second->m_currentTime += deltaTimeSec;
       }
 
-      record.first->SetPose(record.second);
+      posed.push_back(index);
 
       if (state == Animation::State::Rewind)
       {
@@ -249,16 +295,81 @@ namespace ToolKit
       {
         removeList.push_back(index);
       }
-      index++;
     }
 
+    SamplePoses(posed);
+
     std::reverse(removeList.begin(), removeList.end());
     for (int i = 0; i < (int)removeList.size(); i++)
     {
+      m_cursors.erase(m_records[removeList[i]]);
       m_records.erase(m_records.begin() + removeList[i]);
     }
   }
 
+  void AnimationPlayer::SamplePoses(const std::vector<int>& records)
+  {
+    // Records are also removed from m_records directly, such cursors are dropped once they outnumber the records.
+    if (m_cursors.size() > m_records.size())
+    {
+      std::map<AnimRecord, KeyCursor> alive;
+      for (const AnimRecord& record : m_records)
+      {
+        auto cursor = m_cursors.find(record);
+        if (cursor != m_cursors.end())
+        {
+          alive.insert(*cursor);
+        }
+      }
+      m_cursors.swap(alive);
+    }
+
+    // Cursors are created up front, the jobs only touch their own.
+    std::vector<KeyCursor*> cursors(m_records.size(), nullptr);
+    for (int index : records)
+    {
+      cursors[index] = &m_cursors[m_records[index]];
+    }
+
+    // Records posing the same nodes are sampled in order by the same job. Skinned drawables pose the skeleton of their
+    // mesh, which is shared by the drawables using the mesh.
+    std::unordered_map<void*, uint> groupIndices;
+    std::vector<std::vector<int>> groups;
+    for (int index : records)
+    {
+      Entity* entity = m_records[index].first;
+      void* target = entity->m_node;
+      if (entity->IsDrawable())
+      {
+        Drawable* drawable = static_cast<Drawable*> (entity);
+        if (drawable->m_mesh->IsSkinned())
+        {
+          target = static_cast<SkinMesh*> (drawable->m_mesh.get())->m_skeleton;
+        }
+      }
+
+      auto group = groupIndices.insert({ target, (uint)groups.size() });
+      if (group.second)
+      {
+        groups.emplace_back();
+      }
+      groups[group.first->second].push_back(index);
+    }
+
+    auto SampleFn = [this, &groups, &cursors](uint begin, uint end) -> void
+    {
+      for (uint i = begin; i < end; i++)
+      {
+        for (int index : groups[i])
+        {
+          m_records[index].first->SetPose(m_records[index].second, cursors[index]);
+        }
+      }
+    };
+
+    GetJobSystem()->ParallelFor((uint)groups.size(), SampleFn, 0, "SampleAnimations");
+  }
+
   int AnimationPlayer::Exist(const AnimRecord& record) const
   {
     int index = 0;
@@ -3,6 +3,8 @@
 #include "Types.h"
 #include "Resource.h"
 #include "ResourceManager.h"
+#include "AnimationCompression.h"
+#include <map>
 
 namespace ToolKit
 {
@@ -14,6 +16,7 @@ namespace ToolKit
   {
   public:
     int m_frame = 0;
+    float m_time = 0.0f; // Seconds, frame over the fps of the animation. Set on load.
     Vec3 m_position;
     Quaternion m_rotation;
     Vec3 m_scale;
@@ -26,10 +29,17 @@ namespace ToolKit
     Animation(String file);
     ~Animation();
 
-    void GetCurrentPose(Node* node); // interpolate keys based on time.
-    void GetCurrentPose(Skeleton* skeleton);
+    // Interpolate keys based on time. The cursor keeps the keys found for the caller, one per bone. Forward playback
+    // mostly stays between the same keys or moves to the next ones, those are checked before searching.
+    void GetCurrentPose(Node* node, KeyCursor* cursor = nullptr);
+    void GetCurrentPose(Skeleton* skeleton, KeyCursor* cursor = nullptr);
     float GetDuration();
 
+    // Replaces the keys with compressed tracks, sampled as they are. Files written by the importer with a tolerance are
+    // compressed on load.
+    AnimationCompressionReport Compress(const AnimationCompressionSettings& settings);
+    bool IsCompressed() const;
+
     virtual void Load() override;
     virtual void Init(bool flushClientSideArray = true) override;
     virtual void UnInit() override;
@@ -37,7 +47,8 @@ namespace ToolKit
 
 
   private:
-    void GetNearestKeys(const std::vector<Key>& keys, int& key1, int& key2, float& ratio); // Finds nearest keys and ratio to current time.
+    // Interpolates the keys around the current time. Keys are searched in O(log n) unless the cursor hits.
+    bool SampleKeys(const std::vector<Key>& keys, int* cursor, Vec3& translation, Quaternion& rotation, Vec3& scale) const;
 
   public:
     enum class State
@@ -48,7 +59,8 @@ namespace ToolKit
       Stop
     };
 
-    std::unordered_map<String, std::vector<Key> > m_keys;
+    std::unordered_map<String, std::vector<Key> > m_keys; // Empty once compressed.
+    std::unordered_map<String, AnimationTrack> m_tracks;
     float m_fps = 30.0f;
     float m_currentTime = 0.0f; // Seconds
     float m_duration = 0.0f;
@@ -67,10 +79,16 @@ namespace ToolKit
   public:
     void AddRecord(Entity* entity, Animation* anim);
     void RemoveRecord(Entity* entity, Animation* anim);
-    void Update(float deltaTimeSec);
+    void Update(float deltaTimeSec); // Advances the records, then samples their poses in parallel.
     int Exist(const AnimRecord& recrod) const; // -1 For not exist. Otherwise the record index.
 
+  private:
+    void SamplePoses(const std::vector<int>& records);
+
   public:
     std::vector<AnimRecord> m_records;
+
+  private:
+    std::map<AnimRecord, KeyCursor> m_cursors; // Dropped with their records, stale ones only cost a search.
   };
 }
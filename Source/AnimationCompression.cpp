@@ -0,0 +1,311 @@
+#include "stdafx.h"
+#include "AnimationCompression.h"
+#include "Animation.h"
+#include "MathUtil.h"
+#include <sstream>
+#include <iomanip>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  // Dropped keys are checked against the keys around them, a long run of droppable keys is cut to bound the work.
+  static const int g_maxKeySpan = 256;
+
+  // Angle of the rotation between the two, acos of the dot product loses the small angles to float precision.
+  static float RotationDifference(const Quaternion& q1, const Quaternion& q2)
+  {
+    Quaternion diff = q1 * glm::inverse(q2);
+    return 2.0f * glm::atan(glm::length(Vec3(diff.x, diff.y, diff.z)), glm::abs(diff.w));
+  }
+
+  static uint16 Quantize(float val, float min, float range)
+  {
+    if (range <= 0.0f)
+    {
+      return 0;
+    }
+
+    return (uint16)glm::round(glm::clamp((val - min) / range, 0.0f, 1.0f) * 65535.0f);
+  }
+
+  static float Dequantize(uint16 val, float min, float range)
+  {
+    return min + val / 65535.0f * range;
+  }
+
+  static void PackVec(const Vec3& vec, const Vec3& min, const Vec3& range, std::vector<uint16>& packed)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      packed.push_back(Quantize(vec[i], min[i], range[i]));
+    }
+  }
+
+  static Vec3 UnpackVec(const uint16* packed, const Vec3& min, const Vec3& range)
+  {
+    return Vec3
+    (
+      Dequantize(packed[0], min.x, range.x),
+      Dequantize(packed[1], min.y, range.y),
+      Dequantize(packed[2], min.z, range.z)
+    );
+  }
+
+  // Smallest three. The largest component is made positive, q and -q being the same rotation, and left out. The other
+  // three are within +-1/sqrt(2). The index of the largest one goes into the top bits of the first two.
+  static void PackRotation(const Quaternion& rotation, std::vector<uint16>& packed)
+  {
+    Quaternion q = glm::normalize(rotation);
+    float comps[4] = { q.x, q.y, q.z, q.w };
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+      if (glm::abs(comps[i]) > glm::abs(comps[largest]))
+      {
+        largest = i;
+      }
+    }
+
+    float sign = comps[largest] < 0.0f ? -1.0f : 1.0f;
+    uint16 vals[3];
+    for (int i = 0, j = 0; i < 4; i++)
+    {
+      if (i != largest)
+      {
+        float val = glm::clamp(comps[i] * sign * glm::root_two<float>(), -1.0f, 1.0f);
+        vals[j++] = (uint16)glm::round((val * 0.5f + 0.5f) * 32767.0f);
+      }
+    }
+
+    packed.push_back(vals[0] | (uint16)((largest >> 1) << 15));
+    packed.push_back(vals[1] | (uint16)((largest & 1) << 15));
+    packed.push_back(vals[2]);
+  }
+
+  static Quaternion UnpackRotation(const uint16* packed)
+  {
+    int largest = ((packed[0] >> 15) << 1) | (packed[1] >> 15);
+    float vals[3];
+    float sum = 0.0f;
+    for (int i = 0; i < 3; i++)
+    {
+      vals[i] = ((packed[i] & 0x7FFF) / 32767.0f * 2.0f - 1.0f) / glm::root_two<float>();
+      sum += vals[i] * vals[i];
+    }
+
+    float comps[4];
+    for (int i = 0, j = 0; i < 4; i++)
+    {
+      comps[i] = i == largest ? glm::sqrt(glm::max(1.0f - sum, 0.0f)) : vals[j++];
+    }
+
+    return Quaternion(comps[3], comps[0], comps[1], comps[2]);
+  }
+
+  static float KeyTime(const float& time)
+  {
+    return time;
+  }
+
+  bool AnimationTrack::Sample(float time, int* cursor, Vec3& translation, Quaternion& rotation, Vec3& scale) const
+  {
+    int key1;
+    float ratio;
+    if (!FindKeys(m_times, KeyTime, time, cursor, key1, ratio))
+    {
+      return false;
+    }
+
+    int key2 = key1 + 1;
+    if (m_translations.empty())
+    {
+      translation = m_translationMin;
+    }
+    else
+    {
+      Vec3 t1 = UnpackVec(&m_translations[key1 * 3], m_translationMin, m_translationRange);
+      Vec3 t2 = UnpackVec(&m_translations[key2 * 3], m_translationMin, m_translationRange);
+      translation = Interpolate(t1, t2, ratio);
+    }
+
+    if (m_rotations.empty())
+    {
+      rotation = m_rotation;
+    }
+    else
+    {
+      rotation = glm::slerp(UnpackRotation(&m_rotations[key1 * 3]), UnpackRotation(&m_rotations[key2 * 3]), ratio);
+    }
+
+    if (m_scales.empty())
+    {
+      scale = m_scaleMin;
+    }
+    else
+    {
+      Vec3 s1 = UnpackVec(&m_scales[key1 * 3], m_scaleMin, m_scaleRange);
+      Vec3 s2 = UnpackVec(&m_scales[key2 * 3], m_scaleMin, m_scaleRange);
+      scale = Interpolate(s1, s2, ratio);
+    }
+
+    return true;
+  }
+
+  size_t AnimationTrack::GetByteSize() const
+  {
+    size_t size = sizeof(AnimationTrack);
+    size += m_times.size() * sizeof(float);
+    size += (m_translations.size() + m_rotations.size() + m_scales.size()) * sizeof(uint16);
+    return size;
+  }
+
+  float AnimationCompressionReport::GetRatio() const
+  {
+    return compressedBytes > 0 ? (float)rawBytes / (float)compressedBytes : 0.0f;
+  }
+
+  String AnimationCompressionReport::ToString() const
+  {
+    std::stringstream str;
+    str << "keys: " << keptKeys << " / " << keys << ", constant channels: " << constantChannels << " / " << channels;
+    str << ", bytes: " << compressedBytes << " / " << rawBytes << std::fixed << std::setprecision(2) << " (" << GetRatio() << "x)";
+    str << std::setprecision(6) << ", max error t: " << maxTranslationError << " r: " << maxRotationError << " s: " << maxScaleError;
+    return str.str();
+  }
+
+  AnimationTrack CompressTrack(const std::vector<Key>& keys, const AnimationCompressionSettings& settings, AnimationCompressionReport& report)
+  {
+    AnimationTrack track;
+    int count = (int)keys.size();
+    report.keys += count;
+    report.channels += 3;
+    report.rawBytes += sizeof(std::vector<Key>) + keys.size() * sizeof(Key);
+    if (count == 0)
+    {
+      report.compressedBytes += track.GetByteSize();
+      return track;
+    }
+
+    // Constant channels.
+    const Key& first = keys.front();
+    bool constTranslation = true;
+    bool constRotation = true;
+    bool constScale = true;
+    for (const Key& key : keys)
+    {
+      constTranslation = constTranslation && glm::length(key.m_position - first.m_position) <= settings.translationTolerance;
+      constRotation = constRotation && RotationDifference(key.m_rotation, first.m_rotation) <= settings.rotationTolerance;
+      constScale = constScale && glm::length(key.m_scale - first.m_scale) <= settings.scaleTolerance;
+    }
+
+    // Redundant keys. A key is dropped while the last kept key and the next key interpolate all the keys between them.
+    auto WithinToleranceFn = [&keys, &settings, constTranslation, constRotation, constScale](int key1, int key2) -> bool
+    {
+      float span = keys[key2].m_time - keys[key1].m_time;
+      for (int i = key1 + 1; i < key2; i++)
+      {
+        float ratio = span > 0.0f ? (keys[i].m_time - keys[key1].m_time) / span : 0.0f;
+        if (!constTranslation)
+        {
+          Vec3 t = Interpolate(keys[key1].m_position, keys[key2].m_position, ratio);
+          if (glm::length(t - keys[i].m_position) > settings.translationTolerance)
+          {
+            return false;
+          }
+        }
+
+        if (!constRotation)
+        {
+          Quaternion r = glm::slerp(keys[key1].m_rotation, keys[key2].m_rotation, ratio);
+          if (RotationDifference(r, keys[i].m_rotation) > settings.rotationTolerance)
+          {
+            return false;
+          }
+        }
+
+        if (!constScale)
+        {
+          Vec3 s = Interpolate(keys[key1].m_scale, keys[key2].m_scale, ratio);
+          if (glm::length(s - keys[i].m_scale) > settings.scaleTolerance)
+          {
+            return false;
+          }
+        }
+      }
+
+      return true;
+    };
+
+    std::vector<int> kept = { 0 };
+    for (int i = 2; i < count; i++)
+    {
+      if (i - kept.back() > g_maxKeySpan || !WithinToleranceFn(kept.back(), i))
+      {
+        kept.push_back(i - 1);
+      }
+    }
+
+    if (count > 1)
+    {
+      kept.push_back(count - 1);
+    }
+
+    // Ranges of the kept keys.
+    Vec3 tMin(FLT_MAX), tMax(-FLT_MAX), sMin(FLT_MAX), sMax(-FLT_MAX);
+    for (int i : kept)
+    {
+      tMin = glm::min(tMin, keys[i].m_position);
+      tMax = glm::max(tMax, keys[i].m_position);
+      sMin = glm::min(sMin, keys[i].m_scale);
+      sMax = glm::max(sMax, keys[i].m_scale);
+    }
+
+    track.m_translationMin = constTranslation ? first.m_position : tMin;
+    track.m_translationRange = constTranslation ? Vec3() : tMax - tMin;
+    track.m_rotation = first.m_rotation;
+    track.m_scaleMin = constScale ? first.m_scale : sMin;
+    track.m_scaleRange = constScale ? Vec3() : sMax - sMin;
+
+    for (int i : kept)
+    {
+      const Key& key = keys[i];
+      track.m_times.push_back(key.m_time);
+      if (!constTranslation)
+      {
+        PackVec(key.m_position, track.m_translationMin, track.m_translationRange, track.m_translations);
+      }
+
+      if (!constRotation)
+      {
+        PackRotation(key.m_rotation, track.m_rotations);
+      }
+
+      if (!constScale)
+      {
+        PackVec(key.m_scale, track.m_scaleMin, track.m_scaleRange, track.m_scales);
+      }
+    }
+
+    report.keptKeys += (uint)kept.size();
+    report.constantChannels += (uint)constTranslation + (uint)constRotation + (uint)constScale;
+    report.compressedBytes += track.GetByteSize();
+
+    // Errors at the original keys.
+    int cursor = 0;
+    for (const Key& key : keys)
+    {
+      Vec3 t, s;
+      Quaternion r;
+      if (track.Sample(key.m_time, &cursor, t, r, s))
+      {
+        report.maxTranslationError = glm::max(report.maxTranslationError, glm::length(t - key.m_position));
+        report.maxRotationError = glm::max(report.maxRotationError, RotationDifference(r, glm::normalize(key.m_rotation)));
+        report.maxScaleError = glm::max(report.maxScaleError, glm::length(s - key.m_scale));
+      }
+    }
+
+    return track;
+  }
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Types.h"
+
+namespace ToolKit
+{
+
+  class Key;
+
+  // Keys of a bone after compression, sampled without expanding them. Rotations keep their three smallest components,
+  // 15 bits each, the largest one is rebuilt from the unit length. Translations and scales are 16 bits per component
+  // over the range of the track. A channel that doesn't change is stored once, in place of its range.
+  class AnimationTrack
+  {
+  public:
+    bool Sample(float time, int* cursor, Vec3& translation, Quaternion& rotation, Vec3& scale) const; // False outside of the keys.
+    size_t GetByteSize() const;
+
+  public:
+    std::vector<float> m_times; // Seconds.
+    std::vector<uint16> m_translations; // Three per key, empty for a constant channel.
+    std::vector<uint16> m_rotations;
+    std::vector<uint16> m_scales;
+    Vec3 m_translationMin; // Value of the channel when constant.
+    Vec3 m_translationRange;
+    Quaternion m_rotation; // Value of the channel when constant.
+    Vec3 m_scaleMin; // Value of the channel when constant.
+    Vec3 m_scaleRange;
+  };
+
+  // Keys are dropped while the neighbouring keys interpolate them within the tolerances. Quantization adds up to half a
+  // step on top, which is why the errors are measured after the fact.
+  struct AnimationCompressionSettings
+  {
+    float translationTolerance = 0.001f; // Units.
+    float rotationTolerance = 0.001f; // Radians.
+    float scaleTolerance = 0.001f;
+  };
+
+  // Errors are the largest differences between the original keys and the compressed track sampled at their times.
+  struct AnimationCompressionReport
+  {
+    uint keys = 0;
+    uint keptKeys = 0;
+    uint channels = 0;
+    uint constantChannels = 0;
+    size_t rawBytes = 0;
+    size_t compressedBytes = 0;
+    float maxTranslationError = 0.0f;
+    float maxRotationError = 0.0f; // Radians.
+    float maxScaleError = 0.0f;
+
+    float GetRatio() const; // Raw over compressed size.
+    String ToString() const;
+  };
+
+  // Keys must be sorted by time. Adds the sizes and errors of the track to the report.
+  AnimationTrack CompressTrack(const std::vector<Key>& keys, const AnimationCompressionSettings& settings, AnimationCompressionReport& report);
+
+  // Finds the keys around the time and the ratio between them, false when the time is outside of the keys. The keys of
+  // the last search and the pair after them are checked before a binary search, forward playback mostly hits them.
+  template<typename T, typename TimeFn>
+  bool FindKeys(const std::vector<T>& keys, TimeFn timeFn, float time, int* cursor, int& key1, float& ratio)
+  {
+    int count = (int)keys.size();
+    if (count < 2 || time < timeFn(keys.front()) || time > timeFn(keys.back()))
+    {
+      return false;
+    }
+
+    int index = -1;
+    if (cursor != nullptr)
+    {
+      for (int i = glm::max(*cursor, 0); i < *cursor + 2 && i + 1 < count; i++)
+      {
+        if (timeFn(keys[i]) <= time && time <= timeFn(keys[i + 1]))
+        {
+          index = i;
+          break;
+        }
+      }
+    }
+
+    if (index == -1)
+    {
+      auto next = std::upper_bound
+      (
+        keys.begin() + 1,
+        keys.end(),
+        time,
+        [&timeFn](float t, const T& key) -> bool
+        {
+          return t < timeFn(key);
+        }
+      );
+      index = glm::min((int)(next - keys.begin()) - 1, count - 2);
+    }
+
+    if (cursor != nullptr)
+    {
+      *cursor = index;
+    }
+
+    key1 = index;
+    float time1 = timeFn(keys[index]);
+    float span = timeFn(keys[index + 1]) - time1;
+    ratio = span > 0.0f ? (time - time1) / span : 0.0f;
+    return true;
+  }
+
+}
@@ -0,0 +1,604 @@
+#include "stdafx.h"
+#include "BVH.h"
+#include <algorithm>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  // Half of the surface area, only compared against each other.
+  static float AreaOf(const BoundingBox& box)
+  {
+    Vec3 d = box.max - box.min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+
+  static BoundingBox Union(const BoundingBox& a, const BoundingBox& b)
+  {
+    BoundingBox box;
+    box.min = glm::min(a.min, b.min);
+    box.max = glm::max(a.max, b.max);
+    return box;
+  }
+
+  static bool Overlaps(const BoundingBox& a, const BoundingBox& b)
+  {
+    return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+  }
+
+  // Distance where the ray enters the box, 0 if it starts inside, FLT_MAX if it misses.
+  static float RayEntry(const Vec3& origin, const Vec3& invDir, const BoundingBox& box)
+  {
+    Vec3 t1 = (box.min - origin) * invDir;
+    Vec3 t2 = (box.max - origin) * invDir;
+    Vec3 tNear = glm::min(t1, t2);
+    Vec3 tFar = glm::max(t1, t2);
+
+    float tmin = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+    float tmax = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+    return tmin <= tmax ? tmin : FLT_MAX;
+  }
+
+  BVH::Proxy BVH::Insert(Entity* entity, const BoundingBox& box)
+  {
+    Proxy proxy = (Proxy)m_proxyNodes.size();
+    if (!m_freeProxies.empty())
+    {
+      proxy = m_freeProxies.back();
+      m_freeProxies.pop_back();
+    }
+    else
+    {
+      m_proxyNodes.push_back(-1);
+    }
+
+    int leaf = AllocateNode();
+    TreeNode& node = m_nodes[leaf];
+    node.box = box;
+    node.entity = entity;
+    node.proxy = proxy;
+    m_proxyNodes[proxy] = leaf;
+
+    InsertLeaf(leaf);
+    return proxy;
+  }
+
+  void BVH::Remove(Proxy proxy)
+  {
+    int leaf = m_proxyNodes[proxy];
+    assert(leaf != -1);
+
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    m_proxyNodes[proxy] = -1;
+    m_freeProxies.push_back(proxy);
+  }
+
+  void BVH::Refit(Proxy proxy, const BoundingBox& box)
+  {
+    int leaf = m_proxyNodes[proxy];
+    m_nodes[leaf].box = box;
+    RefitUp(m_nodes[leaf].parent);
+  }
+
+  const BoundingBox& BVH::GetBox(Proxy proxy) const
+  {
+    return m_nodes[m_proxyNodes[proxy]].box;
+  }
+
+  void BVH::Clear()
+  {
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = -1;
+    m_proxyNodes.clear();
+    m_freeProxies.clear();
+    m_internalArea = 0.0f;
+    m_builtCost = 0.0f;
+  }
+
+  void BVH::Rebuild()
+  {
+    std::vector<BuildItem> items;
+    items.reserve(m_proxyNodes.size() - m_freeProxies.size());
+    for (const TreeNode& node : m_nodes)
+    {
+      if (node.proxy != InvalidProxy)
+      {
+        items.push_back({ node.box, (node.box.min + node.box.max) * 0.5f, node.entity, node.proxy });
+      }
+    }
+
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_internalArea = 0.0f;
+    m_root = -1;
+    if (!items.empty())
+    {
+      m_nodes.reserve(items.size() * 2 - 1);
+      m_root = Build(items, 0, (int)items.size(), -1);
+    }
+
+    m_builtCost = GetCost();
+    m_rebuilds++;
+  }
+
+  bool BVH::RebuildIfDegraded()
+  {
+    if (m_root == -1 || m_nodes[m_root].left == -1)
+    {
+      return false;
+    }
+
+    if (GetCost() > m_builtCost * m_rebuildRatio)
+    {
+      Rebuild();
+      return true;
+    }
+
+    return false;
+  }
+
+  Entity* BVH::RayCast(const Ray& ray, const RayHitFn& hitFn, float& t) const
+  {
+    t = FLT_MAX;
+    Entity* closest = nullptr;
+    if (m_root == -1)
+    {
+      return closest;
+    }
+
+    Vec3 invDir = 1.0f / ray.direction;
+    float rootEntry = RayEntry(ray.position, invDir, m_nodes[m_root].box);
+    if (rootEntry == FLT_MAX)
+    {
+      return closest;
+    }
+
+    std::vector<std::pair<int, float>> stack;
+    stack.reserve(64);
+    stack.push_back({ m_root, rootEntry });
+    while (!stack.empty())
+    {
+      std::pair<int, float> top = stack.back();
+      stack.pop_back();
+
+      // Closer hit found after the push.
+      if (top.second >= t)
+      {
+        continue;
+      }
+
+      const TreeNode& node = m_nodes[top.first];
+      if (node.left == -1)
+      {
+        float hitT = 0.0f;
+        if (hitFn(node.entity, hitT) && hitT > 0.0f && hitT < t)
+        {
+          t = hitT;
+          closest = node.entity;
+        }
+        continue;
+      }
+
+      float leftEntry = RayEntry(ray.position, invDir, m_nodes[node.left].box);
+      float rightEntry = RayEntry(ray.position, invDir, m_nodes[node.right].box);
+
+      // Nearer child goes on top.
+      int nearChild = node.left;
+      int farChild = node.right;
+      if (rightEntry < leftEntry)
+      {
+        std::swap(nearChild, farChild);
+        std::swap(leftEntry, rightEntry);
+      }
+
+      if (rightEntry < t)
+      {
+        stack.push_back({ farChild, rightEntry });
+      }
+
+      if (leftEntry < t)
+      {
+        stack.push_back({ nearChild, leftEntry });
+      }
+    }
+
+    return closest;
+  }
+
+  void BVH::FrustumQuery(const Frustum& frustum, const FrustumFn& fn) const
+  {
+    if (m_root == -1)
+    {
+      return;
+    }
+
+    bool stop = false;
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+    while (!stack.empty() && !stop)
+    {
+      int index = stack.back();
+      stack.pop_back();
+
+      const TreeNode& node = m_nodes[index];
+      IntersectResult res = FrustumBoxIntersection(frustum, node.box);
+      if (res == IntersectResult::Outside)
+      {
+        continue;
+      }
+
+      if (res == IntersectResult::Inside || node.left == -1)
+      {
+        ReportSubtree(index, res, fn, stop);
+        continue;
+      }
+
+      stack.push_back(node.right);
+      stack.push_back(node.left);
+    }
+  }
+
+  void BVH::BoxQuery(const BoundingBox& box, const BoxFn& fn) const
+  {
+    if (m_root == -1)
+    {
+      return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+    while (!stack.empty())
+    {
+      int index = stack.back();
+      stack.pop_back();
+
+      const TreeNode& node = m_nodes[index];
+      if (!Overlaps(node.box, box))
+      {
+        continue;
+      }
+
+      if (node.left == -1)
+      {
+        if (!fn(node.entity))
+        {
+          return;
+        }
+        continue;
+      }
+
+      stack.push_back(node.right);
+      stack.push_back(node.left);
+    }
+  }
+
+  BVH::Stats BVH::GetStats() const
+  {
+    Stats stats;
+    stats.leafs = (uint)(m_proxyNodes.size() - m_freeProxies.size());
+    stats.height = GetHeight(m_root);
+    stats.rebuilds = m_rebuilds;
+    stats.cost = GetCost();
+    stats.builtCost = m_builtCost;
+    return stats;
+  }
+
+  int BVH::AllocateNode()
+  {
+    if (!m_freeNodes.empty())
+    {
+      int index = m_freeNodes.back();
+      m_freeNodes.pop_back();
+      return index;
+    }
+
+    m_nodes.emplace_back();
+    return (int)m_nodes.size() - 1;
+  }
+
+  void BVH::FreeNode(int index)
+  {
+    m_nodes[index] = TreeNode();
+    m_freeNodes.push_back(index);
+  }
+
+  void BVH::InsertLeaf(int leaf)
+  {
+    if (m_root == -1)
+    {
+      m_root = leaf;
+      m_nodes[leaf].parent = -1;
+      return;
+    }
+
+    // Descend while pushing the leaf down is cheaper than pairing it with the current node. Every ancestor grows by
+    // the same amount whichever child is taken, that part is inherited by both children.
+    BoundingBox box = m_nodes[leaf].box;
+    int sibling = m_root;
+    while (m_nodes[sibling].left != -1)
+    {
+      const TreeNode& node = m_nodes[sibling];
+      float area = AreaOf(node.box);
+      float combined = AreaOf(Union(node.box, box));
+      float cost = 2.0f * combined;
+      float inherited = 2.0f * (combined - area);
+
+      auto ChildCostFn = [this, &box, inherited](int child) -> float
+      {
+        const TreeNode& childNode = m_nodes[child];
+        float grown = AreaOf(Union(childNode.box, box));
+        if (childNode.left == -1)
+        {
+          return grown + inherited;
+        }
+
+        return grown - AreaOf(childNode.box) + inherited;
+      };
+
+      float leftCost = ChildCostFn(node.left);
+      float rightCost = ChildCostFn(node.right);
+      if (cost < leftCost && cost < rightCost)
+      {
+        break;
+      }
+
+      sibling = leftCost < rightCost ? node.left : node.right;
+    }
+
+    int oldParent = m_nodes[sibling].parent;
+    int parent = AllocateNode();
+    TreeNode& parentNode = m_nodes[parent];
+    parentNode.parent = oldParent;
+    parentNode.left = sibling;
+    parentNode.right = leaf;
+    parentNode.box = Union(m_nodes[sibling].box, box);
+    m_internalArea += AreaOf(parentNode.box);
+
+    m_nodes[sibling].parent = parent;
+    m_nodes[leaf].parent = parent;
+    if (oldParent == -1)
+    {
+      m_root = parent;
+    }
+    else
+    {
+      TreeNode& oldParentNode = m_nodes[oldParent];
+      if (oldParentNode.left == sibling)
+      {
+        oldParentNode.left = parent;
+      }
+      else
+      {
+        oldParentNode.right = parent;
+      }
+    }
+
+    RefitUp(oldParent);
+  }
+
+  void BVH::RemoveLeaf(int leaf)
+  {
+    if (leaf == m_root)
+    {
+      m_root = -1;
+      return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+    m_internalArea -= AreaOf(m_nodes[parent].box);
+
+    m_nodes[sibling].parent = grandParent;
+    if (grandParent == -1)
+    {
+      m_root = sibling;
+    }
+    else
+    {
+      TreeNode& grandParentNode = m_nodes[grandParent];
+      if (grandParentNode.left == parent)
+      {
+        grandParentNode.left = sibling;
+      }
+      else
+      {
+        grandParentNode.right = sibling;
+      }
+    }
+
+    FreeNode(parent);
+    RefitUp(grandParent);
+  }
+
+  void BVH::RefitUp(int index)
+  {
+    while (index != -1)
+    {
+      TreeNode& node = m_nodes[index];
+      BoundingBox box = Union(m_nodes[node.left].box, m_nodes[node.right].box);
+
+      // Ancestors only depend on their children.
+      if (box.min == node.box.min && box.max == node.box.max)
+      {
+        break;
+      }
+
+      m_internalArea += AreaOf(box) - AreaOf(node.box);
+      node.box = box;
+      index = node.parent;
+    }
+  }
+
+  int BVH::Build(std::vector<BuildItem>& items, int begin, int end, int parent)
+  {
+    int index = AllocateNode();
+    m_nodes[index].parent = parent;
+    if (end - begin == 1)
+    {
+      const BuildItem& item = items[begin];
+      TreeNode& node = m_nodes[index];
+      node.box = item.box;
+      node.entity = item.entity;
+      node.proxy = item.proxy;
+      m_proxyNodes[item.proxy] = index;
+      return index;
+    }
+
+    BoundingBox centroids;
+    for (int i = begin; i < end; i++)
+    {
+      centroids.min = glm::min(centroids.min, items[i].centroid);
+      centroids.max = glm::max(centroids.max, items[i].centroid);
+    }
+
+    Vec3 extent = centroids.max - centroids.min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    // Binned surface area heuristic along the widest centroid axis.
+    int mid = -1;
+    if (extent[axis] > 0.0f)
+    {
+      const int binCount = 16;
+      BoundingBox bins[binCount];
+      int counts[binCount] = {};
+      float scale = binCount / extent[axis];
+      float axisMin = centroids.min[axis];
+      auto BinOfFn = [scale, axisMin, axis](const BuildItem& item) -> int
+      {
+        return glm::min((int)((item.centroid[axis] - axisMin) * scale), binCount - 1);
+      };
+
+      for (int i = begin; i < end; i++)
+      {
+        int bin = BinOfFn(items[i]);
+        counts[bin]++;
+        bins[bin] = Union(bins[bin], items[i].box);
+      }
+
+      // Areas and counts right of each split.
+      float rightAreas[binCount] = {};
+      int rightCounts[binCount] = {};
+      BoundingBox accumulated;
+      int count = 0;
+      for (int bin = binCount - 1; bin > 0; bin--)
+      {
+        accumulated = Union(accumulated, bins[bin]);
+        count += counts[bin];
+        rightAreas[bin] = count > 0 ? AreaOf(accumulated) : 0.0f;
+        rightCounts[bin] = count;
+      }
+
+      float bestCost = FLT_MAX;
+      int bestSplit = -1;
+      accumulated = BoundingBox();
+      count = 0;
+      for (int bin = 1; bin < binCount; bin++)
+      {
+        accumulated = Union(accumulated, bins[bin - 1]);
+        count += counts[bin - 1];
+        if (count == 0 || rightCounts[bin] == 0)
+        {
+          continue;
+        }
+
+        float cost = AreaOf(accumulated) * count + rightAreas[bin] * rightCounts[bin];
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestSplit = bin;
+        }
+      }
+
+      if (bestSplit != -1)
+      {
+        auto split = std::partition
+        (
+          items.begin() + begin,
+          items.begin() + end,
+          [&BinOfFn, bestSplit](const BuildItem& item) -> bool
+          {
+            return BinOfFn(item) < bestSplit;
+          }
+        );
+        mid = (int)(split - items.begin());
+      }
+    }
+
+    // Coincident centroids, split in half.
+    if (mid == -1)
+    {
+      mid = begin + (end - begin) / 2;
+      std::nth_element
+      (
+        items.begin() + begin,
+        items.begin() + mid,
+        items.begin() + end,
+        [axis](const BuildItem& a, const BuildItem& b) -> bool
+        {
+          return a.centroid[axis] < b.centroid[axis];
+        }
+      );
+    }
+
+    int left = Build(items, begin, mid, index);
+    int right = Build(items, mid, end, index);
+
+    TreeNode& node = m_nodes[index];
+    node.left = left;
+    node.right = right;
+    node.box = Union(m_nodes[left].box, m_nodes[right].box);
+    m_internalArea += AreaOf(node.box);
+    return index;
+  }
+
+  float BVH::GetCost() const
+  {
+    if (m_root == -1)
+    {
+      return 0.0f;
+    }
+
+    float rootArea = AreaOf(m_nodes[m_root].box);
+    return rootArea > 0.0f ? m_internalArea / rootArea : 0.0f;
+  }
+
+  uint BVH::GetHeight(int index) const
+  {
+    if (index == -1)
+    {
+      return 0;
+    }
+
+    const TreeNode& node = m_nodes[index];
+    if (node.left == -1)
+    {
+      return 1;
+    }
+
+    return 1 + glm::max(GetHeight(node.left), GetHeight(node.right));
+  }
+
+  void BVH::ReportSubtree(int index, IntersectResult result, const FrustumFn& fn, bool& stop) const
+  {
+    if (stop)
+    {
+      return;
+    }
+
+    const TreeNode& node = m_nodes[index];
+    if (node.left == -1)
+    {
+      stop = !fn(node.entity, result);
+      return;
+    }
+
+    ReportSubtree(node.left, result, fn, stop);
+    ReportSubtree(node.right, result, fn, stop);
+  }
+
+}
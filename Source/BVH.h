@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Types.h"
+#include "MathUtil.h"
+#include <functional>
+
+namespace ToolKit
+{
+
+  // Dynamic bounding volume hierarchy over entity world bounds, one entity per leaf. Entities are inserted next to the
+  // sibling that grows the tree's surface area the least. Moving entities refit their ancestors without restructuring,
+  // the tree is rebuilt top down with the surface area heuristic once its cost grows past m_rebuildRatio times the cost
+  // of the last build. Proxies returned by Insert stay valid across rebuilds.
+  class BVH
+  {
+  public:
+    typedef uint Proxy;
+    static const Proxy InvalidProxy = (Proxy)-1;
+
+    typedef std::function<bool(Entity* entity, float& t)> RayHitFn; // Returns true with t set if the entity is hit.
+
+    // Called for the entities inside and intersecting, return false to stop the query.
+    typedef std::function<bool(Entity* entity, IntersectResult result)> FrustumFn;
+    typedef std::function<bool(Entity* entity)> BoxFn;
+
+    struct Stats
+    {
+      uint leafs = 0;
+      uint height = 0;
+      uint rebuilds = 0;
+      float cost = 0.0f; // Sum of the internal node areas relative to the root area.
+      float builtCost = 0.0f; // Cost right after the last rebuild.
+    };
+
+  public:
+    Proxy Insert(Entity* entity, const BoundingBox& box);
+    void Remove(Proxy proxy);
+    void Refit(Proxy proxy, const BoundingBox& box); // Updates the bounds of a moved entity and its ancestors.
+    const BoundingBox& GetBox(Proxy proxy) const;
+    void Clear();
+
+    void Rebuild();
+    bool RebuildIfDegraded(); // Returns true if it rebuilds.
+
+    // Returns the closest entity hitFn reports a hit for with t in (0, FLT_MAX). Subtrees farther than the closest hit are
+    // skipped, hitFn is called for every entity whose box the ray enters before that.
+    Entity* RayCast(const Ray& ray, const RayHitFn& hitFn, float& t) const;
+    void FrustumQuery(const Frustum& frustum, const FrustumFn& fn) const; // Subtrees inside the frustum are not tested.
+    void BoxQuery(const BoundingBox& box, const BoxFn& fn) const;
+
+    Stats GetStats() const;
+
+  public:
+    float m_rebuildRatio = 1.5f;
+
+  private:
+    struct TreeNode
+    {
+      BoundingBox box;
+      int parent = -1;
+      int left = -1; // -1 for leafs.
+      int right = -1;
+      Entity* entity = nullptr;
+      Proxy proxy = InvalidProxy;
+    };
+
+    struct BuildItem
+    {
+      BoundingBox box;
+      Vec3 centroid;
+      Entity* entity;
+      Proxy proxy;
+    };
+
+    int AllocateNode();
+    void FreeNode(int index);
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+    void RefitUp(int index); // Recomputes the bounds from index to the root.
+    int Build(std::vector<BuildItem>& items, int begin, int end, int parent);
+    float GetCost() const;
+    uint GetHeight(int index) const;
+    void ReportSubtree(int index, IntersectResult result, const FrustumFn& fn, bool& stop) const;
+
+  private:
+    std::vector<TreeNode> m_nodes;
+    std::vector<int> m_freeNodes;
+    int m_root = -1;
+
+    std::vector<int> m_proxyNodes; // Proxy to leaf index, -1 for free proxies.
+    std::vector<Proxy> m_freeProxies;
+
+    float m_internalArea = 0.0f; // Kept up to date by refits, exact after rebuilds.
+    float m_builtCost = 0.0f;
+    uint m_rebuilds = 0;
+  };
+
+}
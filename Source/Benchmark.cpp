@@ -0,0 +1,666 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "Animation.h"
+#include "Renderer.h"
+#include "Skeleton.h"
+#include "Drawable.h"
+#include "Directional.h"
+#include "Mesh.h"
+#include "Node.h"
+#include "Texture.h"
+#include "Util.h"
+#include "OcclusionCulling.h"
+#include "TransformSystem.h"
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  BenchmarkRunner::BenchmarkRunner(Renderer* renderer, uint width, uint height)
+  {
+    m_renderer = renderer;
+    m_target = new RenderTarget(width, height);
+    m_target->Init();
+  }
+
+  BenchmarkRunner::~BenchmarkRunner()
+  {
+    SafeDel(m_target);
+  }
+
+  bool BenchmarkRunner::LoadPath(const String& file)
+  {
+    if (!CheckFile(file))
+    {
+      return false;
+    }
+
+    XmlFile xmlFile(file.c_str());
+    XmlDocument doc;
+    doc.parse<0>(xmlFile.data());
+
+    XmlNode* root = doc.first_node("path");
+    if (root == nullptr)
+    {
+      return false;
+    }
+
+    m_path.clear();
+    for (XmlNode* node = root->first_node("key"); node; node = node->next_sibling("key"))
+    {
+      CameraKey key;
+      key.time = ReadAttr<float>(node, "t");
+      ReadVec(node->first_node("pos"), key.pos);
+      ReadVec(node->first_node("target"), key.target);
+      m_path.push_back(key);
+    }
+
+    std::sort
+    (
+      m_path.begin(),
+      m_path.end(),
+      [](const CameraKey& a, const CameraKey& b) -> bool
+      {
+        return a.time < b.time;
+      }
+    );
+
+    return !m_path.empty();
+  }
+
+  void BenchmarkRunner::OrbitPath(const BoundingBox& box, float duration)
+  {
+    Vec3 center = (box.min + box.max) * 0.5f;
+    float radius = glm::max(glm::length(box.max - box.min), 1.0f);
+
+    m_path.clear();
+    const int keyCount = 16;
+    for (int i = 0; i <= keyCount; i++)
+    {
+      float t = (float)i / (float)keyCount;
+      float angle = glm::two_pi<float>() * t;
+
+      CameraKey key;
+      key.time = duration * t;
+      key.pos = center + Vec3(glm::cos(angle) * radius, radius * 0.35f, glm::sin(angle) * radius);
+      key.target = center;
+      m_path.push_back(key);
+    }
+  }
+
+  BenchmarkRunner::Report BenchmarkRunner::Run(const EntityRawPtrArray& entities, const LightRawPtrArray& lights)
+  {
+    assert(!m_path.empty() && "Load or generate a camera path first.");
+
+    Camera cam;
+    cam.SetLens(m_fov, (float)m_target->m_width, (float)m_target->m_height);
+
+    std::vector<Drawable*> drawables;
+    for (Entity* ntt : entities)
+    {
+      if (ntt->IsDrawable())
+      {
+        drawables.push_back(static_cast<Drawable*> (ntt));
+      }
+    }
+
+    // Entities don't move during the run, world boxes are computed once. Skinned meshes and meshes without a box are
+    // always drawn.
+    std::vector<BoundingBox> boxes(drawables.size());
+    std::vector<bool> culled(drawables.size());
+    std::vector<uint8> visible(drawables.size());
+    for (size_t i = 0; i < drawables.size(); i++)
+    {
+      const BoundingBox& local = drawables[i]->m_mesh->m_aabb;
+      culled[i] = !drawables[i]->m_mesh->IsSkinned() && local.min.x <= local.max.x;
+      if (culled[i])
+      {
+        boxes[i] = drawables[i]->GetAABB(true);
+      }
+      else
+      {
+        boxes[i].min = Vec3(0.0f);
+        boxes[i].max = Vec3(0.0f);
+      }
+    }
+
+    m_renderer->SetRenderTarget(m_target, false);
+
+    m_frameTimes.clear();
+    m_frameTimes.reserve(m_frames);
+    float duration = m_path.back().time;
+    uint drawCalls = 0;
+    std::vector<uint8> pixels;
+    for (uint i = 0; i < m_warmupFrames + m_frames; i++)
+    {
+      bool recorded = i >= m_warmupFrames;
+      uint frame = recorded ? i - m_warmupFrames : 0;
+      SampleCamera(m_frames > 1 ? duration * frame / (m_frames - 1) : 0.0f, &cam);
+
+      auto start = std::chrono::high_resolution_clock::now();
+      m_renderer->BeginFrame();
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+      Frustum frustum = ExtractFrustum(cam.GetData().projection * cam.GetViewMatrix());
+      FrustumBoxesVisible(frustum, boxes.data(), boxes.size(), visible.data());
+      for (size_t j = 0; j < drawables.size(); j++)
+      {
+        if (visible[j] || !culled[j])
+        {
+          m_renderer->Render(drawables[j], &cam, lights);
+        }
+      }
+
+      m_renderer->EndFrame();
+      glFinish();
+      auto end = std::chrono::high_resolution_clock::now();
+
+      if (!recorded)
+      {
+        continue;
+      }
+
+      m_frameTimes.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+      drawCalls += m_renderer->GetFrameStats().drawCalls;
+
+      bool capture = m_captureEvery == 0 ? frame == m_frames - 1 : frame % m_captureEvery == 0;
+      if (!m_captureDir.empty() && capture)
+      {
+        m_renderer->ReadPixels(m_target, pixels);
+
+        std::stringstream name;
+        name << "frame" << std::setw(5) << std::setfill('0') << frame << ".png";
+        WritePng(m_captureDir + GetPathSeparatorAsStr() + name.str(), m_target->m_width, m_target->m_height, pixels.data());
+      }
+    }
+
+    m_renderer->SetRenderTarget(nullptr);
+
+    Report report;
+    if (m_frameTimes.empty())
+    {
+      return report;
+    }
+
+    std::vector<float> sorted = m_frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Nearest rank.
+    auto PercentileFn = [&sorted](float p) -> float
+    {
+      size_t rank = (size_t)glm::ceil(p * sorted.size());
+      return sorted[glm::clamp(rank, (size_t)1, sorted.size()) - 1];
+    };
+
+    float total = 0.0f;
+    for (float ms : sorted)
+    {
+      total += ms;
+    }
+
+    report.frames = (uint)sorted.size();
+    report.avgMs = total / sorted.size();
+    report.minMs = sorted.front();
+    report.p50Ms = PercentileFn(0.5f);
+    report.p90Ms = PercentileFn(0.9f);
+    report.p95Ms = PercentileFn(0.95f);
+    report.p99Ms = PercentileFn(0.99f);
+    report.maxMs = sorted.back();
+    report.drawCalls = (float)drawCalls / sorted.size();
+
+    return report;
+  }
+
+  String BenchmarkRunner::ToString(const Report& report)
+  {
+    std::stringstream str;
+    str << std::fixed << std::setprecision(3);
+    str << "frames: " << report.frames << "\n";
+    str << "avg: " << report.avgMs << " ms\n";
+    str << "min: " << report.minMs << " ms\n";
+    str << "p50: " << report.p50Ms << " ms\n";
+    str << "p90: " << report.p90Ms << " ms\n";
+    str << "p95: " << report.p95Ms << " ms\n";
+    str << "p99: " << report.p99Ms << " ms\n";
+    str << "max: " << report.maxMs << " ms\n";
+    str << "draw calls: " << report.drawCalls << "\n";
+    return str.str();
+  }
+
+  void BenchmarkRunner::SampleCamera(float time, Camera* cam) const
+  {
+    // Linear between the surrounding keys.
+    Vec3 pos = m_path.back().pos;
+    Vec3 target = m_path.back().target;
+    for (size_t i = 1; i < m_path.size(); i++)
+    {
+      const CameraKey& k0 = m_path[i - 1];
+      const CameraKey& k1 = m_path[i];
+      if (time <= k1.time)
+      {
+        float span = k1.time - k0.time;
+        float t = span > 0.0f ? glm::clamp((time - k0.time) / span, 0.0f, 1.0f) : 1.0f;
+        pos = glm::mix(k0.pos, k1.pos, t);
+        target = glm::mix(k0.target, k1.target, t);
+        break;
+      }
+    }
+
+    if (m_path.size() == 1)
+    {
+      pos = m_path.front().pos;
+      target = m_path.front().target;
+    }
+
+    // Camera looks down its -z.
+    Mat4 view = glm::lookAt(pos, target, Y_AXIS);
+    cam->m_node->SetTranslation(pos, TransformationSpace::TS_WORLD);
+    cam->m_node->SetOrientation(glm::quat_cast(Mat3(glm::inverse(view))), TransformationSpace::TS_WORLD);
+  }
+
+  // Scans from the first key and converts frames to seconds on the way, as Animation did before the key times.
+  void AnimationBenchmark::LinearPose(Animation* anim, Skeleton* skeleton)
+  {
+    for (Bone* bone : skeleton->m_bones)
+    {
+      auto entry = anim->m_keys.find(bone->m_name);
+      if (entry == anim->m_keys.end())
+      {
+        continue;
+      }
+
+      const std::vector<Key>& keys = entry->second;
+      for (size_t i = 1; i < keys.size(); i++)
+      {
+        float keyTime2 = keys[i].m_frame * 1.0f / anim->m_fps;
+        float keyTime1 = keys[i - 1].m_frame * 1.0f / anim->m_fps;
+        if (anim->m_currentTime >= keyTime1 && keyTime2 >= anim->m_currentTime)
+        {
+          float ratio = (anim->m_currentTime - keyTime1) / (keyTime2 - keyTime1);
+          bone->m_node->m_translation = Interpolate(keys[i - 1].m_position, keys[i].m_position, ratio);
+          bone->m_node->m_orientation = glm::slerp(keys[i - 1].m_rotation, keys[i].m_rotation, ratio);
+          bone->m_node->m_scale = Interpolate(keys[i - 1].m_scale, keys[i].m_scale, ratio);
+          bone->m_node->SetLocalDirty();
+          break;
+        }
+      }
+    }
+  }
+
+  std::vector<AnimationBenchmark::Timing> AnimationBenchmark::Run()
+  {
+    Skeleton skeleton;
+    for (uint i = 0; i < m_bones; i++)
+    {
+      skeleton.AddBone(new Bone("bone" + std::to_string(i)));
+    }
+
+    std::vector<Timing> timings;
+    for (uint keyCount : m_keyCounts)
+    {
+      Animation anim;
+      for (uint i = 0; i < m_bones; i++)
+      {
+        std::vector<Key>& keys = anim.m_keys[skeleton.m_bones[i]->m_name];
+        keys.resize(glm::max(keyCount, 2u));
+        for (uint k = 0; k < (uint)keys.size(); k++)
+        {
+          float phase = (float)(k + i);
+          keys[k].m_frame = (int)k;
+          keys[k].m_time = k / anim.m_fps;
+          keys[k].m_position = Vec3(glm::sin(phase), glm::cos(phase), phase * 0.01f);
+          keys[k].m_rotation = glm::angleAxis(phase * 0.1f, Y_AXIS);
+          keys[k].m_scale = Vec3(1.0f);
+        }
+      }
+      anim.m_duration = anim.m_keys.begin()->second.back().m_time;
+
+      auto TimeFn = [this, &anim](const std::function<void()>& poseFn) -> float
+      {
+        auto start = std::chrono::high_resolution_clock::now();
+        anim.m_currentTime = anim.m_duration / 3.0f;
+        for (uint i = 0; i < m_samples; i++)
+        {
+          anim.m_currentTime = glm::mod(anim.m_currentTime + 1.0f / 60.0f, anim.m_duration);
+          poseFn();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        float ns = std::chrono::duration<float, std::nano>(end - start).count();
+        return ns / (float)(m_samples * m_bones);
+      };
+
+      KeyCursor cursor;
+      Timing timing;
+      timing.keys = keyCount;
+      timing.linearNs = TimeFn([&anim, &skeleton]() -> void { LinearPose(&anim, &skeleton); });
+      timing.searchNs = TimeFn([&anim, &skeleton]() -> void { anim.GetCurrentPose(&skeleton); });
+      timing.cursorNs = TimeFn([&anim, &skeleton, &cursor]() -> void { anim.GetCurrentPose(&skeleton, &cursor); });
+
+      // The cursor indexes the raw keys, tracks keep fewer of them.
+      anim.Compress(AnimationCompressionSettings());
+      cursor.clear();
+      timing.compressedNs = TimeFn([&anim, &skeleton, &cursor]() -> void { anim.GetCurrentPose(&skeleton, &cursor); });
+      timings.push_back(timing);
+    }
+
+    return timings;
+  }
+
+  std::vector<TransformBenchmark::Timing> TransformBenchmark::Run()
+  {
+    if (m_nodes == 0)
+    {
+      return std::vector<Timing>();
+    }
+
+    std::mt19937 generator(m_nodes);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto RandomVecFn = [&generator, &unit](float range) -> Vec3
+    {
+      return Vec3(unit(generator) - 0.5f, unit(generator) - 0.5f, unit(generator) - 0.5f) * range;
+    };
+
+    // Parents are picked among the earlier nodes of the same hierarchy, nodes are in parent first order.
+    uint hierarchyCount = glm::clamp(m_hierarchies, 1u, m_nodes);
+    std::vector<std::vector<Node*>> hierarchies(hierarchyCount);
+    for (uint i = 0; i < m_nodes; i++)
+    {
+      std::vector<Node*>& hierarchy = hierarchies[i % hierarchyCount];
+      Node* node = new Node();
+      node->SetTranslation(RandomVecFn(10.0f));
+      node->SetOrientation(glm::angleAxis(unit(generator) * glm::two_pi<float>(), glm::normalize(RandomVecFn(1.0f) + Vec3(0.0f, 0.01f, 0.0f))));
+      node->SetScale(Vec3(1.0f) + RandomVecFn(1.0f));
+      node->m_inheritScale = (i & 1) != 0;
+      node->SetLocalDirty();
+      if (!hierarchy.empty())
+      {
+        hierarchy[(uint)(unit(generator) * hierarchy.size()) % hierarchy.size()]->AddChild(node);
+      }
+      hierarchy.push_back(node);
+    }
+
+    TransformSystem transforms;
+    for (std::vector<Node*>& hierarchy : hierarchies)
+    {
+      if (!hierarchy.empty())
+      {
+        transforms.Add(hierarchy.front());
+      }
+    }
+
+    auto WalkFn = [&hierarchies](uint begin, uint end) -> void
+    {
+      for (uint i = begin; i < end; i++)
+      {
+        for (Node* node : hierarchies[i])
+        {
+          node->GetWorldTransform();
+        }
+      }
+    };
+
+    // Both see the same changes, the system keeps its entries dirty while the nodes are walked.
+    std::vector<Mat4> walked;
+    walked.reserve(m_nodes);
+    auto MeasureFn = [this, &hierarchies, &transforms, &walked, &WalkFn](Timing& timing, const std::function<void()>& moveFn) -> void
+    {
+      for (uint i = 0; i < m_iterations; i++)
+      {
+        moveFn();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        GetJobSystem()->ParallelFor((uint)hierarchies.size(), WalkFn, 0, "UpdateTransforms");
+        auto walkEnd = std::chrono::high_resolution_clock::now();
+
+        walked.clear();
+        for (std::vector<Node*>& hierarchy : hierarchies)
+        {
+          for (Node* node : hierarchy)
+          {
+            walked.push_back(node->GetWorldTransform());
+          }
+        }
+
+        auto flatStart = std::chrono::high_resolution_clock::now();
+        transforms.Update();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        timing.walkMs += std::chrono::duration<float, std::milli>(walkEnd - start).count();
+        timing.flatMs += std::chrono::duration<float, std::milli>(end - flatStart).count();
+
+        uint index = 0;
+        for (std::vector<Node*>& hierarchy : hierarchies)
+        {
+          for (Node* node : hierarchy)
+          {
+            const Mat4& world = node->GetWorldTransform();
+            for (int c = 0; c < 4; c++)
+            {
+              Vec4 error = glm::abs(world[c] - walked[index][c]);
+              timing.maxError = glm::max(timing.maxError, glm::max(glm::max(error.x, error.y), glm::max(error.z, error.w)));
+            }
+            index++;
+          }
+        }
+      }
+
+      timing.walkMs /= (float)glm::max(m_iterations, 1u);
+      timing.flatMs /= (float)glm::max(m_iterations, 1u);
+    };
+
+    // The initial update of the system and the caches is left out.
+    GetJobSystem()->ParallelFor((uint)hierarchies.size(), WalkFn, 0, "UpdateTransforms");
+    transforms.Update();
+
+    std::vector<Timing> timings(2);
+    timings[0].moved = "all nodes";
+    MeasureFn
+    (
+      timings[0],
+      [&hierarchies, &RandomVecFn]() -> void
+      {
+        for (std::vector<Node*>& hierarchy : hierarchies)
+        {
+          for (Node* node : hierarchy)
+          {
+            node->SetTranslation(RandomVecFn(10.0f));
+          }
+        }
+      }
+    );
+
+    timings[1].moved = "roots of 1% of the hierarchies";
+    uint step = glm::max(hierarchyCount / 100, 1u);
+    MeasureFn
+    (
+      timings[1],
+      [&hierarchies, &RandomVecFn, step]() -> void
+      {
+        for (uint i = 0; i < (uint)hierarchies.size(); i += step)
+        {
+          hierarchies[i].front()->SetTranslation(RandomVecFn(10.0f));
+        }
+      }
+    );
+
+    // Children are orphaned by their parent's destructor, the system drops the entries.
+    for (std::vector<Node*>& hierarchy : hierarchies)
+    {
+      for (Node* node : hierarchy)
+      {
+        SafeDel(node);
+      }
+    }
+
+    return timings;
+  }
+
+  BatchMathBenchmark::Result BatchMathBenchmark::Run()
+  {
+    Result result;
+    result.boxes = m_boxes;
+
+    std::mt19937 generator(m_boxes);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto RandomVecFn = [&generator, &unit](float range) -> Vec3
+    {
+      return Vec3(unit(generator) - 0.5f, unit(generator) - 0.5f, unit(generator) - 0.5f) * range;
+    };
+
+    std::vector<BoundingBox> boxes(m_boxes);
+    std::vector<Mat4> transforms(m_boxes);
+    std::vector<BoundingBox> worldBoxes(m_boxes);
+    std::vector<BoundingBox> scalarBoxes(m_boxes);
+    std::vector<uint8> visible(m_boxes);
+    std::vector<uint8> scalarVisible(m_boxes);
+
+    auto TimeFn = [](const std::function<void()>& kernelFn) -> float
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+      kernelFn();
+      auto end = std::chrono::high_resolution_clock::now();
+      return std::chrono::duration<float, std::nano>(end - start).count();
+    };
+
+    for (uint round = 0; round < m_rounds; round++)
+    {
+      for (uint i = 0; i < m_boxes; i++)
+      {
+        Vec3 center = RandomVecFn(10.0f);
+        Vec3 extent = glm::abs(RandomVecFn(4.0f));
+        boxes[i].min = center - extent;
+        boxes[i].max = center + extent;
+
+        Quaternion orientation = glm::angleAxis(unit(generator) * glm::two_pi<float>(), glm::normalize(RandomVecFn(1.0f) + Vec3(0.0f, 0.01f, 0.0f)));
+        transforms[i] = glm::translate(Mat4(), RandomVecFn(200.0f)) * glm::toMat4(orientation) * glm::scale(Mat4(), Vec3(0.1f) + glm::abs(RandomVecFn(6.0f)));
+      }
+
+      // Boxes straddling the planes are common from inside the spread.
+      Vec3 eye = RandomVecFn(50.0f);
+      Vec3 target = eye + glm::normalize(RandomVecFn(1.0f) + Vec3(0.01f, 0.0f, 0.0f));
+      Mat4 view = glm::lookAt(eye, target, glm::abs(target.y - eye.y) > 0.99f ? X_AXIS : Y_AXIS);
+      Mat4 projection = glm::perspective(glm::radians(30.0f + unit(generator) * 60.0f), 0.5f + unit(generator) * 1.5f, 0.1f, 50.0f + unit(generator) * 150.0f);
+      Frustum frustum = ExtractFrustum(projection * view);
+
+      result.transformNs += TimeFn([this, &boxes, &transforms, &worldBoxes]() -> void { TransformAABBs(boxes.data(), transforms.data(), worldBoxes.data(), m_boxes); });
+      result.transformScalarNs += TimeFn([this, &boxes, &transforms, &scalarBoxes]() -> void { TransformAABBsScalar(boxes.data(), transforms.data(), scalarBoxes.data(), m_boxes); });
+      result.cullNs += TimeFn([this, &frustum, &worldBoxes, &visible]() -> void { FrustumBoxesVisible(frustum, worldBoxes.data(), m_boxes, visible.data()); });
+      result.cullScalarNs += TimeFn([this, &frustum, &worldBoxes, &scalarVisible]() -> void { FrustumBoxesVisibleScalar(frustum, worldBoxes.data(), m_boxes, scalarVisible.data()); });
+
+      for (uint i = 0; i < m_boxes; i++)
+      {
+        result.visible += scalarVisible[i];
+        if (visible[i] != scalarVisible[i])
+        {
+          result.maskMismatches++;
+        }
+
+        float error = 0.0f;
+        for (int j = 0; j < 3; j++)
+        {
+          error = glm::max(error, glm::abs(worldBoxes[i].min[j] - scalarBoxes[i].min[j]) / (1.0f + glm::abs(scalarBoxes[i].min[j])));
+          error = glm::max(error, glm::abs(worldBoxes[i].max[j] - scalarBoxes[i].max[j]) / (1.0f + glm::abs(scalarBoxes[i].max[j])));
+        }
+
+        result.maxBoxError = glm::max(result.maxBoxError, error);
+        if (error > 1e-5f)
+        {
+          result.boxMismatches++;
+        }
+      }
+    }
+
+    float perBox = 1.0f / (float)glm::max(m_boxes * m_rounds, 1u);
+    result.transformNs *= perBox;
+    result.transformScalarNs *= perBox;
+    result.cullNs *= perBox;
+    result.cullScalarNs *= perBox;
+
+    return result;
+  }
+
+  OcclusionCullingCheck::Result OcclusionCullingCheck::Run()
+  {
+    Result result;
+
+    // Camera at the origin looking down -z. The wall spans 8 x 4 units at 5 units, the view is 20 x 10 there.
+    Mat4 projectView = glm::perspective(glm::half_pi<float>(), 2.0f, 0.1f, 100.0f) * glm::lookAt(Vec3(), -Z_AXIS, Y_AXIS);
+    const Vec3 wall[4] = { Vec3(-4.0f, -2.0f, -5.0f), Vec3(4.0f, -2.0f, -5.0f), Vec3(4.0f, 2.0f, -5.0f), Vec3(-4.0f, 2.0f, -5.0f) };
+    const uint wallIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    struct Case
+    {
+      const char* name;
+      Vec3 center;
+      float halfSize;
+      bool visible;
+    };
+
+    const Case cases[] =
+    {
+      { "behind the center", Vec3(0.0f, 0.0f, -20.0f), 0.5f, false },
+      { "behind the corner", Vec3(2.0f, 1.0f, -10.0f), 0.5f, false },
+      { "large far behind", Vec3(0.0f, 0.0f, -60.0f), 4.0f, false },
+      { "in front", Vec3(0.0f, 0.0f, -3.0f), 0.5f, true },
+      { "crossing the wall", Vec3(0.0f, 0.0f, -5.0f), 1.0f, true },
+      { "crossing the edge", Vec3(8.0f, 0.0f, -10.0f), 0.5f, true },
+      { "beside", Vec3(15.0f, 0.0f, -10.0f), 0.5f, true },
+      { "above", Vec3(0.0f, 5.0f, -10.0f), 0.5f, true },
+      { "behind the camera", Vec3(0.0f, 0.0f, 3.0f), 0.5f, true }
+    };
+
+    auto RunFn = [&projectView, &wall, &wallIndices, &cases](bool parallel, std::vector<float>& depth, std::vector<bool>& answers) -> void
+    {
+      OcclusionCuller culler;
+      culler.m_parallel = parallel;
+      culler.Begin(projectView);
+      culler.AddOccluder(wall, wallIndices, 6, Mat4(1.0f));
+      culler.Rasterize();
+
+      depth = culler.GetDepthBuffer();
+      answers.clear();
+      for (const Case& test : cases)
+      {
+        BoundingBox box;
+        box.min = test.center - Vec3(test.halfSize);
+        box.max = test.center + Vec3(test.halfSize);
+        answers.push_back(culler.IsVisible(box));
+      }
+    };
+
+    std::vector<float> parallelDepth, serialDepth;
+    std::vector<bool> parallelAnswers, serialAnswers;
+    RunFn(true, parallelDepth, parallelAnswers);
+    RunFn(false, serialDepth, serialAnswers);
+
+    for (size_t i = 0; i < parallelAnswers.size(); i++)
+    {
+      result.checks++;
+      if (parallelAnswers[i] != cases[i].visible)
+      {
+        result.failures.push_back(String("Box ") + cases[i].name + (cases[i].visible ? " is culled." : " is not culled."));
+      }
+    }
+
+    result.checks++;
+    if (parallelDepth != serialDepth)
+    {
+      result.failures.push_back("Band parallel and serial depth buffers differ.");
+    }
+
+    result.checks++;
+    if (parallelAnswers != serialAnswers)
+    {
+      result.failures.push_back("Band parallel and serial visibility differ.");
+    }
+
+    return result;
+  }
+
+}
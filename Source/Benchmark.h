@@ -0,0 +1,154 @@
+#pragma once
+
+#include "MathUtil.h"
+
+namespace ToolKit
+{
+
+  class Renderer;
+  class Skeleton;
+
+  // Renders a scripted camera flight over a set of entities into an offscreen target and reports frame time percentiles.
+  // The camera advances by a fixed step per frame, so every run renders the same frames regardless of the speed.
+  // Frames are finished with glFinish, gpu time is included in the frame time.
+  class BenchmarkRunner
+  {
+  public:
+    struct CameraKey
+    {
+      float time; // In seconds.
+      Vec3 pos;
+      Vec3 target;
+    };
+
+    struct Report
+    {
+      uint frames = 0;
+      float avgMs = 0.0f;
+      float minMs = 0.0f;
+      float p50Ms = 0.0f;
+      float p90Ms = 0.0f;
+      float p95Ms = 0.0f;
+      float p99Ms = 0.0f;
+      float maxMs = 0.0f;
+      float drawCalls = 0.0f; // Average per frame.
+    };
+
+  public:
+    BenchmarkRunner(Renderer* renderer, uint width, uint height);
+    ~BenchmarkRunner();
+
+    bool LoadPath(const String& file); // Xml, a "key" node with a "t" attribute and "pos", "target" children per key.
+    void OrbitPath(const BoundingBox& box, float duration); // Circles around the box, for scenes without a path.
+    Report Run(const EntityRawPtrArray& entities, const LightRawPtrArray& lights);
+    static String ToString(const Report& report);
+
+  public:
+    uint m_frames = 600;
+    uint m_warmupFrames = 30; // Not recorded. Lets the uploads and the shader compilations settle.
+    float m_fov = glm::quarter_pi<float>();
+    String m_captureDir; // Frames are written as png files when set.
+    uint m_captureEvery = 0; // 0 writes the last frame only.
+    std::vector<CameraKey> m_path;
+    std::vector<float> m_frameTimes; // Milliseconds, of the last run.
+
+  private:
+    void SampleCamera(float time, class Camera* cam) const;
+
+  private:
+    Renderer* m_renderer;
+    class RenderTarget* m_target;
+  };
+
+  // Poses a skeleton from a synthetic 30 fps clip, stepping forward at 60 fps as playback does, once per clip length.
+  // Reports the average cost of a bone for each key lookup.
+  class AnimationBenchmark
+  {
+  public:
+    struct Timing
+    {
+      uint keys = 0; // Per bone.
+      float linearNs = 0.0f; // Scan from the first key, the former lookup.
+      float searchNs = 0.0f; // Binary search.
+      float cursorNs = 0.0f; // Cursor, binary search on a miss.
+      float compressedNs = 0.0f; // Cursor, on the compressed tracks.
+    };
+
+  public:
+    std::vector<Timing> Run();
+
+  public:
+    uint m_bones = 64;
+    uint m_samples = 600; // Frames per clip, starting at a third of the clip and wrapping around.
+    std::vector<uint> m_keyCounts = { 30, 300, 3000, 30000 };
+
+  private:
+    static void LinearPose(class Animation* anim, Skeleton* skeleton);
+  };
+
+  // Random forest of nodes whose world transforms are brought up to date the two ways the FramePipeline can. Walking
+  // each hierarchy's nodes on the job system, and a TransformSystem mirroring the forest. First every node moves, then
+  // only the roots of a few hierarchies. The resulting world matrices are compared.
+  class TransformBenchmark
+  {
+  public:
+    struct Timing
+    {
+      String moved;
+      float walkMs = 0.0f;
+      float flatMs = 0.0f;
+      float maxError = 0.0f; // Largest difference between the two world matrices of a node.
+    };
+
+  public:
+    std::vector<Timing> Run();
+
+  public:
+    uint m_nodes = 100000;
+    uint m_hierarchies = 1000;
+    uint m_iterations = 10;
+  };
+
+  // Random boxes, transforms and frustums through the vectorized batch kernels of MathUtil and their scalar references.
+  // Visibility masks must match exactly, transformed boxes up to rounding. Also times both, per box.
+  class BatchMathBenchmark
+  {
+  public:
+    struct Result
+    {
+      uint boxes = 0; // Per kernel and round.
+      uint visible = 0; // Over all rounds, by the scalar reference.
+      uint maskMismatches = 0;
+      uint boxMismatches = 0;
+      float maxBoxError = 0.0f; // Relative.
+      float transformNs = 0.0f;
+      float transformScalarNs = 0.0f;
+      float cullNs = 0.0f;
+      float cullScalarNs = 0.0f;
+    };
+
+  public:
+    Result Run();
+
+  public:
+    uint m_boxes = 10007; // Not a multiple of the lane counts, the remainder path runs too.
+    uint m_rounds = 20; // A new frustum and set of boxes each.
+  };
+
+  // Fixed scene for the OcclusionCuller. A wall faces the camera, boxes fully behind it must be culled, boxes beside it,
+  // in front of it or crossing its edges must stay visible. Rasterizes band parallel and serially, the depth buffers
+  // and the answers must match.
+  class OcclusionCullingCheck
+  {
+  public:
+    struct Result
+    {
+      uint checks = 0;
+      std::vector<String> failures; // Empty when passed.
+    };
+
+  public:
+    Result Run();
+  };
+
+}
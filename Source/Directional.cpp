@@ -172,6 +172,7 @@ namespace ToolKit
   {
     m_color = Vec3(1.0f, 1.0f, 1.0f);
     m_intensity = 1.0f;
+    m_radius = 0.0f;
   }
 
   Light::~Light()
@@ -185,6 +186,7 @@ namespace ToolKit
     data.pos = m_node->GetTranslation(TransformationSpace::TS_WORLD);
     data.color = m_color;
     data.intensity = m_intensity;
+    data.radius = m_radius;
 
     return data;
   }
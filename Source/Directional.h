@@ -71,6 +71,7 @@ namespace ToolKit
       Vec3 dir;
       Vec3 color;
       float intensity;
+      float radius;
     };
 
   public:
@@ -83,6 +84,7 @@ namespace ToolKit
   public:
     Vec3 m_color;
     float m_intensity;
+    float m_radius; // Range of a point light. Lights with zero radius are directional.
   };
 
 }
@@ -11,7 +11,7 @@ namespace ToolKit
 
   Drawable::Drawable()
   {
-    m_mesh = std::make_shared<Mesh>();
+    m_mesh = MeshPtr(new Mesh());
   }
 
   Drawable::~Drawable()
@@ -28,16 +28,16 @@ namespace ToolKit
     return EntityType::Entity_Drawable;
   }
 
-  void Drawable::SetPose(Animation* anim)
+  void Drawable::SetPose(Animation* anim, KeyCursor* cursor)
   {
     if (m_mesh->IsSkinned())
     {
       Skeleton* skeleton = ((SkinMesh*)m_mesh.get())->m_skeleton;
-      anim->GetCurrentPose(skeleton);
+      anim->GetCurrentPose(skeleton, cursor);
     }
     else
     {
-      anim->GetCurrentPose(m_node);
+      anim->GetCurrentPose(m_node, cursor);
     }
   }
 
@@ -65,11 +65,17 @@ namespace ToolKit
     Entity::GetCopy(copyTo);
     Drawable* ntt = static_cast<Drawable*> (copyTo);
     ntt->m_mesh = MeshPtr(m_mesh->GetCopy());
+    ntt->m_occluder = m_occluder;
   }
 
   void Drawable::Serialize(XmlDocument* doc, XmlNode* parent) const
   {
     Entity::Serialize(doc, parent);
+    if (m_occluder)
+    {
+      WriteAttr(parent->last_node(), doc, XmlDrawableOccluderAttr, "1");
+    }
+
     XmlNode* node = doc->allocate_node(rapidxml::node_element, XmlMeshElement.c_str());
     node->append_attribute(doc->allocate_attribute(XmlFileAttr.c_str(), m_mesh->m_file.c_str()));
     parent->last_node()->append_node(node);
@@ -78,6 +84,11 @@ namespace ToolKit
   void Drawable::DeSerialize(XmlDocument* doc, XmlNode* parent)
   {
     Entity::DeSerialize(doc, parent);
+    if (XmlAttribute* attr = parent->first_attribute(XmlDrawableOccluderAttr.c_str()))
+    {
+      m_occluder = std::atoi(attr->value()) != 0;
+    }
+
     if (XmlNode* meshNode = parent->first_node(XmlMeshElement.c_str()))
     {
       XmlAttribute* attr = meshNode->first_attribute(XmlFileAttr.c_str());
@@ -12,7 +12,7 @@ namespace ToolKit
     virtual ~Drawable();
     virtual bool IsDrawable() const override;
     virtual EntityType GetType() const override;
-    virtual void SetPose(Animation* anim) override;
+    virtual void SetPose(Animation* anim, KeyCursor* cursor = nullptr) override;
     virtual struct BoundingBox GetAABB(bool inWorld = false) const override;
     virtual Drawable* GetCopy() const override;
     virtual void GetCopy(Entity* copyTo) const override;
@@ -21,6 +21,9 @@ namespace ToolKit
 
   public:
     MeshPtr m_mesh;
+    // Level of detail picked by the renderer in the last draw, by camera id. Each viewport keeps its own hysteresis.
+    std::vector<std::pair<EntityId, uint>> m_lods;
+    bool m_occluder = false; // Rasterized by the OcclusionCuller to hide the drawables behind.
   };
 
 }
\ No newline at end of file
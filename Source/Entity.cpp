@@ -4,6 +4,8 @@
 #include "ToolKit.h"
 #include "Skeleton.h"
 #include "MathUtil.h"
+#include "Primative.h"
+#include "Prefab.h"
 #include "DebugNew.h"
 
 namespace ToolKit
@@ -25,6 +27,12 @@ namespace ToolKit
     SafeDel(m_node);
   }
 
+  ObjectPool& Entity::GetPool()
+  {
+    static ObjectPool pool("Entity", true);
+    return pool;
+  }
+
   bool Entity::IsDrawable() const
   {
     return false;
@@ -35,9 +43,9 @@ namespace ToolKit
     return EntityType::Entity_Base;
   }
 
-  void Entity::SetPose(Animation* anim)
+  void Entity::SetPose(Animation* anim, KeyCursor* cursor)
   {
-    anim->GetCurrentPose(m_node);
+    anim->GetCurrentPose(m_node, cursor);
   }
 
   struct BoundingBox Entity::GetAABB(bool inWorld) const
@@ -70,6 +78,7 @@ namespace ToolKit
     SafeDel(copyTo->m_node);
     copyTo->m_node = m_node->GetCopy();
     copyTo->m_node->m_entity = copyTo;
+    copyTo->m_static = m_static;
   }
 
   void Entity::Serialize(XmlDocument* doc, XmlNode* parent) const
@@ -93,6 +102,10 @@ namespace ToolKit
     WriteAttr(node, doc, XmlEntityNameAttr, m_name);
     WriteAttr(node, doc, XmlEntityTagAttr, m_tag);
     WriteAttr(node, doc, XmlEntityTypeAttr, std::to_string((int)GetType()));
+    if (m_static)
+    {
+      WriteAttr(node, doc, XmlEntityStaticAttr, "1");
+    }
     m_node->Serialize(doc, node);
   }
 
@@ -130,10 +143,38 @@ namespace ToolKit
       m_tag = attr->value();
     }
 
+    if (XmlAttribute* attr = nttNode->first_attribute(XmlEntityStaticAttr.c_str()))
+    {
+      m_static = std::atoi(attr->value()) != 0;
+    }
+
     if (XmlNode* transformNode = nttNode->first_node(XmlNodeElement.c_str()))
     {
       m_node->DeSerialize(doc, transformNode);
     }
   }
 
+  Entity* Entity::CreateByType(EntityType type)
+  {
+    switch (type)
+    {
+    case EntityType::Entity_Cube:
+      return new Cube(false);
+    case EntityType::Entity_Quad:
+      return new Quad(false);
+    case EntityType::Entity_Sphere:
+      return new Sphere(false);
+    case EntityType::Etity_Arrow:
+      return new Arrow2d(false);
+    case EntityType::Entity_Cone:
+      return new Cone(false);
+    case EntityType::Entity_Drawable:
+      return new Drawable();
+    case EntityType::Entity_Prefab:
+      return new PrefabInstance();
+    default:
+      return nullptr;
+    }
+  }
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Types.h"
+#include "ObjectPool.h"
 
 namespace ToolKit
 {
@@ -23,7 +24,8 @@ namespace ToolKit
     Entity_Surface,
     Entity_Light,
     Entity_Camera,
-    Entity_Directional
+    Entity_Directional,
+    Entity_Prefab
   };
 
   class Entity
@@ -32,20 +34,25 @@ namespace ToolKit
     Entity();
     virtual ~Entity();
 
+    TK_POOLED_CLASS(GetPool)
+    static ObjectPool& GetPool(); // Shared by the subclasses, uses arenas.
+
     virtual bool IsDrawable() const;
     virtual EntityType GetType() const;
-    virtual void SetPose(Animation* anim);
+    virtual void SetPose(Animation* anim, KeyCursor* cursor = nullptr);
     virtual struct BoundingBox GetAABB(bool inWorld = false) const;
     virtual Entity* GetCopy() const;
     virtual void GetCopy(Entity* copyTo) const;
     virtual void Serialize(XmlDocument* doc, XmlNode* parent) const;
     virtual void DeSerialize(XmlDocument* doc, XmlNode* parent);
+    static Entity* CreateByType(EntityType type); // For deserialization. Null for the types that are not loaded from files.
 
   public:
     Node* m_node;
     EntityId m_id;
     String m_name;
     String m_tag;
+    bool m_static = false; // Never moves, geometry can be merged by StaticBatch.
 
     // Internal use only, Helper ID for entity deserialization.
     EntityId _parentId;
@@ -0,0 +1,302 @@
+#include "stdafx.h"
+#include "FrameGraph.h"
+#include "Texture.h"
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  // RenderTargetPool
+  //////////////////////////////////////////
+
+  RenderTargetPool::~RenderTargetPool()
+  {
+    assert(m_inUse.empty() && "Render targets are still in use.");
+    Clear();
+  }
+
+  RenderTarget* RenderTargetPool::Acquire(uint width, uint height, bool depthStencil)
+  {
+    m_acquired++;
+    for (size_t i = 0; i < m_free.size(); i++)
+    {
+      Entry& entry = m_free[i];
+      if ((uint)entry.target->m_width == width && (uint)entry.target->m_height == height && entry.depthStencil == depthStencil)
+      {
+        entry.lastUsed = m_frame;
+        m_inUse.push_back(entry);
+        m_free.erase(m_free.begin() + i);
+        return m_inUse.back().target;
+      }
+    }
+
+    Entry entry;
+    entry.target = new RenderTarget(width, height, depthStencil);
+    entry.target->Init();
+    entry.depthStencil = depthStencil;
+    entry.lastUsed = m_frame;
+    m_inUse.push_back(entry);
+    m_created++;
+
+    return entry.target;
+  }
+
+  void RenderTargetPool::Release(RenderTarget* target)
+  {
+    for (size_t i = 0; i < m_inUse.size(); i++)
+    {
+      if (m_inUse[i].target == target)
+      {
+        m_inUse[i].lastUsed = m_frame;
+        m_free.push_back(m_inUse[i]);
+        m_inUse.erase(m_inUse.begin() + i);
+        return;
+      }
+    }
+
+    assert(false && "Target is not acquired from this pool.");
+  }
+
+  void RenderTargetPool::NextFrame()
+  {
+    m_frame++;
+    m_lastAcquired = m_acquired;
+    m_acquired = 0;
+
+    for (size_t i = 0; i < m_free.size();)
+    {
+      if (m_frame - m_free[i].lastUsed > m_maxIdleFrames)
+      {
+        SafeDel(m_free[i].target);
+        m_free.erase(m_free.begin() + i);
+      }
+      else
+      {
+        i++;
+      }
+    }
+  }
+
+  void RenderTargetPool::Clear()
+  {
+    for (Entry& entry : m_free)
+    {
+      SafeDel(entry.target);
+    }
+    m_free.clear();
+  }
+
+  RenderTargetPool::Stats RenderTargetPool::GetStats() const
+  {
+    Stats stats;
+    stats.created = m_created;
+    stats.acquired = m_lastAcquired;
+    stats.inUse = (uint)m_inUse.size();
+    stats.free = (uint)m_free.size();
+    return stats;
+  }
+
+  // FrameGraph
+  //////////////////////////////////////////
+
+  FrameGraph::FrameGraph(RenderTargetPool* pool)
+  {
+    assert(pool != nullptr);
+    m_pool = pool;
+  }
+
+  FrameGraph::~FrameGraph()
+  {
+    Reset();
+  }
+
+  FrameGraph::ResourceId FrameGraph::CreateTarget(const String& name, uint width, uint height, bool depthStencil)
+  {
+    Resource resource;
+    resource.name = name;
+    resource.width = width;
+    resource.height = height;
+    resource.depthStencil = depthStencil;
+    m_resources.push_back(resource);
+
+    return (ResourceId)m_resources.size() - 1;
+  }
+
+  FrameGraph::ResourceId FrameGraph::ImportTarget(const String& name, RenderTarget* target)
+  {
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.target = target;
+    m_resources.push_back(resource);
+
+    return (ResourceId)m_resources.size() - 1;
+  }
+
+  void FrameGraph::AddPass(const String& name, const std::vector<ResourceId>& reads, const std::vector<ResourceId>& writes, ExecuteFn execute, bool sideEffect)
+  {
+    Pass pass;
+    pass.name = name;
+    pass.reads = reads;
+    pass.writes = writes;
+    pass.execute = execute;
+    pass.sideEffect = sideEffect;
+    m_passes.push_back(pass);
+
+    for (ResourceId id : writes)
+    {
+      assert(id >= 0 && id < (ResourceId)m_resources.size());
+      m_resources[id].producers.push_back((int)m_passes.size() - 1);
+    }
+  }
+
+  RenderTarget* FrameGraph::GetTarget(ResourceId id) const
+  {
+    assert(id >= 0 && id < (ResourceId)m_resources.size());
+    return m_resources[id].target;
+  }
+
+  void FrameGraph::Execute()
+  {
+    Compile();
+
+    for (int i = 0; i < (int)m_passes.size(); i++)
+    {
+      Pass& pass = m_passes[i];
+      if (pass.culled)
+      {
+        continue;
+      }
+
+      for (Resource& resource : m_resources)
+      {
+        if (!resource.imported && resource.firstUse == i)
+        {
+          resource.target = m_pool->Acquire(resource.width, resource.height, resource.depthStencil);
+        }
+      }
+
+      if (pass.execute)
+      {
+        pass.execute();
+      }
+
+      for (Resource& resource : m_resources)
+      {
+        if (!resource.imported && resource.lastUse == i)
+        {
+          m_pool->Release(resource.target);
+          resource.target = nullptr;
+        }
+      }
+    }
+
+    Reset();
+  }
+
+  void FrameGraph::Compile()
+  {
+    // Reference counts. A pass is referenced by its outputs, a resource by the passes reading it.
+    for (Pass& pass : m_passes)
+    {
+      pass.refCount = (int)pass.writes.size() + (pass.sideEffect ? 1 : 0);
+      pass.culled = false;
+      for (ResourceId id : pass.reads)
+      {
+        assert(id >= 0 && id < (ResourceId)m_resources.size());
+        m_resources[id].refCount++;
+      }
+    }
+
+    std::vector<ResourceId> unreferenced;
+    for (ResourceId id = 0; id < (ResourceId)m_resources.size(); id++)
+    {
+      Resource& resource = m_resources[id];
+      if (resource.imported)
+      {
+        resource.refCount++; // Consumed outside of the graph.
+      }
+
+      if (resource.refCount == 0)
+      {
+        unreferenced.push_back(id);
+      }
+    }
+
+    auto CullFn = [this, &unreferenced](Pass& pass) -> void
+    {
+      pass.culled = true;
+      for (ResourceId id : pass.reads)
+      {
+        if (--m_resources[id].refCount == 0)
+        {
+          unreferenced.push_back(id);
+        }
+      }
+    };
+
+    for (Pass& pass : m_passes)
+    {
+      if (pass.refCount == 0)
+      {
+        CullFn(pass);
+      }
+    }
+
+    // Cull producers of unreferenced resources, recursively through their inputs.
+    while (!unreferenced.empty())
+    {
+      Resource& resource = m_resources[unreferenced.back()];
+      unreferenced.pop_back();
+
+      for (int producer : resource.producers)
+      {
+        Pass& pass = m_passes[producer];
+        if (!pass.culled && --pass.refCount == 0)
+        {
+          CullFn(pass);
+        }
+      }
+    }
+
+    // Lifetimes of transient targets over the surviving passes.
+    m_culledPassCount = 0;
+    for (int i = 0; i < (int)m_passes.size(); i++)
+    {
+      Pass& pass = m_passes[i];
+      if (pass.culled)
+      {
+        m_culledPassCount++;
+        continue;
+      }
+
+      auto UseFn = [this, i](ResourceId id) -> void
+      {
+        Resource& resource = m_resources[id];
+        if (resource.firstUse == -1)
+        {
+          resource.firstUse = i;
+        }
+        resource.lastUse = i;
+      };
+
+      std::for_each(pass.reads.begin(), pass.reads.end(), UseFn);
+      std::for_each(pass.writes.begin(), pass.writes.end(), UseFn);
+    }
+  }
+
+  void FrameGraph::Reset()
+  {
+    for (Resource& resource : m_resources)
+    {
+      if (!resource.imported && resource.target != nullptr)
+      {
+        m_pool->Release(resource.target);
+      }
+    }
+
+    m_resources.clear();
+    m_passes.clear();
+  }
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Types.h"
+#include <functional>
+
+namespace ToolKit
+{
+
+  class RenderTarget;
+
+  // Recycles render targets across passes and frames. Targets are matched by size and format,
+  // targets that stay unused for m_maxIdleFrames are destroyed by NextFrame.
+  class RenderTargetPool
+  {
+  public:
+    struct Stats
+    {
+      uint created = 0; // Total targets created by the pool.
+      uint acquired = 0; // Acquires in the last completed frame.
+      uint inUse = 0;
+      uint free = 0;
+    };
+
+  public:
+    ~RenderTargetPool();
+
+    RenderTarget* Acquire(uint width, uint height, bool depthStencil = true); // Initialized target, content is undefined.
+    void Release(RenderTarget* target); // Target must be acquired from this pool.
+    void NextFrame(); // Trims idle targets. Call once per frame.
+    void Clear(); // Destroys free targets. Needs a current gl context.
+    Stats GetStats() const;
+
+  public:
+    uint m_maxIdleFrames = 120;
+
+  private:
+    struct Entry
+    {
+      RenderTarget* target = nullptr;
+      bool depthStencil = true;
+      uint lastUsed = 0;
+    };
+
+    std::vector<Entry> m_free;
+    std::vector<Entry> m_inUse;
+    uint m_frame = 0;
+    uint m_created = 0;
+    uint m_acquired = 0;
+    uint m_lastAcquired = 0;
+  };
+
+  // Single frame render graph. Passes declare the targets they read and write, Execute culls passes whose
+  // outputs are never consumed and backs transient targets with pooled ones only for their lifetime,
+  // so transients with disjoint lifetimes alias the same target. Imported targets and side effect passes are never culled.
+  class FrameGraph
+  {
+  public:
+    typedef int ResourceId;
+    typedef std::function<void()> ExecuteFn;
+
+  public:
+    FrameGraph(RenderTargetPool* pool);
+    ~FrameGraph();
+
+    ResourceId CreateTarget(const String& name, uint width, uint height, bool depthStencil = true);
+    ResourceId ImportTarget(const String& name, RenderTarget* target);
+    void AddPass(const String& name, const std::vector<ResourceId>& reads, const std::vector<ResourceId>& writes, ExecuteFn execute, bool sideEffect = false);
+    RenderTarget* GetTarget(ResourceId id) const; // Valid only while a pass that uses the resource executes.
+    void Execute(); // Compiles, runs and resets the graph.
+
+  public:
+    uint m_culledPassCount = 0; // Of the last execution.
+
+  private:
+    void Compile();
+    void Reset();
+
+  private:
+    struct Resource
+    {
+      String name;
+      uint width = 0;
+      uint height = 0;
+      bool depthStencil = true;
+      bool imported = false;
+      RenderTarget* target = nullptr;
+      std::vector<int> producers;
+      int refCount = 0;
+      int firstUse = -1;
+      int lastUse = -1;
+    };
+
+    struct Pass
+    {
+      String name;
+      std::vector<ResourceId> reads;
+      std::vector<ResourceId> writes;
+      ExecuteFn execute;
+      bool sideEffect = false;
+      int refCount = 0;
+      bool culled = false;
+    };
+
+    RenderTargetPool* m_pool;
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+  };
+
+}
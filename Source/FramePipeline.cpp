@@ -0,0 +1,278 @@
+#include "stdafx.h"
+#include "FramePipeline.h"
+#include "ToolKit.h"
+#include "Directional.h"
+#include "Drawable.h"
+#include "Mesh.h"
+#include "Node.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  typedef std::chrono::high_resolution_clock Clock;
+
+  static float ElapsedMs(const Clock::time_point& start, const Clock::time_point& end)
+  {
+    return std::chrono::duration<float, std::milli>(end - start).count();
+  }
+
+  // Batched kernels are worth a job only for a good number of items.
+  static uint GrainOf(uint count)
+  {
+    return glm::max(1024u, count / (GetJobSystem()->GetThreadCount() * 4));
+  }
+
+  void FramePipeline::Run(float deltaTimeSec, const EntityRawPtrArray& entities, std::vector<View>& views)
+  {
+    Clock::time_point start = Clock::now();
+
+    // Cameras are read before the jobs start, views of animated cameras lag a frame behind.
+    std::vector<Frustum> frustums(views.size());
+    for (size_t i = 0; i < views.size(); i++)
+    {
+      Camera* cam = views[i].camera;
+      frustums[i] = ExtractFrustum(cam->GetData().projection * cam->GetViewMatrix());
+    }
+
+    Clock::time_point animationEnd, gatherEnd, transformEnd, boundsEnd;
+    std::vector<Clock::time_point> viewStarts(views.size());
+    std::vector<Clock::time_point> viewEnds(views.size());
+
+    JobSystem* jobs = GetJobSystem();
+    JobCounter prepared, transformed, bounded, listed;
+    jobs->Run
+    (
+      [deltaTimeSec, &animationEnd]() -> void
+      {
+        GetAnimationPlayer()->Update(deltaTimeSec);
+        animationEnd = Clock::now();
+      },
+      &prepared, nullptr, "Animation"
+    );
+
+    jobs->Run
+    (
+      [this, &entities, &gatherEnd]() -> void
+      {
+        Gather(entities);
+        gatherEnd = Clock::now();
+      },
+      &prepared, nullptr, "Gather"
+    );
+
+    jobs->Run
+    (
+      [this, &transformEnd]() -> void
+      {
+        UpdateTransforms();
+        transformEnd = Clock::now();
+      },
+      &transformed, &prepared, "Transforms"
+    );
+
+    jobs->Run
+    (
+      [this, &boundsEnd]() -> void
+      {
+        UpdateBounds();
+        boundsEnd = Clock::now();
+      },
+      &bounded, &transformed, "Bounds"
+    );
+
+    for (size_t i = 0; i < views.size(); i++)
+    {
+      jobs->Run
+      (
+        [this, i, &views, &frustums, &viewStarts, &viewEnds]() -> void
+        {
+          viewStarts[i] = Clock::now();
+          BuildRenderList(views[i], frustums[i]);
+          viewEnds[i] = Clock::now();
+        },
+        &listed, &bounded, "Visibility"
+      );
+    }
+
+    jobs->Wait(&listed);
+    jobs->Wait(&bounded);
+
+    m_stats.animationMs = ElapsedMs(start, animationEnd);
+    m_stats.gatherMs = ElapsedMs(start, gatherEnd);
+    m_stats.transformMs = ElapsedMs(std::max(animationEnd, gatherEnd), transformEnd);
+    m_stats.boundsMs = ElapsedMs(transformEnd, boundsEnd);
+    m_stats.visibilityMs = 0.0f;
+    m_stats.visible = 0;
+    if (!views.empty())
+    {
+      Clock::time_point first = *std::min_element(viewStarts.begin(), viewStarts.end());
+      Clock::time_point last = *std::max_element(viewEnds.begin(), viewEnds.end());
+      m_stats.visibilityMs = ElapsedMs(first, last);
+
+      for (const View& view : views)
+      {
+        m_stats.visible += (uint)view.renderList.size();
+      }
+    }
+
+    m_stats.totalMs = ElapsedMs(start, Clock::now());
+    m_stats.drawables = (uint)m_drawables.size();
+    m_stats.hierarchies = (uint)m_hierarchies.size();
+    m_stats.threads = jobs->GetThreadCount();
+  }
+
+  const FramePipeline::Stats& FramePipeline::GetStats() const
+  {
+    return m_stats;
+  }
+
+  void FramePipeline::Gather(const EntityRawPtrArray& entities)
+  {
+    m_drawables.clear();
+    m_cullable.clear();
+    for (std::vector<Node*>& hierarchy : m_hierarchies)
+    {
+      hierarchy.clear();
+    }
+
+    std::unordered_map<Node*, uint> rootIndices;
+    uint hierarchyCount = 0;
+    for (Entity* ntt : entities)
+    {
+      if (!ntt->IsDrawable() || (m_skipFn && m_skipFn(ntt)))
+      {
+        continue;
+      }
+
+      // Meshes without a bounding box are always drawn.
+      Drawable* drawable = static_cast<Drawable*> (ntt);
+      const BoundingBox& local = drawable->m_mesh->m_aabb;
+      bool cullable = !drawable->m_mesh->IsSkinned() && ntt->GetType() != EntityType::Entity_Billboard && local.min.x <= local.max.x;
+      m_drawables.push_back(drawable);
+      m_cullable.push_back(cullable);
+      if (!cullable)
+      {
+        continue;
+      }
+
+      Node* rootNode = ntt->m_node->GetRoot();
+      auto root = rootIndices.insert({ rootNode, hierarchyCount });
+      if (root.second)
+      {
+        hierarchyCount++;
+        if (m_hierarchies.size() < hierarchyCount)
+        {
+          m_hierarchies.emplace_back();
+        }
+        m_roots.resize(hierarchyCount);
+        m_roots[hierarchyCount - 1] = rootNode;
+      }
+      m_hierarchies[root.first->second].push_back(ntt->m_node);
+    }
+
+    m_hierarchies.resize(hierarchyCount);
+    m_roots.resize(hierarchyCount);
+  }
+
+  void FramePipeline::UpdateTransforms()
+  {
+    // Animation is done, nothing else touches the nodes. A hierarchy joins the system once, nodes attached to it later
+    // join through Node::AddChild. Hierarchies mirrored by another system are walked.
+    m_walked.clear();
+    for (uint i = 0; i < (uint)m_roots.size(); i++)
+    {
+      Node* root = m_roots[i];
+      if (m_flatTransforms && root->m_transformSystem == nullptr)
+      {
+        m_transforms.Add(root);
+      }
+
+      if (!m_flatTransforms || root->m_transformSystem != &m_transforms)
+      {
+        m_walked.push_back(i);
+      }
+    }
+
+    if (m_flatTransforms)
+    {
+      m_transforms.Update();
+    }
+
+    // World caches are filled from the root down, a hierarchy never spans two jobs.
+    auto UpdateFn = [this](uint begin, uint end) -> void
+    {
+      for (uint i = begin; i < end; i++)
+      {
+        for (Node* node : m_hierarchies[m_walked[i]])
+        {
+          node->GetWorldTransform();
+        }
+      }
+    };
+
+    GetJobSystem()->ParallelFor((uint)m_walked.size(), UpdateFn, 0, "UpdateTransforms");
+  }
+
+  void FramePipeline::UpdateBounds()
+  {
+    uint count = (uint)m_drawables.size();
+    m_localBoxes.resize(count);
+    m_worlds.resize(count);
+    m_worldBoxes.resize(count);
+
+    // Boxes of the drawables that are not culled are left unused.
+    auto BoundsFn = [this](uint begin, uint end) -> void
+    {
+      for (uint i = begin; i < end; i++)
+      {
+        Drawable* drawable = m_drawables[i];
+        m_localBoxes[i] = drawable->m_mesh->m_aabb;
+        m_worlds[i] = m_cullable[i] ? drawable->m_node->m_worldCache : Mat4();
+      }
+
+      TransformAABBs(&m_localBoxes[begin], &m_worlds[begin], &m_worldBoxes[begin], end - begin);
+    };
+
+    GetJobSystem()->ParallelFor(count, BoundsFn, GrainOf(count), "UpdateBounds");
+  }
+
+  void FramePipeline::BuildRenderList(View& view, const Frustum& frustum)
+  {
+    std::vector<Drawable*>& renderList = view.renderList;
+    if (!view.frustumCulling)
+    {
+      renderList = m_drawables;
+      return;
+    }
+
+    uint count = (uint)m_drawables.size();
+    std::vector<uint8> visible(count);
+    auto VisibleFn = [this, &frustum, &visible](uint begin, uint end) -> void
+    {
+      FrustumBoxesVisible(frustum, &m_worldBoxes[begin], end - begin, &visible[begin]);
+    };
+    GetJobSystem()->ParallelFor(count, VisibleFn, GrainOf(count), "FrustumCull");
+
+    renderList.clear();
+    for (uint i = 0; i < count; i++)
+    {
+      if (!m_cullable[i])
+      {
+        renderList.push_back(m_drawables[i]);
+      }
+    }
+
+    for (uint i = 0; i < count; i++)
+    {
+      if (m_cullable[i] && visible[i])
+      {
+        renderList.push_back(m_drawables[i]);
+      }
+    }
+  }
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Types.h"
+#include "MathUtil.h"
+#include "TransformSystem.h"
+#include <functional>
+
+namespace ToolKit
+{
+
+  class Camera;
+  class Drawable;
+
+  // Per frame work up to the draw calls, run as dependent jobs on the job system. Animations are sampled while the
+  // drawables are gathered and grouped by hierarchy. Then the world transforms are brought up to date in a
+  // TransformSystem mirroring the hierarchies, or one job per group of hierarchies, followed by the world bounds. Last, the visibility and render list of each view, views in
+  // parallel. Drawing stays on the calling thread. Nothing else may change the entities while Run is in progress.
+  class FramePipeline
+  {
+  public:
+    struct View
+    {
+      Camera* camera = nullptr;
+      bool frustumCulling = true;
+      std::vector<Drawable*> renderList; // Drawables without bounds first, then the visible ones, in entity order.
+    };
+
+    // Milliseconds. Stages wait on the previous one, except animation and gather which overlap.
+    struct Stats
+    {
+      float animationMs = 0.0f;
+      float gatherMs = 0.0f;
+      float transformMs = 0.0f;
+      float boundsMs = 0.0f;
+      float visibilityMs = 0.0f; // From the first view started to the last one done.
+      float totalMs = 0.0f;
+      uint drawables = 0;
+      uint hierarchies = 0;
+      uint visible = 0; // Over all views.
+      uint threads = 0;
+    };
+
+  public:
+    void Run(float deltaTimeSec, const EntityRawPtrArray& entities, std::vector<View>& views);
+    const Stats& GetStats() const;
+
+  public:
+    std::function<bool(Entity*)> m_skipFn; // Leaves entities out of the render lists, such as the merged static ones.
+    bool m_flatTransforms = true; // Mirror the hierarchies in m_transforms, otherwise their nodes are walked.
+
+  private:
+    void Gather(const EntityRawPtrArray& entities);
+    void UpdateTransforms();
+    void UpdateBounds();
+    void BuildRenderList(View& view, const Frustum& frustum);
+
+  private:
+    std::vector<Drawable*> m_drawables; // In entity order.
+    std::vector<uint8> m_cullable; // Has bounds and is posed once per frame. Billboards face each view.
+    std::vector<std::vector<Node*>> m_hierarchies; // Nodes of the drawables, grouped by root.
+    std::vector<Node*> m_roots; // Of m_hierarchies.
+    std::vector<uint> m_walked; // Hierarchies updated through their nodes.
+    TransformSystem m_transforms; // Keeps the mirrored hierarchies until their nodes are destroyed.
+    std::vector<BoundingBox> m_localBoxes;
+    std::vector<Mat4> m_worlds;
+    std::vector<BoundingBox> m_worldBoxes;
+    Stats m_stats;
+  };
+
+}
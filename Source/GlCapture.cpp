@@ -0,0 +1,1444 @@
+#include "stdafx.h"
+#include "GlCapture.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  static const char* g_glOpNames[] =
+  {
+    "GenBuffer",
+    "DeleteBuffer",
+    "BindBuffer",
+    "BufferData",
+    "BufferSubData",
+    "GenTexture",
+    "DeleteTexture",
+    "BindTexture",
+    "ActiveTexture",
+    "TexImage2D",
+    "TexSubImage2D",
+    "TexParameteri",
+    "TexParameterf",
+    "GenerateMipmap",
+    "GenFramebuffer",
+    "DeleteFramebuffer",
+    "BindFramebuffer",
+    "FramebufferTexture2D",
+    "FramebufferRenderbuffer",
+    "DrawBuffers",
+    "BlitFramebuffer",
+    "GenRenderbuffer",
+    "DeleteRenderbuffer",
+    "BindRenderbuffer",
+    "RenderbufferStorage",
+    "CreateShader",
+    "ShaderSource",
+    "CompileShader",
+    "DeleteShader",
+    "CreateProgram",
+    "AttachShader",
+    "LinkProgram",
+    "DeleteProgram",
+    "UseProgram",
+    "GetUniformLocation",
+    "Uniform1i",
+    "Uniform1ui",
+    "Uniform1f",
+    "Uniform2f",
+    "Uniform3i",
+    "Uniform3fv",
+    "Uniform4fv",
+    "UniformMatrix3fv",
+    "UniformMatrix4fv",
+    "EnableVertexAttribArray",
+    "DisableVertexAttribArray",
+    "VertexAttribPointer",
+    "VertexAttribIPointer",
+    "DrawElements",
+    "DrawArrays",
+    "Clear",
+    "ClearColor",
+    "Viewport",
+    "Enable",
+    "Disable",
+    "CullFace",
+    "BlendFunc",
+    "LineWidth"
+  };
+
+  static_assert(sizeof(g_glOpNames) / sizeof(g_glOpNames[0]) == (size_t)GlOp::Count, "Every op needs a name.");
+
+  static const char g_captureMagic[4] = { 'T', 'K', 'G', 'L' };
+  static const uint g_captureVersion = 1;
+
+  static uint64_t FloatBits(float val)
+  {
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(float));
+    return bits;
+  }
+
+  static float BitsFloat(uint64_t val)
+  {
+    uint32_t bits = (uint32_t)val;
+    float f;
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+  }
+
+  static GlCall MakeCall(GlOp op, std::initializer_list<uint64_t> args, const void* data = nullptr, size_t size = 0)
+  {
+    assert(args.size() <= 10);
+
+    GlCall call;
+    call.op = op;
+    call.argCount = (uint8)args.size();
+    std::copy(args.begin(), args.end(), call.args);
+    if (data != nullptr && size > 0)
+    {
+      call.data.assign((const uint8*)data, (const uint8*)data + size);
+    }
+
+    return call;
+  }
+
+  static uint64_t ObjectKey(GlObjectType type, GLuint id)
+  {
+    return ((uint64_t)type << 32) | id;
+  }
+
+  // Rows are aligned to 4 bytes, the default unpack alignment.
+  static size_t ImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+  {
+    size_t components = 4;
+    switch (format)
+    {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+      components = 1;
+      break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+      components = 2;
+      break;
+    case GL_RGB:
+    case GL_RGB_INTEGER:
+      components = 3;
+      break;
+    }
+
+    size_t componentSize = 1;
+    switch (type)
+    {
+    case GL_FLOAT:
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+      componentSize = 4;
+      break;
+    case GL_HALF_FLOAT:
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+      componentSize = 2;
+      break;
+    case GL_UNSIGNED_INT_24_8:
+      components = 1;
+      componentSize = 4;
+      break;
+    }
+
+    size_t row = (width * components * componentSize + 3) / 4 * 4;
+    return row * height;
+  }
+
+  // Removes the earlier calls of the same op whose first matchCount arguments are equal.
+  static void ReplaceCall(std::vector<GlCall>& calls, const GlCall& call, int matchCount)
+  {
+    auto match = [&call, matchCount](const GlCall& other) -> bool
+    {
+      return other.op == call.op && std::equal(call.args, call.args + matchCount, other.args);
+    };
+
+    calls.erase(std::remove_if(calls.begin(), calls.end(), match), calls.end());
+    calls.push_back(call);
+  }
+
+  // GlCapture
+  //////////////////////////////////////////
+
+  GlCapture GlCapture::m_instance;
+
+  GlCapture::GlCapture()
+  {
+  }
+
+  GlCapture* GlCapture::GetInstance()
+  {
+    return &m_instance;
+  }
+
+  void GlCapture::RequestCapture(const String& file)
+  {
+    m_requestedFile = file;
+  }
+
+  bool GlCapture::IsCapturing() const
+  {
+    return m_recording || !m_requestedFile.empty();
+  }
+
+  void GlCapture::BeginFrame()
+  {
+    if (m_requestedFile.empty() || m_recording)
+    {
+      return;
+    }
+
+    m_file = m_requestedFile;
+    m_requestedFile.clear();
+    m_frameCalls.clear();
+    m_recording = true;
+  }
+
+  void GlCapture::EndFrame()
+  {
+    if (!m_recording)
+    {
+      return;
+    }
+    m_recording = false;
+
+    // Objects are recreated in their state at the end of the frame, which also covers the ones the frame uses.
+    std::vector<GlCall> setup;
+    WriteSetup(setup);
+
+    if (Write(m_file, setup))
+    {
+      Logger::GetInstance()->Log("Gl capture: " + std::to_string(m_frameCalls.size()) + " calls written to " + m_file);
+    }
+    else
+    {
+      Logger::GetInstance()->Log("Gl capture: can't write " + m_file);
+    }
+
+    m_frameCalls.clear();
+  }
+
+  void GlCapture::Record(const GlCall& call)
+  {
+    if (m_recording)
+    {
+      m_frameCalls.push_back(call);
+    }
+  }
+
+  GlCapture::Object* GlCapture::CreateObject(GlObjectType type, GLuint id)
+  {
+    Object& object = m_objects[ObjectKey(type, id)];
+    object = Object();
+    return &object;
+  }
+
+  GlCapture::Object* GlCapture::FindObject(GlObjectType type, GLuint id)
+  {
+    auto object = m_objects.find(ObjectKey(type, id));
+    if (object == m_objects.end())
+    {
+      return nullptr;
+    }
+
+    return &object->second;
+  }
+
+  void GlCapture::RemoveObject(GlObjectType type, GLuint id)
+  {
+    m_objects.erase(ObjectKey(type, id));
+  }
+
+  GLuint GlCapture::GetBound(GLenum target)
+  {
+    GLenum binding = 0;
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+      binding = GL_ARRAY_BUFFER_BINDING;
+      break;
+    case GL_ELEMENT_ARRAY_BUFFER:
+      binding = GL_ELEMENT_ARRAY_BUFFER_BINDING;
+      break;
+    case GL_TEXTURE_2D:
+      binding = GL_TEXTURE_BINDING_2D;
+      break;
+    case GL_TEXTURE_CUBE_MAP:
+    case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+    case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+    case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+    case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
+      binding = GL_TEXTURE_BINDING_CUBE_MAP;
+      break;
+    case GL_FRAMEBUFFER:
+    case GL_DRAW_FRAMEBUFFER:
+      binding = GL_DRAW_FRAMEBUFFER_BINDING;
+      break;
+    case GL_READ_FRAMEBUFFER:
+      binding = GL_READ_FRAMEBUFFER_BINDING;
+      break;
+    case GL_RENDERBUFFER:
+      binding = GL_RENDERBUFFER_BINDING;
+      break;
+    default:
+      assert(false && "Unknown bind target.");
+      return 0;
+    }
+
+    GLint id = 0;
+    glGetIntegerv(binding, &id);
+    return (GLuint)id;
+  }
+
+  void GlCapture::WriteSetup(std::vector<GlCall>& calls) const
+  {
+    calls.push_back(MakeCall(GlOp::ActiveTexture, { GL_TEXTURE0 }));
+
+    // Dependencies first: shaders for programs, attachments for framebuffers.
+    for (int type = 0; type < (int)GlObjectType::Count; type++)
+    {
+      for (const auto& entry : m_objects)
+      {
+        if ((int)(entry.first >> 32) != type)
+        {
+          continue;
+        }
+
+        GLuint id = (GLuint)entry.first;
+        const Object& object = entry.second;
+        switch ((GlObjectType)type)
+        {
+        case GlObjectType::Shader:
+        case GlObjectType::Program:
+          calls.insert(calls.end(), object.calls.begin(), object.calls.end());
+          break;
+        case GlObjectType::Texture:
+          calls.push_back(MakeCall(GlOp::GenTexture, { id }));
+          if (object.target != 0)
+          {
+            calls.push_back(MakeCall(GlOp::BindTexture, { object.target, id }));
+            calls.insert(calls.end(), object.calls.begin(), object.calls.end());
+            calls.push_back(MakeCall(GlOp::BindTexture, { object.target, 0 }));
+          }
+          break;
+        case GlObjectType::Renderbuffer:
+          calls.push_back(MakeCall(GlOp::GenRenderbuffer, { id }));
+          calls.push_back(MakeCall(GlOp::BindRenderbuffer, { GL_RENDERBUFFER, id }));
+          calls.insert(calls.end(), object.calls.begin(), object.calls.end());
+          calls.push_back(MakeCall(GlOp::BindRenderbuffer, { GL_RENDERBUFFER, 0 }));
+          break;
+        case GlObjectType::Framebuffer:
+          calls.push_back(MakeCall(GlOp::GenFramebuffer, { id }));
+          calls.push_back(MakeCall(GlOp::BindFramebuffer, { GL_FRAMEBUFFER, id }));
+          calls.insert(calls.end(), object.calls.begin(), object.calls.end());
+          calls.push_back(MakeCall(GlOp::BindFramebuffer, { GL_FRAMEBUFFER, 0 }));
+          break;
+        case GlObjectType::Buffer:
+          calls.push_back(MakeCall(GlOp::GenBuffer, { id }));
+          if (object.target != 0)
+          {
+            calls.push_back(MakeCall(GlOp::BindBuffer, { object.target, id }));
+            calls.push_back(MakeCall(GlOp::BufferData, { object.target, object.contents.size(), object.usage }, object.contents.data(), object.contents.size()));
+            calls.push_back(MakeCall(GlOp::BindBuffer, { object.target, 0 }));
+          }
+          break;
+        default:
+          break;
+        }
+      }
+    }
+
+    // State at the frame start. Queried, code outside of the hooks may have changed it.
+    for (GLenum cap : { GL_CULL_FACE, GL_DEPTH_TEST, GL_BLEND })
+    {
+      calls.push_back(MakeCall(glIsEnabled(cap) ? GlOp::Enable : GlOp::Disable, { cap }));
+    }
+
+    GLint vals[4] = {};
+    glGetIntegerv(GL_CULL_FACE_MODE, vals);
+    calls.push_back(MakeCall(GlOp::CullFace, { (uint64_t)vals[0] }));
+
+    glGetIntegerv(GL_BLEND_SRC_RGB, vals);
+    glGetIntegerv(GL_BLEND_DST_RGB, vals + 1);
+    calls.push_back(MakeCall(GlOp::BlendFunc, { (uint64_t)vals[0], (uint64_t)vals[1] }));
+
+    GLfloat floats[4] = {};
+    glGetFloatv(GL_LINE_WIDTH, floats);
+    calls.push_back(MakeCall(GlOp::LineWidth, { FloatBits(floats[0]) }));
+
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, floats);
+    calls.push_back(MakeCall(GlOp::ClearColor, { FloatBits(floats[0]), FloatBits(floats[1]), FloatBits(floats[2]), FloatBits(floats[3]) }));
+
+    glGetIntegerv(GL_VIEWPORT, vals);
+    calls.push_back(MakeCall(GlOp::Viewport, { (uint64_t)vals[0], (uint64_t)vals[1], (uint64_t)vals[2], (uint64_t)vals[3] }));
+
+    calls.push_back(MakeCall(GlOp::BindFramebuffer, { GL_FRAMEBUFFER, GetBound(GL_FRAMEBUFFER) }));
+    calls.push_back(MakeCall(GlOp::BindBuffer, { GL_ARRAY_BUFFER, GetBound(GL_ARRAY_BUFFER) }));
+    calls.push_back(MakeCall(GlOp::BindBuffer, { GL_ELEMENT_ARRAY_BUFFER, GetBound(GL_ELEMENT_ARRAY_BUFFER) }));
+
+    glGetIntegerv(GL_CURRENT_PROGRAM, vals);
+    calls.push_back(MakeCall(GlOp::UseProgram, { (uint64_t)vals[0] }));
+
+    // Units used by the renderer.
+    GLint activeUnit = GL_TEXTURE0;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+    for (GLenum unit = GL_TEXTURE0; unit <= GL_TEXTURE3; unit++)
+    {
+      glActiveTexture(unit);
+      calls.push_back(MakeCall(GlOp::ActiveTexture, { unit }));
+      calls.push_back(MakeCall(GlOp::BindTexture, { GL_TEXTURE_2D, GetBound(GL_TEXTURE_2D) }));
+      calls.push_back(MakeCall(GlOp::BindTexture, { GL_TEXTURE_CUBE_MAP, GetBound(GL_TEXTURE_CUBE_MAP) }));
+    }
+    glActiveTexture(activeUnit);
+    calls.push_back(MakeCall(GlOp::ActiveTexture, { (uint64_t)activeUnit }));
+  }
+
+  bool GlCapture::Write(const String& file, const std::vector<GlCall>& setup) const
+  {
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::binary);
+    if (!out.is_open())
+    {
+      return false;
+    }
+
+    auto WriteUintFn = [&out](uint val) -> void
+    {
+      out.write((const char*)&val, sizeof(uint));
+    };
+
+    auto WriteCallsFn = [&out, &WriteUintFn](const std::vector<GlCall>& calls) -> void
+    {
+      for (const GlCall& call : calls)
+      {
+        WriteUintFn((uint)call.op);
+        out.put((char)call.argCount);
+        out.write((const char*)call.args, call.argCount * sizeof(uint64_t));
+        WriteUintFn((uint)call.data.size());
+        out.write((const char*)call.data.data(), call.data.size());
+      }
+    };
+
+    out.write(g_captureMagic, sizeof(g_captureMagic));
+    WriteUintFn(g_captureVersion);
+    WriteUintFn((uint)setup.size());
+    WriteUintFn((uint)m_frameCalls.size());
+    WriteCallsFn(setup);
+    WriteCallsFn(m_frameCalls);
+
+    return out.good();
+  }
+
+  // Hooks
+  //////////////////////////////////////////
+
+  // Declared in GlCaptureHooks.h, which is not included here so that the calls below reach gl.
+  namespace GlHooks
+  {
+
+    static GlCapture* Capture()
+    {
+      return GlCapture::GetInstance();
+    }
+
+    static void GenObjects(GlObjectType type, GlOp op, GLsizei n, const GLuint* ids)
+    {
+      for (GLsizei i = 0; i < n; i++)
+      {
+        Capture()->CreateObject(type, ids[i]);
+        Capture()->Record(MakeCall(op, { ids[i] }));
+      }
+    }
+
+    static void DeleteObjects(GlObjectType type, GlOp op, GLsizei n, const GLuint* ids)
+    {
+      for (GLsizei i = 0; i < n; i++)
+      {
+        if (ids[i] != 0)
+        {
+          Capture()->RemoveObject(type, ids[i]);
+          Capture()->Record(MakeCall(op, { ids[i] }));
+        }
+      }
+    }
+
+    void GenBuffers(GLsizei n, GLuint* buffers)
+    {
+      glGenBuffers(n, buffers);
+      GenObjects(GlObjectType::Buffer, GlOp::GenBuffer, n, buffers);
+    }
+
+    void DeleteBuffers(GLsizei n, const GLuint* buffers)
+    {
+      glDeleteBuffers(n, buffers);
+      DeleteObjects(GlObjectType::Buffer, GlOp::DeleteBuffer, n, buffers);
+    }
+
+    void BindBuffer(GLenum target, GLuint buffer)
+    {
+      glBindBuffer(target, buffer);
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Buffer, buffer))
+      {
+        object->target = target;
+      }
+      Capture()->Record(MakeCall(GlOp::BindBuffer, { target, buffer }));
+    }
+
+    void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+    {
+      glBufferData(target, size, data, usage);
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Buffer, GlCapture::GetBound(target)))
+      {
+        object->usage = usage;
+        object->contents.assign(size, 0);
+        if (data != nullptr)
+        {
+          memcpy(object->contents.data(), data, size);
+        }
+      }
+      Capture()->Record(MakeCall(GlOp::BufferData, { target, (uint64_t)size, usage }, data, data != nullptr ? size : 0));
+    }
+
+    void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+      glBufferSubData(target, offset, size, data);
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Buffer, GlCapture::GetBound(target)))
+      {
+        if (object->contents.size() < (size_t)(offset + size))
+        {
+          object->contents.resize(offset + size);
+        }
+        memcpy(object->contents.data() + offset, data, size);
+      }
+      Capture()->Record(MakeCall(GlOp::BufferSubData, { target, (uint64_t)offset, (uint64_t)size }, data, size));
+    }
+
+    void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+    {
+      void* ptr = glMapBufferRange(target, offset, length, access);
+      GlCapture::Mapping& mapping = Capture()->m_mapping;
+      mapping.target = target;
+      mapping.offset = offset;
+      mapping.length = length;
+      mapping.ptr = ptr;
+      return ptr;
+    }
+
+    GLboolean UnmapBuffer(GLenum target)
+    {
+      // Written contents are recorded as a sub data upload.
+      GlCapture::Mapping& mapping = Capture()->m_mapping;
+      if (mapping.ptr != nullptr && mapping.target == target)
+      {
+        if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Buffer, GlCapture::GetBound(target)))
+        {
+          if (object->contents.size() < (size_t)(mapping.offset + mapping.length))
+          {
+            object->contents.resize(mapping.offset + mapping.length);
+          }
+          memcpy(object->contents.data() + mapping.offset, mapping.ptr, mapping.length);
+        }
+        Capture()->Record(MakeCall(GlOp::BufferSubData, { target, (uint64_t)mapping.offset, (uint64_t)mapping.length }, mapping.ptr, mapping.length));
+      }
+      mapping = GlCapture::Mapping();
+
+      return glUnmapBuffer(target);
+    }
+
+    void GenTextures(GLsizei n, GLuint* textures)
+    {
+      glGenTextures(n, textures);
+      GenObjects(GlObjectType::Texture, GlOp::GenTexture, n, textures);
+    }
+
+    void DeleteTextures(GLsizei n, const GLuint* textures)
+    {
+      glDeleteTextures(n, textures);
+      DeleteObjects(GlObjectType::Texture, GlOp::DeleteTexture, n, textures);
+    }
+
+    void BindTexture(GLenum target, GLuint texture)
+    {
+      glBindTexture(target, texture);
+      GlCapture::Object* object = Capture()->FindObject(GlObjectType::Texture, texture);
+      if (object != nullptr && object->target == 0)
+      {
+        object->target = target;
+      }
+      Capture()->Record(MakeCall(GlOp::BindTexture, { target, texture }));
+    }
+
+    void ActiveTexture(GLenum texture)
+    {
+      glActiveTexture(texture);
+      Capture()->Record(MakeCall(GlOp::ActiveTexture, { texture }));
+    }
+
+    void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+    {
+      glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+
+      size_t size = pixels != nullptr ? ImageSize(width, height, format, type) : 0;
+      GlCall call = MakeCall(GlOp::TexImage2D, { target, (uint64_t)level, (uint64_t)internalFormat, (uint64_t)width, (uint64_t)height, (uint64_t)border, format, type }, pixels, size);
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Texture, GlCapture::GetBound(target)))
+      {
+        // Redefining a level drops its earlier contents.
+        auto overwritten = [target, level](const GlCall& other) -> bool
+        {
+          return other.op == GlOp::TexSubImage2D && other.args[0] == target && other.args[1] == (uint64_t)level;
+        };
+        object->calls.erase(std::remove_if(object->calls.begin(), object->calls.end(), overwritten), object->calls.end());
+        ReplaceCall(object->calls, call, 2);
+      }
+      Capture()->Record(call);
+    }
+
+    void TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+    {
+      glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+
+      GlCall call = MakeCall(GlOp::TexSubImage2D, { target, (uint64_t)level, (uint64_t)xoffset, (uint64_t)yoffset, (uint64_t)width, (uint64_t)height, format, type }, pixels, ImageSize(width, height, format, type));
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Texture, GlCapture::GetBound(target)))
+      {
+        object->calls.push_back(call);
+      }
+      Capture()->Record(call);
+    }
+
+    void TexParameteri(GLenum target, GLenum pname, GLint param)
+    {
+      glTexParameteri(target, pname, param);
+
+      GlCall call = MakeCall(GlOp::TexParameteri, { target, pname, (uint64_t)param });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Texture, GlCapture::GetBound(target)))
+      {
+        ReplaceCall(object->calls, call, 2);
+      }
+      Capture()->Record(call);
+    }
+
+    void TexParameterf(GLenum target, GLenum pname, GLfloat param)
+    {
+      glTexParameterf(target, pname, param);
+
+      GlCall call = MakeCall(GlOp::TexParameterf, { target, pname, FloatBits(param) });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Texture, GlCapture::GetBound(target)))
+      {
+        ReplaceCall(object->calls, call, 2);
+      }
+      Capture()->Record(call);
+    }
+
+    void GenerateMipmap(GLenum target)
+    {
+      glGenerateMipmap(target);
+
+      GlCall call = MakeCall(GlOp::GenerateMipmap, { target });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Texture, GlCapture::GetBound(target)))
+      {
+        ReplaceCall(object->calls, call, 1);
+      }
+      Capture()->Record(call);
+    }
+
+    void GenFramebuffers(GLsizei n, GLuint* framebuffers)
+    {
+      glGenFramebuffers(n, framebuffers);
+      GenObjects(GlObjectType::Framebuffer, GlOp::GenFramebuffer, n, framebuffers);
+    }
+
+    void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+    {
+      glDeleteFramebuffers(n, framebuffers);
+      DeleteObjects(GlObjectType::Framebuffer, GlOp::DeleteFramebuffer, n, framebuffers);
+    }
+
+    void BindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+      glBindFramebuffer(target, framebuffer);
+      Capture()->Record(MakeCall(GlOp::BindFramebuffer, { target, framebuffer }));
+    }
+
+    void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+    {
+      glFramebufferTexture2D(target, attachment, textarget, texture, level);
+
+      // Replayed on GL_FRAMEBUFFER while the object is bound.
+      GlCall call = MakeCall(GlOp::FramebufferTexture2D, { GL_FRAMEBUFFER, attachment, textarget, texture, (uint64_t)level });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Framebuffer, GlCapture::GetBound(target)))
+      {
+        ReplaceCall(object->calls, call, 2);
+      }
+      call.args[0] = target;
+      Capture()->Record(call);
+    }
+
+    void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+    {
+      glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+
+      GlCall call = MakeCall(GlOp::FramebufferRenderbuffer, { GL_FRAMEBUFFER, attachment, renderbuffertarget, renderbuffer });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Framebuffer, GlCapture::GetBound(target)))
+      {
+        ReplaceCall(object->calls, call, 2);
+      }
+      call.args[0] = target;
+      Capture()->Record(call);
+    }
+
+    void DrawBuffers(GLsizei n, const GLenum* bufs)
+    {
+      glDrawBuffers(n, bufs);
+
+      GlCall call = MakeCall(GlOp::DrawBuffers, { (uint64_t)n }, bufs, n * sizeof(GLenum));
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Framebuffer, GlCapture::GetBound(GL_DRAW_FRAMEBUFFER)))
+      {
+        ReplaceCall(object->calls, call, 0);
+      }
+      Capture()->Record(call);
+    }
+
+    void BlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
+    {
+      glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+      Capture()->Record
+      (
+        MakeCall
+        (
+          GlOp::BlitFramebuffer,
+          {
+            (uint64_t)srcX0, (uint64_t)srcY0, (uint64_t)srcX1, (uint64_t)srcY1,
+            (uint64_t)dstX0, (uint64_t)dstY0, (uint64_t)dstX1, (uint64_t)dstY1,
+            mask, filter
+          }
+        )
+      );
+    }
+
+    void GenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+    {
+      glGenRenderbuffers(n, renderbuffers);
+      GenObjects(GlObjectType::Renderbuffer, GlOp::GenRenderbuffer, n, renderbuffers);
+    }
+
+    void DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+    {
+      glDeleteRenderbuffers(n, renderbuffers);
+      DeleteObjects(GlObjectType::Renderbuffer, GlOp::DeleteRenderbuffer, n, renderbuffers);
+    }
+
+    void BindRenderbuffer(GLenum target, GLuint renderbuffer)
+    {
+      glBindRenderbuffer(target, renderbuffer);
+      Capture()->Record(MakeCall(GlOp::BindRenderbuffer, { target, renderbuffer }));
+    }
+
+    void RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+      glRenderbufferStorage(target, internalformat, width, height);
+
+      GlCall call = MakeCall(GlOp::RenderbufferStorage, { target, internalformat, (uint64_t)width, (uint64_t)height });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Renderbuffer, GlCapture::GetBound(target)))
+      {
+        ReplaceCall(object->calls, call, 0);
+      }
+      Capture()->Record(call);
+    }
+
+    GLuint CreateShader(GLenum type)
+    {
+      GLuint shader = glCreateShader(type);
+
+      GlCall call = MakeCall(GlOp::CreateShader, { type, shader });
+      Capture()->CreateObject(GlObjectType::Shader, shader)->calls.push_back(call);
+      Capture()->Record(call);
+
+      return shader;
+    }
+
+    void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+    {
+      glShaderSource(shader, count, string, length);
+
+      String source;
+      for (GLsizei i = 0; i < count; i++)
+      {
+        if (length != nullptr && length[i] >= 0)
+        {
+          source.append(string[i], length[i]);
+        }
+        else
+        {
+          source.append(string[i]);
+        }
+      }
+
+      GlCall call = MakeCall(GlOp::ShaderSource, { shader }, source.data(), source.size());
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Shader, shader))
+      {
+        ReplaceCall(object->calls, call, 1);
+      }
+      Capture()->Record(call);
+    }
+
+    void CompileShader(GLuint shader)
+    {
+      glCompileShader(shader);
+
+      GlCall call = MakeCall(GlOp::CompileShader, { shader });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Shader, shader))
+      {
+        ReplaceCall(object->calls, call, 1);
+      }
+      Capture()->Record(call);
+    }
+
+    void DeleteShader(GLuint shader)
+    {
+      // The log is kept, programs linked with the shader recreate it.
+      glDeleteShader(shader);
+      Capture()->Record(MakeCall(GlOp::DeleteShader, { shader }));
+    }
+
+    GLuint CreateProgram()
+    {
+      GLuint program = glCreateProgram();
+
+      GlCall call = MakeCall(GlOp::CreateProgram, { program });
+      Capture()->CreateObject(GlObjectType::Program, program)->calls.push_back(call);
+      Capture()->Record(call);
+
+      return program;
+    }
+
+    void AttachShader(GLuint program, GLuint shader)
+    {
+      glAttachShader(program, shader);
+
+      GlCall call = MakeCall(GlOp::AttachShader, { program, shader });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Program, program))
+      {
+        ReplaceCall(object->calls, call, 2);
+      }
+      Capture()->Record(call);
+    }
+
+    void LinkProgram(GLuint program)
+    {
+      glLinkProgram(program);
+
+      GlCall call = MakeCall(GlOp::LinkProgram, { program });
+      if (GlCapture::Object* object = Capture()->FindObject(GlObjectType::Program, program))
+      {
+        ReplaceCall(object->calls, call, 1);
+      }
+      Capture()->Record(call);
+    }
+
+    void DeleteProgram(GLuint program)
+    {
+      glDeleteProgram(program);
+      if (program != 0)
+      {
+        Capture()->RemoveObject(GlObjectType::Program, program);
+        Capture()->Record(MakeCall(GlOp::DeleteProgram, { program }));
+      }
+    }
+
+    void UseProgram(GLuint program)
+    {
+      glUseProgram(program);
+      Capture()->Record(MakeCall(GlOp::UseProgram, { program }));
+    }
+
+    GLint GetUniformLocation(GLuint program, const GLchar* name)
+    {
+      GLint location = glGetUniformLocation(program, name);
+      Capture()->Record(MakeCall(GlOp::GetUniformLocation, { program, (uint64_t)(uint32_t)location }, name, strlen(name)));
+      return location;
+    }
+
+    void Uniform1i(GLint location, GLint v0)
+    {
+      glUniform1i(location, v0);
+      Capture()->Record(MakeCall(GlOp::Uniform1i, { (uint64_t)(uint32_t)location, (uint64_t)(uint32_t)v0 }));
+    }
+
+    void Uniform1ui(GLint location, GLuint v0)
+    {
+      glUniform1ui(location, v0);
+      Capture()->Record(MakeCall(GlOp::Uniform1ui, { (uint64_t)(uint32_t)location, v0 }));
+    }
+
+    void Uniform1f(GLint location, GLfloat v0)
+    {
+      glUniform1f(location, v0);
+      Capture()->Record(MakeCall(GlOp::Uniform1f, { (uint64_t)(uint32_t)location, FloatBits(v0) }));
+    }
+
+    void Uniform2f(GLint location, GLfloat v0, GLfloat v1)
+    {
+      glUniform2f(location, v0, v1);
+      Capture()->Record(MakeCall(GlOp::Uniform2f, { (uint64_t)(uint32_t)location, FloatBits(v0), FloatBits(v1) }));
+    }
+
+    void Uniform3i(GLint location, GLint v0, GLint v1, GLint v2)
+    {
+      glUniform3i(location, v0, v1, v2);
+      Capture()->Record(MakeCall(GlOp::Uniform3i, { (uint64_t)(uint32_t)location, (uint64_t)(uint32_t)v0, (uint64_t)(uint32_t)v1, (uint64_t)(uint32_t)v2 }));
+    }
+
+    void Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+      glUniform3fv(location, count, value);
+      Capture()->Record(MakeCall(GlOp::Uniform3fv, { (uint64_t)(uint32_t)location, (uint64_t)count }, value, count * 3 * sizeof(GLfloat)));
+    }
+
+    void Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+      glUniform4fv(location, count, value);
+      Capture()->Record(MakeCall(GlOp::Uniform4fv, { (uint64_t)(uint32_t)location, (uint64_t)count }, value, count * 4 * sizeof(GLfloat)));
+    }
+
+    void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+      glUniformMatrix3fv(location, count, transpose, value);
+      Capture()->Record(MakeCall(GlOp::UniformMatrix3fv, { (uint64_t)(uint32_t)location, (uint64_t)count, transpose }, value, count * 9 * sizeof(GLfloat)));
+    }
+
+    void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+      glUniformMatrix4fv(location, count, transpose, value);
+      Capture()->Record(MakeCall(GlOp::UniformMatrix4fv, { (uint64_t)(uint32_t)location, (uint64_t)count, transpose }, value, count * 16 * sizeof(GLfloat)));
+    }
+
+    void EnableVertexAttribArray(GLuint index)
+    {
+      glEnableVertexAttribArray(index);
+      Capture()->Record(MakeCall(GlOp::EnableVertexAttribArray, { index }));
+    }
+
+    void DisableVertexAttribArray(GLuint index)
+    {
+      glDisableVertexAttribArray(index);
+      Capture()->Record(MakeCall(GlOp::DisableVertexAttribArray, { index }));
+    }
+
+    // Pointers are offsets into the bound buffers, client side arrays are not used.
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+    {
+      glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+      Capture()->Record(MakeCall(GlOp::VertexAttribPointer, { index, (uint64_t)size, type, normalized, (uint64_t)stride, (uint64_t)(uintptr_t)pointer }));
+    }
+
+    void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer)
+    {
+      glVertexAttribIPointer(index, size, type, stride, pointer);
+      Capture()->Record(MakeCall(GlOp::VertexAttribIPointer, { index, (uint64_t)size, type, (uint64_t)stride, (uint64_t)(uintptr_t)pointer }));
+    }
+
+    void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+      glDrawElements(mode, count, type, indices);
+      Capture()->Record(MakeCall(GlOp::DrawElements, { mode, (uint64_t)count, type, (uint64_t)(uintptr_t)indices }));
+    }
+
+    void DrawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+      glDrawArrays(mode, first, count);
+      Capture()->Record(MakeCall(GlOp::DrawArrays, { mode, (uint64_t)first, (uint64_t)count }));
+    }
+
+    void Clear(GLbitfield mask)
+    {
+      glClear(mask);
+      Capture()->Record(MakeCall(GlOp::Clear, { mask }));
+    }
+
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+      glViewport(x, y, width, height);
+      Capture()->Record(MakeCall(GlOp::Viewport, { (uint64_t)x, (uint64_t)y, (uint64_t)width, (uint64_t)height }));
+    }
+
+    void Enable(GLenum cap)
+    {
+      glEnable(cap);
+      Capture()->Record(MakeCall(GlOp::Enable, { cap }));
+    }
+
+    void Disable(GLenum cap)
+    {
+      glDisable(cap);
+      Capture()->Record(MakeCall(GlOp::Disable, { cap }));
+    }
+
+    void CullFace(GLenum mode)
+    {
+      glCullFace(mode);
+      Capture()->Record(MakeCall(GlOp::CullFace, { mode }));
+    }
+
+    void BlendFunc(GLenum sfactor, GLenum dfactor)
+    {
+      glBlendFunc(sfactor, dfactor);
+      Capture()->Record(MakeCall(GlOp::BlendFunc, { sfactor, dfactor }));
+    }
+
+    void LineWidth(GLfloat width)
+    {
+      glLineWidth(width);
+      Capture()->Record(MakeCall(GlOp::LineWidth, { FloatBits(width) }));
+    }
+
+  }
+
+  // GlReplay
+  //////////////////////////////////////////
+
+  GlReplay::~GlReplay()
+  {
+    Release();
+  }
+
+  bool GlReplay::Load(const String& file)
+  {
+    std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+    if (!in.is_open())
+    {
+      m_error = "Can't open " + file;
+      return false;
+    }
+
+    auto ReadUintFn = [&in]() -> uint
+    {
+      uint val = 0;
+      in.read((char*)&val, sizeof(uint));
+      return val;
+    };
+
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    if (memcmp(magic, g_captureMagic, sizeof(magic)) != 0 || ReadUintFn() != g_captureVersion)
+    {
+      m_error = file + " is not a capture or has a different version.";
+      return false;
+    }
+
+    uint setupCount = ReadUintFn();
+    uint frameCount = ReadUintFn();
+
+    auto ReadCallsFn = [&in, &ReadUintFn](std::vector<GlCall>& calls, uint count) -> bool
+    {
+      calls.resize(count);
+      for (GlCall& call : calls)
+      {
+        uint op = ReadUintFn();
+        call.argCount = (uint8)in.get();
+        if (op >= (uint)GlOp::Count || call.argCount > 10)
+        {
+          return false;
+        }
+
+        call.op = (GlOp)op;
+        in.read((char*)call.args, call.argCount * sizeof(uint64_t));
+        call.data.resize(ReadUintFn());
+        in.read((char*)call.data.data(), call.data.size());
+      }
+
+      return in.good();
+    };
+
+    if (!ReadCallsFn(m_setup, setupCount) || !ReadCallsFn(m_frame, frameCount))
+    {
+      m_error = file + " is corrupted.";
+      return false;
+    }
+
+    return true;
+  }
+
+  GlReplay::Report GlReplay::Run(uint iterations)
+  {
+    Report report;
+    report.setupCalls = (uint)m_setup.size();
+    report.frameCalls = (uint)m_frame.size();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const GlCall& call : m_setup)
+    {
+      Execute(call);
+    }
+    glFinish();
+    auto end = std::chrono::high_resolution_clock::now();
+    report.setupMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+    for (uint i = 0; i < iterations; i++)
+    {
+      start = std::chrono::high_resolution_clock::now();
+      for (const GlCall& call : m_frame)
+      {
+        Execute(call);
+      }
+      glFinish();
+      end = std::chrono::high_resolution_clock::now();
+      report.frameMs.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+    }
+
+    uint counts[(int)GlOp::Count] = {};
+    for (const GlCall& call : m_frame)
+    {
+      counts[(int)call.op]++;
+    }
+
+    for (int op = 0; op < (int)GlOp::Count; op++)
+    {
+      if (counts[op] > 0)
+      {
+        report.histogram.push_back({ g_glOpNames[op], counts[op] });
+      }
+    }
+
+    std::stable_sort
+    (
+      report.histogram.begin(),
+      report.histogram.end(),
+      [](const std::pair<String, uint>& a, const std::pair<String, uint>& b) -> bool
+      {
+        return a.second > b.second;
+      }
+    );
+
+    Release();
+    return report;
+  }
+
+  String GlReplay::ToString(const Report& report)
+  {
+    std::vector<float> sorted = report.frameMs;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::stringstream str;
+    str << std::fixed << std::setprecision(3);
+    str << "setup: " << report.setupCalls << " calls, " << report.setupMs << " ms\n";
+    str << "frame: " << report.frameCalls << " calls\n";
+    if (!sorted.empty())
+    {
+      float total = 0.0f;
+      for (float ms : sorted)
+      {
+        total += ms;
+      }
+
+      str << "iterations: " << sorted.size() << "\n";
+      str << "avg: " << total / sorted.size() << " ms\n";
+      str << "min: " << sorted.front() << " ms\n";
+      str << "median: " << sorted[sorted.size() / 2] << " ms\n";
+      str << "max: " << sorted.back() << " ms\n";
+    }
+
+    str << "calls per frame:\n";
+    for (const std::pair<String, uint>& entry : report.histogram)
+    {
+      str << "  " << std::left << std::setw(28) << entry.first << entry.second << "\n";
+    }
+
+    return str.str();
+  }
+
+  void GlReplay::Execute(const GlCall& call)
+  {
+    const uint64_t* a = call.args;
+    const void* data = call.data.empty() ? nullptr : call.data.data();
+
+    auto GenFn = [this](GlObjectType type, uint64_t captured, GLuint id) -> void
+    {
+      m_ids[(int)type][(GLuint)captured] = id;
+    };
+
+    auto DeleteFn = [this](GlObjectType type, uint64_t captured) -> GLuint
+    {
+      GLuint id = MapId(type, captured);
+      m_ids[(int)type].erase((GLuint)captured);
+      return id;
+    };
+
+    auto LocationFn = [this](uint64_t captured) -> GLint
+    {
+      if ((GLint)(uint32_t)captured == -1)
+      {
+        return -1;
+      }
+
+      auto location = m_locations.find(((uint64_t)m_program << 32) | (uint32_t)captured);
+      return location == m_locations.end() ? -1 : location->second;
+    };
+
+    GLuint id = 0;
+    switch (call.op)
+    {
+    case GlOp::GenBuffer:
+      glGenBuffers(1, &id);
+      GenFn(GlObjectType::Buffer, a[0], id);
+      break;
+    case GlOp::DeleteBuffer:
+      id = DeleteFn(GlObjectType::Buffer, a[0]);
+      glDeleteBuffers(1, &id);
+      break;
+    case GlOp::BindBuffer:
+      glBindBuffer((GLenum)a[0], MapId(GlObjectType::Buffer, a[1]));
+      break;
+    case GlOp::BufferData:
+      glBufferData((GLenum)a[0], (GLsizeiptr)a[1], data, (GLenum)a[2]);
+      break;
+    case GlOp::BufferSubData:
+      glBufferSubData((GLenum)a[0], (GLintptr)a[1], (GLsizeiptr)a[2], data);
+      break;
+    case GlOp::GenTexture:
+      glGenTextures(1, &id);
+      GenFn(GlObjectType::Texture, a[0], id);
+      break;
+    case GlOp::DeleteTexture:
+      id = DeleteFn(GlObjectType::Texture, a[0]);
+      glDeleteTextures(1, &id);
+      break;
+    case GlOp::BindTexture:
+      glBindTexture((GLenum)a[0], MapId(GlObjectType::Texture, a[1]));
+      break;
+    case GlOp::ActiveTexture:
+      glActiveTexture((GLenum)a[0]);
+      break;
+    case GlOp::TexImage2D:
+      glTexImage2D((GLenum)a[0], (GLint)a[1], (GLint)a[2], (GLsizei)a[3], (GLsizei)a[4], (GLint)a[5], (GLenum)a[6], (GLenum)a[7], data);
+      break;
+    case GlOp::TexSubImage2D:
+      glTexSubImage2D((GLenum)a[0], (GLint)a[1], (GLint)a[2], (GLint)a[3], (GLsizei)a[4], (GLsizei)a[5], (GLenum)a[6], (GLenum)a[7], data);
+      break;
+    case GlOp::TexParameteri:
+      glTexParameteri((GLenum)a[0], (GLenum)a[1], (GLint)a[2]);
+      break;
+    case GlOp::TexParameterf:
+      glTexParameterf((GLenum)a[0], (GLenum)a[1], BitsFloat(a[2]));
+      break;
+    case GlOp::GenerateMipmap:
+      glGenerateMipmap((GLenum)a[0]);
+      break;
+    case GlOp::GenFramebuffer:
+      glGenFramebuffers(1, &id);
+      GenFn(GlObjectType::Framebuffer, a[0], id);
+      break;
+    case GlOp::DeleteFramebuffer:
+      id = DeleteFn(GlObjectType::Framebuffer, a[0]);
+      glDeleteFramebuffers(1, &id);
+      break;
+    case GlOp::BindFramebuffer:
+      glBindFramebuffer((GLenum)a[0], MapId(GlObjectType::Framebuffer, a[1]));
+      break;
+    case GlOp::FramebufferTexture2D:
+      glFramebufferTexture2D((GLenum)a[0], (GLenum)a[1], (GLenum)a[2], MapId(GlObjectType::Texture, a[3]), (GLint)a[4]);
+      break;
+    case GlOp::FramebufferRenderbuffer:
+      glFramebufferRenderbuffer((GLenum)a[0], (GLenum)a[1], (GLenum)a[2], MapId(GlObjectType::Renderbuffer, a[3]));
+      break;
+    case GlOp::DrawBuffers:
+      glDrawBuffers((GLsizei)a[0], (const GLenum*)data);
+      break;
+    case GlOp::BlitFramebuffer:
+      glBlitFramebuffer((GLint)a[0], (GLint)a[1], (GLint)a[2], (GLint)a[3], (GLint)a[4], (GLint)a[5], (GLint)a[6], (GLint)a[7], (GLbitfield)a[8], (GLenum)a[9]);
+      break;
+    case GlOp::GenRenderbuffer:
+      glGenRenderbuffers(1, &id);
+      GenFn(GlObjectType::Renderbuffer, a[0], id);
+      break;
+    case GlOp::DeleteRenderbuffer:
+      id = DeleteFn(GlObjectType::Renderbuffer, a[0]);
+      glDeleteRenderbuffers(1, &id);
+      break;
+    case GlOp::BindRenderbuffer:
+      glBindRenderbuffer((GLenum)a[0], MapId(GlObjectType::Renderbuffer, a[1]));
+      break;
+    case GlOp::RenderbufferStorage:
+      glRenderbufferStorage((GLenum)a[0], (GLenum)a[1], (GLsizei)a[2], (GLsizei)a[3]);
+      break;
+    case GlOp::CreateShader:
+      GenFn(GlObjectType::Shader, a[1], glCreateShader((GLenum)a[0]));
+      break;
+    case GlOp::ShaderSource:
+    {
+      const GLchar* source = (const GLchar*)data;
+      GLint length = (GLint)call.data.size();
+      glShaderSource(MapId(GlObjectType::Shader, a[0]), 1, &source, &length);
+    }
+    break;
+    case GlOp::CompileShader:
+      glCompileShader(MapId(GlObjectType::Shader, a[0]));
+      break;
+    case GlOp::DeleteShader:
+      glDeleteShader(DeleteFn(GlObjectType::Shader, a[0]));
+      break;
+    case GlOp::CreateProgram:
+      GenFn(GlObjectType::Program, a[0], glCreateProgram());
+      break;
+    case GlOp::AttachShader:
+      glAttachShader(MapId(GlObjectType::Program, a[0]), MapId(GlObjectType::Shader, a[1]));
+      break;
+    case GlOp::LinkProgram:
+      glLinkProgram(MapId(GlObjectType::Program, a[0]));
+      break;
+    case GlOp::DeleteProgram:
+      glDeleteProgram(DeleteFn(GlObjectType::Program, a[0]));
+      break;
+    case GlOp::UseProgram:
+      m_program = (GLuint)a[0];
+      glUseProgram(MapId(GlObjectType::Program, a[0]));
+      break;
+    case GlOp::GetUniformLocation:
+    {
+      String name(call.data.begin(), call.data.end());
+      GLint location = glGetUniformLocation(MapId(GlObjectType::Program, a[0]), name.c_str());
+      m_locations[(a[0] << 32) | (uint32_t)a[1]] = location;
+    }
+    break;
+    case GlOp::Uniform1i:
+      glUniform1i(LocationFn(a[0]), (GLint)a[1]);
+      break;
+    case GlOp::Uniform1ui:
+      glUniform1ui(LocationFn(a[0]), (GLuint)a[1]);
+      break;
+    case GlOp::Uniform1f:
+      glUniform1f(LocationFn(a[0]), BitsFloat(a[1]));
+      break;
+    case GlOp::Uniform2f:
+      glUniform2f(LocationFn(a[0]), BitsFloat(a[1]), BitsFloat(a[2]));
+      break;
+    case GlOp::Uniform3i:
+      glUniform3i(LocationFn(a[0]), (GLint)a[1], (GLint)a[2], (GLint)a[3]);
+      break;
+    case GlOp::Uniform3fv:
+      glUniform3fv(LocationFn(a[0]), (GLsizei)a[1], (const GLfloat*)data);
+      break;
+    case GlOp::Uniform4fv:
+      glUniform4fv(LocationFn(a[0]), (GLsizei)a[1], (const GLfloat*)data);
+      break;
+    case GlOp::UniformMatrix3fv:
+      glUniformMatrix3fv(LocationFn(a[0]), (GLsizei)a[1], (GLboolean)a[2], (const GLfloat*)data);
+      break;
+    case GlOp::UniformMatrix4fv:
+      glUniformMatrix4fv(LocationFn(a[0]), (GLsizei)a[1], (GLboolean)a[2], (const GLfloat*)data);
+      break;
+    case GlOp::EnableVertexAttribArray:
+      glEnableVertexAttribArray((GLuint)a[0]);
+      break;
+    case GlOp::DisableVertexAttribArray:
+      glDisableVertexAttribArray((GLuint)a[0]);
+      break;
+    case GlOp::VertexAttribPointer:
+      glVertexAttribPointer((GLuint)a[0], (GLint)a[1], (GLenum)a[2], (GLboolean)a[3], (GLsizei)a[4], (const void*)(uintptr_t)a[5]);
+      break;
+    case GlOp::VertexAttribIPointer:
+      glVertexAttribIPointer((GLuint)a[0], (GLint)a[1], (GLenum)a[2], (GLsizei)a[3], (const void*)(uintptr_t)a[4]);
+      break;
+    case GlOp::DrawElements:
+      glDrawElements((GLenum)a[0], (GLsizei)a[1], (GLenum)a[2], (const void*)(uintptr_t)a[3]);
+      break;
+    case GlOp::DrawArrays:
+      glDrawArrays((GLenum)a[0], (GLint)a[1], (GLsizei)a[2]);
+      break;
+    case GlOp::Clear:
+      glClear((GLbitfield)a[0]);
+      break;
+    case GlOp::ClearColor:
+      glClearColor(BitsFloat(a[0]), BitsFloat(a[1]), BitsFloat(a[2]), BitsFloat(a[3]));
+      break;
+    case GlOp::Viewport:
+      glViewport((GLint)a[0], (GLint)a[1], (GLsizei)a[2], (GLsizei)a[3]);
+      break;
+    case GlOp::Enable:
+      glEnable((GLenum)a[0]);
+      break;
+    case GlOp::Disable:
+      glDisable((GLenum)a[0]);
+      break;
+    case GlOp::CullFace:
+      glCullFace((GLenum)a[0]);
+      break;
+    case GlOp::BlendFunc:
+      glBlendFunc((GLenum)a[0], (GLenum)a[1]);
+      break;
+    case GlOp::LineWidth:
+      glLineWidth(BitsFloat(a[0]));
+      break;
+    default:
+      assert(false);
+      break;
+    }
+  }
+
+  GLuint GlReplay::MapId(GlObjectType type, uint64_t id) const
+  {
+    // Objects created outside of the hooks have no replay counterpart.
+    const std::unordered_map<GLuint, GLuint>& ids = m_ids[(int)type];
+    auto mapped = ids.find((GLuint)id);
+    return mapped == ids.end() ? 0 : mapped->second;
+  }
+
+  void GlReplay::Release()
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glUseProgram(0);
+
+    for (auto& entry : m_ids[(int)GlObjectType::Program])
+    {
+      glDeleteProgram(entry.second);
+    }
+
+    for (auto& entry : m_ids[(int)GlObjectType::Shader])
+    {
+      glDeleteShader(entry.second);
+    }
+
+    for (auto& entry : m_ids[(int)GlObjectType::Texture])
+    {
+      glDeleteTextures(1, &entry.second);
+    }
+
+    for (auto& entry : m_ids[(int)GlObjectType::Renderbuffer])
+    {
+      glDeleteRenderbuffers(1, &entry.second);
+    }
+
+    for (auto& entry : m_ids[(int)GlObjectType::Framebuffer])
+    {
+      glDeleteFramebuffers(1, &entry.second);
+    }
+
+    for (auto& entry : m_ids[(int)GlObjectType::Buffer])
+    {
+      glDeleteBuffers(1, &entry.second);
+    }
+
+    for (std::unordered_map<GLuint, GLuint>& ids : m_ids)
+    {
+      ids.clear();
+    }
+    m_locations.clear();
+    m_program = 0;
+  }
+
+}
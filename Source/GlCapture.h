@@ -0,0 +1,181 @@
+#pragma once
+
+#include "Types.h"
+#include "GL/glew.h"
+#include <cstdint>
+#include <unordered_map>
+
+namespace ToolKit
+{
+
+  // Recorded gl calls. Ids in the arguments are the ones of the capturing process, the replay maps them to its own.
+  enum class GlOp
+  {
+    GenBuffer,
+    DeleteBuffer,
+    BindBuffer,
+    BufferData,
+    BufferSubData,
+    GenTexture,
+    DeleteTexture,
+    BindTexture,
+    ActiveTexture,
+    TexImage2D,
+    TexSubImage2D,
+    TexParameteri,
+    TexParameterf,
+    GenerateMipmap,
+    GenFramebuffer,
+    DeleteFramebuffer,
+    BindFramebuffer,
+    FramebufferTexture2D,
+    FramebufferRenderbuffer,
+    DrawBuffers,
+    BlitFramebuffer,
+    GenRenderbuffer,
+    DeleteRenderbuffer,
+    BindRenderbuffer,
+    RenderbufferStorage,
+    CreateShader,
+    ShaderSource,
+    CompileShader,
+    DeleteShader,
+    CreateProgram,
+    AttachShader,
+    LinkProgram,
+    DeleteProgram,
+    UseProgram,
+    GetUniformLocation,
+    Uniform1i,
+    Uniform1ui,
+    Uniform1f,
+    Uniform2f,
+    Uniform3i,
+    Uniform3fv,
+    Uniform4fv,
+    UniformMatrix3fv,
+    UniformMatrix4fv,
+    EnableVertexAttribArray,
+    DisableVertexAttribArray,
+    VertexAttribPointer,
+    VertexAttribIPointer,
+    DrawElements,
+    DrawArrays,
+    Clear,
+    ClearColor,
+    Viewport,
+    Enable,
+    Disable,
+    CullFace,
+    BlendFunc,
+    LineWidth,
+    Count
+  };
+
+  enum class GlObjectType
+  {
+    Shader,
+    Program,
+    Texture,
+    Renderbuffer,
+    Framebuffer,
+    Buffer,
+    Count
+  };
+
+  struct GlCall
+  {
+    GlOp op;
+    uint8 argCount = 0;
+    uint64_t args[10] = {}; // Floats are stored as their bits.
+    std::vector<uint8> data; // Buffer and image contents, shader sources, uniform arrays and names.
+  };
+
+  // Records the gl calls of a frame into a file that GlReplay can re-issue. Only compiled in with TK_GL_CAPTURE, units
+  // including GlCaptureHooks.h route their gl calls through the recorder. Objects are tracked from the start, so the file
+  // begins with the calls that recreate every live object and the gl state at the frame start, followed by the frame.
+  class GlCapture
+  {
+  public:
+    static GlCapture* GetInstance();
+
+    void RequestCapture(const String& file); // Captures the next frame.
+    bool IsCapturing() const;
+    void BeginFrame(); // Called by Renderer::BeginFrame.
+    void EndFrame(); // Called by Renderer::EndFrame, writes the file.
+
+    // Used by the hooks.
+    struct Object
+    {
+      GLenum target = 0; // Texture and buffer bind target.
+      GLenum usage = 0;
+      std::vector<GlCall> calls; // Calls that define the object, applied with the object bound.
+      std::vector<uint8> contents; // Shadow copy of the buffer contents.
+    };
+
+    void Record(const GlCall& call);
+    Object* CreateObject(GlObjectType type, GLuint id);
+    Object* FindObject(GlObjectType type, GLuint id);
+    void RemoveObject(GlObjectType type, GLuint id);
+    static GLuint GetBound(GLenum target); // Object bound to a buffer, texture, framebuffer or renderbuffer target.
+
+  public:
+    struct Mapping
+    {
+      GLenum target = 0;
+      GLintptr offset = 0;
+      GLsizeiptr length = 0;
+      void* ptr = nullptr;
+    } m_mapping; // Last glMapBufferRange, recorded at unmap.
+
+  private:
+    GlCapture();
+    void WriteSetup(std::vector<GlCall>& calls) const;
+    bool Write(const String& file, const std::vector<GlCall>& setup) const;
+
+  private:
+    static GlCapture m_instance;
+    std::unordered_map<uint64_t, Object> m_objects; // Type in the high, id in the low 32 bits.
+    std::vector<GlCall> m_frameCalls;
+    String m_requestedFile;
+    String m_file;
+    bool m_recording = false;
+  };
+
+  // Re-issues a captured frame. The setup part runs once, the frame part is timed over the iterations.
+  class GlReplay
+  {
+  public:
+    struct Report
+    {
+      uint setupCalls = 0;
+      uint frameCalls = 0;
+      float setupMs = 0.0f;
+      std::vector<float> frameMs;
+      std::vector<std::pair<String, uint>> histogram; // Calls per frame by op, most frequent first.
+    };
+
+  public:
+    ~GlReplay();
+
+    bool Load(const String& file); // Sets m_error on failure.
+    Report Run(uint iterations);
+    static String ToString(const Report& report);
+
+  public:
+    String m_error;
+
+  private:
+    void Execute(const GlCall& call);
+    GLuint MapId(GlObjectType type, uint64_t id) const;
+    void Release();
+
+  private:
+    std::vector<GlCall> m_setup;
+    std::vector<GlCall> m_frame;
+    std::unordered_map<GLuint, GLuint> m_ids[(int)GlObjectType::Count];
+    std::unordered_map<uint64_t, GLint> m_locations; // Captured program and location to the replay location.
+    GLuint m_program = 0; // Captured id of the program in use.
+  };
+
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+// Routes the gl calls of the including unit through GlCapture. Include after every other header, before DebugNew.h.
+// Has no effect unless TK_GL_CAPTURE is defined.
+#ifdef TK_GL_CAPTURE
+
+#include "GlCapture.h"
+
+namespace ToolKit
+{
+
+  namespace GlHooks
+  {
+    void GenBuffers(GLsizei n, GLuint* buffers);
+    void DeleteBuffers(GLsizei n, const GLuint* buffers);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+    void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    GLboolean UnmapBuffer(GLenum target);
+    void GenTextures(GLsizei n, GLuint* textures);
+    void DeleteTextures(GLsizei n, const GLuint* textures);
+    void BindTexture(GLenum target, GLuint texture);
+    void ActiveTexture(GLenum texture);
+    void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+    void TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+    void TexParameteri(GLenum target, GLenum pname, GLint param);
+    void TexParameterf(GLenum target, GLenum pname, GLfloat param);
+    void GenerateMipmap(GLenum target);
+    void GenFramebuffers(GLsizei n, GLuint* framebuffers);
+    void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+    void BindFramebuffer(GLenum target, GLuint framebuffer);
+    void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+    void DrawBuffers(GLsizei n, const GLenum* bufs);
+    void BlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+    void GenRenderbuffers(GLsizei n, GLuint* renderbuffers);
+    void DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers);
+    void BindRenderbuffer(GLenum target, GLuint renderbuffer);
+    void RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+    GLuint CreateShader(GLenum type);
+    void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+    void CompileShader(GLuint shader);
+    void DeleteShader(GLuint shader);
+    GLuint CreateProgram(void);
+    void AttachShader(GLuint program, GLuint shader);
+    void LinkProgram(GLuint program);
+    void DeleteProgram(GLuint program);
+    void UseProgram(GLuint program);
+    GLint GetUniformLocation(GLuint program, const GLchar* name);
+    void Uniform1i(GLint location, GLint v0);
+    void Uniform1ui(GLint location, GLuint v0);
+    void Uniform1f(GLint location, GLfloat v0);
+    void Uniform2f(GLint location, GLfloat v0, GLfloat v1);
+    void Uniform3i(GLint location, GLint v0, GLint v1, GLint v2);
+    void Uniform3fv(GLint location, GLsizei count, const GLfloat* value);
+    void Uniform4fv(GLint location, GLsizei count, const GLfloat* value);
+    void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void EnableVertexAttribArray(GLuint index);
+    void DisableVertexAttribArray(GLuint index);
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+    void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer);
+    void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+    void DrawArrays(GLenum mode, GLint first, GLsizei count);
+    void Clear(GLbitfield mask);
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void Enable(GLenum cap);
+    void Disable(GLenum cap);
+    void CullFace(GLenum mode);
+    void BlendFunc(GLenum sfactor, GLenum dfactor);
+    void LineWidth(GLfloat width);
+  }
+
+}
+
+#undef glGenBuffers
+#define glGenBuffers ToolKit::GlHooks::GenBuffers
+#undef glDeleteBuffers
+#define glDeleteBuffers ToolKit::GlHooks::DeleteBuffers
+#undef glBindBuffer
+#define glBindBuffer ToolKit::GlHooks::BindBuffer
+#undef glBufferData
+#define glBufferData ToolKit::GlHooks::BufferData
+#undef glBufferSubData
+#define glBufferSubData ToolKit::GlHooks::BufferSubData
+#undef glMapBufferRange
+#define glMapBufferRange ToolKit::GlHooks::MapBufferRange
+#undef glUnmapBuffer
+#define glUnmapBuffer ToolKit::GlHooks::UnmapBuffer
+#undef glGenTextures
+#define glGenTextures ToolKit::GlHooks::GenTextures
+#undef glDeleteTextures
+#define glDeleteTextures ToolKit::GlHooks::DeleteTextures
+#undef glBindTexture
+#define glBindTexture ToolKit::GlHooks::BindTexture
+#undef glActiveTexture
+#define glActiveTexture ToolKit::GlHooks::ActiveTexture
+#undef glTexImage2D
+#define glTexImage2D ToolKit::GlHooks::TexImage2D
+#undef glTexSubImage2D
+#define glTexSubImage2D ToolKit::GlHooks::TexSubImage2D
+#undef glTexParameteri
+#define glTexParameteri ToolKit::GlHooks::TexParameteri
+#undef glTexParameterf
+#define glTexParameterf ToolKit::GlHooks::TexParameterf
+#undef glGenerateMipmap
+#define glGenerateMipmap ToolKit::GlHooks::GenerateMipmap
+#undef glGenFramebuffers
+#define glGenFramebuffers ToolKit::GlHooks::GenFramebuffers
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers ToolKit::GlHooks::DeleteFramebuffers
+#undef glBindFramebuffer
+#define glBindFramebuffer ToolKit::GlHooks::BindFramebuffer
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D ToolKit::GlHooks::FramebufferTexture2D
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer ToolKit::GlHooks::FramebufferRenderbuffer
+#undef glDrawBuffers
+#define glDrawBuffers ToolKit::GlHooks::DrawBuffers
+#undef glBlitFramebuffer
+#define glBlitFramebuffer ToolKit::GlHooks::BlitFramebuffer
+#undef glGenRenderbuffers
+#define glGenRenderbuffers ToolKit::GlHooks::GenRenderbuffers
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers ToolKit::GlHooks::DeleteRenderbuffers
+#undef glBindRenderbuffer
+#define glBindRenderbuffer ToolKit::GlHooks::BindRenderbuffer
+#undef glRenderbufferStorage
+#define glRenderbufferStorage ToolKit::GlHooks::RenderbufferStorage
+#undef glCreateShader
+#define glCreateShader ToolKit::GlHooks::CreateShader
+#undef glShaderSource
+#define glShaderSource ToolKit::GlHooks::ShaderSource
+#undef glCompileShader
+#define glCompileShader ToolKit::GlHooks::CompileShader
+#undef glDeleteShader
+#define glDeleteShader ToolKit::GlHooks::DeleteShader
+#undef glCreateProgram
+#define glCreateProgram ToolKit::GlHooks::CreateProgram
+#undef glAttachShader
+#define glAttachShader ToolKit::GlHooks::AttachShader
+#undef glLinkProgram
+#define glLinkProgram ToolKit::GlHooks::LinkProgram
+#undef glDeleteProgram
+#define glDeleteProgram ToolKit::GlHooks::DeleteProgram
+#undef glUseProgram
+#define glUseProgram ToolKit::GlHooks::UseProgram
+#undef glGetUniformLocation
+#define glGetUniformLocation ToolKit::GlHooks::GetUniformLocation
+#undef glUniform1i
+#define glUniform1i ToolKit::GlHooks::Uniform1i
+#undef glUniform1ui
+#define glUniform1ui ToolKit::GlHooks::Uniform1ui
+#undef glUniform1f
+#define glUniform1f ToolKit::GlHooks::Uniform1f
+#undef glUniform2f
+#define glUniform2f ToolKit::GlHooks::Uniform2f
+#undef glUniform3i
+#define glUniform3i ToolKit::GlHooks::Uniform3i
+#undef glUniform3fv
+#define glUniform3fv ToolKit::GlHooks::Uniform3fv
+#undef glUniform4fv
+#define glUniform4fv ToolKit::GlHooks::Uniform4fv
+#undef glUniformMatrix3fv
+#define glUniformMatrix3fv ToolKit::GlHooks::UniformMatrix3fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv ToolKit::GlHooks::UniformMatrix4fv
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray ToolKit::GlHooks::EnableVertexAttribArray
+#undef glDisableVertexAttribArray
+#define glDisableVertexAttribArray ToolKit::GlHooks::DisableVertexAttribArray
+#undef glVertexAttribPointer
+#define glVertexAttribPointer ToolKit::GlHooks::VertexAttribPointer
+#undef glVertexAttribIPointer
+#define glVertexAttribIPointer ToolKit::GlHooks::VertexAttribIPointer
+#undef glDrawElements
+#define glDrawElements ToolKit::GlHooks::DrawElements
+#undef glDrawArrays
+#define glDrawArrays ToolKit::GlHooks::DrawArrays
+#undef glClear
+#define glClear ToolKit::GlHooks::Clear
+#undef glViewport
+#define glViewport ToolKit::GlHooks::Viewport
+#undef glEnable
+#define glEnable ToolKit::GlHooks::Enable
+#undef glDisable
+#define glDisable ToolKit::GlHooks::Disable
+#undef glCullFace
+#define glCullFace ToolKit::GlHooks::CullFace
+#undef glBlendFunc
+#define glBlendFunc ToolKit::GlHooks::BlendFunc
+#undef glLineWidth
+#define glLineWidth ToolKit::GlHooks::LineWidth
+
+#endif
@@ -0,0 +1,283 @@
+#include "stdafx.h"
+#include "Headless.h"
+#include "ToolKit.h"
+#include "SDL.h"
+#include <sstream>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  // Egl headers aren't among the dependencies, the few types and enums used here are declared instead.
+#ifdef _WIN32
+  #define TK_EGLAPIENTRY __stdcall
+#else
+  #define TK_EGLAPIENTRY
+#endif
+
+  typedef int EglInt;
+  typedef uint EglBoolean;
+  typedef uint EglEnum;
+  typedef void* EglHandle; // Display, config, surface and context.
+
+  static const EglInt g_eglNone = 0x3038;
+  static const EglInt g_eglExtensions = 0x3055;
+  static const EglInt g_eglSurfaceType = 0x3033;
+  static const EglInt g_eglPbufferBit = 0x0001;
+  static const EglInt g_eglRenderableType = 0x3040;
+  static const EglInt g_eglOpenglEs3Bit = 0x0040;
+  static const EglInt g_eglRedSize = 0x3024;
+  static const EglInt g_eglGreenSize = 0x3023;
+  static const EglInt g_eglBlueSize = 0x3022;
+  static const EglInt g_eglAlphaSize = 0x3021;
+  static const EglInt g_eglDepthSize = 0x3025;
+  static const EglInt g_eglWidth = 0x3057;
+  static const EglInt g_eglHeight = 0x3056;
+  static const EglInt g_eglContextClientVersion = 0x3098;
+  static const EglEnum g_eglOpenglEsApi = 0x30A0;
+  static const EglEnum g_eglPlatformSurfacelessMesa = 0x31DD;
+
+  struct EglApi
+  {
+    void* (TK_EGLAPIENTRY* GetProcAddress)(const char* name);
+    const char* (TK_EGLAPIENTRY* QueryString)(EglHandle display, EglInt name);
+    EglHandle (TK_EGLAPIENTRY* GetDisplay)(void* nativeDisplay);
+    EglHandle (TK_EGLAPIENTRY* GetPlatformDisplayEXT)(EglEnum platform, void* nativeDisplay, const EglInt* attribs);
+    EglBoolean (TK_EGLAPIENTRY* Initialize)(EglHandle display, EglInt* major, EglInt* minor);
+    EglBoolean (TK_EGLAPIENTRY* Terminate)(EglHandle display);
+    EglBoolean (TK_EGLAPIENTRY* BindAPI)(EglEnum api);
+    EglBoolean (TK_EGLAPIENTRY* ChooseConfig)(EglHandle display, const EglInt* attribs, EglHandle* configs, EglInt size, EglInt* count);
+    EglHandle (TK_EGLAPIENTRY* CreatePbufferSurface)(EglHandle display, EglHandle config, const EglInt* attribs);
+    EglHandle (TK_EGLAPIENTRY* CreateContext)(EglHandle display, EglHandle config, EglHandle shareContext, const EglInt* attribs);
+    EglBoolean (TK_EGLAPIENTRY* MakeCurrent)(EglHandle display, EglHandle draw, EglHandle read, EglHandle context);
+    EglBoolean (TK_EGLAPIENTRY* DestroySurface)(EglHandle display, EglHandle surface);
+    EglBoolean (TK_EGLAPIENTRY* DestroyContext)(EglHandle display, EglHandle context);
+    EglInt (TK_EGLAPIENTRY* GetError)();
+  };
+
+  static EglApi g_egl;
+
+  static bool HasExtension(const char* extensions, const String& name)
+  {
+    if (extensions == nullptr)
+    {
+      return false;
+    }
+
+    std::istringstream list(extensions);
+    String ext;
+    while (list >> ext)
+    {
+      if (ext == name)
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  static String EglError(const String& call)
+  {
+    std::stringstream str;
+    str << call << " failed, egl error 0x" << std::hex << g_egl.GetError();
+    return str.str();
+  }
+
+  HeadlessContext::~HeadlessContext()
+  {
+    UnInit();
+  }
+
+  bool HeadlessContext::Init()
+  {
+#ifdef _WIN32
+    const char* libraryName = "libEGL.dll";
+#else
+    const char* libraryName = "libEGL.so.1";
+#endif
+
+    m_library = SDL_LoadObject(libraryName);
+    if (m_library == nullptr)
+    {
+      m_error = "EGL is not available, " + String(libraryName) + " can't be loaded. Headless runs need an EGL driver such as Mesa or ANGLE.";
+      return false;
+    }
+
+    auto LoadFn = [this](const char* name, auto& fn) -> bool
+    {
+      fn = (std::remove_reference_t<decltype(fn)>)SDL_LoadFunction(m_library, name);
+      if (fn == nullptr)
+      {
+        m_error = "EGL is not available, " + String(name) + " is missing from libEGL.";
+      }
+
+      return fn != nullptr;
+    };
+
+    bool loaded = LoadFn("eglGetProcAddress", g_egl.GetProcAddress)
+      && LoadFn("eglQueryString", g_egl.QueryString)
+      && LoadFn("eglGetDisplay", g_egl.GetDisplay)
+      && LoadFn("eglInitialize", g_egl.Initialize)
+      && LoadFn("eglTerminate", g_egl.Terminate)
+      && LoadFn("eglBindAPI", g_egl.BindAPI)
+      && LoadFn("eglChooseConfig", g_egl.ChooseConfig)
+      && LoadFn("eglCreatePbufferSurface", g_egl.CreatePbufferSurface)
+      && LoadFn("eglCreateContext", g_egl.CreateContext)
+      && LoadFn("eglMakeCurrent", g_egl.MakeCurrent)
+      && LoadFn("eglDestroySurface", g_egl.DestroySurface)
+      && LoadFn("eglDestroyContext", g_egl.DestroyContext)
+      && LoadFn("eglGetError", g_egl.GetError);
+
+    if (!loaded)
+    {
+      UnInit();
+      return false;
+    }
+
+    // Mesa's surfaceless platform doesn't touch the window system at all, the default display may need one.
+    const char* clientExtensions = g_egl.QueryString(nullptr, g_eglExtensions);
+    if (HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless") && HasExtension(clientExtensions, "EGL_EXT_platform_base"))
+    {
+      g_egl.GetPlatformDisplayEXT = (decltype(g_egl.GetPlatformDisplayEXT))g_egl.GetProcAddress("eglGetPlatformDisplayEXT");
+      if (g_egl.GetPlatformDisplayEXT != nullptr)
+      {
+        m_display = g_egl.GetPlatformDisplayEXT(g_eglPlatformSurfacelessMesa, nullptr, nullptr);
+      }
+    }
+
+    if (m_display == nullptr)
+    {
+      m_display = g_egl.GetDisplay(nullptr);
+    }
+
+    if (m_display == nullptr || !g_egl.Initialize(m_display, nullptr, nullptr))
+    {
+      m_error = EglError("eglInitialize");
+      m_display = nullptr;
+      UnInit();
+      return false;
+    }
+
+    if (!g_egl.BindAPI(g_eglOpenglEsApi))
+    {
+      m_error = EglError("eglBindAPI");
+      UnInit();
+      return false;
+    }
+
+    // A pbuffer gives the default framebuffer that the gl replay draws to. Without one the context is surfaceless.
+    const EglInt pbufferAttribs[] =
+    {
+      g_eglSurfaceType, g_eglPbufferBit,
+      g_eglRenderableType, g_eglOpenglEs3Bit,
+      g_eglRedSize, 8, g_eglGreenSize, 8, g_eglBlueSize, 8, g_eglAlphaSize, 8,
+      g_eglDepthSize, 24,
+      g_eglNone
+    };
+
+    const EglInt surfacelessAttribs[] =
+    {
+      g_eglRenderableType, g_eglOpenglEs3Bit,
+      g_eglNone
+    };
+
+    EglHandle config = nullptr;
+    EglInt configCount = 0;
+    if (g_egl.ChooseConfig(m_display, pbufferAttribs, &config, 1, &configCount) && configCount > 0)
+    {
+      // The default framebuffer is rarely drawn to, keep it small.
+      const EglInt surfaceAttribs[] = { g_eglWidth, 64, g_eglHeight, 64, g_eglNone };
+      m_surface = g_egl.CreatePbufferSurface(m_display, config, surfaceAttribs);
+      if (m_surface == nullptr)
+      {
+        m_error = EglError("eglCreatePbufferSurface");
+        UnInit();
+        return false;
+      }
+    }
+    else if (HasExtension(g_egl.QueryString(m_display, g_eglExtensions), "EGL_KHR_surfaceless_context"))
+    {
+      if (!g_egl.ChooseConfig(m_display, surfacelessAttribs, &config, 1, &configCount) || configCount == 0)
+      {
+        m_error = "EGL has no OpenGL ES 3 config.";
+        UnInit();
+        return false;
+      }
+    }
+    else
+    {
+      m_error = "EGL has neither an OpenGL ES 3 pbuffer config nor surfaceless context support.";
+      UnInit();
+      return false;
+    }
+
+    const EglInt contextAttribs[] = { g_eglContextClientVersion, 3, g_eglNone };
+    m_context = g_egl.CreateContext(m_display, config, nullptr, contextAttribs);
+    if (m_context == nullptr)
+    {
+      m_error = EglError("eglCreateContext");
+      UnInit();
+      return false;
+    }
+
+    if (!g_egl.MakeCurrent(m_display, m_surface, m_surface, m_context))
+    {
+      m_error = EglError("eglMakeCurrent");
+      UnInit();
+      return false;
+    }
+
+    glewExperimental = true;
+    GLenum err = glewInit();
+    if (GLEW_OK != err)
+    {
+      m_error = "glew can't load the gl functions of the EGL context, it must be built with GLEW_EGL here: ";
+      m_error += (const char*)glewGetErrorString(err);
+      UnInit();
+      return false;
+    }
+
+    Main::GetInstance()->Init();
+
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+
+    return true;
+  }
+
+  void HeadlessContext::UnInit()
+  {
+    if (Main::GetInstance()->m_initiated)
+    {
+      Main::GetInstance()->Uninit();
+    }
+
+    if (m_display != nullptr)
+    {
+      g_egl.MakeCurrent(m_display, nullptr, nullptr, nullptr);
+      if (m_context != nullptr)
+      {
+        g_egl.DestroyContext(m_display, m_context);
+        m_context = nullptr;
+      }
+
+      if (m_surface != nullptr)
+      {
+        g_egl.DestroySurface(m_display, m_surface);
+        m_surface = nullptr;
+      }
+
+      g_egl.Terminate(m_display);
+      m_display = nullptr;
+    }
+
+    if (m_library != nullptr)
+    {
+      SDL_UnloadObject(m_library);
+      m_library = nullptr;
+      g_egl = EglApi();
+    }
+  }
+
+}
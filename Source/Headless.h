@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Types.h"
+
+namespace ToolKit
+{
+
+  // Gl context for automated runs, nothing is shown on the screen and no window system is needed. Frames are rendered
+  // into RenderTargets and read back with Renderer::ReadPixels. The context is an EGL one on a small pbuffer, or on no
+  // surface at all when the driver only supports that. libEGL is loaded at runtime, Mesa's (llvmpipe) or ANGLE's are
+  // enough. Gl functions are loaded by glew, which has to be built with GLEW_EGL where the platform's gl dispatch doesn't
+  // serve EGL contexts.
+  class HeadlessContext
+  {
+  public:
+    ~HeadlessContext();
+
+    bool Init(); // Creates the context, initializes glew and Main. Sets m_error on failure.
+    void UnInit();
+
+  public:
+    String m_error;
+
+  private:
+    void* m_library = nullptr; // libEGL.
+    void* m_display = nullptr; // EGLDisplay.
+    void* m_surface = nullptr; // EGLSurface, null when surfaceless.
+    void* m_context = nullptr; // EGLContext.
+  };
+
+}
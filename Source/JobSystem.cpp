@@ -0,0 +1,307 @@
+#include "stdafx.h"
+#include "JobSystem.h"
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  static thread_local uint g_threadIndex = 0;
+
+  bool JobCounter::IsDone() const
+  {
+    return m_pending == 0;
+  }
+
+  JobSystem::~JobSystem()
+  {
+    Uninit();
+  }
+
+  void JobSystem::Init(uint workerCount)
+  {
+    if (m_initiated)
+    {
+      return;
+    }
+
+    if (workerCount == ~0u)
+    {
+      uint hardware = std::thread::hardware_concurrency();
+      workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    m_workerCount = workerCount;
+    m_initTime = std::chrono::high_resolution_clock::now();
+
+    uint started = m_singleThreaded ? 0 : workerCount;
+    for (uint i = 0; i <= started; i++)
+    {
+      m_queues.push_back(new WorkerQueue());
+    }
+
+    m_running = true;
+    for (uint i = 1; i <= started; i++)
+    {
+      m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+
+    m_initiated = true;
+  }
+
+  void JobSystem::Uninit()
+  {
+    if (!m_initiated)
+    {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+      m_running = false;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+      worker.join();
+    }
+    m_workers.clear();
+
+    for (WorkerQueue* queue : m_queues)
+    {
+      assert(queue->jobs.empty() && "Jobs are left unfinished.");
+      SafeDel(queue);
+    }
+    m_queues.clear();
+    m_queued = 0;
+
+    m_initiated = false;
+  }
+
+  void JobSystem::SetSingleThreaded(bool singleThreaded)
+  {
+    if (m_singleThreaded == singleThreaded)
+    {
+      return;
+    }
+
+    m_singleThreaded = singleThreaded;
+    if (m_initiated)
+    {
+      uint workerCount = m_workerCount;
+      Uninit();
+      Init(workerCount);
+    }
+  }
+
+  bool JobSystem::IsSingleThreaded() const
+  {
+    return m_singleThreaded;
+  }
+
+  uint JobSystem::GetThreadCount() const
+  {
+    return glm::max(1u, (uint)m_queues.size());
+  }
+
+  uint JobSystem::GetThreadIndex()
+  {
+    return g_threadIndex;
+  }
+
+  void JobSystem::Run(const JobFn& fn, JobCounter* counter, JobCounter* dependency, const char* name)
+  {
+    Job job;
+    job.fn = fn;
+    job.counter = counter;
+    job.name = name;
+
+    if (counter != nullptr)
+    {
+      counter->m_pending++;
+    }
+
+    // Without Init, jobs run right away. Nothing can be pending then.
+    if (!m_initiated)
+    {
+      assert(dependency == nullptr || dependency->IsDone());
+      Execute(0, job);
+      return;
+    }
+
+    if (dependency != nullptr)
+    {
+      std::lock_guard<std::mutex> lock(dependency->m_mutex);
+      if (dependency->m_pending > 0)
+      {
+        dependency->m_dependents.push_back(std::move(job));
+        return;
+      }
+    }
+
+    Enqueue(std::move(job));
+  }
+
+  void JobSystem::Wait(JobCounter* counter)
+  {
+    if (counter == nullptr)
+    {
+      return;
+    }
+
+    uint thread = g_threadIndex < m_queues.size() ? g_threadIndex : 0;
+    while (counter->m_pending > 0)
+    {
+      Job job;
+      if (m_initiated && FindJob(thread, job))
+      {
+        Execute(thread, job);
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    // The last job may still be releasing the dependents, the counter is safe to destroy after this.
+    std::lock_guard<std::mutex> lock(counter->m_mutex);
+  }
+
+  void JobSystem::ParallelFor(uint count, const JobRangeFn& fn, uint grain, const char* name)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    if (grain == 0)
+    {
+      grain = glm::max(1u, count / (GetThreadCount() * 4));
+    }
+
+    if (!m_initiated || grain >= count)
+    {
+      fn(0, count);
+      return;
+    }
+
+    JobCounter counter;
+    for (uint begin = 0; begin < count; begin += grain)
+    {
+      uint end = glm::min(begin + grain, count);
+      Run([&fn, begin, end]() -> void { fn(begin, end); }, &counter, nullptr, name);
+    }
+
+    Wait(&counter);
+  }
+
+  void JobSystem::Enqueue(Job&& job)
+  {
+    uint thread = g_threadIndex < m_queues.size() ? g_threadIndex : 0;
+    WorkerQueue* queue = m_queues[thread];
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->jobs.push_back(std::move(job));
+      m_queued++;
+    }
+
+    if (!m_workers.empty())
+    {
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+      m_wake.notify_one();
+    }
+  }
+
+  bool JobSystem::FindJob(uint thread, Job& job)
+  {
+    // Newest of the own jobs first, its data is likely in the cache.
+    {
+      WorkerQueue* queue = m_queues[thread];
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (!queue->jobs.empty())
+      {
+        job = std::move(queue->jobs.back());
+        queue->jobs.pop_back();
+        m_queued--;
+        return true;
+      }
+    }
+
+    // Then the oldest of the others, they tend to be the larger pieces of work.
+    uint count = (uint)m_queues.size();
+    for (uint i = 1; i < count; i++)
+    {
+      WorkerQueue* queue = m_queues[(thread + i) % count];
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (!queue->jobs.empty())
+      {
+        job = std::move(queue->jobs.front());
+        queue->jobs.pop_front();
+        m_queued--;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void JobSystem::Execute(uint thread, Job& job)
+  {
+    if (m_timingHook)
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+      job.fn();
+      auto end = std::chrono::high_resolution_clock::now();
+
+      JobTiming timing;
+      timing.name = job.name;
+      timing.thread = thread;
+      timing.startMs = std::chrono::duration<float, std::milli>(start - m_initTime).count();
+      timing.durationMs = std::chrono::duration<float, std::milli>(end - start).count();
+      m_timingHook(timing);
+    }
+    else
+    {
+      job.fn();
+    }
+
+    JobCounter* counter = job.counter;
+    if (counter == nullptr)
+    {
+      return;
+    }
+
+    // Decremented under the lock, so a dependent is either released here or queued right away by Run.
+    std::vector<Job> dependents;
+    {
+      std::lock_guard<std::mutex> lock(counter->m_mutex);
+      if (--counter->m_pending == 0)
+      {
+        dependents.swap(counter->m_dependents);
+      }
+    }
+
+    for (Job& dependent : dependents)
+    {
+      Enqueue(std::move(dependent));
+    }
+  }
+
+  void JobSystem::WorkerLoop(uint thread)
+  {
+    g_threadIndex = thread;
+    while (m_running)
+    {
+      Job job;
+      if (FindJob(thread, job))
+      {
+        Execute(thread, job);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_sleepMutex);
+      m_wake.wait(lock, [this]() -> bool { return m_queued > 0 || !m_running; });
+    }
+  }
+
+}
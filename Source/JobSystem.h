@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace ToolKit
+{
+
+  typedef std::function<void()> JobFn;
+  typedef std::function<void(uint begin, uint end)> JobRangeFn;
+
+  // Counts the unfinished jobs of a group. Jobs depending on a counter are queued once it drops to zero.
+  class JobCounter
+  {
+    friend class JobSystem;
+
+  public:
+    bool IsDone() const;
+
+  private:
+    struct Job
+    {
+      JobFn fn;
+      JobCounter* counter = nullptr;
+      const char* name = nullptr;
+    };
+
+    std::atomic<int> m_pending { 0 };
+    std::mutex m_mutex;
+    std::vector<Job> m_dependents;
+  };
+
+  struct JobTiming
+  {
+    const char* name; // Null for unnamed jobs.
+    uint thread;
+    float startMs; // Since Init.
+    float durationMs;
+  };
+
+  // Work stealing scheduler. Every thread has its own deque, it pushes and pops at the back while idle threads steal
+  // from the front of the others. Thread 0 is the one that calls Init, other threads submitting jobs share its deque.
+  // Waiting on a counter runs jobs instead of blocking, so jobs can submit and wait on jobs. In single threaded mode
+  // no workers are started and every job runs on the waiting thread, in a fixed order.
+  class JobSystem
+  {
+  public:
+    ~JobSystem();
+
+    void Init(uint workerCount = ~0u); // Defaults to one worker per remaining hardware thread.
+    void Uninit(); // Jobs must be waited on before.
+    void SetSingleThreaded(bool singleThreaded); // Restarts the workers, call when no job is in flight.
+    bool IsSingleThreaded() const;
+    uint GetThreadCount() const; // Workers and thread 0.
+    static uint GetThreadIndex();
+
+    void Run(const JobFn& fn, JobCounter* counter = nullptr, JobCounter* dependency = nullptr, const char* name = nullptr);
+    void Wait(JobCounter* counter);
+
+    // Splits [0, count) in ranges of grain items, grain 0 gives a few ranges per thread. Returns when all are done.
+    void ParallelFor(uint count, const JobRangeFn& fn, uint grain = 0, const char* name = nullptr);
+
+  public:
+    std::function<void(const JobTiming&)> m_timingHook; // Called after each job, on the thread that ran it.
+
+  private:
+    typedef JobCounter::Job Job;
+
+    struct WorkerQueue
+    {
+      std::mutex mutex;
+      std::deque<Job> jobs;
+    };
+
+    void Enqueue(Job&& job);
+    bool FindJob(uint thread, Job& job);
+    void Execute(uint thread, Job& job);
+    void WorkerLoop(uint thread);
+
+  private:
+    std::vector<std::thread> m_workers;
+    std::vector<WorkerQueue*> m_queues; // Index is the thread index.
+    std::atomic<uint> m_queued { 0 };
+    std::atomic<bool> m_running { false };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    uint m_workerCount = 0;
+    bool m_singleThreaded = false;
+    bool m_initiated = false;
+    std::chrono::high_resolution_clock::time_point m_initTime;
+  };
+
+}
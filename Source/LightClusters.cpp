@@ -0,0 +1,354 @@
+#include "stdafx.h"
+#include "LightClusters.h"
+#include "Directional.h"
+#include "Shader.h"
+#include "ToolKit.h"
+#include <chrono>
+#include "GlCaptureHooks.h"
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  LightClusters::~LightClusters()
+  {
+    if (m_lightTexture != 0)
+    {
+      GLuint textures[3] = { m_lightTexture, m_clusterTexture, m_indexTexture };
+      glDeleteTextures(3, textures);
+    }
+  }
+
+  void LightClusters::Build(const LightRawPtrArray& lights, const Mat4& view, const Mat4& project)
+  {
+    m_lightData.clear();
+
+    auto AddDataFn = [this](const Light::LightData& data) -> void
+    {
+      m_lightData.push_back(Vec4(data.pos, data.radius));
+      m_lightData.push_back(Vec4(data.dir, 0.0f));
+      m_lightData.push_back(Vec4(data.color, data.intensity));
+    };
+
+    // Global lights come first, clusters index the point lights after them.
+    std::vector<Light::LightData> pointData;
+    for (Light* light : lights)
+    {
+      Light::LightData data = light->GetData();
+      if (data.radius > 0.0f)
+      {
+        pointData.push_back(data);
+      }
+      else
+      {
+        AddDataFn(data);
+      }
+    }
+    m_globalLightCount = (uint)(m_lightData.size() / 3);
+
+    std::vector<PointLight> pointLights;
+    pointLights.reserve(pointData.size());
+    for (const Light::LightData& data : pointData)
+    {
+      AddDataFn(data);
+      pointLights.push_back({ Vec3(view * Vec4(data.pos, 1.0f)), data.radius });
+    }
+
+    Bin(pointLights, project, m_globalLightCount);
+    m_stats.globalLights = m_globalLightCount;
+  }
+
+  void LightClusters::Bin(const std::vector<PointLight>& lights, const Mat4& project, uint firstIndex)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Depth range from the projection.
+    m_project = project;
+    m_linear = project[3][3] != 0.0f;
+    if (m_linear)
+    {
+      m_near = (project[3][2] + 1.0f) / project[2][2];
+      m_far = (project[3][2] - 1.0f) / project[2][2];
+    }
+    else
+    {
+      m_near = project[3][2] / (project[2][2] - 1.0f);
+      m_far = project[3][2] / (project[2][2] + 1.0f);
+    }
+
+    uint tileCount = m_tilesX * m_tilesY;
+    m_bins.resize(tileCount * m_slices);
+    for (std::vector<uint>& bin : m_bins)
+    {
+      bin.clear();
+    }
+
+    // Each slice only writes its own bins.
+    auto BinSliceFn = [this, &lights, &project, firstIndex, tileCount](uint slice) -> void
+    {
+      float sliceNear = GetSliceDepth(slice);
+      float sliceFar = GetSliceDepth(slice + 1);
+
+      for (uint i = 0; i < (uint)lights.size(); i++)
+      {
+        const PointLight& light = lights[i];
+        float depth = -light.pos.z;
+        float d0 = glm::max(sliceNear, depth - light.radius);
+        float d1 = glm::min(sliceFar, depth + light.radius);
+        if (d0 > d1)
+        {
+          continue;
+        }
+
+        // Screen rectangle of the light's bounding box, clipped to the slice.
+        Vec2 rmin(FLT_MAX);
+        Vec2 rmax(-FLT_MAX);
+        for (int c = 0; c < 8; c++)
+        {
+          Vec4 corner
+          (
+            light.pos.x + (c & 1 ? light.radius : -light.radius),
+            light.pos.y + (c & 2 ? light.radius : -light.radius),
+            c & 4 ? -d1 : -d0,
+            1.0f
+          );
+
+          Vec4 clip = project * corner;
+          Vec2 ndc = Vec2(clip) / clip.w;
+          rmin = glm::min(rmin, ndc);
+          rmax = glm::max(rmax, ndc);
+        }
+
+        if (rmax.x < -1.0f || rmin.x > 1.0f || rmax.y < -1.0f || rmin.y > 1.0f)
+        {
+          continue;
+        }
+
+        int x0 = glm::clamp((int)glm::floor((rmin.x * 0.5f + 0.5f) * m_tilesX), 0, (int)m_tilesX - 1);
+        int x1 = glm::clamp((int)glm::floor((rmax.x * 0.5f + 0.5f) * m_tilesX), 0, (int)m_tilesX - 1);
+        int y0 = glm::clamp((int)glm::floor((rmin.y * 0.5f + 0.5f) * m_tilesY), 0, (int)m_tilesY - 1);
+        int y1 = glm::clamp((int)glm::floor((rmax.y * 0.5f + 0.5f) * m_tilesY), 0, (int)m_tilesY - 1);
+
+        for (int y = y0; y <= y1; y++)
+        {
+          for (int x = x0; x <= x1; x++)
+          {
+            m_bins[slice * tileCount + y * m_tilesX + x].push_back(firstIndex + i);
+          }
+        }
+      }
+    };
+
+    auto BinRangeFn = [&BinSliceFn](uint begin, uint end) -> void
+    {
+      for (uint slice = begin; slice < end; slice++)
+      {
+        BinSliceFn(slice);
+      }
+    };
+
+    if (m_parallel)
+    {
+      GetJobSystem()->ParallelFor(m_slices, BinRangeFn, 1, "BinLightSlices");
+    }
+    else
+    {
+      BinRangeFn(0, m_slices);
+    }
+
+    // Compact into a single index list.
+    m_clusters.resize(m_bins.size());
+    m_lightIndices.clear();
+    m_stats.maxPerCluster = 0;
+    for (size_t i = 0; i < m_bins.size(); i++)
+    {
+      const std::vector<uint>& bin = m_bins[i];
+      m_clusters[i] = { (uint)m_lightIndices.size(), (uint)bin.size() };
+      m_lightIndices.insert(m_lightIndices.end(), bin.begin(), bin.end());
+      m_stats.maxPerCluster = glm::max(m_stats.maxPerCluster, (uint)bin.size());
+    }
+
+    m_stats.pointLights = (uint)lights.size();
+    m_stats.indices = (uint)m_lightIndices.size();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.binMs = std::chrono::duration<float, std::milli>(end - start).count();
+  }
+
+  int LightClusters::GetClusterIndex(const Vec3& viewPos) const
+  {
+    int slice = GetSlice(-viewPos.z);
+    if (slice == -1)
+    {
+      return -1;
+    }
+
+    Vec4 clip = m_project * Vec4(viewPos, 1.0f);
+    Vec2 ndc = Vec2(clip) / clip.w;
+    if (glm::any(glm::lessThan(ndc, Vec2(-1.0f))) || glm::any(glm::greaterThan(ndc, Vec2(1.0f))))
+    {
+      return -1;
+    }
+
+    int x = glm::min((int)((ndc.x * 0.5f + 0.5f) * m_tilesX), (int)m_tilesX - 1);
+    int y = glm::min((int)((ndc.y * 0.5f + 0.5f) * m_tilesY), (int)m_tilesY - 1);
+
+    return (slice * m_tilesY + y) * m_tilesX + x;
+  }
+
+  const LightClusters::Cluster& LightClusters::GetCluster(int index) const
+  {
+    assert(index >= 0 && index < (int)m_clusters.size());
+    return m_clusters[index];
+  }
+
+  void LightClusters::Upload()
+  {
+    // Unit 0 is left alone, the renderer caches its binding.
+    glActiveTexture(GL_TEXTURE1);
+
+    if (m_lightTexture == 0)
+    {
+      GLuint textures[3];
+      glGenTextures(3, textures);
+      m_lightTexture = textures[0];
+      m_clusterTexture = textures[1];
+      m_indexTexture = textures[2];
+
+      for (GLuint texture : textures)
+      {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      }
+    }
+
+    Vec4 empty[3];
+    uint lightCount = (uint)(m_lightData.size() / 3);
+    glBindTexture(GL_TEXTURE_2D, m_lightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 3, glm::max(lightCount, 1u), 0, GL_RGBA, GL_FLOAT, lightCount > 0 ? m_lightData.data() : empty);
+
+    glBindTexture(GL_TEXTURE_2D, m_clusterTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, m_tilesX * m_tilesY, m_slices, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, m_clusters.data());
+
+    // Indices are wrapped into rows of m_indexTextureWidth.
+    uint count = (uint)m_lightIndices.size();
+    uint rows = count / m_indexTextureWidth;
+    uint remainder = count % m_indexTextureWidth;
+    glBindTexture(GL_TEXTURE_2D, m_indexTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, m_indexTextureWidth, glm::max(rows + (remainder > 0 ? 1 : 0), 1u), 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    if (rows > 0)
+    {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_indexTextureWidth, rows, GL_RED_INTEGER, GL_UNSIGNED_INT, m_lightIndices.data());
+    }
+
+    if (remainder > 0)
+    {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rows, remainder, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, m_lightIndices.data() + rows * m_indexTextureWidth);
+    }
+
+    // Nothing else uses units 1 - 3, the textures stay bound for the draws of the pass.
+    glBindTexture(GL_TEXTURE_2D, m_lightTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_clusterTexture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Zero marks programs that never took the values.
+    if (++m_uploadCount == 0)
+    {
+      m_uploadCount = 1;
+    }
+  }
+
+  void LightClusters::Bind(Program* program, const Vec2& viewportSize)
+  {
+    SetEnabled(program, true);
+
+    Program::ClusterUniforms& uniforms = program->m_clusterUniforms;
+    if (uniforms.upload == m_uploadCount && uniforms.viewportSize == viewportSize)
+    {
+      return;
+    }
+
+    uniforms.upload = m_uploadCount;
+    uniforms.viewportSize = viewportSize;
+    glUniform3i(uniforms.dims, m_tilesX, m_tilesY, m_slices);
+    glUniform2f(uniforms.viewport, viewportSize.x, viewportSize.y);
+    glUniform2f(uniforms.depthRange, m_near, m_far);
+    glUniform1i(uniforms.linear, m_linear ? 1 : 0);
+    glUniform1i(uniforms.globalCount, m_globalLightCount);
+    glUniform1i(uniforms.indexWidth, m_indexTextureWidth);
+  }
+
+  void LightClusters::Unbind(Program* program)
+  {
+    SetEnabled(program, false);
+  }
+
+  void LightClusters::SetEnabled(Program* program, bool enabled)
+  {
+    Program::ClusterUniforms& uniforms = program->m_clusterUniforms;
+    if (!uniforms.resolved)
+    {
+      GLuint handle = program->m_handle;
+      uniforms.enabled = glGetUniformLocation(handle, "Clusters.enabled");
+      uniforms.dims = glGetUniformLocation(handle, "Clusters.dims");
+      uniforms.viewport = glGetUniformLocation(handle, "Clusters.viewport");
+      uniforms.depthRange = glGetUniformLocation(handle, "Clusters.depthRange");
+      uniforms.linear = glGetUniformLocation(handle, "Clusters.linear");
+      uniforms.globalCount = glGetUniformLocation(handle, "Clusters.globalCount");
+      uniforms.indexWidth = glGetUniformLocation(handle, "Clusters.indexWidth");
+
+      // Samplers of different types can't share unit 0, even if unused. Units never change, set them once.
+      glUniform1i(glGetUniformLocation(handle, "LightTexture"), 1);
+      glUniform1i(glGetUniformLocation(handle, "ClusterTexture"), 2);
+      glUniform1i(glGetUniformLocation(handle, "LightIndexTexture"), 3);
+      uniforms.resolved = true;
+    }
+
+    if (uniforms.enabledValue != (int)enabled)
+    {
+      uniforms.enabledValue = (int)enabled;
+      glUniform1i(uniforms.enabled, uniforms.enabledValue);
+    }
+  }
+
+  const LightClusters::Stats& LightClusters::GetStats() const
+  {
+    return m_stats;
+  }
+
+  int LightClusters::GetSlice(float depth) const
+  {
+    if (depth < m_near || depth > m_far)
+    {
+      return -1;
+    }
+
+    float t = 0.0f;
+    if (m_linear)
+    {
+      t = (depth - m_near) / (m_far - m_near);
+    }
+    else
+    {
+      t = glm::log(depth / m_near) / glm::log(m_far / m_near);
+    }
+
+    return glm::min((int)(t * m_slices), (int)m_slices - 1);
+  }
+
+  float LightClusters::GetSliceDepth(uint slice) const
+  {
+    float t = (float)slice / (float)m_slices;
+    if (m_linear)
+    {
+      return m_near + (m_far - m_near) * t;
+    }
+
+    return m_near * glm::pow(m_far / m_near, t);
+  }
+
+}
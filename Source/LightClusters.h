@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Types.h"
+#include "GL/glew.h"
+
+namespace ToolKit
+{
+
+  // Clustered light assignment. The view frustum is split into m_tilesX * m_tilesY screen tiles and m_slices depth slices,
+  // each cluster lists the point lights whose range overlaps it. Slices are exponential for perspective and linear for
+  // orthographic projections. Directional lights reach every cluster, they are kept as global lights.
+  // Binning runs on worker threads and doesn't need gl, Upload sends the result to textures read by the shaders.
+  class LightClusters
+  {
+  public:
+    struct PointLight
+    {
+      Vec3 pos; // View space.
+      float radius;
+    };
+
+    struct Cluster
+    {
+      uint offset; // In m_lightIndices.
+      uint count;
+    };
+
+    struct Stats
+    {
+      uint pointLights = 0;
+      uint globalLights = 0;
+      uint indices = 0;
+      uint maxPerCluster = 0;
+      float binMs = 0.0f;
+    };
+
+  public:
+    ~LightClusters();
+
+    void Build(const LightRawPtrArray& lights, const Mat4& view, const Mat4& project); // Bins and fills the light data.
+    void Bin(const std::vector<PointLight>& lights, const Mat4& project, uint firstIndex = 0); // Stored indices start from firstIndex.
+    int GetClusterIndex(const Vec3& viewPos) const; // -1 if outside of the frustum.
+    const Cluster& GetCluster(int index) const;
+    void Upload(); // Needs a gl context. Leaves the textures bound to units 1 - 3.
+    void Bind(class Program* program, const Vec2& viewportSize); // Feeds the cluster uniforms, once per upload and program.
+    static void Unbind(class Program* program); // Disables the clusters in the program, it uses the first 8 lights.
+    const Stats& GetStats() const;
+
+  public:
+    uint m_tilesX = 16;
+    uint m_tilesY = 9;
+    uint m_slices = 24;
+    bool m_parallel = true;
+
+    std::vector<Cluster> m_clusters; // Index is (slice * m_tilesY + y) * m_tilesX + x.
+    std::vector<uint> m_lightIndices;
+
+  private:
+    int GetSlice(float depth) const;
+    float GetSliceDepth(uint slice) const;
+    static void SetEnabled(class Program* program, bool enabled); // Looks the uniforms up on first use.
+
+  private:
+    float m_near = 0.01f;
+    float m_far = 1000.0f;
+    bool m_linear = false;
+    uint m_globalLightCount = 0;
+    std::vector<Vec4> m_lightData; // 3 texels per light: position & radius, direction, color & intensity.
+    Mat4 m_project;
+    Stats m_stats;
+    std::vector<std::vector<uint>> m_bins; // Per cluster, kept to reuse the allocations.
+
+    GLuint m_lightTexture = 0;
+    GLuint m_clusterTexture = 0;
+    GLuint m_indexTexture = 0;
+    uint m_indexTextureWidth = 1024;
+    uint m_uploadCount = 0;
+  };
+
+}
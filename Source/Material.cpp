@@ -74,6 +74,10 @@ namespace ToolKit
       {
         ReadVec(node, m_color);
       }
+      else if (String("uvTransform").compare(node->name()) == 0)
+      {
+        ReadVec(node, m_uvTransform);
+      }
       else
       {
         assert(false);
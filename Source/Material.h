@@ -31,6 +31,7 @@ namespace ToolKit
     ShaderPtr m_vertexShader;
     ShaderPtr m_fragmetShader;
     Vec3 m_color;
+    Vec4 m_uvTransform = Vec4(0.0f, 0.0f, 1.0f, 1.0f); // Offset in xy, scale in zw. Places the texture in an atlas page.
 
   private:
     RenderState m_renderState;
@@ -1,10 +1,19 @@
 #include "stdafx.h"
 #include "MathUtil.h"
 #include "Mesh.h"
-#include "DebugNew.h"
+#include "TriangleBVH.h"
+
+#if defined(__AVX__)
+#define TK_MATH_AVX
+#include <immintrin.h>
+#endif
 
-#include <mutex>
-#include <execution>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TK_MATH_SIMD
+#include <emmintrin.h>
+#endif
+
+#include "DebugNew.h"
 
 namespace ToolKit
 {
@@ -165,47 +174,33 @@ namespace ToolKit
   // http://www.cs.otago.ac.nz/postgrads/alexis/planeExtraction.pdf
   Frustum ExtractFrustum(const Mat4& projectViewModel)
   {
-    Frustum frustum;
+    // Gribb & Hartmann, rows of the column major glm matrix. Planes are flipped to face outwards,
+    // which is the convention FrustumBoxIntersection and the picking frustum use.
+    auto rowFn = [&projectViewModel](int i) -> Vec4
+    {
+      return Vec4(projectViewModel[0][i], projectViewModel[1][i], projectViewModel[2][i], projectViewModel[3][i]);
+    };
 
-    // Left clipping plane
-    frustum.planes[0].normal.x = projectViewModel[3][0] + projectViewModel[0][0];
-    frustum.planes[0].normal.y = projectViewModel[3][1] + projectViewModel[0][1];
-    frustum.planes[0].normal.z = projectViewModel[3][2] + projectViewModel[0][2];
-    frustum.planes[0].d = projectViewModel[3][3] + projectViewModel[0][3];
-
-    // Right clipping plane
-    frustum.planes[1].normal.x = projectViewModel[3][0] - projectViewModel[0][0];
-    frustum.planes[1].normal.y = projectViewModel[3][1] - projectViewModel[0][1];
-    frustum.planes[1].normal.z = projectViewModel[3][2] - projectViewModel[0][2];
-    frustum.planes[1].d = projectViewModel[3][3] - projectViewModel[0][3];
-
-    // Top clipping plane
-    frustum.planes[2].normal.x = projectViewModel[3][0] + projectViewModel[1][0];
-    frustum.planes[2].normal.y = projectViewModel[3][1] + projectViewModel[1][1];
-    frustum.planes[2].normal.z = projectViewModel[3][2] + projectViewModel[1][2];
-    frustum.planes[2].d = projectViewModel[3][3] + projectViewModel[1][3];
-
-    // Bottom clipping plane
-    frustum.planes[3].normal.x = projectViewModel[3][0] - projectViewModel[1][0];
-    frustum.planes[3].normal.y = projectViewModel[3][1] - projectViewModel[1][1];
-    frustum.planes[3].normal.z = projectViewModel[3][2] - projectViewModel[1][2];
-    frustum.planes[3].d = projectViewModel[3][3] - projectViewModel[1][3];
-
-    // Near clipping plane
-    frustum.planes[4].normal.x = projectViewModel[3][0] + projectViewModel[2][0];
-    frustum.planes[4].normal.y = projectViewModel[3][1] + projectViewModel[2][1];
-    frustum.planes[4].normal.z = projectViewModel[3][2] + projectViewModel[2][2];
-    frustum.planes[4].d = projectViewModel[3][3] + projectViewModel[2][3];
-
-    // Far clipping plane
-    frustum.planes[5].normal.x = projectViewModel[3][0] - projectViewModel[2][0];
-    frustum.planes[5].normal.y = projectViewModel[3][1] - projectViewModel[2][1];
-    frustum.planes[5].normal.z = projectViewModel[3][2] - projectViewModel[2][2];
-    frustum.planes[5].d = projectViewModel[3][3] - projectViewModel[2][3];
-
-    // Normalize the plane equations, if requested
+    Vec4 r0 = rowFn(0);
+    Vec4 r1 = rowFn(1);
+    Vec4 r2 = rowFn(2);
+    Vec4 r3 = rowFn(3);
+
+    Vec4 planes[6] =
+    {
+      r3 + r0, // Left
+      r3 - r0, // Right
+      r3 - r1, // Top
+      r3 + r1, // Bottom
+      r3 + r2, // Near
+      r3 - r2  // Far
+    };
+
+    Frustum frustum;
     for (int i = 0; i < 6; i++)
     {
+      frustum.planes[i].normal = -Vec3(planes[i]);
+      frustum.planes[i].d = -planes[i].w;
       NormalizePlaneEquation(frustum.planes[i]);
     }
 
@@ -303,30 +298,17 @@ namespace ToolKit
     mesh->GetAllMeshes(meshes);
     float closestPickedDistance = FLT_MAX;
     bool hit = false;
-    std::mutex updateHit;
 
     for (Mesh* const mesh : meshes)
     {
-      std::for_each
-      (
-        std::execution::par_unseq,
-        mesh->m_faces.begin(),
-        mesh->m_faces.end(),
-        [&updateHit, &t, &closestPickedDistance, &ray, &hit](Face& face)
-        {
-          float dist = FLT_MAX;
-          if (RayTriangleIntersection(ray, face.vertices[0]->pos, face.vertices[1]->pos, face.vertices[2]->pos, dist))
-          {
-            std::lock_guard<std::mutex> guard(updateHit);
-            if (dist < closestPickedDistance && t >= 0.0f)
-            {
-              t = dist;
-              closestPickedDistance = dist;
-              hit = true;
-            }
-          }
-        }
-      );
+      TriangleBVH* bvh = mesh->GetTriangleBVH();
+      float dist = FLT_MAX;
+      if (bvh != nullptr && bvh->RayCast(ray, dist) && dist < closestPickedDistance)
+      {
+        t = dist;
+        closestPickedDistance = dist;
+        hit = true;
+      }
     }
 
     return hit;
@@ -466,53 +448,20 @@ namespace ToolKit
 
   void TransformAABB(BoundingBox& box, const Mat4& transform)
   {
-    // Calculate all 8 edges.
-    Vec3 maxtr = box.max;
-
-    Vec3 maxtl = box.max;
-    maxtl.x = box.min.x;
-
-    Vec3 maxbr = maxtr;
-    maxbr.y = box.min.y;
-
-    Vec3 maxbl = maxtl;
-    maxbl.x = box.min.x;
+    // Center moves with the transform, extent is spread over the axes by the absolute linear part.
+    Vec3 center = (box.min + box.max) * 0.5f;
+    Vec3 extent = (box.max - box.min) * 0.5f;
 
-    Vec3 minbl = maxbl;
-    minbl.z = box.min.z;
-
-    Vec3 minbr = maxbr;
-    minbr.z = box.min.z;
-
-    Vec3 mintl = maxtl;
-    maxtl.z = box.min.z;
-
-    Vec3 mintr = maxtr;
-    mintr.z = box.min.z;
-
-    std::vector<Vec4> vertices =
+    Vec3 c = Vec3(transform[3]);
+    Vec3 e;
+    for (int i = 0; i < 3; i++)
     {
-      Vec4(mintr, 1.0f),
-      Vec4(mintl, 1.0f),
-      Vec4(minbr, 1.0f),
-      Vec4(minbl, 1.0f),
-      Vec4(maxtr, 1.0f),
-      Vec4(maxtl, 1.0f),
-      Vec4(maxbr, 1.0f),
-      Vec4(maxbl, 1.0f)
-    };
-
-    BoundingBox bb;
-
-    // Transform and update aabb.
-    for (int i = 0; i < 8; i++)
-    {
-      Vec3 v = transform * vertices[i];
-      bb.min = glm::min(v, bb.min);
-      bb.max = glm::max(v, bb.max);
+      c += Vec3(transform[i]) * center[i];
+      e += glm::abs(Vec3(transform[i])) * extent[i];
     }
 
-    box = bb;
+    box.min = c - e;
+    box.max = c + e;
   }
 
   PlaneEquation PlaneFrom(Vec3 const pnts[3])
@@ -595,4 +544,166 @@ namespace ToolKit
       return glm::ceil(val * glm::pow(10.0f, (float)nDecimal) - 0.4999999999999f) / glm::pow(10.0f, (float)nDecimal);
   }
 
+  // Batch Operations
+  //////////////////////////////////////////
+
+  void TransformAABBs(const BoundingBox* boxes, const Mat4* transforms, BoundingBox* out, size_t count)
+  {
+#ifdef TK_MATH_SIMD
+    // A box per iteration, lanes are the matrix columns.
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (size_t i = 0; i < count; i++)
+    {
+      const BoundingBox& box = boxes[i];
+      const float* m = &transforms[i][0][0];
+      Vec3 center = (box.min + box.max) * 0.5f;
+      Vec3 extent = (box.max - box.min) * 0.5f;
+
+      __m128 c = _mm_loadu_ps(m + 12);
+      __m128 e = _mm_setzero_ps();
+      for (int j = 0; j < 3; j++)
+      {
+        __m128 axis = _mm_loadu_ps(m + j * 4);
+        c = _mm_add_ps(c, _mm_mul_ps(axis, _mm_set1_ps(center[j])));
+        e = _mm_add_ps(e, _mm_mul_ps(_mm_and_ps(axis, absMask), _mm_set1_ps(extent[j])));
+      }
+
+      alignas(16) float rmin[4];
+      alignas(16) float rmax[4];
+      _mm_store_ps(rmin, _mm_sub_ps(c, e));
+      _mm_store_ps(rmax, _mm_add_ps(c, e));
+      out[i].min = Vec3(rmin[0], rmin[1], rmin[2]);
+      out[i].max = Vec3(rmax[0], rmax[1], rmax[2]);
+    }
+#else
+    TransformAABBsScalar(boxes, transforms, out, count);
+#endif
+  }
+
+  void TransformAABBsScalar(const BoundingBox* boxes, const Mat4* transforms, BoundingBox* out, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      out[i] = boxes[i];
+      TransformAABB(out[i], transforms[i]);
+    }
+  }
+
+  // Outside if the box corner furthest against the plane normal is still in front of it, which is
+  // dot(n, center) + d - dot(abs(n), extent) > 0.
+  void FrustumBoxesVisible(const Frustum& frustum, const BoundingBox* boxes, size_t count, uint8* visible)
+  {
+    size_t i = 0;
+
+#ifdef TK_MATH_AVX
+    const __m256 half8 = _mm256_set1_ps(0.5f);
+    for (; i + 8 <= count; i += 8)
+    {
+      const BoundingBox* b = boxes + i;
+      __m256 minX = _mm256_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x, b[4].min.x, b[5].min.x, b[6].min.x, b[7].min.x);
+      __m256 minY = _mm256_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y, b[4].min.y, b[5].min.y, b[6].min.y, b[7].min.y);
+      __m256 minZ = _mm256_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z, b[4].min.z, b[5].min.z, b[6].min.z, b[7].min.z);
+      __m256 maxX = _mm256_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x, b[4].max.x, b[5].max.x, b[6].max.x, b[7].max.x);
+      __m256 maxY = _mm256_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y, b[4].max.y, b[5].max.y, b[6].max.y, b[7].max.y);
+      __m256 maxZ = _mm256_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z, b[4].max.z, b[5].max.z, b[6].max.z, b[7].max.z);
+
+      __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half8);
+      __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half8);
+      __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half8);
+      __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half8);
+      __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half8);
+      __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half8);
+
+      __m256 outside = _mm256_setzero_ps();
+      for (const PlaneEquation& plane : frustum.planes)
+      {
+        __m256 dist = _mm256_add_ps
+        (
+          _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.normal.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.normal.y))),
+          _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.normal.z)), _mm256_set1_ps(plane.d))
+        );
+        __m256 radius = _mm256_add_ps
+        (
+          _mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(glm::abs(plane.normal.x))), _mm256_mul_ps(ey, _mm256_set1_ps(glm::abs(plane.normal.y)))),
+          _mm256_mul_ps(ez, _mm256_set1_ps(glm::abs(plane.normal.z)))
+        );
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_sub_ps(dist, radius), _mm256_setzero_ps(), _CMP_GT_OQ));
+      }
+
+      int mask = _mm256_movemask_ps(outside);
+      for (int j = 0; j < 8; j++)
+      {
+        visible[i + j] = (mask >> j) & 1 ? 0 : 1;
+      }
+    }
+#endif
+
+#ifdef TK_MATH_SIMD
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= count; i += 4)
+    {
+      const BoundingBox* b = boxes + i;
+      __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+      __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+      __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+      __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+      __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+      __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+
+      __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+      __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+      __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+      __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+      __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+      __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+      __m128 outside = _mm_setzero_ps();
+      for (const PlaneEquation& plane : frustum.planes)
+      {
+        __m128 dist = _mm_add_ps
+        (
+          _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.normal.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.normal.y))),
+          _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.normal.z)), _mm_set1_ps(plane.d))
+        );
+        __m128 radius = _mm_add_ps
+        (
+          _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(glm::abs(plane.normal.x))), _mm_mul_ps(ey, _mm_set1_ps(glm::abs(plane.normal.y)))),
+          _mm_mul_ps(ez, _mm_set1_ps(glm::abs(plane.normal.z)))
+        );
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_sub_ps(dist, radius), _mm_setzero_ps()));
+      }
+
+      int mask = _mm_movemask_ps(outside);
+      for (int j = 0; j < 4; j++)
+      {
+        visible[i + j] = (mask >> j) & 1 ? 0 : 1;
+      }
+    }
+#endif
+
+    // Remainder.
+    FrustumBoxesVisibleScalar(frustum, boxes + i, count - i, visible + i);
+  }
+
+  void FrustumBoxesVisibleScalar(const Frustum& frustum, const BoundingBox* boxes, size_t count, uint8* visible)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      const BoundingBox& box = boxes[i];
+      Vec3 center = (box.min + box.max) * 0.5f;
+      Vec3 extent = (box.max - box.min) * 0.5f;
+
+      bool outside = false;
+      for (const PlaneEquation& plane : frustum.planes)
+      {
+        // Same operation order as the vector versions.
+        float dist = (center.x * plane.normal.x + center.y * plane.normal.y) + (center.z * plane.normal.z + plane.d);
+        float radius = (extent.x * glm::abs(plane.normal.x) + extent.y * glm::abs(plane.normal.y)) + extent.z * glm::abs(plane.normal.z);
+        outside |= dist - radius > 0.0f;
+      }
+
+      visible[i] = outside ? 0 : 1;
+    }
+  }
+
 }
@@ -77,12 +77,21 @@ namespace ToolKit
   // Geometric Operations
   //////////////////////////////////////////
   void NormalizePlaneEquation(PlaneEquation& plane);
-  void TransformAABB(BoundingBox& box, const Mat4& transform);
+  void TransformAABB(BoundingBox& box, const Mat4& transform); // Affine transforms only.
   PlaneEquation PlaneFrom(Vec3 const pnts[3]);
   PlaneEquation PlaneFrom(Vec3 point, Vec3 normal);
   float SignedDistance(const PlaneEquation& plane, const Vec3& pnt);
   Vec3 ProjectPointOntoPlane(const PlaneEquation& plane, const Vec3& pnt);
 
+  // Batch Operations
+  //////////////////////////////////////////
+  // Vectorized with SSE, or AVX when the build targets it. The scalar versions use the same arithmetic and are the
+  // reference for testing the vectorized ones.
+  void TransformAABBs(const BoundingBox* boxes, const Mat4* transforms, BoundingBox* out, size_t count);
+  void TransformAABBsScalar(const BoundingBox* boxes, const Mat4* transforms, BoundingBox* out, size_t count);
+  void FrustumBoxesVisible(const Frustum& frustum, const BoundingBox* boxes, size_t count, uint8* visible); // 0 if outside, 1 otherwise.
+  void FrustumBoxesVisibleScalar(const Frustum& frustum, const BoundingBox* boxes, size_t count, uint8* visible);
+
   // Conversions and Interpolation
   //////////////////////////////////////////
   Vec3 Interpolate(const Vec3& vec1, const Vec3& vec2, float ratio);
@@ -4,8 +4,11 @@
 #include "Material.h"
 #include "Texture.h"
 #include "Skeleton.h"
+#include "MeshSimplify.h"
+#include "TriangleBVH.h"
 #include "rapidxml.hpp"
 #include "rapidxml_utils.hpp"
+#include "GlCaptureHooks.h"
 #include "DebugNew.h"
 
 #include <unordered_map>
@@ -13,6 +16,21 @@
 namespace ToolKit
 {
 
+  std::atomic<uint> Mesh::m_geometryEpoch(1);
+  std::mutex Mesh::m_geometryHookLock;
+  std::vector<std::pair<uint, std::function<void(Mesh*)>>> Mesh::m_geometryHooks;
+  uint Mesh::m_nextGeometryHook = 0;
+
+  GpuBuffer::GpuBuffer(GLuint id)
+  {
+    m_id = id;
+  }
+
+  GpuBuffer::~GpuBuffer()
+  {
+    glDeleteBuffers(1, &m_id);
+  }
+
   Mesh::Mesh()
   {
     m_material = std::make_shared<Material>();
@@ -29,6 +47,12 @@ namespace ToolKit
     UnInit();
   }
 
+  ObjectPool& Mesh::GetPool()
+  {
+    static ObjectPool pool("Mesh");
+    return pool;
+  }
+
   void Mesh::Init(bool flushClientSideArray)
   {
     if (m_initiated)
@@ -36,11 +60,20 @@ namespace ToolKit
       return;
     }
 
-    InitVertices(flushClientSideArray);
-    InitIndices(flushClientSideArray);
-    if (!flushClientSideArray)
+    if (m_dynamic)
     {
-      ConstructFaces();
+      m_vertexCount = (uint)m_clientSideVertices.size();
+      m_indexCount = (uint)m_clientSideIndices.size();
+    }
+    else
+    {
+      if (flushClientSideArray && GetMeshManager()->m_buildTriangleBVH)
+      {
+        GetTriangleBVH();
+      }
+
+      InitVertices(flushClientSideArray);
+      InitIndices(flushClientSideArray);
     }
 
     m_material->Init();
@@ -55,10 +88,11 @@ namespace ToolKit
 
   void Mesh::UnInit()
   {
-    GLuint buffers[2] = { m_vboIndexId, m_vboVertexId };
-    glDeleteBuffers(2, buffers);
+    m_vertexBuffer = nullptr;
+    m_indexBuffer = nullptr;
     m_vboVertexId = 0;
     m_vboIndexId = 0;
+    m_triangleBVH = nullptr;
 
     for (MeshPtr& subMesh : m_subMeshes)
     {
@@ -81,6 +115,12 @@ namespace ToolKit
 
     XmlNode* node = doc.first_node("meshContainer");
     DeSerialize(&doc, node);
+
+    MeshManager* manager = GetMeshManager();
+    if (manager->m_lodLevelCount > 0)
+    {
+      GenerateLods(manager->m_lodLevelCount, manager->m_lodReduction);
+    }
   }
 
   Mesh* Mesh::GetCopy()
@@ -90,31 +130,18 @@ namespace ToolKit
     cpy->m_vertexCount = m_vertexCount;
     cpy->m_clientSideIndices = m_clientSideIndices;
     cpy->m_indexCount = m_indexCount;
-    cpy->m_faces = m_faces;
-
-    // Copy video memory.
-    if (m_vertexCount > 0)
-    {
-      glGenBuffers(1, &cpy->m_vboVertexId);
-      glBindBuffer(GL_COPY_WRITE_BUFFER, cpy->m_vboVertexId);
-      glBindBuffer(GL_COPY_READ_BUFFER, m_vboVertexId);
-      uint size = GetVertexSize() * m_vertexCount;
-      glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
-      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
-    }
 
-    if (m_indexCount > 0)
-    {
-      glGenBuffers(1, &cpy->m_vboIndexId);
-      glBindBuffer(GL_COPY_WRITE_BUFFER, cpy->m_vboIndexId);
-      glBindBuffer(GL_COPY_READ_BUFFER, m_vboIndexId);
-      uint size = sizeof(uint) * m_indexCount;
-      glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
-      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
-    }
+    // Share video memory, buffers are replaced when a copy modifies its geometry.
+    cpy->m_vertexBuffer = m_vertexBuffer;
+    cpy->m_indexBuffer = m_indexBuffer;
+    cpy->m_vboVertexId = m_vboVertexId;
+    cpy->m_vboIndexId = m_vboIndexId;
+    cpy->m_material = m_material;
+    cpy->m_triangleBVH = m_triangleBVH;
 
-    cpy->m_material = MaterialPtr(m_material->GetCopy());
     cpy->m_aabb = m_aabb;
+    cpy->m_lods = m_lods;
+    cpy->m_dynamic = m_dynamic;
 
     cpy->m_file = m_file;
     cpy->m_initiated = m_initiated;
@@ -141,6 +168,10 @@ namespace ToolKit
 
   void Mesh::CalculateAABoundingBox()
   {
+    // Called after the geometry changes, the picking bvh is rebuilt on demand.
+    m_triangleBVH = nullptr;
+    SetGeometryDirty();
+
     if (m_clientSideVertices.empty())
     {
       return;
@@ -185,39 +216,81 @@ namespace ToolKit
     }
   }
 
-  void Mesh::ConstructFaces()
+  void Mesh::ApplyTransform(const Mat4& transform)
   {
-    size_t triCnt = m_clientSideIndices.size() / 3;
-    m_faces.resize(triCnt);
-    for (size_t i = 0; i < triCnt; i++)
+    Mat4 its = glm::inverseTranspose(transform);
+    for (Vertex& v : m_clientSideVertices)
     {
-      if (m_clientSideIndices.empty())
-      {
-        for (size_t j = 0; j < 3; j++)
-        {
-          m_faces[i].vertices[j] = &m_clientSideVertices[i * 3 + j];
-        }
-      }
-      else
+      v.pos = transform * Vec4(v.pos, 1.0f);
+      v.norm = glm::normalize(its * Vec4(v.norm, 1.0f));
+      v.btan = glm::normalize(its * Vec4(v.btan, 1.0f));
+    }
+
+    if (m_initiated && !m_dynamic && !m_clientSideVertices.empty())
+    {
+      InitVertices(false);
+    }
+
+    m_triangleBVH = nullptr;
+    SetGeometryDirty();
+  }
+
+  MaterialPtr Mesh::GetUniqueMaterial()
+  {
+    if (m_material.use_count() > 1)
+    {
+      m_material = MaterialPtr(m_material->GetCopy());
+    }
+
+    return m_material;
+  }
+
+  bool Mesh::IsGeometryShared() const
+  {
+    return m_vertexBuffer.use_count() > 1 || m_indexBuffer.use_count() > 1;
+  }
+
+  TriangleBVH* Mesh::GetTriangleBVH()
+  {
+    if (m_triangleBVH == nullptr)
+    {
+      // Flushed. Skin meshes keep their vertices in their own array and are not picked by triangles either.
+      if (m_clientSideVertices.size() != m_vertexCount)
       {
-        for (size_t j = 0; j < 3; j++)
-        {
-          size_t indx = m_clientSideIndices[i * 3 + j];
-          m_faces[i].vertices[j] = &m_clientSideVertices[indx];
-        }
+        return nullptr;
       }
+
+      m_triangleBVH = TriangleBVHPtr(new TriangleBVH());
+      m_triangleBVH->Build(m_clientSideVertices, m_clientSideIndices);
     }
+
+    return m_triangleBVH.get();
   }
 
-  void Mesh::ApplyTransform(const Mat4& transform)
+  void Mesh::GenerateLods(uint levelCount, float reduction)
   {
-    Mat4 its = glm::inverseTranspose(transform);
-    for (Vertex& v : m_clientSideVertices)
+    MeshRawPtrArray meshes;
+    GetAllMeshes(meshes);
+
+    for (Mesh* mesh : meshes)
     {
-      v.pos = transform * Vec4(v.pos, 1.0f);
-      v.norm = glm::normalize(its * Vec4(v.norm, 1.0f));
-      v.btan = glm::normalize(its * Vec4(v.btan, 1.0f));
+      mesh->m_lods.clear();
+
+      const Mesh* prev = mesh;
+      for (uint i = 0; i < levelCount; i++)
+      {
+        MeshPtr lod = SimplifyMesh(prev, reduction);
+        if (lod == nullptr)
+        {
+          break;
+        }
+
+        mesh->m_lods.push_back(lod);
+        prev = lod.get();
+      }
     }
+
+    SetGeometryDirty();
   }
 
   void Mesh::Serialize(XmlDocument* doc, XmlNode* parent) const
@@ -411,11 +484,14 @@ namespace ToolKit
 
   void Mesh::InitVertices(bool flush)
   {
-    glDeleteBuffers(1, &m_vboVertexId);
+    // Releases only this mesh's reference, copies sharing the buffer keep it.
+    m_vertexBuffer = nullptr;
+    m_vboVertexId = 0;
 
     if (!m_clientSideVertices.empty())
     {
       glGenBuffers(1, &m_vboVertexId);
+      m_vertexBuffer = std::make_shared<GpuBuffer>(m_vboVertexId);
       glBindBuffer(GL_ARRAY_BUFFER, m_vboVertexId);
       glBufferData(GL_ARRAY_BUFFER, GetVertexSize() * m_clientSideVertices.size(), m_clientSideVertices.data(), GL_STATIC_DRAW);
       m_vertexCount = (uint)m_clientSideVertices.size();
@@ -430,11 +506,13 @@ namespace ToolKit
 
   void Mesh::InitIndices(bool flush)
   {
-    glDeleteBuffers(1, &m_vboIndexId);
+    m_indexBuffer = nullptr;
+    m_vboIndexId = 0;
 
     if (!m_clientSideIndices.empty())
     {
       glGenBuffers(1, &m_vboIndexId);
+      m_indexBuffer = std::make_shared<GpuBuffer>(m_vboIndexId);
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIndexId);
       glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * m_clientSideIndices.size(), m_clientSideIndices.data(), GL_STATIC_DRAW);
       m_indexCount = (uint)m_clientSideIndices.size();
@@ -447,6 +525,46 @@ namespace ToolKit
     }
   }
 
+  uint Mesh::GetGeometryEpoch()
+  {
+    return m_geometryEpoch;
+  }
+
+  uint Mesh::AddGeometryHook(const std::function<void(Mesh*)>& hook)
+  {
+    std::lock_guard<std::mutex> lock(m_geometryHookLock);
+    m_geometryHooks.push_back({ ++m_nextGeometryHook, hook });
+    return m_nextGeometryHook;
+  }
+
+  void Mesh::RemoveGeometryHook(uint id)
+  {
+    std::lock_guard<std::mutex> lock(m_geometryHookLock);
+    for (size_t i = 0; i < m_geometryHooks.size(); i++)
+    {
+      if (m_geometryHooks[i].first == id)
+      {
+        m_geometryHooks.erase(m_geometryHooks.begin() + i);
+        break;
+      }
+    }
+  }
+
+  void Mesh::SetGeometryDirty()
+  {
+    // Zero is never used, users can start from it to see the first state as a change.
+    if (++m_geometryEpoch == 0)
+    {
+      m_geometryEpoch = 1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_geometryHookLock);
+    for (auto& hook : m_geometryHooks)
+    {
+      hook.second(this);
+    }
+  }
+
   void Mesh::UpdateAABB(const Vec3& v)
   {
     m_aabb.max = glm::max(m_aabb.max, v);
@@ -572,11 +690,13 @@ namespace ToolKit
 
   void SkinMesh::InitVertices(bool flush)
   {
-    glDeleteBuffers(1, &m_vboIndexId);
+    m_vertexBuffer = nullptr;
+    m_vboVertexId = 0;
 
     if (!m_clientSideVertices.empty())
     {
       glGenBuffers(1, &m_vboVertexId);
+      m_vertexBuffer = std::make_shared<GpuBuffer>(m_vboVertexId);
       glBindBuffer(GL_ARRAY_BUFFER, m_vboVertexId);
       glBufferData(GL_ARRAY_BUFFER, GetVertexSize() * m_clientSideVertices.size(), m_clientSideVertices.data(), GL_STATIC_DRAW);
       m_vertexCount = (uint)m_clientSideVertices.size();
@@ -5,8 +5,12 @@
 #include "ResourceManager.h"
 #include "MathUtil.h"
 #include "Serialize.h"
+#include "ObjectPool.h"
 #include "GL/glew.h"
 #include <memory>
+#include <atomic>
+#include <functional>
+#include <mutex>
 
 namespace ToolKit
 {
@@ -22,10 +26,15 @@ namespace ToolKit
     Vec3 btan;
   };
 
-  class Face
+  // Owns a gl buffer object. Copies of a mesh share their buffers, the buffer is deleted with its last owner.
+  class GpuBuffer
   {
   public:
-    Vertex* vertices[3];
+    GpuBuffer(GLuint id);
+    ~GpuBuffer();
+
+  public:
+    GLuint m_id;
   };
 
   class Mesh : public Resource, public Serializable
@@ -35,17 +44,26 @@ namespace ToolKit
     Mesh(String file);
     virtual ~Mesh();
 
+    TK_POOLED_CLASS(GetPool)
+    static ObjectPool& GetPool(); // Shared with SkinMesh.
+
     virtual void Init(bool flushClientSideArray = true) override;
     virtual void UnInit() override;
     virtual void Load() override;
-    virtual Mesh* GetCopy() override;
+    virtual Mesh* GetCopy() override; // Shares the gpu buffers and the material with this mesh.
     virtual int GetVertexSize() const;
     virtual bool IsSkinned() const;
     void CalculateAABoundingBox();
+    static uint GetGeometryEpoch(); // Changes whenever any mesh's bounds or geometry does.
+    static uint AddGeometryHook(const std::function<void(Mesh*)>& hook); // Called with each changed mesh, on the thread that changes it. Returns the id to remove it with.
+    static void RemoveGeometryHook(uint id);
     void GetAllMeshes(MeshRawPtrArray& meshes);
     void GetAllMeshes(MeshRawCPtrArray& meshes) const;
-    void ConstructFaces();
-    void ApplyTransform(const Mat4& transform);
+    void ApplyTransform(const Mat4& transform); // Transforms client side vertices. Reuploads them if initiated, detaching from shared buffers.
+    MaterialPtr GetUniqueMaterial(); // For editing. Clones the material first if it is shared.
+    bool IsGeometryShared() const;
+    void GenerateLods(uint levelCount, float reduction); // Simplifies this mesh and its sub meshes. Needs client side arrays, call before Init.
+    TriangleBVH* GetTriangleBVH(); // For picking, built on first use. Null if the client side arrays are flushed before.
 
     virtual void Serialize(XmlDocument* doc, XmlNode* parent) const override;
     virtual void DeSerialize(XmlDocument* doc, XmlNode* parent) override;
@@ -58,21 +76,39 @@ namespace ToolKit
   public:
     VertexArray m_clientSideVertices;
     std::vector<uint> m_clientSideIndices;
-    GLuint m_vboVertexId = 0;
-    GLuint m_vboIndexId = 0;
+    GLuint m_vboVertexId = 0; // Of m_vertexBuffer.
+    GLuint m_vboIndexId = 0; // Of m_indexBuffer.
     uint m_vertexCount = 0;
     uint m_indexCount = 0;
     MaterialPtr m_material;
     MeshPtrArray m_subMeshes;
     BoundingBox m_aabb;
-    FaceArray m_faces;
+    MeshPtrArray m_lods; // Simplified levels, coarser with increasing index. Level 0 is the mesh itself.
+    bool m_dynamic = false; // Regenerated frequently. Init keeps the client side arrays and the renderer streams them, no buffers are created. Not for skinned meshes.
+
+  protected:
+    GpuBufferPtr m_vertexBuffer;
+    GpuBufferPtr m_indexBuffer;
+    TriangleBVHPtr m_triangleBVH; // Shared by the copies.
+
+  private:
+    void SetGeometryDirty();
 
   private:
     MeshRawPtrArray m_allMeshes;
+    static std::atomic<uint> m_geometryEpoch; // Meshes are loaded and simplified on different threads.
+    static std::mutex m_geometryHookLock;
+    static std::vector<std::pair<uint, std::function<void(Mesh*)>>> m_geometryHooks;
+    static uint m_nextGeometryHook;
   };
 
   class MeshManager : public ResourceManager<Mesh>
   {
+  public:
+    // Lod chain generated for meshes loaded from files. No lods are generated when m_lodLevelCount is 0.
+    uint m_lodLevelCount = 0;
+    float m_lodReduction = 0.5f; // Triangle ratio of each level to the previous one.
+    bool m_buildTriangleBVH = false; // Builds the picking bvh of meshes before Init flushes their client side arrays.
   };
 
   class SkinVertex : public Vertex
@@ -0,0 +1,394 @@
+#include "stdafx.h"
+#include "MeshSimplify.h"
+#include "Mesh.h"
+#include "Material.h"
+#include <map>
+#include <queue>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  // Symmetric 4x4 matrix, upper triangle.
+  struct Quadric
+  {
+    double m[10] = { 0.0 };
+
+    Quadric()
+    {
+    }
+
+    Quadric(double a, double b, double c, double d)
+    {
+      m[0] = a * a; m[1] = a * b; m[2] = a * c; m[3] = a * d;
+      m[4] = b * b; m[5] = b * c; m[6] = b * d;
+      m[7] = c * c; m[8] = c * d;
+      m[9] = d * d;
+    }
+
+    void Add(const Quadric& q, double weight = 1.0)
+    {
+      for (int i = 0; i < 10; i++)
+      {
+        m[i] += q.m[i] * weight;
+      }
+    }
+
+    double Error(const Vec3& p) const
+    {
+      double x = p.x, y = p.y, z = p.z;
+      return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+        + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+        + m[7] * z * z + 2.0 * m[8] * z
+        + m[9];
+    }
+  };
+
+  struct Collapse
+  {
+    double cost;
+    uint from;
+    uint to;
+    uint fromVersion;
+    uint toVersion;
+
+    bool operator> (const Collapse& other) const
+    {
+      return cost > other.cost;
+    }
+  };
+
+  MeshPtr SimplifyMesh(const Mesh* source, float targetRatio)
+  {
+    const VertexArray& vertices = source->m_clientSideVertices;
+    if (vertices.empty() || source->IsSkinned() || source->m_material == nullptr)
+    {
+      return nullptr;
+    }
+
+    if (source->m_material->GetRenderState()->drawType != DrawType::Triangle)
+    {
+      return nullptr;
+    }
+
+    std::vector<uint> indices = source->m_clientSideIndices;
+    if (indices.empty())
+    {
+      indices.resize(vertices.size());
+      for (uint i = 0; i < (uint)indices.size(); i++)
+      {
+        indices[i] = i;
+      }
+    }
+
+    uint triCount = (uint)indices.size() / 3;
+    uint targetCount = (uint)(triCount * glm::clamp(targetRatio, 0.0f, 1.0f));
+    if (triCount < 4 || targetCount >= triCount)
+    {
+      return nullptr;
+    }
+
+    // Weld vertices by position, so that uv seams and hard edges collapse together.
+    auto lessFn = [](const Vec3& a, const Vec3& b) -> bool
+    {
+      if (a.x != b.x) return a.x < b.x;
+      if (a.y != b.y) return a.y < b.y;
+      return a.z < b.z;
+    };
+    std::map<Vec3, uint, decltype(lessFn)> positionIds(lessFn);
+
+    std::vector<uint> groupOf(vertices.size());
+    std::vector<Vec3> groupPos;
+    std::vector<std::vector<uint>> groupVerts;
+    for (uint i = 0; i < (uint)vertices.size(); i++)
+    {
+      auto res = positionIds.insert({ vertices[i].pos, (uint)groupPos.size() });
+      if (res.second)
+      {
+        groupPos.push_back(vertices[i].pos);
+        groupVerts.push_back({});
+      }
+
+      groupOf[i] = res.first->second;
+      groupVerts[groupOf[i]].push_back(i);
+    }
+
+    uint groupCount = (uint)groupPos.size();
+    std::vector<Quadric> quadrics(groupCount);
+    std::vector<std::vector<uint>> groupTris(groupCount);
+    std::vector<bool> triRemoved(triCount, false);
+
+    auto triGroupFn = [&](uint tri, int corner) -> uint
+    {
+      return groupOf[indices[tri * 3 + corner]];
+    };
+
+    // Face quadrics, area weighted.
+    std::map<std::pair<uint, uint>, std::vector<uint>> edgeTris;
+    for (uint t = 0; t < triCount; t++)
+    {
+      uint g0 = triGroupFn(t, 0), g1 = triGroupFn(t, 1), g2 = triGroupFn(t, 2);
+      if (g0 == g1 || g1 == g2 || g0 == g2)
+      {
+        triRemoved[t] = true;
+        continue;
+      }
+
+      Vec3 n = glm::cross(groupPos[g1] - groupPos[g0], groupPos[g2] - groupPos[g0]);
+      float area = glm::length(n);
+      if (area > 0.0f)
+      {
+        n /= area;
+      }
+
+      Quadric q(n.x, n.y, n.z, -glm::dot(n, groupPos[g0]));
+      for (uint g : { g0, g1, g2 })
+      {
+        quadrics[g].Add(q, area * 0.5);
+        groupTris[g].push_back(t);
+      }
+
+      uint corners[3] = { g0, g1, g2 };
+      for (int i = 0; i < 3; i++)
+      {
+        uint a = corners[i], b = corners[(i + 1) % 3];
+        edgeTris[{ glm::min(a, b), glm::max(a, b) }].push_back(t);
+      }
+    }
+
+    // Open boundaries are preserved with planes perpendicular to the border faces.
+    for (auto& edge : edgeTris)
+    {
+      if (edge.second.size() != 1)
+      {
+        continue;
+      }
+
+      uint t = edge.second.front();
+      Vec3 p0 = groupPos[triGroupFn(t, 0)], p1 = groupPos[triGroupFn(t, 1)], p2 = groupPos[triGroupFn(t, 2)];
+      Vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+
+      Vec3 a = groupPos[edge.first.first];
+      Vec3 b = groupPos[edge.first.second];
+      Vec3 n = glm::cross(b - a, faceNormal);
+      float len = glm::length(n);
+      if (len <= 0.0f)
+      {
+        continue;
+      }
+      n /= len;
+
+      const double boundaryWeight = 1000.0;
+      Quadric q(n.x, n.y, n.z, -glm::dot(n, a));
+      quadrics[edge.first.first].Add(q, boundaryWeight * glm::length2(b - a));
+      quadrics[edge.first.second].Add(q, boundaryWeight * glm::length2(b - a));
+    }
+
+    std::vector<uint> versions(groupCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    auto pushEdgeFn = [&](uint a, uint b) -> void
+    {
+      Quadric q = quadrics[a];
+      q.Add(quadrics[b]);
+
+      double costAB = q.Error(groupPos[b]);
+      double costBA = q.Error(groupPos[a]);
+      if (costAB <= costBA)
+      {
+        heap.push({ costAB, a, b, versions[a], versions[b] });
+      }
+      else
+      {
+        heap.push({ costBA, b, a, versions[b], versions[a] });
+      }
+    };
+
+    for (auto& edge : edgeTris)
+    {
+      pushEdgeFn(edge.first.first, edge.first.second);
+    }
+    edgeTris.clear();
+
+    uint aliveCount = 0;
+    for (uint t = 0; t < triCount; t++)
+    {
+      aliveCount += triRemoved[t] ? 0 : 1;
+    }
+
+    while (aliveCount > targetCount && !heap.empty())
+    {
+      Collapse c = heap.top();
+      heap.pop();
+
+      if (versions[c.from] != c.fromVersion || versions[c.to] != c.toVersion || groupVerts[c.from].empty())
+      {
+        continue; // Stale.
+      }
+
+      // Reject collapses that flip the faces around the removed vertex.
+      bool flips = false;
+      for (uint t : groupTris[c.from])
+      {
+        if (triRemoved[t])
+        {
+          continue;
+        }
+
+        uint g[3] = { triGroupFn(t, 0), triGroupFn(t, 1), triGroupFn(t, 2) };
+        if (g[0] == c.to || g[1] == c.to || g[2] == c.to)
+        {
+          continue;
+        }
+
+        Vec3 p[3] = { groupPos[g[0]], groupPos[g[1]], groupPos[g[2]] };
+        Vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        for (int i = 0; i < 3; i++)
+        {
+          if (g[i] == c.from)
+          {
+            p[i] = groupPos[c.to];
+          }
+        }
+
+        Vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+        if (glm::dot(before, after) <= 0.0f)
+        {
+          flips = true;
+          break;
+        }
+      }
+
+      if (flips)
+      {
+        continue;
+      }
+
+      // Each removed vertex is mapped to a vertex of the target position, preferably one connected with a face.
+      std::unordered_map<uint, uint> remap;
+      for (uint v : groupVerts[c.from])
+      {
+        uint target = groupVerts[c.to].front();
+        for (uint t : groupTris[c.from])
+        {
+          if (triRemoved[t])
+          {
+            continue;
+          }
+
+          uint* tri = &indices[t * 3];
+          if (tri[0] != v && tri[1] != v && tri[2] != v)
+          {
+            continue;
+          }
+
+          for (int i = 0; i < 3; i++)
+          {
+            if (groupOf[tri[i]] == c.to)
+            {
+              target = tri[i];
+            }
+          }
+        }
+        remap[v] = target;
+      }
+
+      for (uint t : groupTris[c.from])
+      {
+        if (triRemoved[t])
+        {
+          continue;
+        }
+
+        uint* tri = &indices[t * 3];
+        bool degenerate = false;
+        for (int i = 0; i < 3; i++)
+        {
+          degenerate |= groupOf[tri[i]] == c.to;
+        }
+
+        if (degenerate)
+        {
+          triRemoved[t] = true;
+          aliveCount--;
+          continue;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+          if (groupOf[tri[i]] == c.from)
+          {
+            tri[i] = remap[tri[i]];
+          }
+        }
+        groupTris[c.to].push_back(t);
+      }
+
+      quadrics[c.to].Add(quadrics[c.from]);
+      groupVerts[c.from].clear();
+      groupTris[c.from].clear();
+      versions[c.from]++;
+      versions[c.to]++;
+
+      // Compact the target's face list and requeue its edges.
+      std::vector<uint>& targetTris = groupTris[c.to];
+      targetTris.erase
+      (
+        std::remove_if(targetTris.begin(), targetTris.end(), [&triRemoved](uint t) { return triRemoved[t]; }),
+        targetTris.end()
+      );
+      std::sort(targetTris.begin(), targetTris.end());
+      targetTris.erase(std::unique(targetTris.begin(), targetTris.end()), targetTris.end());
+
+      std::vector<uint> neighbors;
+      for (uint t : targetTris)
+      {
+        for (int i = 0; i < 3; i++)
+        {
+          uint g = triGroupFn(t, i);
+          if (g != c.to)
+          {
+            neighbors.push_back(g);
+          }
+        }
+      }
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+      for (uint n : neighbors)
+      {
+        pushEdgeFn(c.to, n);
+      }
+    }
+
+    // Compact the surviving vertices.
+    MeshPtr lod = MeshPtr(new Mesh());
+    std::vector<uint> newIndex(vertices.size(), UINT_MAX);
+    for (uint t = 0; t < triCount; t++)
+    {
+      if (triRemoved[t])
+      {
+        continue;
+      }
+
+      for (int i = 0; i < 3; i++)
+      {
+        uint v = indices[t * 3 + i];
+        if (newIndex[v] == UINT_MAX)
+        {
+          newIndex[v] = (uint)lod->m_clientSideVertices.size();
+          lod->m_clientSideVertices.push_back(vertices[v]);
+        }
+        lod->m_clientSideIndices.push_back(newIndex[v]);
+      }
+    }
+
+    lod->m_vertexCount = (uint)lod->m_clientSideVertices.size();
+    lod->m_indexCount = (uint)lod->m_clientSideIndices.size();
+    lod->m_material = source->m_material;
+    lod->CalculateAABoundingBox();
+
+    return lod;
+  }
+
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Types.h"
+
+namespace ToolKit
+{
+
+  // Quadric error metric simplification (Garland & Heckbert) with half edge collapses.
+  // Only the mesh itself is simplified, sub meshes are ignored. Source must be a triangle mesh with its client side arrays.
+  // Returns a new mesh that shares the source's material, or nullptr if the source can't be simplified.
+  MeshPtr SimplifyMesh(const class Mesh* source, float targetRatio);
+
+}
@@ -1,12 +1,33 @@
 #include "stdafx.h"
 #include "Node.h"
 #include "MathUtil.h"
+#include "TransformSystem.h"
 #include "DebugNew.h"
 
 namespace ToolKit
 {
 
   NodeId Node::m_nextId = 0;
+  std::atomic<uint> Node::m_epoch(1);
+
+  void NodeChangeList::Add(Node* node)
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_nodes.insert(node);
+  }
+
+  void NodeChangeList::Remove(Node* node)
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_nodes.erase(node);
+  }
+
+  void NodeChangeList::Take(std::vector<Node*>& nodes)
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    nodes.assign(m_nodes.begin(), m_nodes.end());
+    m_nodes.clear();
+  }
 
   Node::Node()
   {
@@ -16,12 +37,28 @@ namespace ToolKit
   Node::~Node()
   {
     OrphanSelf(true);
-    for (Node* child : m_children)
+    while (!m_children.empty())
     {
-      Orphan(child, true);
+      Orphan(m_children.back(), true);
+    }
+
+    if (m_transformSystem != nullptr)
+    {
+      m_transformSystem->Remove(this);
+    }
+
+    if (m_changes != nullptr)
+    {
+      m_changes->Remove(this);
     }
   }
 
+  ObjectPool& Node::GetPool()
+  {
+    static ObjectPool pool("Node", true);
+    return pool;
+  }
+
   void Node::Translate(const Vec3& val, TransformationSpace space)
   {
     Vec3 tmpScl = m_scale;
@@ -31,6 +68,7 @@ namespace ToolKit
     TransformImp(ts, space, &m_translation, nullptr, nullptr);
 
     m_scale = tmpScl;
+    SetLocalDirty();
   }
 
   void Node::Rotate(const Quaternion& val, TransformationSpace space)
@@ -42,11 +80,13 @@ namespace ToolKit
     TransformImp(ts, space, nullptr, &m_orientation, nullptr);
 
     m_scale = tmpScl;
+    SetLocalDirty();
   }
 
   void Node::Scale(const Vec3& val)
   {
     m_scale *= val;
+    SetLocalDirty();
   }
 
   void Node::Transform(const Mat4& val, TransformationSpace space, bool noScale)
@@ -60,6 +100,7 @@ namespace ToolKit
     if (noScale)
     {
       m_scale = tmpScl;
+      SetLocalDirty();
     }
   }
 
@@ -74,6 +115,7 @@ namespace ToolKit
     if (noScale)
     {
       m_scale = tmpScl;
+      SetLocalDirty();
     }
   }
 
@@ -95,7 +137,7 @@ namespace ToolKit
       else
       {
         m_translation = val;
-        SetChildrenDirty();
+        SetLocalDirty();
       }
     }
     else
@@ -123,7 +165,7 @@ namespace ToolKit
       else
       {
         m_orientation = val;
-        SetChildrenDirty();
+        SetLocalDirty();
       }
     }
     else
@@ -143,7 +185,7 @@ namespace ToolKit
   void Node::SetScale(const Vec3& val)
   {
     m_scale = val;
-    SetChildrenDirty();
+    SetLocalDirty();
   }
 
   Vec3 Node::GetScale()
@@ -161,11 +203,11 @@ namespace ToolKit
     case TransformationSpace::TS_PARENT:
       if (m_parent != nullptr)
       {
-        axes = m_parent->GetTransform(TransformationSpace::TS_WORLD);
+        axes = m_parent->GetWorldTransform();
       }
       break;
     case TransformationSpace::TS_LOCAL:
-      axes = GetTransform(TransformationSpace::TS_WORLD);
+      axes = GetWorldTransform();
     default:
       break;
     }
@@ -184,10 +226,25 @@ namespace ToolKit
     assert(child->m_parent == nullptr);
     Mat4 ts = child->GetTransform(TransformationSpace::TS_WORLD);
 
+    // Joined hierarchies are mirrored by the same system.
+    if (m_transformSystem != nullptr && child->m_transformSystem == nullptr)
+    {
+      m_transformSystem->Add(child);
+    }
+    else if (child->m_transformSystem != nullptr && m_transformSystem == nullptr)
+    {
+      child->m_transformSystem->Add(this);
+    }
+    assert(m_transformSystem == child->m_transformSystem && "Nodes are mirrored by different transform systems.");
+
+    if (m_changes != nullptr && child->m_changes != m_changes)
+    {
+      child->Watch(m_changes);
+    }
+
     m_children.push_back(child);
     child->m_parent = this;
-    child->m_dirty = true;
-    child->SetChildrenDirty();
+    child->SetLocalDirty();
 
     if (preserveTransform)
     {  
@@ -204,8 +261,7 @@ namespace ToolKit
         Mat4 ts = child->GetTransform(TransformationSpace::TS_WORLD);
 
         child->m_parent = nullptr;
-        child->m_dirty = true;
-        child->SetChildrenDirty();
+        child->SetLocalDirty();
         m_children.erase(m_children.begin() + i);
 
         if (preserveTransform)
@@ -249,6 +305,7 @@ namespace ToolKit
     node->m_translation = m_translation;
     node->m_orientation = m_orientation;
     node->m_scale = m_scale;
+    node->SetLocalDirty();
 
     return node;
   }
@@ -336,11 +393,14 @@ namespace ToolKit
     {
       ReadVec(n, m_scale);
     }
+
+    SetLocalDirty();
   }
 
   void Node::SetInheritScaleDeep(bool val)
   {
     m_inheritScale = val;
+    SetLocalDirty();
     for (Node* n : m_children)
     {
       n->SetInheritScaleDeep(val);
@@ -349,23 +409,24 @@ namespace ToolKit
 
   void Node::TransformImp(const Mat4& val, TransformationSpace space, Vec3* translation, Quaternion* orientation, Vec3* scale)
   {
+    // Callers may have replaced the scale temporarily, the cached local transform is not used.
     Mat4 ps, ts;
     ps = GetParentTransform();
     switch (space)
     {
     case TransformationSpace::TS_WORLD:
-      ts = glm::inverse(ps) * val * ps * GetLocalTransform();
+      ts = glm::inverse(ps) * val * ps * ComputeLocalTransform();
       break;
     case TransformationSpace::TS_PARENT:
-      ts = val * GetLocalTransform();
+      ts = val * ComputeLocalTransform();
       break;
     case TransformationSpace::TS_LOCAL:
-      ts = GetLocalTransform() * val;
+      ts = ComputeLocalTransform() * val;
       break;
     }
 
     DecomposeMatrix(ts, translation, orientation, scale);
-    SetChildrenDirty();
+    SetLocalDirty();
   }
 
   void Node::SetTransformImp(const Mat4& val, TransformationSpace space, Vec3* translation, Quaternion* orientation, Vec3* scale)
@@ -376,8 +437,7 @@ namespace ToolKit
     case TransformationSpace::TS_WORLD:
       if (m_parent != nullptr)
       {
-        Mat4 ps = GetParentTransform();
-        ts = glm::inverse(ps) * val;
+        ts = glm::inverse(GetParentTransform()) * val;
         break;
       } // Fall trough.
     case TransformationSpace::TS_PARENT:
@@ -389,7 +449,7 @@ namespace ToolKit
     }
 
     DecomposeMatrix(ts, translation, orientation, scale);
-    SetChildrenDirty();
+    SetLocalDirty();
   }
 
   void Node::GetTransformImp(TransformationSpace space, Mat4* transform, Vec3* translation, Quaternion* orientation, Vec3* scale)
@@ -399,14 +459,30 @@ namespace ToolKit
     case TransformationSpace::TS_WORLD:
       if (m_parent != nullptr)
       {
-        Mat4 ts = GetLocalTransform();
-        Mat4 ps = GetParentTransform();
-        ts = ps * ts;
+        const Mat4& ts = GetWorldTransform();
         if (transform != nullptr)
         {
           *transform = ts;
         }
-        DecomposeMatrix(ts, translation, orientation, scale);
+        if (translation != nullptr)
+        {
+          *translation = glm::column(ts, 3).xyz;
+        }
+
+        // Decomposed once per world change.
+        if ((orientation != nullptr || scale != nullptr) && m_decomposedVersion != m_worldVersion)
+        {
+          DecomposeMatrix(ts, nullptr, &m_worldOrientation, &m_worldScale);
+          m_decomposedVersion = m_worldVersion;
+        }
+        if (orientation != nullptr)
+        {
+          *orientation = m_worldOrientation;
+        }
+        if (scale != nullptr)
+        {
+          *scale = m_worldScale;
+        }
         break;
       } // Fall trough.
     case TransformationSpace::TS_PARENT:
@@ -449,7 +525,7 @@ namespace ToolKit
     }
   }
 
-  ToolKit::Mat4 Node::GetLocalTransform() const
+  Mat4 Node::ComputeLocalTransform() const
   {
     Mat4 ts, rt, scl;
     scl = glm::scale(scl, m_scale);
@@ -458,46 +534,114 @@ namespace ToolKit
     return ts * rt * scl;
   }
 
-  Mat4 Node::GetParentTransform()
+  const Mat4& Node::GetLocalTransform()
   {
-    Mat4 ps;
-    if (m_parent != nullptr)
+    if (m_localCacheVersion != m_localVersion)
     {
-      if (!m_dirty)
-      {
-        return m_parentCache;
-      }
+      m_localCache = ComputeLocalTransform();
+      m_localCacheVersion = m_localVersion;
+    }
 
-      ps = m_parent->GetTransform(TransformationSpace::TS_WORLD);
+    return m_localCache;
+  }
 
-      if (m_inheritOnlyTranslate)
-      {
-        Vec3 t = ps[3];
-        ps = glm::translate(Mat4(), t);
-      }
-      else if (!m_inheritScale)
+  const Mat4& Node::GetParentTransform()
+  {
+    GetWorldTransform();
+    return m_parentCache;
+  }
+
+  const Mat4& Node::GetWorldTransform()
+  {
+    // A change during the walk bumps the epoch past this one, the next call validates again.
+    uint epoch = m_epoch.load();
+    if (m_validatedEpoch == epoch)
+    {
+      return m_worldCache;
+    }
+
+    uint parentVersion = 0;
+    if (m_parent != nullptr)
+    {
+      m_parent->GetWorldTransform();
+      parentVersion = m_parent->m_worldVersion;
+    }
+
+    if (m_worldLocalVersion != m_localVersion || m_worldParentVersion != parentVersion)
+    {
+      m_parentCache = Mat4();
+      if (m_parent != nullptr)
       {
-        for (int i = 0; i < 3; i++)
+        m_parentCache = m_parent->m_worldCache;
+        if (m_inheritOnlyTranslate)
+        {
+          Vec3 t = m_parentCache[3];
+          m_parentCache = glm::translate(Mat4(), t);
+        }
+        else if (!m_inheritScale)
         {
-          Vec3 v = ps[i];
-          ps[i].xyz = glm::normalize(v);
+          for (int i = 0; i < 3; i++)
+          {
+            Vec3 v = m_parentCache[i];
+            m_parentCache[i].xyz = glm::normalize(v);
+          }
         }
       }
 
-      m_parentCache = ps;
+      m_worldCache = m_parentCache * GetLocalTransform();
+      m_worldLocalVersion = m_localVersion;
+      m_worldParentVersion = parentVersion;
+      m_worldVersion++;
+    }
+
+    m_validatedEpoch = epoch;
+    return m_worldCache;
+  }
+
+  uint Node::GetWorldVersion()
+  {
+    GetWorldTransform();
+    return m_worldVersion;
+  }
+
+  uint Node::GetEpoch()
+  {
+    return m_epoch;
+  }
+
+  void Node::Watch(const NodeChangeListPtr& changes)
+  {
+    // Descendants of a watched node watch the same list, AddChild keeps it so.
+    if (m_changes == changes)
+    {
+      return;
     }
 
-    m_dirty = false;
-    return ps;
+    m_changes = changes;
+    for (Node* child : m_children)
+    {
+      child->Watch(changes);
+    }
   }
 
-  void Node::SetChildrenDirty()
+  void Node::SetLocalDirty()
   {
-    for (Node* c : m_children)
+    m_localVersion++;
+    if (m_transformSystem != nullptr)
+    {
+      m_transformSystem->Sync(this);
+    }
+
+    if (m_changes != nullptr)
+    {
+      m_changes->Add(this);
+    }
+
+    // Zero is the initial validated epoch of new nodes.
+    if (++m_epoch == 0)
     {
-      c->m_dirty = true;
-      c->SetChildrenDirty();
+      m_epoch = 1;
     }
   }
 
-}
+}
\ No newline at end of file
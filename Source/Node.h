@@ -1,10 +1,34 @@
 #pragma once
 
 #include "ToolKit.h"
+#include "ObjectPool.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
 
 namespace ToolKit
 {
 
+  class TransformSystem;
+  class Node;
+
+  // Nodes whose local transform, parent or inheritance changed since the owner last took them. Nodes of a watched
+  // hierarchy add themselves on the thread that changes them. They share the list, it outlives its owner if they do.
+  class NodeChangeList
+  {
+  public:
+    void Add(Node* node);
+    void Remove(Node* node); // Called by the Node destructor.
+    void Take(std::vector<Node*>& nodes); // Empties the list.
+
+  private:
+    std::mutex m_lock;
+    std::unordered_set<Node*> m_nodes;
+  };
+
+  typedef std::shared_ptr<NodeChangeList> NodeChangeListPtr;
+
   enum class TransformationSpace
   {
     TS_WORLD,
@@ -15,12 +39,20 @@ namespace ToolKit
   class Node
   {
     friend class Animation;
+    friend class AnimationBenchmark;
     friend class Skeleton;
+    friend class FramePipeline;
+    friend class PrefabInstance;
+    friend class TransformSystem;
+    friend class TransformBenchmark;
 
   public:
     Node();
     ~Node();
 
+    TK_POOLED_CLASS(GetPool)
+    static ObjectPool& GetPool(); // Uses arenas.
+
     void Translate(const Vec3& val, TransformationSpace space = TransformationSpace::TS_PARENT);
     void Rotate(const Quaternion& val, TransformationSpace space = TransformationSpace::TS_PARENT);
     void Scale(const Vec3& val);
@@ -42,14 +74,19 @@ namespace ToolKit
     void Serialize(XmlDocument* doc, XmlNode* parent) const;
     void DeSerialize(XmlDocument* doc, XmlNode* parent);
     void SetInheritScaleDeep(bool val);
+    uint GetWorldVersion(); // Changes whenever the world transform does.
+    static uint GetEpoch(); // Changes whenever any node's transform does.
+    void Watch(const NodeChangeListPtr& changes); // The node and its descendants, nodes attached later join through AddChild.
 
   private:
     void TransformImp(const Mat4& val, TransformationSpace space, Vec3* translation, Quaternion* orientation, Vec3* scale);
     void SetTransformImp(const Mat4& val, TransformationSpace space, Vec3* translation, Quaternion* orientation, Vec3* scale);
     void GetTransformImp(TransformationSpace space, Mat4* transform, Vec3* translation, Quaternion* orientation, Vec3* scale);
-    Mat4 GetLocalTransform() const;
-    Mat4 GetParentTransform();
-    void SetChildrenDirty();
+    Mat4 ComputeLocalTransform() const;
+    const Mat4& GetLocalTransform();
+    const Mat4& GetParentTransform();
+    const Mat4& GetWorldTransform();
+    void SetLocalDirty(); // Call after changing the translation, orientation, scale, parent or inheritance.
 
   public:
     NodeId m_id;
@@ -65,8 +102,29 @@ namespace ToolKit
     Vec3 m_scale = Vec3(1.0f);
     static NodeId m_nextId;
 
+    // Caches are validated against version counters instead of being invalidated down the hierarchy. A change bumps
+    // the node's local version and the global epoch. World queries return the cache right away while the epoch is
+    // unchanged, otherwise they compare the versions up to the root and recompute only what actually changed.
+    static std::atomic<uint> m_epoch; // Nodes of different hierarchies can be changed on different threads.
+    uint m_localVersion = 1;
+    uint m_worldVersion = 0; // Bumped when the world cache is recomputed, children compare against it.
+
+    Mat4 m_localCache;
+    uint m_localCacheVersion = 0;
+
     Mat4 m_parentCache;
-    bool m_dirty = true; // Hint for child to update its parent cache.
+    Mat4 m_worldCache;
+    uint m_worldLocalVersion = 0; // Local version the world cache is computed with.
+    uint m_worldParentVersion = 0; // Parent's world version the world cache is computed with.
+    uint m_validatedEpoch = 0;
+
+    Quaternion m_worldOrientation;
+    Vec3 m_worldScale;
+    uint m_decomposedVersion = 0; // World version of the decomposed orientation and scale.
+
+    TransformSystem* m_transformSystem = nullptr; // Set while the node is mirrored in a TransformSystem.
+    uint m_transformHandle = 0;
+    NodeChangeListPtr m_changes; // Set while the node is watched.
   };
 
 }
\ No newline at end of file
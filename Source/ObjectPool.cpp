@@ -0,0 +1,457 @@
+#include "stdafx.h"
+#include "ObjectPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  struct PoolBlock
+  {
+    PoolSource* source; // Null while the block is free.
+    uint size; // Header included.
+#ifdef _DEBUG
+    const char* file;
+    int line;
+#endif
+  };
+
+  static const size_t HeaderSize = (sizeof(PoolBlock) + 15) & ~(size_t)15;
+  static const size_t Granularity = 16;
+  static const size_t ClassCount = 64; // Blocks up to 1 KB.
+  static const size_t SlabSize = 64 * 1024;
+
+  static thread_local PoolArena* g_currentArena = nullptr;
+
+  static void* PayloadOf(PoolBlock* block)
+  {
+    return (char*)block + HeaderSize;
+  }
+
+  static void Stamp(PoolBlock* block, PoolSource* source, size_t size, [[maybe_unused]] const char* file, [[maybe_unused]] int line)
+  {
+    block->source = source;
+    block->size = (uint)size;
+#ifdef _DEBUG
+    block->file = file;
+    block->line = line;
+#endif
+  }
+
+  // Alive pools and arenas, for the statistics.
+  struct PoolRegistry
+  {
+    std::mutex mutex;
+    std::vector<ObjectPool*> pools;
+    std::vector<PoolArena*> arenas;
+  };
+
+  static PoolRegistry& GetRegistry()
+  {
+    static PoolRegistry registry;
+    return registry;
+  }
+
+  template<typename T>
+  static void Unregister(std::vector<T*>& list, T* entry)
+  {
+    list.erase(std::find(list.begin(), list.end(), entry));
+  }
+
+  // Blocks of a single size, or heap blocks of any size when the block size is 0. Used with the pool locked.
+  class PoolSizeClass : public PoolSource
+  {
+  public:
+    PoolSizeClass(ObjectPool* pool, size_t blockSize)
+      : m_pool(pool), m_blockSize(blockSize)
+    {
+    }
+
+    ~PoolSizeClass()
+    {
+      for (char* slab : m_slabs)
+      {
+        std::free(slab);
+      }
+    }
+
+    PoolBlock* Take(size_t size)
+    {
+      PoolBlock* block = nullptr;
+      if (m_blockSize == 0)
+      {
+        block = (PoolBlock*)std::malloc(size);
+      }
+      else
+      {
+        if (m_free == nullptr)
+        {
+          Grow();
+        }
+
+        block = m_free;
+        m_free = *(PoolBlock**)PayloadOf(block);
+      }
+
+      m_used += size;
+      m_live++;
+      return block;
+    }
+
+    void Reclaim(PoolBlock* block) override
+    {
+      if (m_pool == nullptr)
+      {
+        ReclaimOrphaned(block);
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+      m_pool->m_live--;
+      m_live--;
+      m_used -= block->size;
+      if (m_blockSize == 0)
+      {
+        std::free(block);
+        return;
+      }
+
+      block->source = nullptr;
+      *(PoolBlock**)PayloadOf(block) = m_free;
+      m_free = block;
+    }
+
+    uint GetLive() const
+    {
+      return m_live;
+    }
+
+    // Called by the destructor of a pool whose blocks outlive it, such as a static pool at exit. The blocks come back
+    // without a pool to lock then, the class deletes itself along with the last of them.
+    void Orphan()
+    {
+      m_pool = nullptr;
+      m_orphaned = m_live;
+    }
+
+    void AddStats(PoolStats& stats) const
+    {
+      stats.slabs += (uint)m_slabs.size();
+      stats.reserved += m_blockSize == 0 ? m_used : m_slabs.size() * SlabSize;
+      stats.used += m_used;
+    }
+
+#ifdef _DEBUG
+    void ReportLeaks(const String& name) const
+    {
+      size_t count = SlabSize / m_blockSize;
+      for (char* slab : m_slabs)
+      {
+        for (size_t i = 0; i < count; i++)
+        {
+          PoolBlock* block = (PoolBlock*)(slab + i * m_blockSize);
+          if (block->source != nullptr)
+          {
+            _RPT4(_CRT_WARN, "%s(%d) : %s pool leaked a %d byte block.\n", block->file ? block->file : "?", block->line, name.c_str(), (int)m_blockSize);
+          }
+        }
+      }
+    }
+#endif
+
+  private:
+    void ReclaimOrphaned(PoolBlock* block)
+    {
+      block->source = nullptr;
+      if (m_blockSize == 0)
+      {
+        std::free(block);
+      }
+
+      if (--m_orphaned == 0)
+      {
+        delete this;
+      }
+    }
+
+    void Grow()
+    {
+      char* slab = (char*)std::malloc(SlabSize);
+      m_slabs.push_back(slab);
+
+      // Linked backwards, so the blocks are handed out in address order.
+      size_t count = SlabSize / m_blockSize;
+      for (size_t i = count; i > 0; i--)
+      {
+        PoolBlock* block = (PoolBlock*)(slab + (i - 1) * m_blockSize);
+        block->source = nullptr;
+        *(PoolBlock**)PayloadOf(block) = m_free;
+        m_free = block;
+      }
+    }
+
+  private:
+    ObjectPool* m_pool;
+    size_t m_blockSize;
+    std::vector<char*> m_slabs;
+    PoolBlock* m_free = nullptr;
+    size_t m_used = 0;
+    uint m_live = 0;
+    std::atomic<uint> m_orphaned { 0 }; // Blocks still out once the pool is gone.
+  };
+
+  ObjectPool::ObjectPool(const String& name, bool useArena)
+    : m_name(name), m_useArena(useArena), m_classes(ClassCount + 1, nullptr)
+  {
+    PoolRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.pools.push_back(this);
+  }
+
+  ObjectPool::~ObjectPool()
+  {
+    {
+      PoolRegistry& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      Unregister(registry.pools, this);
+    }
+
+#ifdef _DEBUG
+    if (m_live > 0)
+    {
+      for (size_t i = 0; i < ClassCount; i++)
+      {
+        if (m_classes[i] != nullptr)
+        {
+          m_classes[i]->ReportLeaks(m_name);
+        }
+      }
+    }
+#endif
+
+    // Blocks still alive point to their size classes, those are left behind until the blocks are freed.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (PoolSizeClass*& sizeClass : m_classes)
+    {
+      if (sizeClass != nullptr && sizeClass->GetLive() > 0)
+      {
+        sizeClass->Orphan();
+        sizeClass = nullptr;
+      }
+      else
+      {
+        SafeDel(sizeClass);
+      }
+    }
+  }
+
+  void* ObjectPool::Allocate(size_t size, const char* file, int line)
+  {
+    if (m_useArena && g_currentArena != nullptr)
+    {
+      return g_currentArena->Allocate(size, file, line);
+    }
+
+    size_t blockSize = (HeaderSize + size + Granularity - 1) / Granularity * Granularity;
+    size_t index = glm::min(blockSize / Granularity - 1, ClassCount);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PoolSizeClass*& sizeClass = m_classes[index];
+    if (sizeClass == nullptr)
+    {
+      sizeClass = new PoolSizeClass(this, index < ClassCount ? blockSize : 0);
+    }
+
+    PoolBlock* block = sizeClass->Take(blockSize);
+    Stamp(block, sizeClass, blockSize, file, line);
+
+    m_live++;
+    m_peak = glm::max(m_peak, m_live);
+    m_allocations++;
+    return PayloadOf(block);
+  }
+
+  void ObjectPool::Free(void* ptr)
+  {
+    if (ptr == nullptr)
+    {
+      return;
+    }
+
+    PoolBlock* block = (PoolBlock*)((char*)ptr - HeaderSize);
+    assert(block->source != nullptr && "Block is already freed.");
+    block->source->Reclaim(block);
+  }
+
+  PoolStats ObjectPool::GetStats() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    PoolStats stats;
+    stats.name = m_name;
+    stats.live = m_live;
+    stats.peak = m_peak;
+    stats.allocations = m_allocations;
+    for (PoolSizeClass* sizeClass : m_classes)
+    {
+      if (sizeClass != nullptr)
+      {
+        sizeClass->AddStats(stats);
+      }
+    }
+
+    return stats;
+  }
+
+  void ObjectPool::GetAllStats(std::vector<PoolStats>& stats)
+  {
+    PoolRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (ObjectPool* pool : registry.pools)
+    {
+      stats.push_back(pool->GetStats());
+    }
+
+    for (PoolArena* arena : registry.arenas)
+    {
+      stats.push_back(arena->GetStats());
+    }
+  }
+
+  PoolArena* PoolArena::Create(const String& name)
+  {
+    return new PoolArena(name);
+  }
+
+  PoolArena::PoolArena(const String& name)
+    : m_name(name)
+  {
+    PoolRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.arenas.push_back(this);
+  }
+
+  PoolArena::~PoolArena()
+  {
+    {
+      PoolRegistry& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      Unregister(registry.arenas, this);
+    }
+
+    for (const auto& slab : m_slabs)
+    {
+      std::free(slab.first);
+    }
+  }
+
+  void PoolArena::Release()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_released = true;
+    if (m_live == 0)
+    {
+      lock.unlock();
+      delete this;
+    }
+  }
+
+  void* PoolArena::Allocate(size_t size, const char* file, int line)
+  {
+    size_t blockSize = (HeaderSize + size + Granularity - 1) / Granularity * Granularity;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(!m_released);
+
+    // Skip to a slab with room, blocks larger than a slab get one of their own.
+    while (m_current < m_slabs.size() && m_offset + blockSize > m_slabs[m_current].second)
+    {
+      m_current++;
+      m_offset = 0;
+    }
+
+    if (m_current == m_slabs.size())
+    {
+      size_t slabSize = glm::max(SlabSize, blockSize);
+      m_slabs.push_back({ (char*)std::malloc(slabSize), slabSize });
+    }
+
+    PoolBlock* block = (PoolBlock*)(m_slabs[m_current].first + m_offset);
+    m_offset += blockSize;
+    Stamp(block, this, blockSize, file, line);
+
+    m_live++;
+    m_peak = glm::max(m_peak, m_live);
+    m_allocations++;
+    m_used += blockSize;
+    return PayloadOf(block);
+  }
+
+  PoolStats PoolArena::GetStats() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    PoolStats stats;
+    stats.name = m_name;
+    stats.live = m_live;
+    stats.peak = m_peak;
+    stats.allocations = m_allocations;
+    stats.slabs = (uint)m_slabs.size();
+    for (const auto& slab : m_slabs)
+    {
+      stats.reserved += slab.second;
+    }
+    stats.used = m_used;
+
+    return stats;
+  }
+
+  void PoolArena::Reclaim(PoolBlock* block)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_live--;
+    m_used -= block->size;
+    block->source = nullptr;
+    if (m_live > 0)
+    {
+      return;
+    }
+
+    if (m_released)
+    {
+      lock.unlock();
+      delete this;
+      return;
+    }
+
+    Rewind();
+  }
+
+  void PoolArena::Rewind()
+  {
+    // Keeps the first slab for the next batch of allocations.
+    size_t keep = !m_slabs.empty() && m_slabs[0].second == SlabSize ? 1 : 0;
+    for (size_t i = keep; i < m_slabs.size(); i++)
+    {
+      std::free(m_slabs[i].first);
+    }
+
+    m_slabs.resize(keep);
+    m_current = 0;
+    m_offset = 0;
+  }
+
+  PoolArena::Scope::Scope(PoolArena* arena)
+  {
+    m_previous = g_currentArena;
+    g_currentArena = arena;
+  }
+
+  PoolArena::Scope::~Scope()
+  {
+    g_currentArena = m_previous;
+  }
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Types.h"
+#include <cstdint>
+#include <mutex>
+
+// Routes the allocations of a class and its subclasses to the pool returned by PoolFn. Also declares the placement form
+// DebugNew.h expands new to, headers using it must be included before DebugNew.h. std::make_shared bypasses class
+// allocators, create pooled objects with new.
+#define TK_POOLED_CLASS(PoolFn) \
+  static void* operator new(size_t size) { return PoolFn().Allocate(size); } \
+  static void* operator new(size_t size, int, const char* file, int line) { return PoolFn().Allocate(size, file, line); } \
+  static void operator delete(void* ptr) { ToolKit::ObjectPool::Free(ptr); } \
+  static void operator delete(void* ptr, int, const char*, int) { ToolKit::ObjectPool::Free(ptr); }
+
+namespace ToolKit
+{
+
+  struct PoolStats
+  {
+    String name;
+    uint live = 0; // Blocks in use.
+    uint peak = 0;
+    uint64_t allocations = 0; // In total.
+    uint slabs = 0;
+    size_t reserved = 0; // Bytes taken from the heap.
+    size_t used = 0; // Bytes of the live blocks, headers included.
+  };
+
+  // Where a block goes back to when it is freed.
+  class PoolSource
+  {
+  public:
+    virtual ~PoolSource() {}
+    virtual void Reclaim(struct PoolBlock* block) = 0;
+  };
+
+  // Hands out blocks of any size from slabs, one set of slabs per 16 byte size class. Freed blocks are kept in a list
+  // per class and reused before a new slab is taken, so objects of a kind stay packed and the heap is not touched in
+  // steady state. Blocks larger than the largest class come from the heap. Each block starts with a small header
+  // pointing to its source, so Free only needs the pointer. In debug builds the header also keeps the allocation site
+  // and the blocks still alive when the pool goes away are reported like the crt leak dump does.
+  class ObjectPool
+  {
+  public:
+    ObjectPool(const String& name, bool useArena = false); // With useArena, the current arena of the thread is used when there is one.
+    ~ObjectPool();
+
+    void* Allocate(size_t size, const char* file = nullptr, int line = 0);
+    static void Free(void* ptr);
+    PoolStats GetStats() const;
+    static void GetAllStats(std::vector<PoolStats>& stats); // Of every pool and arena alive.
+
+  private:
+    friend class PoolSizeClass;
+
+    String m_name;
+    bool m_useArena;
+    mutable std::mutex m_mutex;
+    std::vector<class PoolSizeClass*> m_classes; // Created on first use, the last one is for the heap blocks.
+    uint m_live = 0;
+    uint m_peak = 0;
+    uint64_t m_allocations = 0;
+  };
+
+  // Bump allocator for objects that go away together, such as the entities of a loaded scene. Blocks freed one by one
+  // are not reused, instead the arena rewinds to its first slab once all of them are freed. The owner releases the
+  // arena when it is done, objects still alive stay valid and the arena is deleted along with the last one.
+  class PoolArena : public PoolSource
+  {
+  public:
+    static PoolArena* Create(const String& name);
+    void Release();
+    void* Allocate(size_t size, const char* file, int line);
+    PoolStats GetStats() const;
+    void Reclaim(PoolBlock* block) override;
+
+    // While in scope, allocations of the pools using arenas on this thread come from the arena.
+    class Scope
+    {
+    public:
+      Scope(PoolArena* arena);
+      ~Scope();
+
+    private:
+      PoolArena* m_previous;
+    };
+
+  private:
+    PoolArena(const String& name);
+    ~PoolArena();
+    void Rewind();
+
+  private:
+    String m_name;
+    mutable std::mutex m_mutex;
+    std::vector<std::pair<char*, size_t>> m_slabs;
+    size_t m_current = 0; // Slab bumped from.
+    size_t m_offset = 0;
+    bool m_released = false;
+    uint m_live = 0;
+    uint m_peak = 0;
+    uint64_t m_allocations = 0;
+    size_t m_used = 0;
+  };
+
+}
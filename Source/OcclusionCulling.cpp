@@ -0,0 +1,475 @@
+#include "stdafx.h"
+#include "OcclusionCulling.h"
+#include "Drawable.h"
+#include "Mesh.h"
+#include "Node.h"
+#include "Directional.h"
+#include "ToolKit.h"
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TK_OCCLUSION_SIMD
+#include <emmintrin.h>
+#endif
+
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  OcclusionCuller::OcclusionCuller()
+  {
+    Resize(256, 128);
+  }
+
+  OcclusionCuller::~OcclusionCuller()
+  {
+  }
+
+  void OcclusionCuller::Resize(uint width, uint height)
+  {
+    m_width = glm::max(4u, (width + 3) & ~3u);
+    m_height = glm::max(1u, height);
+    m_depth.assign(m_width * m_height, 1.0f);
+
+    m_levels.clear();
+    uint w = m_width, h = m_height;
+    while (true)
+    {
+      Level level;
+      level.width = w;
+      level.height = h;
+      level.minDepth.assign(w * h, 1.0f);
+      level.maxDepth.assign(w * h, 1.0f);
+      m_levels.push_back(level);
+
+      if (w == 1 && h == 1)
+      {
+        break;
+      }
+
+      w = (w + 1) / 2;
+      h = (h + 1) / 2;
+    }
+  }
+
+  void OcclusionCuller::Begin(const Mat4& projectView)
+  {
+    m_projectView = projectView;
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+    m_triangles.clear();
+    m_stats = Stats();
+  }
+
+  void OcclusionCuller::Begin(Camera* cam)
+  {
+    Begin(cam->GetData().projection * cam->GetViewMatrix());
+  }
+
+  void OcclusionCuller::AddOccluder(Drawable* occluder)
+  {
+    MeshRawPtrArray meshes;
+    occluder->m_mesh->GetAllMeshes(meshes);
+
+    MeshRawPtrArray sources = meshes;
+    bool flushed = false;
+    for (Mesh* mesh : meshes)
+    {
+      flushed |= mesh->m_vertexCount > 0 && mesh->m_clientSideVertices.empty();
+    }
+
+    // Client side arrays are gone after the upload, geometry is read from the file once and kept for the next frames.
+    if (flushed)
+    {
+      const String& file = occluder->m_mesh->m_file;
+      MeshPtr cached;
+      if (!file.empty())
+      {
+        auto entry = m_sourceCache.find(file);
+        if (entry == m_sourceCache.end())
+        {
+          cached = MeshPtr(new Mesh(file));
+          cached->Load();
+          m_sourceCache[file] = cached;
+        }
+        else
+        {
+          cached = entry->second;
+        }
+
+        sources.clear();
+        cached->GetAllMeshes(sources);
+      }
+
+      if (file.empty() || sources.size() != meshes.size())
+      {
+        if (m_skipped.insert(occluder->m_mesh.get()).second)
+        {
+          Logger::GetInstance()->Log("Occlusion culling: no client side geometry for occluder " + occluder->m_name + ", skipped.");
+        }
+        return;
+      }
+    }
+
+    Mat4 transform = occluder->m_node->GetTransform(TransformationSpace::TS_WORLD);
+    std::vector<Vec3> positions;
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+      if (meshes[m]->m_material->GetRenderState()->drawType != DrawType::Triangle)
+      {
+        continue;
+      }
+
+      Mesh* mesh = sources[m];
+      positions.resize(mesh->m_clientSideVertices.size());
+      for (size_t i = 0; i < positions.size(); i++)
+      {
+        positions[i] = mesh->m_clientSideVertices[i].pos;
+      }
+
+      const std::vector<uint>& indices = mesh->m_clientSideIndices;
+      uint count = indices.empty() ? (uint)positions.size() : (uint)indices.size();
+      AddOccluder(positions.data(), indices.empty() ? nullptr : indices.data(), count, transform);
+    }
+
+    m_stats.occluders++;
+  }
+
+  void OcclusionCuller::AddOccluder(const Vec3* positions, const uint* indices, uint indexCount, const Mat4& transform)
+  {
+    Mat4 mvp = m_projectView * transform;
+    for (uint i = 0; i + 2 < indexCount; i += 3)
+    {
+      ScreenTriangle tri;
+      bool valid = true;
+      for (uint j = 0; j < 3; j++)
+      {
+        const Vec3& p = positions[indices ? indices[i + j] : i + j];
+        Vec4 clip = mvp * Vec4(p, 1.0f);
+
+        // Triangles crossing the near plane are dropped. Not occluding is always safe.
+        if (clip.w <= 1e-5f)
+        {
+          valid = false;
+          break;
+        }
+
+        Vec3 ndc = Vec3(clip) / clip.w;
+        if (ndc.z < -1.0f)
+        {
+          valid = false;
+          break;
+        }
+
+        tri.v[j] = Vec3
+        (
+          (ndc.x * 0.5f + 0.5f) * m_width,
+          (ndc.y * 0.5f + 0.5f) * m_height,
+          ndc.z * 0.5f + 0.5f
+        );
+      }
+
+      if (!valid)
+      {
+        continue;
+      }
+
+      tri.minY = glm::min(tri.v[0].y, glm::min(tri.v[1].y, tri.v[2].y));
+      tri.maxY = glm::max(tri.v[0].y, glm::max(tri.v[1].y, tri.v[2].y));
+      if (tri.maxY < 0.0f || tri.minY > (float)m_height)
+      {
+        continue;
+      }
+
+      m_triangles.push_back(tri);
+      m_stats.occluderTriangles++;
+    }
+  }
+
+  void OcclusionCuller::Rasterize()
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    uint bandCount = (m_height + m_bandHeight - 1) / m_bandHeight;
+    auto RasterizeBandsFn = [this](uint begin, uint end) -> void
+    {
+      for (uint band = begin; band < end; band++)
+      {
+        RasterizeBand(band);
+      }
+    };
+
+    if (m_parallel)
+    {
+      GetJobSystem()->ParallelFor(bandCount, RasterizeBandsFn, 1, "RasterizeOccluders");
+    }
+    else
+    {
+      RasterizeBandsFn(0, bandCount);
+    }
+
+    BuildHierarchy();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.rasterizeMs = std::chrono::duration<float, std::milli>(end - start).count();
+  }
+
+  void OcclusionCuller::RasterizeBand(uint band)
+  {
+    int bandMinY = (int)(band * m_bandHeight);
+    int bandMaxY = glm::min((int)m_height, bandMinY + (int)m_bandHeight) - 1;
+
+    for (const ScreenTriangle& tri : m_triangles)
+    {
+      if (tri.maxY < (float)bandMinY || tri.minY > (float)(bandMaxY + 1))
+      {
+        continue;
+      }
+
+      Vec3 v0 = tri.v[0], v1 = tri.v[1], v2 = tri.v[2];
+      float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+      if (area == 0.0f)
+      {
+        continue;
+      }
+
+      // Both windings are rasterized, make the interior positive.
+      if (area < 0.0f)
+      {
+        std::swap(v1, v2);
+        area = -area;
+      }
+
+      // Edge functions E(x, y) = a * x + b * y + c.
+      Vec3 v[3] = { v0, v1, v2 };
+      float a[3], b[3], c[3];
+      for (int i = 0; i < 3; i++)
+      {
+        const Vec3& p = v[i];
+        const Vec3& q = v[(i + 1) % 3];
+        a[i] = p.y - q.y;
+        b[i] = q.x - p.x;
+        c[i] = p.x * q.y - p.y * q.x;
+      }
+
+      // Depth plane z = zx * x + zy * y + zc.
+      float zx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+      float zy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+      float zc = v0.z - zx * v0.x - zy * v0.y;
+
+      float minX = glm::min(v0.x, glm::min(v1.x, v2.x));
+      float maxX = glm::max(v0.x, glm::max(v1.x, v2.x));
+      int x0 = glm::max(0, (int)glm::floor(minX)) & ~3;
+      int x1 = glm::min((int)m_width - 1, (int)glm::ceil(maxX));
+      int y0 = glm::max(bandMinY, (int)glm::floor(tri.minY));
+      int y1 = glm::min(bandMaxY, (int)glm::ceil(tri.maxY));
+
+      for (int y = y0; y <= y1; y++)
+      {
+        float py = y + 0.5f;
+        float* row = &m_depth[y * m_width];
+
+#ifdef TK_OCCLUSION_SIMD
+        __m128 zero = _mm_setzero_ps();
+        __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 a0 = _mm_set1_ps(a[0]), a1 = _mm_set1_ps(a[1]), a2 = _mm_set1_ps(a[2]);
+        __m128 r0 = _mm_set1_ps(b[0] * py + c[0]);
+        __m128 r1 = _mm_set1_ps(b[1] * py + c[1]);
+        __m128 r2 = _mm_set1_ps(b[2] * py + c[2]);
+        __m128 zxv = _mm_set1_ps(zx);
+        __m128 zr = _mm_set1_ps(zy * py + zc);
+
+        for (int x = x0; x <= x1; x += 4)
+        {
+          __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+          __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+          __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+          __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+          __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+          if (_mm_movemask_ps(inside) == 0)
+          {
+            continue;
+          }
+
+          __m128 z = _mm_add_ps(_mm_mul_ps(zxv, px), zr);
+          __m128 old = _mm_loadu_ps(row + x);
+          __m128 closer = _mm_min_ps(old, z);
+          _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+        }
+#else
+        for (int x = x0; x <= x1; x++)
+        {
+          float px = x + 0.5f;
+          if
+          (
+            a[0] * px + b[0] * py + c[0] >= 0.0f &&
+            a[1] * px + b[1] * py + c[1] >= 0.0f &&
+            a[2] * px + b[2] * py + c[2] >= 0.0f
+          )
+          {
+            row[x] = glm::min(row[x], zx * px + zy * py + zc);
+          }
+        }
+#endif
+      }
+    }
+  }
+
+  void OcclusionCuller::BuildHierarchy()
+  {
+    Level& base = m_levels[0];
+    base.minDepth = m_depth;
+    base.maxDepth = m_depth;
+
+    for (size_t l = 1; l < m_levels.size(); l++)
+    {
+      const Level& fine = m_levels[l - 1];
+      Level& coarse = m_levels[l];
+      for (uint y = 0; y < coarse.height; y++)
+      {
+        for (uint x = 0; x < coarse.width; x++)
+        {
+          float minDepth = 1.0f;
+          float maxDepth = 0.0f;
+          for (uint cy = y * 2; cy < glm::min(y * 2 + 2, fine.height); cy++)
+          {
+            for (uint cx = x * 2; cx < glm::min(x * 2 + 2, fine.width); cx++)
+            {
+              minDepth = glm::min(minDepth, fine.minDepth[cy * fine.width + cx]);
+              maxDepth = glm::max(maxDepth, fine.maxDepth[cy * fine.width + cx]);
+            }
+          }
+
+          coarse.minDepth[y * coarse.width + x] = minDepth;
+          coarse.maxDepth[y * coarse.width + x] = maxDepth;
+        }
+      }
+    }
+  }
+
+  bool OcclusionCuller::IsVisible(const BoundingBox& worldBox)
+  {
+    m_stats.tested++;
+
+    Vec3 minNdc(FLT_MAX);
+    Vec3 maxNdc(-FLT_MAX);
+    for (int i = 0; i < 8; i++)
+    {
+      Vec3 corner
+      (
+        (i & 1) ? worldBox.max.x : worldBox.min.x,
+        (i & 2) ? worldBox.max.y : worldBox.min.y,
+        (i & 4) ? worldBox.max.z : worldBox.min.z
+      );
+
+      Vec4 clip = m_projectView * Vec4(corner, 1.0f);
+      if (clip.w <= 1e-5f)
+      {
+        return true; // Crosses the near plane.
+      }
+
+      Vec3 ndc = Vec3(clip) / clip.w;
+      minNdc = glm::min(minNdc, ndc);
+      maxNdc = glm::max(maxNdc, ndc);
+    }
+
+    float depth = minNdc.z * 0.5f + 0.5f;
+    if (depth < 0.0f)
+    {
+      return true;
+    }
+
+    int x0 = (int)glm::floor((minNdc.x * 0.5f + 0.5f) * m_width);
+    int x1 = (int)glm::floor((maxNdc.x * 0.5f + 0.5f) * m_width);
+    int y0 = (int)glm::floor((minNdc.y * 0.5f + 0.5f) * m_height);
+    int y1 = (int)glm::floor((maxNdc.y * 0.5f + 0.5f) * m_height);
+
+    x0 = glm::max(x0, 0);
+    y0 = glm::max(y0, 0);
+    x1 = glm::min(x1, (int)m_width - 1);
+    y1 = glm::min(y1, (int)m_height - 1);
+    if (x0 > x1 || y0 > y1)
+    {
+      return true; // Off screen, left to the frustum test.
+    }
+
+    // Start from the level where the rectangle spans a few cells.
+    uint level = 0;
+    while
+    (
+      level + 1 < m_levels.size() &&
+      ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3)
+    )
+    {
+      level++;
+    }
+
+    for (int cy = y0 >> level; cy <= (y1 >> level); cy++)
+    {
+      for (int cx = x0 >> level; cx <= (x1 >> level); cx++)
+      {
+        if (TestCell(level, cx, cy, x0, y0, x1, y1, depth))
+        {
+          return true;
+        }
+      }
+    }
+
+    m_stats.culled++;
+    return false;
+  }
+
+  bool OcclusionCuller::TestCell(uint level, int cx, int cy, int x0, int y0, int x1, int y1, float depth) const
+  {
+    const Level& l = m_levels[level];
+    uint index = cy * l.width + cx;
+
+    // In front of every occluder sample in the cell.
+    if (depth <= l.minDepth[index])
+    {
+      return true;
+    }
+
+    // Behind every occluder sample in the cell.
+    if (depth > l.maxDepth[index])
+    {
+      return false;
+    }
+
+    if (level == 0)
+    {
+      return true;
+    }
+
+    uint child = level - 1;
+    const Level& fine = m_levels[child];
+    for (int y = glm::max(cy * 2, y0 >> child); y <= glm::min(cy * 2 + 1, y1 >> child); y++)
+    {
+      for (int x = glm::max(cx * 2, x0 >> child); x <= glm::min(cx * 2 + 1, x1 >> child); x++)
+      {
+        if (x < (int)fine.width && y < (int)fine.height && TestCell(child, x, y, x0, y0, x1, y1, depth))
+        {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  uint OcclusionCuller::GetWidth() const
+  {
+    return m_width;
+  }
+
+  uint OcclusionCuller::GetHeight() const
+  {
+    return m_height;
+  }
+
+  const std::vector<float>& OcclusionCuller::GetDepthBuffer() const
+  {
+    return m_depth;
+  }
+
+}
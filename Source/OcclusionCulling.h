@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Types.h"
+#include "MathUtil.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ToolKit
+{
+
+  class Drawable;
+  class Camera;
+  class Mesh;
+
+  // Software occlusion culling. Occluder triangles are rasterized into a small depth buffer, split into horizontal bands
+  // that are filled in parallel. A min / max depth hierarchy built over the buffer is used to test bounding boxes.
+  // Everything is on the cpu, no gl calls are made.
+  class OcclusionCuller
+  {
+  public:
+    struct Stats
+    {
+      uint occluders = 0;
+      uint occluderTriangles = 0;
+      uint tested = 0;
+      uint culled = 0;
+      float rasterizeMs = 0.0f;
+    };
+
+  public:
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    void Resize(uint width, uint height); // Width is rounded up to a multiple of 4.
+    void Begin(const Mat4& projectView); // Clears the depth buffer and the occluder list.
+    void Begin(Camera* cam);
+    void AddOccluder(Drawable* occluder); // Flushed meshes are read back from their files, skipped when they have none.
+    void AddOccluder(const Vec3* positions, const uint* indices, uint indexCount, const Mat4& transform); // Triangle list. Indices are optional.
+    void Rasterize(); // Fills the depth buffer and the hierarchy.
+    bool IsVisible(const BoundingBox& worldBox); // Call after Rasterize. Conservative, returns true when in doubt.
+
+    uint GetWidth() const;
+    uint GetHeight() const;
+    const std::vector<float>& GetDepthBuffer() const; // Row major, bottom row first. 1 is the far plane.
+
+  private:
+    struct ScreenTriangle
+    {
+      Vec3 v[3]; // Pixel x, y and depth in [0, 1].
+      float minY;
+      float maxY;
+    };
+
+    void RasterizeBand(uint band);
+    void BuildHierarchy();
+    bool TestCell(uint level, int cx, int cy, int x0, int y0, int x1, int y1, float depth) const; // Pixel rectangle x0, y0 - x1, y1.
+
+  public:
+    uint m_bandHeight = 16;
+    bool m_parallel = true;
+    Stats m_stats;
+
+  private:
+    uint m_width = 0;
+    uint m_height = 0;
+    Mat4 m_projectView;
+    std::vector<float> m_depth;
+    std::vector<ScreenTriangle> m_triangles;
+
+    // Level 0 is the depth buffer resolution, each level halves the previous one.
+    struct Level
+    {
+      uint width;
+      uint height;
+      std::vector<float> minDepth;
+      std::vector<float> maxDepth;
+    };
+    std::vector<Level> m_levels;
+
+    std::unordered_map<String, MeshPtr> m_sourceCache; // Geometry of the flushed occluders by file.
+    std::unordered_set<Mesh*> m_skipped; // Occluders already warned about.
+  };
+
+}
@@ -0,0 +1,357 @@
+#include "stdafx.h"
+#include "Prefab.h"
+#include "ToolKit.h"
+#include "Drawable.h"
+#include "Node.h"
+#include "Util.h"
+#include "rapidxml.hpp"
+#include "rapidxml_utils.hpp"
+#include "rapidxml_print.hpp"
+#include <fstream>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  Prefab::Prefab()
+  {
+  }
+
+  Prefab::Prefab(String file)
+  {
+    m_file = file;
+  }
+
+  Prefab::~Prefab()
+  {
+    UnInit();
+  }
+
+  void Prefab::Load()
+  {
+    if (m_loaded)
+    {
+      return;
+    }
+
+    XmlFile file(m_file.c_str());
+    XmlDocument doc;
+    doc.parse<0>(file.data());
+
+    XmlNode* root = doc.first_node(XmlPrefabElement.c_str());
+    if (root == nullptr)
+    {
+      return;
+    }
+
+    std::unordered_map<EntityId, int> indices;
+    for (XmlNode* node = root->first_node(XmlEntityElement.c_str()); node; node = node->next_sibling(XmlEntityElement.c_str()))
+    {
+      EntityType type = (EntityType)ReadAttr<int>(node, XmlEntityTypeAttr);
+      if (type == EntityType::Entity_Prefab)
+      {
+        continue;
+      }
+
+      Entity* ntt = Entity::CreateByType(type);
+      if (ntt == nullptr)
+      {
+        continue;
+      }
+
+      ntt->DeSerialize(&doc, node);
+      indices[ntt->m_id] = (int)m_entities.size();
+      m_entities.push_back(ntt);
+    }
+
+    // Parents outside of the prefab are dropped.
+    for (Entity* ntt : m_entities)
+    {
+      auto parent = indices.find(ntt->_parentId);
+      m_parents.push_back(parent != indices.end() ? parent->second : -1);
+    }
+
+    m_loaded = true;
+  }
+
+  void Prefab::Init(bool flushClientSideArray)
+  {
+    m_initiated = true;
+  }
+
+  void Prefab::UnInit()
+  {
+    for (Entity* ntt : m_entities)
+    {
+      SafeDel(ntt);
+    }
+    m_entities.clear();
+    m_parents.clear();
+
+    m_initiated = false;
+    m_loaded = false;
+  }
+
+  bool Prefab::Save(const String& file, const EntityRawPtrArray& entities)
+  {
+    std::ofstream stream;
+    stream.open(file.c_str(), std::ios::out);
+    if (!stream.is_open())
+    {
+      return false;
+    }
+
+    XmlDocument doc;
+    XmlNode* root = doc.allocate_node(rapidxml::node_element, XmlPrefabElement.c_str());
+    doc.append_node(root);
+    for (Entity* ntt : entities)
+    {
+      assert(ntt->GetType() != EntityType::Entity_Prefab && "Prefabs can't be nested.");
+      ntt->Serialize(&doc, root);
+    }
+
+    std::string xml;
+    rapidxml::print(std::back_inserter(xml), doc, 0);
+    stream << xml;
+    stream.close();
+
+    return true;
+  }
+
+  PrefabInstance::PrefabInstance()
+  {
+  }
+
+  PrefabInstance::PrefabInstance(const PrefabPtr& prefab)
+    : m_prefab(prefab)
+  {
+  }
+
+  PrefabInstance::~PrefabInstance()
+  {
+    for (Entity* part : m_parts)
+    {
+      SafeDel(part);
+    }
+  }
+
+  EntityType PrefabInstance::GetType() const
+  {
+    return EntityType::Entity_Prefab;
+  }
+
+  PrefabInstance* PrefabInstance::GetCopy() const
+  {
+    PrefabInstance* cpy = new PrefabInstance();
+    GetCopy(cpy);
+
+    return cpy;
+  }
+
+  void PrefabInstance::GetCopy(Entity* copyTo) const
+  {
+    Entity::GetCopy(copyTo);
+    PrefabInstance* ntt = static_cast<PrefabInstance*> (copyTo);
+    ntt->m_prefab = m_prefab;
+    GetOverrides(ntt->m_overrides);
+  }
+
+  void PrefabInstance::Serialize(XmlDocument* doc, XmlNode* parent) const
+  {
+    Entity::Serialize(doc, parent);
+    if (m_prefab == nullptr)
+    {
+      return;
+    }
+
+    XmlNode* node = doc->allocate_node(rapidxml::node_element, XmlPrefabElement.c_str());
+    WriteAttr(node, doc, XmlFileAttr, m_prefab->m_file);
+    parent->last_node()->append_node(node);
+
+    std::vector<Override> overrides;
+    GetOverrides(overrides);
+    for (const Override& ovr : overrides)
+    {
+      XmlNode* ovrNode = doc->allocate_node(rapidxml::node_element, XmlPrefabOverrideElement.c_str());
+      WriteAttr(ovrNode, doc, XmlPrefabPartAttr, std::to_string(ovr.part));
+      WriteAttr(ovrNode, doc, XmlEntityNameAttr, ovr.name);
+      WriteAttr(ovrNode, doc, XmlEntityTagAttr, ovr.tag);
+      WriteAttr(ovrNode, doc, XmlEntityStaticAttr, std::to_string((int)ovr.isStatic));
+      WriteAttr(ovrNode, doc, XmlDrawableOccluderAttr, std::to_string((int)ovr.occluder));
+
+      XmlNode* tNode = doc->allocate_node(rapidxml::node_element, XmlTranslateElement.c_str());
+      WriteVec(tNode, doc, ovr.translation);
+      ovrNode->append_node(tNode);
+
+      tNode = doc->allocate_node(rapidxml::node_element, XmlRotateElement.c_str());
+      WriteVec(tNode, doc, ovr.orientation);
+      ovrNode->append_node(tNode);
+
+      tNode = doc->allocate_node(rapidxml::node_element, XmlScaleElement.c_str());
+      WriteVec(tNode, doc, ovr.scale);
+      ovrNode->append_node(tNode);
+
+      node->append_node(ovrNode);
+    }
+  }
+
+  void PrefabInstance::DeSerialize(XmlDocument* doc, XmlNode* parent)
+  {
+    Entity::DeSerialize(doc, parent);
+
+    XmlNode* node = parent->first_node(XmlPrefabElement.c_str());
+    if (node == nullptr)
+    {
+      return;
+    }
+
+    XmlAttribute* attr = node->first_attribute(XmlFileAttr.c_str());
+    m_prefab = GetPrefabManager()->Create(attr->value());
+
+    m_overrides.clear();
+    for (XmlNode* ovrNode = node->first_node(XmlPrefabOverrideElement.c_str()); ovrNode; ovrNode = ovrNode->next_sibling(XmlPrefabOverrideElement.c_str()))
+    {
+      Override ovr;
+      ovr.part = ReadAttr<uint>(ovrNode, XmlPrefabPartAttr);
+      if (ovr.part >= m_prefab->m_entities.size())
+      {
+        continue; // The prefab has changed since.
+      }
+
+      if (XmlAttribute* nameAttr = ovrNode->first_attribute(XmlEntityNameAttr.c_str()))
+      {
+        ovr.name = nameAttr->value();
+      }
+
+      if (XmlAttribute* tagAttr = ovrNode->first_attribute(XmlEntityTagAttr.c_str()))
+      {
+        ovr.tag = tagAttr->value();
+      }
+
+      ovr.isStatic = ReadAttr<int>(ovrNode, XmlEntityStaticAttr) != 0;
+      ovr.occluder = ReadAttr<int>(ovrNode, XmlDrawableOccluderAttr) != 0;
+
+      if (XmlNode* n = ovrNode->first_node(XmlTranslateElement.c_str()))
+      {
+        ReadVec(n, ovr.translation);
+      }
+
+      if (XmlNode* n = ovrNode->first_node(XmlRotateElement.c_str()))
+      {
+        ReadVec(n, ovr.orientation);
+      }
+
+      if (XmlNode* n = ovrNode->first_node(XmlScaleElement.c_str()))
+      {
+        ReadVec(n, ovr.scale);
+      }
+
+      m_overrides.push_back(ovr);
+    }
+  }
+
+  bool PrefabInstance::IsExpanded() const
+  {
+    return !m_parts.empty();
+  }
+
+  void PrefabInstance::Expand()
+  {
+    if (IsExpanded() || m_prefab == nullptr)
+    {
+      return;
+    }
+
+    // Parts get new ids, the overrides refer to them by their index in the prefab.
+    for (Entity* tmpl : m_prefab->m_entities)
+    {
+      Entity* part = Entity::CreateByType(tmpl->GetType());
+      part->m_name = tmpl->m_name;
+      part->m_tag = tmpl->m_tag;
+      part->m_static = tmpl->m_static;
+
+      Node* node = part->m_node;
+      node->m_inheritScale = tmpl->m_node->m_inheritScale;
+      node->m_inheritOnlyTranslate = tmpl->m_node->m_inheritOnlyTranslate;
+      node->m_translation = tmpl->m_node->m_translation;
+      node->m_orientation = tmpl->m_node->m_orientation;
+      node->m_scale = tmpl->m_node->m_scale;
+      node->SetLocalDirty();
+
+      if (tmpl->IsDrawable())
+      {
+        Drawable* drawable = static_cast<Drawable*> (part);
+        drawable->m_mesh = static_cast<Drawable*> (tmpl)->m_mesh;
+        drawable->m_occluder = static_cast<Drawable*> (tmpl)->m_occluder;
+      }
+
+      m_parts.push_back(part);
+    }
+
+    for (size_t i = 0; i < m_parts.size(); i++)
+    {
+      int parent = m_prefab->m_parents[i];
+      Node* parentNode = parent == -1 ? m_node : m_parts[parent]->m_node;
+      parentNode->AddChild(m_parts[i]->m_node);
+    }
+
+    for (const Override& ovr : m_overrides)
+    {
+      Entity* part = m_parts[ovr.part];
+      part->m_name = ovr.name;
+      part->m_tag = ovr.tag;
+      part->m_static = ovr.isStatic;
+      if (part->IsDrawable())
+      {
+        static_cast<Drawable*> (part)->m_occluder = ovr.occluder;
+      }
+
+      Node* node = part->m_node;
+      node->m_translation = ovr.translation;
+      node->m_orientation = ovr.orientation;
+      node->m_scale = ovr.scale;
+      node->SetLocalDirty();
+    }
+    m_overrides.clear();
+  }
+
+  const EntityRawPtrArray& PrefabInstance::GetParts() const
+  {
+    return m_parts;
+  }
+
+  void PrefabInstance::GetOverrides(std::vector<Override>& overrides) const
+  {
+    if (!IsExpanded())
+    {
+      overrides = m_overrides;
+      return;
+    }
+
+    overrides.clear();
+    for (size_t i = 0; i < m_parts.size(); i++)
+    {
+      Entity* part = m_parts[i];
+      Entity* tmpl = m_prefab->m_entities[i];
+
+      Override ovr;
+      ovr.part = (uint)i;
+      ovr.name = part->m_name;
+      ovr.tag = part->m_tag;
+      ovr.isStatic = part->m_static;
+      ovr.occluder = part->IsDrawable() && static_cast<Drawable*> (part)->m_occluder;
+      ovr.translation = part->m_node->m_translation;
+      ovr.orientation = part->m_node->m_orientation;
+      ovr.scale = part->m_node->m_scale;
+
+      bool occluder = tmpl->IsDrawable() && static_cast<Drawable*> (tmpl)->m_occluder;
+      bool same = ovr.name == tmpl->m_name && ovr.tag == tmpl->m_tag && ovr.isStatic == tmpl->m_static && ovr.occluder == occluder;
+      same = same && ovr.translation == tmpl->m_node->m_translation && ovr.orientation == tmpl->m_node->m_orientation && ovr.scale == tmpl->m_node->m_scale;
+      if (!same)
+      {
+        overrides.push_back(ovr);
+      }
+    }
+  }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Entity.h"
+#include "Resource.h"
+#include "ResourceManager.h"
+
+namespace ToolKit
+{
+
+  // A hierarchy of entities saved once and placed many times through PrefabInstance. The entities loaded from the file
+  // are templates, they never enter a scene. Instances share their meshes and materials.
+  class Prefab : public Resource
+  {
+  public:
+    Prefab();
+    Prefab(String file);
+    ~Prefab();
+
+    virtual void Load() override;
+    virtual void Init(bool flushClientSideArray = true) override;
+    virtual void UnInit() override;
+
+    // Writes the entities as a prefab. Entities whose parent is left out become the roots. Prefab instances and their
+    // parts can't be nested into a prefab.
+    static bool Save(const String& file, const EntityRawPtrArray& entities);
+
+  public:
+    EntityRawPtrArray m_entities; // Templates, in file order.
+    std::vector<int> m_parents; // Index of each template's parent, -1 for the roots.
+  };
+
+  class PrefabManager : public ResourceManager<Prefab>
+  {
+  };
+
+  // Places a prefab. Only the transform of the instance and the properties of the parts that differ from the prefab
+  // are saved. Parts are created by Expand, until then the instance costs no more than its overrides. The parts are
+  // owned by the instance and parented to its node.
+  class PrefabInstance : public Entity
+  {
+  public:
+    PrefabInstance();
+    PrefabInstance(const PrefabPtr& prefab);
+    virtual ~PrefabInstance();
+
+    virtual EntityType GetType() const override;
+    virtual PrefabInstance* GetCopy() const override; // Shares the prefab and carries the overrides, not expanded.
+    virtual void GetCopy(Entity* copyTo) const override;
+    virtual void Serialize(XmlDocument* doc, XmlNode* parent) const override;
+    virtual void DeSerialize(XmlDocument* doc, XmlNode* parent) override;
+
+    bool IsExpanded() const;
+    void Expand(); // Creates the parts and applies the overrides.
+    const EntityRawPtrArray& GetParts() const; // Index aligned with the prefab's entities. Empty until expanded.
+
+  public:
+    PrefabPtr m_prefab;
+
+  private:
+    // Properties of a part that differs from its template.
+    struct Override
+    {
+      uint part = 0;
+      String name;
+      String tag;
+      bool isStatic = false;
+      bool occluder = false;
+      Vec3 translation;
+      Quaternion orientation;
+      Vec3 scale = Vec3(1.0f);
+    };
+
+    void GetOverrides(std::vector<Override>& overrides) const;
+
+  private:
+    EntityRawPtrArray m_parts;
+    std::vector<Override> m_overrides; // Loaded ones, waiting for the expansion.
+  };
+
+}
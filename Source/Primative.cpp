@@ -279,7 +279,6 @@ namespace ToolKit
     m_mesh->m_material = GetMaterialManager()->GetCopyOfDefaultMaterial();
 
     m_mesh->CalculateAABoundingBox();
-    m_mesh->ConstructFaces();
   }
 
   Quad::Quad(bool genDef)
@@ -340,7 +339,6 @@ namespace ToolKit
     m_mesh->m_material = GetMaterialManager()->GetCopyOfDefaultMaterial();
 
     m_mesh->CalculateAABoundingBox();
-    m_mesh->ConstructFaces();
   }
 
   Sphere::Sphere(bool genDef)
@@ -432,7 +430,6 @@ namespace ToolKit
     m_mesh->m_material = GetMaterialManager()->GetCopyOfDefaultMaterial();
 
     m_mesh->CalculateAABoundingBox();
-    m_mesh->ConstructFaces();
   }
 
   void Sphere::Serialize(XmlDocument* doc, XmlNode* parent) const
@@ -557,7 +554,6 @@ namespace ToolKit
     m_mesh->m_material = GetMaterialManager()->Create(MaterialPath("default.material"));
 
     m_mesh->CalculateAABoundingBox();
-    m_mesh->ConstructFaces();
   }
 
   Cone* Cone::GetCopy() const
@@ -669,7 +665,6 @@ namespace ToolKit
     m_mesh->m_material = newMaterial;
 
     m_mesh->CalculateAABoundingBox();
-    m_mesh->ConstructFaces();
   }
 
   LineBatch::LineBatch(const Vec3Array& linePnts, const Vec3& color, DrawType t, float lineWidth)
@@ -677,6 +672,7 @@ namespace ToolKit
     MaterialPtr newMaterial = GetMaterialManager()->GetCopyOfUnlitColorMaterial();
     newMaterial->GetRenderState()->drawType = t;
     m_mesh->m_material = newMaterial;
+    m_mesh->m_dynamic = true; // Mostly regenerated every frame.
 
     Generate(linePnts, color, t, lineWidth);
   }
@@ -716,8 +712,9 @@ namespace ToolKit
 
     m_mesh->m_vertexCount = (uint)vertices.size();
     m_mesh->m_clientSideVertices = vertices;
-    m_mesh->m_material->m_color = color;
-    m_mesh->m_material->GetRenderState()->lineWidth = lineWidth;
+    MaterialPtr material = m_mesh->GetUniqueMaterial();
+    material->m_color = color;
+    material->GetRenderState()->lineWidth = lineWidth;
 
     m_mesh->CalculateAABoundingBox();
   }
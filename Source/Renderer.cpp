@@ -9,6 +9,10 @@
 #include "Surface.h"
 #include "Skeleton.h"
 #include "GlobalCache.h"
+#include "StreamBuffer.h"
+#include "LightClusters.h"
+#include <cstring>
+#include "GlCaptureHooks.h"
 #include "DebugNew.h"
 
 namespace ToolKit
@@ -16,12 +20,71 @@ namespace ToolKit
 
 #define BUFFER_OFFSET(idx) (static_cast<char*>(0) + (idx))
 
+  // Strips and loops are merged as line lists.
+  static DrawType ListType(DrawType type)
+  {
+    if (type == DrawType::LineStrip || type == DrawType::LineLoop)
+    {
+      return DrawType::Line;
+    }
+
+    return type;
+  }
+
+  bool Renderer::IsBatchCompatible(Material* batchMat, DrawType batchDrawType, Material* material)
+  {
+    if (batchMat == material)
+    {
+      return true;
+    }
+
+    if
+    (
+      batchMat->m_vertexShader != material->m_vertexShader ||
+      batchMat->m_fragmetShader != material->m_fragmetShader ||
+      batchMat->m_color != material->m_color
+    )
+    {
+      return false;
+    }
+
+    const RenderState* a = batchMat->GetRenderState();
+    const RenderState* b = material->GetRenderState();
+    return batchDrawType == ListType(b->drawType) &&
+      a->cullMode == b->cullMode &&
+      a->depthTestEnabled == b->depthTestEnabled &&
+      a->blendFunction == b->blendFunction &&
+      a->diffuseTextureInUse == b->diffuseTextureInUse &&
+      a->diffuseTexture == b->diffuseTexture &&
+      a->cubeMapInUse == b->cubeMapInUse &&
+      a->cubeMap == b->cubeMap &&
+      a->lineWidth == b->lineWidth;
+  }
+
   Renderer::Renderer()
   {
+    m_vertexStream = new StreamBuffer(GL_ARRAY_BUFFER, 1024 * 1024);
+    m_indexStream = new StreamBuffer(GL_ELEMENT_ARRAY_BUFFER, 256 * 1024);
+    m_lightClusters = new LightClusters();
   }
 
   Renderer::~Renderer()
   {
+    for (GpuTimerQuery& query : m_pendingQueries)
+    {
+      m_freeQueries.push_back(query.query);
+    }
+    m_pendingQueries.clear();
+
+    if (!m_freeQueries.empty())
+    {
+      glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+      m_freeQueries.clear();
+    }
+
+    SafeDel(m_vertexStream);
+    SafeDel(m_indexStream);
+    SafeDel(m_lightClusters);
   }
 
   void Renderer::Render(Drawable* object, Camera* cam, const LightRawPtrArray& lights)
@@ -32,7 +95,12 @@ namespace ToolKit
       return;
     }
 
+    bool upload = !object->m_mesh->m_initiated;
     object->m_mesh->Init();
+    if (upload)
+    {
+      CountUploads(object->m_mesh.get());
+    }
 
     g_meshCollector.clear();
     object->m_mesh->GetAllMeshes(g_meshCollector);
@@ -41,39 +109,52 @@ namespace ToolKit
     m_lights = lights;
     SetProjectViewModel(object, cam);
 
+    uint lod = 0;
     for (Mesh* mesh : g_meshCollector)
     {
-      m_mat = mesh->m_material.get();
-
-      ProgramPtr prg = CreateProgram(m_mat->m_vertexShader, m_mat->m_fragmetShader);
-      BindProgram(prg);
-      FeedUniforms(prg);
-
-      RenderState* rs = m_mat->GetRenderState();
-      SetRenderState(rs);
-
-      glBindBuffer(GL_ARRAY_BUFFER, mesh->m_vboVertexId);
-      SetVertexLayout(VertexLayout::Mesh);
+      if (!mesh->m_lods.empty())
+      {
+        lod = SelectLod(object, cam);
+        break;
+      }
+    }
 
-      if (mesh->m_indexCount != 0)
+    for (Mesh* mesh : g_meshCollector)
+    {
+      if (lod == 0 || mesh->m_lods.empty())
       {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->m_vboIndexId);
-        glDrawElements((GLenum)rs->drawType, mesh->m_indexCount, GL_UNSIGNED_INT, nullptr);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        RenderMesh(mesh);
+        continue;
       }
-      else
+
+      Mesh* lodMesh = mesh->m_lods[glm::min((size_t)lod, mesh->m_lods.size()) - 1].get();
+      if (!lodMesh->m_initiated)
       {
-        glDrawArrays((GLenum)rs->drawType, 0, mesh->m_vertexCount);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        lodMesh->Init();
+        CountUploads(lodMesh);
       }
 
-      SetVertexLayout(VertexLayout::None);
+      RenderMesh(lodMesh);
+
+      // Non indexed meshes draw their vertices.
+      uint sourceCount = mesh->m_indexCount > 0 ? mesh->m_indexCount : mesh->m_vertexCount;
+      uint lodCount = lodMesh->m_indexCount > 0 ? lodMesh->m_indexCount : lodMesh->m_vertexCount;
+      if (sourceCount > lodCount)
+      {
+        m_stats.trianglesSaved += (sourceCount - lodCount) / 3;
+      }
     }
   }
 
   void Renderer::RenderSkinned(Drawable* object, Camera* cam)
   {
+    bool upload = !object->m_mesh->m_initiated;
     object->m_mesh->Init();
+    if (upload)
+    {
+      CountUploads(object->m_mesh.get());
+    }
+
     SetProjectViewModel(object, cam);
 
     static ShaderPtr skinShader = GetShaderManager()->Create(ShaderPath("defaultSkin.shader"));
@@ -102,11 +183,15 @@ namespace ToolKit
       RenderState* rs = mesh->m_material->GetRenderState();
       SetRenderState(rs);
 
+      GLint loc = glGetUniformLocation(skinProg->m_handle, "UvTransform");
+      glUniform4fv(loc, 1, &mesh->m_material->m_uvTransform.x);
+
       glBindBuffer(GL_ARRAY_BUFFER, mesh->m_vboVertexId);
       SetVertexLayout(VertexLayout::SkinMesh);
 
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->m_vboIndexId);
       glDrawElements((GLenum)rs->drawType, mesh->m_indexCount, GL_UNSIGNED_INT, nullptr);
+      CountDraw(rs->drawType, mesh->m_indexCount);
 
       glBindBuffer(GL_ARRAY_BUFFER, 0);
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -114,6 +199,84 @@ namespace ToolKit
     }
   }
 
+  void Renderer::BeginBatch(Camera* cam)
+  {
+    assert(m_batches.empty() && "Batches can't be nested.");
+    m_batchCam = cam;
+  }
+
+  void Renderer::AddToBatch(Drawable* object)
+  {
+    assert(m_batchCam != nullptr && "Call BeginBatch first.");
+    if (!m_batchSettings.enabled || object->m_mesh->IsSkinned())
+    {
+      Render(object, m_batchCam);
+      return;
+    }
+
+    MeshRawPtrArray meshes;
+    object->m_mesh->GetAllMeshes(meshes);
+
+    Mat4 transform = object->m_node->GetTransform(TransformationSpace::TS_WORLD);
+    for (Mesh* mesh : meshes)
+    {
+      if (!IsBatchable(mesh))
+      {
+        // Draw directly.
+        bool upload = !mesh->m_initiated;
+        mesh->Init();
+        if (upload)
+        {
+          CountUploads(mesh);
+        }
+
+        m_cam = m_batchCam;
+        m_lights.clear();
+        SetProjectViewModel(object, m_batchCam);
+        RenderMesh(mesh);
+        continue;
+      }
+
+      mesh->m_material->Init();
+
+      Batch* target = nullptr;
+      for (Batch& batch : m_batches)
+      {
+        if (IsBatchCompatible(batch.material.get(), batch.drawType, mesh->m_material.get()))
+        {
+          target = &batch;
+          break;
+        }
+      }
+
+      if (target == nullptr)
+      {
+        Batch batch;
+        batch.material = mesh->m_material;
+        batch.drawType = ListType(mesh->m_material->GetRenderState()->drawType);
+        m_batches.push_back(batch);
+        target = &m_batches.back();
+      }
+      else if (target->vertices.size() + mesh->m_clientSideVertices.size() > m_batchSettings.maxBatchVertexCount)
+      {
+        DrawBatch(*target);
+      }
+
+      AppendToBatch(*target, mesh, transform);
+    }
+  }
+
+  void Renderer::EndBatch()
+  {
+    for (Batch& batch : m_batches)
+    {
+      DrawBatch(batch);
+    }
+
+    m_batches.clear();
+    m_batchCam = nullptr;
+  }
+
   void Renderer::Render2d(Surface* object, glm::ivec2 screenDimensions)
   {
     static ShaderPtr vertexShader = GetShaderManager()->Create(ShaderPath("defaultVertex.shader"));
@@ -121,7 +284,13 @@ namespace ToolKit
     static ProgramPtr prog = CreateProgram(vertexShader, fragShader);
     BindProgram(prog);
 
+    bool upload = !object->m_mesh->m_initiated;
     object->m_mesh->Init();
+    if (upload)
+    {
+      CountUploads(object->m_mesh.get());
+    }
+
     RenderState* rs = object->m_mesh->m_material->GetRenderState();
     SetRenderState(rs);
 
@@ -130,10 +299,14 @@ namespace ToolKit
     Mat4 mul = pm * object->m_node->GetTransform(TransformationSpace::TS_WORLD);
     glUniformMatrix4fv(pvloc, 1, false, (float*)&mul);
 
+    GLint uvloc = glGetUniformLocation(prog->m_handle, "UvTransform");
+    glUniform4fv(uvloc, 1, &object->m_mesh->m_material->m_uvTransform.x);
+
     glBindBuffer(GL_ARRAY_BUFFER, object->m_mesh->m_vboVertexId);
     SetVertexLayout(VertexLayout::Mesh);
 
     glDrawArrays((GLenum)rs->drawType, 0, object->m_mesh->m_vertexCount);
+    CountDraw(rs->drawType, object->m_mesh->m_vertexCount);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     SetVertexLayout(VertexLayout::None);
@@ -214,12 +387,14 @@ namespace ToolKit
     {
       m_renderState.diffuseTexture = state->diffuseTexture;
       glBindTexture(GL_TEXTURE_2D, m_renderState.diffuseTexture);
+      m_stats.textureBinds++;
     }
 
     if (m_renderState.cubeMap != state->cubeMap && state->cubeMapInUse)
     {
       m_renderState.cubeMap = state->cubeMap;
       glBindTexture(GL_TEXTURE_CUBE_MAP, m_renderState.cubeMap);
+      m_stats.textureBinds++;
     }
 
     if (m_renderState.lineWidth != state->lineWidth)
@@ -262,6 +437,40 @@ namespace ToolKit
     SetRenderTarget(tmp, clear);
   }
 
+  void Renderer::CopyRenderTarget(RenderTarget* source, RenderTarget* destination)
+  {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source->m_frameBufferId);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination->m_frameBufferId);
+    glBlitFramebuffer
+    (
+      0, 0, source->m_width, source->m_height,
+      0, 0, destination->m_width, destination->m_height,
+      GL_COLOR_BUFFER_BIT, GL_NEAREST
+    );
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_renderTarget == nullptr ? 0 : m_renderTarget->m_frameBufferId);
+  }
+
+  void Renderer::ReadPixels(RenderTarget* source, std::vector<uint8>& rgba)
+  {
+    uint rowSize = source->m_width * 4;
+    rgba.resize(rowSize * source->m_height);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source->m_frameBufferId);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, source->m_width, source->m_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, m_renderTarget == nullptr ? 0 : m_renderTarget->m_frameBufferId);
+
+    // Gl rows start from the bottom.
+    std::vector<uint8> row(rowSize);
+    for (int top = 0, bottom = source->m_height - 1; top < bottom; top++, bottom--)
+    {
+      memcpy(row.data(), &rgba[top * rowSize], rowSize);
+      memcpy(&rgba[top * rowSize], &rgba[bottom * rowSize], rowSize);
+      memcpy(&rgba[bottom * rowSize], row.data(), rowSize);
+    }
+  }
+
   void Renderer::DrawFullQuad(ShaderPtr fragmentShader)
   {
     static ShaderPtr fullQuadVert = GetShaderManager()->Create(ShaderPath("fullQuadVert.shader"));
@@ -280,6 +489,115 @@ namespace ToolKit
     Render(&quad, &dummy);
   }
 
+  void Renderer::SetClusteredLights(Camera* cam, const LightRawPtrArray& lights)
+  {
+    m_lightClusters->Build(lights, cam->GetViewMatrix(), cam->GetData().projection);
+    m_lightClusters->Upload();
+    m_clusterCam = cam;
+  }
+
+  void Renderer::ClearClusteredLights()
+  {
+    m_clusterCam = nullptr;
+  }
+
+  void Renderer::BeginFrame()
+  {
+    m_stats = RenderStats();
+
+#ifdef TK_GL_CAPTURE
+    GlCapture::GetInstance()->BeginFrame();
+#endif
+  }
+
+  void Renderer::EndFrame()
+  {
+    if (m_passActive)
+    {
+      EndPass();
+    }
+
+    m_lastFrameStats = m_stats;
+    ResolveGpuTimers();
+
+    m_vertexStream->NextFrame();
+    m_indexStream->NextFrame();
+
+#ifdef TK_GL_CAPTURE
+    GlCapture::GetInstance()->EndFrame();
+#endif
+
+    float gpuTime = 0.0f;
+    for (const PassTiming& timing : m_passTimings)
+    {
+      gpuTime += timing.gpuTimeMs;
+    }
+
+    m_drawCallHistory[m_statHistoryIndex] = (float)m_lastFrameStats.drawCalls;
+    m_gpuTimeHistory[m_statHistoryIndex] = gpuTime;
+    m_statHistoryIndex = (m_statHistoryIndex + 1) % m_statHistorySize;
+
+    m_frameCount++;
+  }
+
+  void Renderer::BeginPass(const String& name)
+  {
+    assert(!m_passActive && "Passes can't be nested.");
+    if (m_passActive)
+    {
+      EndPass();
+    }
+    m_passActive = true;
+
+    if (!IsGpuTimerSupported())
+    {
+      return;
+    }
+
+    GLuint query = 0;
+    if (m_freeQueries.empty())
+    {
+      glGenQueries(1, &query);
+    }
+    else
+    {
+      query = m_freeQueries.back();
+      m_freeQueries.pop_back();
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    m_pendingQueries.push_back({ name, query, m_frameCount });
+  }
+
+  void Renderer::EndPass()
+  {
+    if (!m_passActive)
+    {
+      return;
+    }
+    m_passActive = false;
+
+    if (IsGpuTimerSupported())
+    {
+      glEndQuery(GL_TIME_ELAPSED);
+    }
+  }
+
+  const RenderStats& Renderer::GetFrameStats() const
+  {
+    return m_lastFrameStats;
+  }
+
+  const std::vector<PassTiming>& Renderer::GetPassTimings() const
+  {
+    return m_passTimings;
+  }
+
+  bool Renderer::IsGpuTimerSupported() const
+  {
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+  }
+
   void Renderer::SetProjectViewModel(Drawable* object, Camera* cam)
   {
     m_view = cam->GetViewMatrix();
@@ -296,6 +614,7 @@ namespace ToolKit
 
     m_currentProgram = program->m_handle;
     glUseProgram(program->m_handle);
+    m_stats.programBinds++;
   }
 
   void Renderer::LinkProgram(GLuint program, GLuint vertexP, GLuint fragmentP)
@@ -375,13 +694,25 @@ namespace ToolKit
         break;
         case Uniform::LIGHT_DATA:
         {
-          size_t lsize = m_lights.size();
-          if (lsize == 0)
+          if (m_clusterCam != nullptr && m_clusterCam == m_cam)
           {
+            Vec2 viewport = Vec2(m_windowWidth, m_windowHeight);
+            if (m_renderTarget != nullptr)
+            {
+              viewport = Vec2(m_renderTarget->m_width, m_renderTarget->m_height);
+            }
+
+            m_lightClusters->Bind(program.get(), viewport);
             break;
           }
 
-          assert(g_lightPosStrCache.size() >= lsize);
+          LightClusters::Unbind(program.get());
+
+          size_t lsize = glm::min(m_lights.size(), g_lightPosStrCache.size());
+          if (lsize == 0)
+          {
+            break;
+          }
 
           for (size_t i = 0; i < lsize; i++)
           {
@@ -398,7 +729,7 @@ namespace ToolKit
           }
 
           GLint loc = glGetUniformLocation(program->m_handle, "LightData.activeCount");
-          glUniform1i(loc, (int)m_lights.size());
+          glUniform1i(loc, (int)lsize);
         }
         break;
         case Uniform::CAM_DATA:
@@ -429,6 +760,19 @@ namespace ToolKit
           glUniform1ui(loc, m_frameCount);
         }
         break;
+        case Uniform::UV_TRANSFORM:
+        {
+          // Batched vertices have their uvs transformed already.
+          Vec4 uvTransform(0.0f, 0.0f, 1.0f, 1.0f);
+          if (m_mat != nullptr && !m_drawingBatch)
+          {
+            uvTransform = m_mat->m_uvTransform;
+          }
+
+          GLint loc = glGetUniformLocation(program->m_handle, "UvTransform");
+          glUniform4fv(loc, 1, &uvTransform.x);
+        }
+        break;
         default:
           assert(false);
           break;
@@ -473,7 +817,345 @@ namespace ToolKit
     }
   }
 
-  void Renderer::SetVertexLayout(VertexLayout layout)
+  void Renderer::RenderMesh(Mesh* mesh)
+  {
+    if (mesh->m_dynamic)
+    {
+      RenderDynamicMesh(mesh);
+      return;
+    }
+
+    m_mat = mesh->m_material.get();
+
+    ProgramPtr prg = CreateProgram(m_mat->m_vertexShader, m_mat->m_fragmetShader);
+    BindProgram(prg);
+    FeedUniforms(prg);
+
+    RenderState* rs = m_mat->GetRenderState();
+    SetRenderState(rs);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->m_vboVertexId);
+    SetVertexLayout(VertexLayout::Mesh);
+
+    if (mesh->m_indexCount != 0)
+    {
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->m_vboIndexId);
+      glDrawElements((GLenum)rs->drawType, mesh->m_indexCount, GL_UNSIGNED_INT, nullptr);
+      CountDraw(rs->drawType, mesh->m_indexCount);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    else
+    {
+      glDrawArrays((GLenum)rs->drawType, 0, mesh->m_vertexCount);
+      CountDraw(rs->drawType, mesh->m_vertexCount);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    SetVertexLayout(VertexLayout::None);
+  }
+
+  void Renderer::RenderDynamicMesh(Mesh* mesh)
+  {
+    assert(!mesh->IsSkinned() && "Skinned meshes can't be streamed.");
+    if (mesh->m_clientSideVertices.empty())
+    {
+      return;
+    }
+
+    m_mat = mesh->m_material.get();
+
+    ProgramPtr prg = CreateProgram(m_mat->m_vertexShader, m_mat->m_fragmetShader);
+    BindProgram(prg);
+    FeedUniforms(prg);
+
+    RenderState* rs = m_mat->GetRenderState();
+    SetRenderState(rs);
+
+    uint vertexBytes = (uint)(mesh->m_clientSideVertices.size() * sizeof(Vertex));
+    uint vertexOffset = m_vertexStream->Write(mesh->m_clientSideVertices.data(), vertexBytes);
+    SetVertexLayout(VertexLayout::Mesh, vertexOffset);
+    m_stats.bufferUploads++;
+    m_stats.uploadedBytes += vertexBytes;
+
+    if (!mesh->m_clientSideIndices.empty())
+    {
+      uint indexCount = (uint)mesh->m_clientSideIndices.size();
+      uint indexBytes = indexCount * (uint)sizeof(uint);
+      uint indexOffset = m_indexStream->Write(mesh->m_clientSideIndices.data(), indexBytes);
+      m_stats.bufferUploads++;
+      m_stats.uploadedBytes += indexBytes;
+
+      glDrawElements((GLenum)rs->drawType, indexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(indexOffset));
+      CountDraw(rs->drawType, indexCount);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    else
+    {
+      glDrawArrays((GLenum)rs->drawType, 0, (GLsizei)mesh->m_clientSideVertices.size());
+      CountDraw(rs->drawType, (uint)mesh->m_clientSideVertices.size());
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    SetVertexLayout(VertexLayout::None);
+  }
+
+  uint Renderer::SelectLod(Drawable* object, Camera* cam)
+  {
+    const std::vector<float>& thresholds = m_lodSettings.screenSizes;
+    if (!m_lodSettings.enabled || thresholds.empty())
+    {
+      object->m_lods.clear();
+      return 0;
+    }
+
+    // A handful of cameras at most, one per viewport.
+    uint* state = nullptr;
+    for (std::pair<EntityId, uint>& camLod : object->m_lods)
+    {
+      if (camLod.first == cam->m_id)
+      {
+        state = &camLod.second;
+        break;
+      }
+    }
+
+    if (state == nullptr)
+    {
+      object->m_lods.push_back({ cam->m_id, 0 });
+      state = &object->m_lods.back().second;
+    }
+
+    BoundingBox box = object->GetAABB(true);
+    Vec3 center = (box.min + box.max) * 0.5f;
+    float radius = glm::distance(box.min, box.max) * 0.5f;
+
+    Camera::CamData data = cam->GetData();
+    float screenSize = 0.0f;
+    if (data.ortographic)
+    {
+      screenSize = 2.0f * radius / data.height;
+    }
+    else
+    {
+      float dist = glm::max(glm::distance(center, data.pos), data.nearDist);
+      screenSize = radius / (dist * glm::tan(data.fov * 0.5f));
+    }
+
+    // Switch to a coarser level only below the band and back to a finer level only above it.
+    uint lod = glm::min(*state, (uint)thresholds.size());
+    float h = m_lodSettings.hysteresis;
+    while (lod < thresholds.size() && screenSize < thresholds[lod] * (1.0f - h))
+    {
+      lod++;
+    }
+
+    while (lod > 0 && screenSize > thresholds[lod - 1] * (1.0f + h))
+    {
+      lod--;
+    }
+
+    *state = lod;
+    return lod;
+  }
+
+  void Renderer::CountDraw(DrawType type, uint elementCount)
+  {
+    m_stats.drawCalls++;
+    if (type == DrawType::Triangle)
+    {
+      m_stats.triangles += elementCount / 3;
+    }
+  }
+
+  void Renderer::CountUploads(Mesh* mesh)
+  {
+    MeshRawPtrArray meshes;
+    mesh->GetAllMeshes(meshes);
+    for (Mesh* m : meshes)
+    {
+      if (m->m_dynamic)
+      {
+        continue; // Counted as streamed.
+      }
+
+      if (m->m_vertexCount > 0)
+      {
+        m_stats.bufferUploads++;
+        m_stats.uploadedBytes += m->m_vertexCount * m->GetVertexSize();
+      }
+
+      if (m->m_indexCount > 0)
+      {
+        m_stats.bufferUploads++;
+        m_stats.uploadedBytes += m->m_indexCount * (uint)sizeof(uint);
+      }
+    }
+  }
+
+  void Renderer::ResolveGpuTimers()
+  {
+    // Queries are in frame order. Consume the oldest frames whose results are all available, so reading never stalls.
+    size_t consumed = 0;
+    while (consumed < m_pendingQueries.size())
+    {
+      uint frame = m_pendingQueries[consumed].frame;
+      if (m_frameCount - frame < m_gpuTimerLatency)
+      {
+        break;
+      }
+
+      size_t end = consumed;
+      bool available = true;
+      while (end < m_pendingQueries.size() && m_pendingQueries[end].frame == frame)
+      {
+        GLuint ready = 0;
+        glGetQueryObjectuiv(m_pendingQueries[end].query, GL_QUERY_RESULT_AVAILABLE, &ready);
+        available = available && ready;
+        end++;
+      }
+
+      if (!available)
+      {
+        break;
+      }
+
+      m_passTimings.clear();
+      for (size_t i = consumed; i < end; i++)
+      {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_pendingQueries[i].query, GL_QUERY_RESULT, &elapsed);
+        m_passTimings.push_back({ m_pendingQueries[i].name, (float)(elapsed / 1000000.0) });
+        m_freeQueries.push_back(m_pendingQueries[i].query);
+      }
+
+      consumed = end;
+    }
+
+    m_pendingQueries.erase(m_pendingQueries.begin(), m_pendingQueries.begin() + consumed);
+  }
+
+  bool Renderer::IsBatchable(Mesh* mesh) const
+  {
+    size_t vertexCount = mesh->m_clientSideVertices.size();
+    if (vertexCount == 0 || vertexCount > m_batchSettings.maxMeshVertexCount)
+    {
+      return false;
+    }
+
+    // Indexed meshes must still have their indices on the client side.
+    if (mesh->m_indexCount != 0 && mesh->m_clientSideIndices.empty())
+    {
+      return false;
+    }
+
+    return mesh->m_material != nullptr;
+  }
+
+  void Renderer::AppendToBatch(Batch& batch, Mesh* mesh, const Mat4& transform)
+  {
+    uint base = (uint)batch.vertices.size();
+    Mat3 normalTransform = glm::transpose(glm::inverse(Mat3(transform)));
+    const Vec4& uvTransform = mesh->m_material->m_uvTransform; // Materials sharing an atlas page end up in the same batch.
+    for (const Vertex& v : mesh->m_clientSideVertices)
+    {
+      Vertex tv = v;
+      tv.pos = Vec3(transform * Vec4(v.pos, 1.0f));
+      tv.tex = v.tex * Vec2(uvTransform.z, uvTransform.w) + Vec2(uvTransform.x, uvTransform.y);
+      tv.norm = normalTransform * v.norm;
+      if (glm::length2(tv.norm) > 0.0f)
+      {
+        tv.norm = glm::normalize(tv.norm);
+      }
+      tv.btan = Mat3(transform) * v.btan;
+      batch.vertices.push_back(tv);
+    }
+
+    std::vector<uint> local = mesh->m_clientSideIndices;
+    if (local.empty())
+    {
+      local.resize(mesh->m_clientSideVertices.size());
+      for (uint i = 0; i < (uint)local.size(); i++)
+      {
+        local[i] = i;
+      }
+    }
+
+    DrawType drawType = mesh->m_material->GetRenderState()->drawType;
+    if (drawType == DrawType::LineStrip || drawType == DrawType::LineLoop)
+    {
+      for (size_t i = 1; i < local.size(); i++)
+      {
+        batch.indices.push_back(base + local[i - 1]);
+        batch.indices.push_back(base + local[i]);
+      }
+
+      if (drawType == DrawType::LineLoop && local.size() > 2)
+      {
+        batch.indices.push_back(base + local.back());
+        batch.indices.push_back(base + local.front());
+      }
+    }
+    else
+    {
+      for (uint index : local)
+      {
+        batch.indices.push_back(base + index);
+      }
+    }
+
+    batch.meshCount++;
+  }
+
+  void Renderer::DrawBatch(Batch& batch)
+  {
+    if (batch.indices.empty())
+    {
+      return;
+    }
+
+    uint vertexBytes = (uint)(batch.vertices.size() * sizeof(Vertex));
+    uint indexBytes = (uint)(batch.indices.size() * sizeof(uint));
+    uint vertexOffset = m_vertexStream->Write(batch.vertices.data(), vertexBytes);
+    uint indexOffset = m_indexStream->Write(batch.indices.data(), indexBytes);
+    m_stats.bufferUploads += 2;
+    m_stats.uploadedBytes += vertexBytes + indexBytes;
+
+    // Vertices are already in world space.
+    m_cam = m_batchCam;
+    m_lights.clear();
+    m_view = m_batchCam->GetViewMatrix();
+    m_project = m_batchCam->GetData().projection;
+    m_model = Mat4(1.0f);
+    m_mat = batch.material.get();
+
+    ProgramPtr prg = CreateProgram(m_mat->m_vertexShader, m_mat->m_fragmetShader);
+    BindProgram(prg);
+    m_drawingBatch = true;
+    FeedUniforms(prg);
+    m_drawingBatch = false;
+
+    RenderState rs = *m_mat->GetRenderState();
+    rs.drawType = batch.drawType;
+    SetRenderState(&rs);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexStream->m_id);
+    SetVertexLayout(VertexLayout::Mesh, vertexOffset);
+    glDrawElements((GLenum)rs.drawType, (GLsizei)batch.indices.size(), GL_UNSIGNED_INT, BUFFER_OFFSET(indexOffset));
+    CountDraw(rs.drawType, (uint)batch.indices.size());
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    SetVertexLayout(VertexLayout::None);
+
+    m_stats.batchedMeshes += batch.meshCount;
+    m_stats.drawsSaved += batch.meshCount - 1;
+
+    batch.vertices.clear();
+    batch.indices.clear();
+    batch.meshCount = 0;
+  }
+
+  void Renderer::SetVertexLayout(VertexLayout layout, uint baseOffset)
   {
     if (layout == VertexLayout::None)
     {
@@ -485,9 +1167,9 @@ namespace ToolKit
 
     if (layout == VertexLayout::Mesh)
     {
-      GLuint offset = 0;
+      GLuint offset = baseOffset;
       glEnableVertexAttribArray(0); // Vertex
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(offset));
       offset += 3 * sizeof(float);
 
       glEnableVertexAttribArray(1); // Normal
@@ -504,9 +1186,9 @@ namespace ToolKit
 
     if (layout == VertexLayout::SkinMesh)
     {
-      GLuint offset = 0;
+      GLuint offset = baseOffset;
       glEnableVertexAttribArray(0); // Vertex
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinVertex), 0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinVertex), BUFFER_OFFSET(offset));
       offset += 3 * sizeof(float);
 
       glEnableVertexAttribArray(1); // Normal
@@ -16,6 +16,42 @@ namespace ToolKit
   class Shader;
   class Material;
   class RenderTarget;
+  class Mesh;
+  class StreamBuffer;
+  class LightClusters;
+
+  struct RenderStats
+  {
+    uint drawCalls = 0;
+    uint programBinds = 0;
+    uint textureBinds = 0;
+    uint bufferUploads = 0;
+    uint uploadedBytes = 0;
+    uint triangles = 0;
+    uint batchedMeshes = 0; // Meshes merged by the dynamic batcher.
+    uint drawsSaved = 0;
+    uint trianglesSaved = 0; // By drawing lower levels of detail.
+  };
+
+  struct LodSettings
+  {
+    bool enabled = true;
+    float hysteresis = 0.15f; // Relative band around each threshold, avoids flickering between levels.
+    std::vector<float> screenSizes = { 0.25f, 0.12f, 0.05f }; // Level i + 1 is used below screenSizes[i]. Ratio of the projected diameter to the viewport height.
+  };
+
+  struct BatchSettings
+  {
+    bool enabled = true;
+    uint maxMeshVertexCount = 300; // Meshes with more vertices are drawn directly.
+    uint maxBatchVertexCount = 65536; // A batch is flushed before it grows beyond.
+  };
+
+  struct PassTiming
+  {
+    String name;
+    float gpuTimeMs = 0.0f;
+  };
 
   class Renderer
   {
@@ -29,14 +65,40 @@ namespace ToolKit
     void SetRenderState(const RenderState* const state);
     void SetRenderTarget(RenderTarget* renderTarget, bool clear = true);
     void SwapRenderTarget(RenderTarget** renderTarget, bool clear = true);
+    void CopyRenderTarget(RenderTarget* source, RenderTarget* destination); // Blits the color attachment, keeps the current target bound.
+    void ReadPixels(RenderTarget* source, std::vector<uint8>& rgba); // Rows from top to bottom. Stalls until the target is rendered.
     void DrawFullQuad(ShaderPtr fragmentShader);
 
+    // Dynamic batching. Small meshes added in between are transformed on the cpu, merged by material and drawn at EndBatch.
+    // Meshes that can't be batched are drawn immediately. Client side arrays of batched meshes must be present, Init flushes them.
+    void BeginBatch(Camera* cam);
+    void AddToBatch(Drawable* object);
+    void EndBatch();
+    static bool IsBatchCompatible(Material* batchMat, DrawType batchDrawType, Material* material); // Uv transforms may differ.
+
+    // Clustered lighting. Following draws with cam take their lights from the clusters, there is no limit on the light count.
+    // Shaders without cluster support keep using the first 8 lights.
+    void SetClusteredLights(Camera* cam, const LightRawPtrArray& lights);
+    void ClearClusteredLights();
+
+    // Statistics & instrumentation.
+    void BeginFrame();
+    void EndFrame();
+    void BeginPass(const String& name); // Passes can't be nested. Times the pass on the gpu if supported.
+    void EndPass();
+    const RenderStats& GetFrameStats() const; // Stats of the last completed frame.
+    const std::vector<PassTiming>& GetPassTimings() const; // Gpu times of the latest resolved frame. Lags m_gpuTimerLatency frames.
+    bool IsGpuTimerSupported() const;
+
   private:
     void SetProjectViewModel(Drawable* object, Camera* cam);
     void BindProgram(ProgramPtr program);
     void LinkProgram(GLuint program, GLuint vertexP, GLuint fragmentP);
     ProgramPtr CreateProgram(ShaderPtr vertex, ShaderPtr fragment);
     void FeedUniforms(ProgramPtr program);
+    void RenderMesh(Mesh* mesh);
+    void RenderDynamicMesh(Mesh* mesh);
+    uint SelectLod(Drawable* object, Camera* cam);
 
     enum class VertexLayout
     {
@@ -44,13 +106,32 @@ namespace ToolKit
       Mesh,
       SkinMesh
     };
-    void SetVertexLayout(VertexLayout layout);
+    void SetVertexLayout(VertexLayout layout, uint baseOffset = 0); // Byte offset of the first vertex in the bound buffer.
+    void CountDraw(DrawType type, uint elementCount);
+    void CountUploads(Mesh* mesh);
+    void ResolveGpuTimers();
+
+    struct Batch;
+    bool IsBatchable(Mesh* mesh) const;
+    void AppendToBatch(Batch& batch, Mesh* mesh, const Mat4& transform);
+    void DrawBatch(Batch& batch);
 
   public:
     uint m_frameCount = 0;
     uint m_windowWidth = 0;
     uint m_windowHeight = 0;
 
+    // Stat history for graphs. Ring buffers, m_statHistoryIndex is the oldest entry.
+    static const uint m_statHistorySize = 128;
+    float m_drawCallHistory[m_statHistorySize] = {};
+    float m_gpuTimeHistory[m_statHistorySize] = {};
+    uint m_statHistoryIndex = 0;
+    uint m_gpuTimerLatency = 3; // Frames to wait before reading back the timer queries.
+
+    BatchSettings m_batchSettings;
+    LodSettings m_lodSettings;
+    LightClusters* m_lightClusters = nullptr;
+
   private:
     GLuint m_currentProgram = 0;
     Mat4 m_project;
@@ -58,11 +139,45 @@ namespace ToolKit
     Mat4 m_model;
     LightRawPtrArray m_lights;
     Camera* m_cam = nullptr;
+    Camera* m_clusterCam = nullptr;
     Material* m_mat = nullptr;
     RenderTarget* m_renderTarget = nullptr;
 
     std::unordered_map<String, ProgramPtr> m_programs;
     RenderState m_renderState;
+
+    // Statistics.
+    struct GpuTimerQuery
+    {
+      String name;
+      GLuint query = 0;
+      uint frame = 0;
+    };
+
+    RenderStats m_stats;
+    RenderStats m_lastFrameStats;
+    std::vector<PassTiming> m_passTimings;
+    std::vector<GpuTimerQuery> m_pendingQueries;
+    std::vector<GLuint> m_freeQueries;
+    bool m_passActive = false;
+
+    // Dynamic batching.
+    struct Batch
+    {
+      MaterialPtr material; // Holds the material, objects may be deleted before the batch is drawn.
+      DrawType drawType = DrawType::Triangle; // Strips and loops are converted to lists.
+      VertexArray vertices;
+      std::vector<uint> indices;
+      uint meshCount = 0;
+    };
+
+    std::vector<Batch> m_batches;
+    Camera* m_batchCam = nullptr;
+    bool m_drawingBatch = false;
+
+    // Per frame geometry of batches and dynamic meshes.
+    StreamBuffer* m_vertexStream = nullptr;
+    StreamBuffer* m_indexStream = nullptr;
   };
 
 }
@@ -2,6 +2,7 @@
 
 #include "Util.h"
 #include "Logger.h"
+#include "ObjectPool.h"
 
 #include <memory>
 #include <unordered_map>
@@ -43,6 +44,8 @@ namespace ToolKit
           assert(fileCheck);
         }
 
+        // Resources outlive the scenes, keep them out of an arena being filled.
+        PoolArena::Scope noArena(nullptr);
         T* resource = new Ti(file);
         resource->Load();
         m_storage[file] = std::shared_ptr<T>(resource);
@@ -5,6 +5,7 @@
 #include "rapidxml_utils.hpp"
 #include "rapidxml_print.hpp"
 #include <vector>
+#include "GlCaptureHooks.h"
 #include "DebugNew.h"
 
 namespace ToolKit
@@ -89,6 +90,10 @@ namespace ToolKit
         {
           m_uniforms.push_back(Uniform::FRAME_COUNT);
         }
+        else if (String("UvTransform").compare(attr->value()) == 0)
+        {
+          m_uniforms.push_back(Uniform::UV_TRANSFORM);
+        }
         else
         {
           assert(false);
@@ -198,6 +203,7 @@ namespace ToolKit
       "in uvec4 vBones;"
       "in vec4 vWeights;"
       "uniform mat4 ProjectViewModel;"
+      "uniform vec4 UvTransform;"
       "uniform Bone bones[64];"
       "out vec3 v_pos;"
       "out vec3 v_normal;"
@@ -211,7 +217,7 @@ namespace ToolKit
       "   gl_Position += bones[vBones.w].transform * bones[vBones.w].bindPose * vec4(vPosition, 1.0) * vWeights.w;"
       "   v_pos = gl_Position.xyz;"
       "   gl_Position = ProjectViewModel * gl_Position;"
-      "   v_texture = vTexture;"
+      "   v_texture = vTexture * UvTransform.zw + UvTransform.xy;"
       "   v_normal = vNormal;"
       "   v_bitan = vBiTan;"
       "}";
@@ -15,7 +15,8 @@ namespace ToolKit
     LIGHT_DATA,
     CAM_DATA,
     COLOR,
-    FRAME_COUNT
+    FRAME_COUNT,
+    UV_TRANSFORM
   };
 
   class Shader : public Resource
@@ -47,10 +48,28 @@ namespace ToolKit
     Program(ShaderPtr vertex, ShaderPtr fragment);
     ~Program();
 
+    // Clustered lighting uniforms, looked up at the first draw with the program. Values are program state, they are
+    // fed again only when they change.
+    struct ClusterUniforms
+    {
+      bool resolved = false;
+      GLint enabled = -1;
+      GLint dims = -1;
+      GLint viewport = -1;
+      GLint depthRange = -1;
+      GLint linear = -1;
+      GLint globalCount = -1;
+      GLint indexWidth = -1;
+      int enabledValue = -1; // Unknown until fed.
+      uint upload = 0; // LightClusters upload the values come from, 0 for none.
+      Vec2 viewportSize;
+    };
+
   public:
     GLuint m_handle = 0;
     String m_tag;
     ShaderPtrArray m_shaders;
+    ClusterUniforms m_clusterUniforms;
   };
 
   class ShaderManager : public ResourceManager<Shader>
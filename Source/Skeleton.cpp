@@ -133,6 +133,7 @@ namespace ToolKit
 
     subNode = node->first_node("rotation");
     ReadVec(subNode, bone->m_node->m_orientation);
+    bone->m_node->SetLocalDirty();
 
     XmlNode* bindPoseNode = node->first_node("bindPose");
     if (bindPoseNode != nullptr)
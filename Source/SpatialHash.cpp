@@ -0,0 +1,271 @@
+#include "stdafx.h"
+#include "SpatialHash.h"
+#include <algorithm>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  static bool Overlaps(const BoundingBox& a, const BoundingBox& b)
+  {
+    return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+  }
+
+  SpatialHash::SpatialHash(float cellSize)
+  {
+    assert(cellSize > 0.0f);
+    m_invCellSize = 1.0f / cellSize;
+  }
+
+  SpatialHash::Proxy SpatialHash::InsertSphere(Entity* entity, const Vec3& center, float radius, uint layer)
+  {
+    BoundingBox box;
+    box.min = center - Vec3(radius);
+    box.max = center + Vec3(radius);
+
+    Proxy proxy = InsertBox(entity, box, layer);
+    m_items[proxy].radius = radius;
+    return proxy;
+  }
+
+  SpatialHash::Proxy SpatialHash::InsertBox(Entity* entity, const BoundingBox& box, uint layer)
+  {
+    Proxy proxy = (Proxy)m_items.size();
+    if (!m_freeProxies.empty())
+    {
+      proxy = m_freeProxies.back();
+      m_freeProxies.pop_back();
+    }
+    else
+    {
+      m_items.emplace_back();
+      m_alive.push_back(false);
+    }
+
+    Item& item = m_items[proxy];
+    item = Item();
+    item.box = box;
+    item.center = (box.min + box.max) * 0.5f;
+    item.entity = entity;
+    item.layer = layer;
+    item.minCell = CellOf(box.min);
+    item.maxCell = CellOf(box.max);
+    m_alive[proxy] = true;
+
+    AddToCells(proxy);
+    return proxy;
+  }
+
+  void SpatialHash::MoveSphere(Proxy proxy, const Vec3& center)
+  {
+    float radius = m_items[proxy].radius;
+    BoundingBox box;
+    box.min = center - Vec3(radius);
+    box.max = center + Vec3(radius);
+    Update(proxy, box);
+  }
+
+  void SpatialHash::MoveBox(Proxy proxy, const BoundingBox& box)
+  {
+    Update(proxy, box);
+  }
+
+  void SpatialHash::Remove(Proxy proxy)
+  {
+    assert(m_alive[proxy]);
+    RemoveFromCells(proxy);
+    m_alive[proxy] = false;
+    m_freeProxies.push_back(proxy);
+  }
+
+  void SpatialHash::Clear()
+  {
+    m_cells.clear();
+    m_items.clear();
+    m_alive.clear();
+    m_freeProxies.clear();
+  }
+
+  const SpatialHash::Item& SpatialHash::GetItem(Proxy proxy) const
+  {
+    return m_items[proxy];
+  }
+
+  uint SpatialHash::GetCount() const
+  {
+    return (uint)(m_items.size() - m_freeProxies.size());
+  }
+
+  void SpatialHash::QueryRadius(const Vec3& center, float radius, std::vector<Proxy>& result, uint layerMask) const
+  {
+    BoundingBox box;
+    box.min = center - Vec3(radius);
+    box.max = center + Vec3(radius);
+    QueryBox(box, result, layerMask);
+  }
+
+  void SpatialHash::QueryBox(const BoundingBox& box, std::vector<Proxy>& result, uint layerMask) const
+  {
+    IVec3 minCell = CellOf(box.min);
+    IVec3 maxCell = CellOf(box.max);
+
+    // An item spanning several of the cells is only reported from the first one they share.
+    auto VisitCellFn = [this, &box, &result, layerMask, &minCell](const IVec3& cell, const std::vector<Proxy>& proxies) -> void
+    {
+      for (Proxy proxy : proxies)
+      {
+        const Item& item = m_items[proxy];
+        if ((item.layer & layerMask) == 0 || glm::max(item.minCell, minCell) != cell)
+        {
+          continue;
+        }
+
+        if (Overlaps(item.box, box))
+        {
+          result.push_back(proxy);
+        }
+      }
+    };
+
+    IVec3 span = maxCell - minCell + IVec3(1);
+    if ((size_t)span.x * span.y * span.z > m_cells.size())
+    {
+      // Larger than the occupied part, visit the occupied cells instead.
+      for (const auto& cell : m_cells)
+      {
+        for (Proxy proxy : cell.second)
+        {
+          const Item& item = m_items[proxy];
+          IVec3 start = glm::max(item.minCell, minCell);
+          if (glm::all(glm::lessThanEqual(start, glm::min(item.maxCell, maxCell))) && KeyOf(start) == cell.first)
+          {
+            if ((item.layer & layerMask) != 0 && Overlaps(item.box, box))
+            {
+              result.push_back(proxy);
+            }
+          }
+        }
+      }
+      return;
+    }
+
+    for (int z = minCell.z; z <= maxCell.z; z++)
+    {
+      for (int y = minCell.y; y <= maxCell.y; y++)
+      {
+        for (int x = minCell.x; x <= maxCell.x; x++)
+        {
+          IVec3 cell(x, y, z);
+          auto proxies = m_cells.find(KeyOf(cell));
+          if (proxies != m_cells.end())
+          {
+            VisitCellFn(cell, proxies->second);
+          }
+        }
+      }
+    }
+  }
+
+  void SpatialHash::GetPairs(std::vector<std::pair<Proxy, Proxy>>& pairs, uint layerMask) const
+  {
+    for (const auto& cell : m_cells)
+    {
+      const std::vector<Proxy>& proxies = cell.second;
+      for (size_t i = 0; i < proxies.size(); i++)
+      {
+        const Item& a = m_items[proxies[i]];
+        if ((a.layer & layerMask) == 0)
+        {
+          continue;
+        }
+
+        for (size_t j = i + 1; j < proxies.size(); j++)
+        {
+          const Item& b = m_items[proxies[j]];
+          if ((b.layer & layerMask) == 0 || !Overlaps(a.box, b.box))
+          {
+            continue;
+          }
+
+          // Pairs sharing several cells are reported from the first one.
+          if (KeyOf(glm::max(a.minCell, b.minCell)) == cell.first)
+          {
+            pairs.push_back({ proxies[i], proxies[j] });
+          }
+        }
+      }
+    }
+  }
+
+  void SpatialHash::Update(Proxy proxy, const BoundingBox& box)
+  {
+    Item& item = m_items[proxy];
+    IVec3 minCell = CellOf(box.min);
+    IVec3 maxCell = CellOf(box.max);
+    if (minCell != item.minCell || maxCell != item.maxCell)
+    {
+      RemoveFromCells(proxy);
+      item.minCell = minCell;
+      item.maxCell = maxCell;
+      AddToCells(proxy);
+    }
+
+    item.box = box;
+    item.center = (box.min + box.max) * 0.5f;
+  }
+
+  void SpatialHash::AddToCells(Proxy proxy)
+  {
+    const Item& item = m_items[proxy];
+    for (int z = item.minCell.z; z <= item.maxCell.z; z++)
+    {
+      for (int y = item.minCell.y; y <= item.maxCell.y; y++)
+      {
+        for (int x = item.minCell.x; x <= item.maxCell.x; x++)
+        {
+          m_cells[KeyOf(IVec3(x, y, z))].push_back(proxy);
+        }
+      }
+    }
+  }
+
+  void SpatialHash::RemoveFromCells(Proxy proxy)
+  {
+    const Item& item = m_items[proxy];
+    for (int z = item.minCell.z; z <= item.maxCell.z; z++)
+    {
+      for (int y = item.minCell.y; y <= item.maxCell.y; y++)
+      {
+        for (int x = item.minCell.x; x <= item.maxCell.x; x++)
+        {
+          auto cell = m_cells.find(KeyOf(IVec3(x, y, z)));
+          assert(cell != m_cells.end());
+
+          std::vector<Proxy>& proxies = cell->second;
+          auto entry = std::find(proxies.begin(), proxies.end(), proxy);
+          *entry = proxies.back();
+          proxies.pop_back();
+
+          // Moving items leave a trail of cells, empty ones are dropped.
+          if (proxies.empty())
+          {
+            m_cells.erase(cell);
+          }
+        }
+      }
+    }
+  }
+
+  IVec3 SpatialHash::CellOf(const Vec3& pos) const
+  {
+    return IVec3(glm::floor(pos * m_invCellSize));
+  }
+
+  uint64_t SpatialHash::KeyOf(const IVec3& cell)
+  {
+    // 21 bits per axis, wraps after a million cells along an axis.
+    const uint64_t mask = (1 << 21) - 1;
+    return ((uint64_t)cell.x & mask) << 42 | ((uint64_t)cell.y & mask) << 21 | ((uint64_t)cell.z & mask);
+  }
+
+}
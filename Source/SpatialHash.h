@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Types.h"
+#include "MathUtil.h"
+#include <cstdint>
+#include <unordered_map>
+
+namespace ToolKit
+{
+
+  // Broadphase for gameplay collision queries. Spheres and boxes are put in the cells of a uniform grid they overlap,
+  // cells are hashed so the grid is unbounded. Queries return the items whose bounds overlap, exact tests such as
+  // SphereSphereIntersection are left to the caller. Items are filtered by layer bits, a query takes a mask of layers.
+  // Works best with a cell size around the size of the common items, larger items span several cells.
+  class SpatialHash
+  {
+  public:
+    typedef uint Proxy;
+    static const Proxy InvalidProxy = (Proxy)-1;
+
+    struct Item
+    {
+      BoundingBox box;
+      Vec3 center; // Of the sphere, or the box.
+      float radius = 0.0f; // Zero for boxes.
+      Entity* entity = nullptr;
+      uint layer = 1;
+      IVec3 minCell;
+      IVec3 maxCell;
+    };
+
+  public:
+    SpatialHash(float cellSize = 4.0f);
+
+    Proxy InsertSphere(Entity* entity, const Vec3& center, float radius, uint layer = 1);
+    Proxy InsertBox(Entity* entity, const BoundingBox& box, uint layer = 1);
+    void MoveSphere(Proxy proxy, const Vec3& center); // Cells are only touched when the item leaves its cells.
+    void MoveBox(Proxy proxy, const BoundingBox& box);
+    void Remove(Proxy proxy);
+    void Clear();
+    const Item& GetItem(Proxy proxy) const;
+    uint GetCount() const;
+
+    // Queries append their results, each item is reported once.
+    void QueryRadius(const Vec3& center, float radius, std::vector<Proxy>& result, uint layerMask = ~0u) const; // Bounds overlap the sphere's box.
+    void QueryBox(const BoundingBox& box, std::vector<Proxy>& result, uint layerMask = ~0u) const;
+    void GetPairs(std::vector<std::pair<Proxy, Proxy>>& pairs, uint layerMask = ~0u) const; // Items with overlapping bounds.
+
+  private:
+    void Update(Proxy proxy, const BoundingBox& box);
+    void AddToCells(Proxy proxy);
+    void RemoveFromCells(Proxy proxy);
+    IVec3 CellOf(const Vec3& pos) const;
+    static uint64_t KeyOf(const IVec3& cell);
+
+  private:
+    float m_invCellSize;
+    std::unordered_map<uint64_t, std::vector<Proxy>> m_cells;
+    std::vector<Item> m_items;
+    std::vector<bool> m_alive;
+    std::vector<Proxy> m_freeProxies;
+  };
+
+}
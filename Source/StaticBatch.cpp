@@ -0,0 +1,267 @@
+#include "stdafx.h"
+#include "StaticBatch.h"
+#include "Drawable.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "Node.h"
+#include "Directional.h"
+#include "Renderer.h"
+#include "MathUtil.h"
+#include <map>
+#include <tuple>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  StaticBatch::StaticBatch()
+  {
+  }
+
+  StaticBatch::~StaticBatch()
+  {
+    Clear();
+  }
+
+  void StaticBatch::Build(const EntityRawPtrArray& entities)
+  {
+    Clear();
+
+    struct Chunk
+    {
+      MaterialPtr material;
+      VertexArray vertices;
+      std::vector<uint> indices;
+    };
+    std::vector<Chunk> chunks;
+
+    // Material, cell -> index of the chunk that is being filled.
+    typedef std::tuple<Material*, int, int, int> ChunkKey;
+    std::map<ChunkKey, size_t> openChunks;
+
+    // Flushed meshes are read back from their files, once per file.
+    std::unordered_map<String, MeshPtr> fileCache;
+
+    // Materials that only differ by their uv transforms, such as the ones sharing an atlas page, are merged.
+    std::vector<MaterialPtr> batchMaterials;
+    auto BatchMaterialFn = [&batchMaterials](const MaterialPtr& material) -> MaterialPtr
+    {
+      for (const MaterialPtr& batchMaterial : batchMaterials)
+      {
+        if (Renderer::IsBatchCompatible(batchMaterial.get(), DrawType::Triangle, material.get()))
+        {
+          return batchMaterial;
+        }
+      }
+
+      batchMaterials.push_back(material);
+      return material;
+    };
+
+    for (Entity* ntt : entities)
+    {
+      // Billboards are oriented every frame.
+      if (!ntt->m_static || !ntt->IsDrawable() || ntt->GetType() == EntityType::Entity_Billboard)
+      {
+        continue;
+      }
+
+      Drawable* drawable = static_cast<Drawable*> (ntt);
+      if (drawable->m_mesh == nullptr || drawable->m_mesh->IsSkinned())
+      {
+        continue;
+      }
+
+      MeshRawPtrArray meshes;
+      drawable->m_mesh->GetAllMeshes(meshes);
+
+      MeshRawPtrArray sources = meshes;
+      bool flushed = false;
+      for (Mesh* mesh : meshes)
+      {
+        flushed |= mesh->m_vertexCount > 0 && mesh->m_clientSideVertices.empty();
+      }
+
+      if (flushed)
+      {
+        const String& file = drawable->m_mesh->m_file;
+        if (file.empty())
+        {
+          continue;
+        }
+
+        MeshPtr& cached = fileCache[file];
+        if (cached == nullptr)
+        {
+          cached = MeshPtr(new Mesh(file));
+          cached->Load();
+        }
+
+        sources.clear();
+        cached->GetAllMeshes(sources);
+        if (sources.size() != meshes.size())
+        {
+          continue;
+        }
+      }
+
+      // Only triangle lists are merged, entity is left as is otherwise.
+      bool mergeable = true;
+      for (Mesh* mesh : meshes)
+      {
+        mergeable &= mesh->m_material->GetRenderState()->drawType == DrawType::Triangle;
+      }
+
+      if (!mergeable)
+      {
+        continue;
+      }
+
+      Mat4 transform = ntt->m_node->GetTransform(TransformationSpace::TS_WORLD);
+      for (size_t i = 0; i < meshes.size(); i++)
+      {
+        Mesh baked;
+        baked.m_clientSideVertices = sources[i]->m_clientSideVertices;
+        baked.m_clientSideIndices = sources[i]->m_clientSideIndices;
+        if (baked.m_clientSideVertices.empty())
+        {
+          continue;
+        }
+
+        baked.ApplyTransform(transform);
+        baked.CalculateAABoundingBox();
+
+        if (baked.m_clientSideIndices.empty())
+        {
+          baked.m_clientSideIndices.resize(baked.m_clientSideVertices.size());
+          for (uint j = 0; j < (uint)baked.m_clientSideIndices.size(); j++)
+          {
+            baked.m_clientSideIndices[j] = j;
+          }
+        }
+
+        Vec3 center = (baked.m_aabb.min + baked.m_aabb.max) * 0.5f;
+        glm::ivec3 cell = glm::floor(center / m_chunkSize);
+        const Vec4& uvTransform = meshes[i]->m_material->m_uvTransform;
+        for (Vertex& v : baked.m_clientSideVertices)
+        {
+          v.tex = v.tex * Vec2(uvTransform.z, uvTransform.w) + Vec2(uvTransform.x, uvTransform.y);
+        }
+
+        MaterialPtr material = BatchMaterialFn(meshes[i]->m_material);
+        ChunkKey key(material.get(), cell.x, cell.y, cell.z);
+
+        auto chunkIt = openChunks.find(key);
+        if
+        (
+          chunkIt == openChunks.end() ||
+          chunks[chunkIt->second].vertices.size() + baked.m_clientSideVertices.size() > m_maxChunkVertexCount
+        )
+        {
+          chunks.push_back(Chunk());
+          chunks.back().material = material;
+          openChunks[key] = chunks.size() - 1;
+        }
+
+        Chunk& chunk = chunks[openChunks[key]];
+        uint base = (uint)chunk.vertices.size();
+        chunk.vertices.insert(chunk.vertices.end(), baked.m_clientSideVertices.begin(), baked.m_clientSideVertices.end());
+        for (uint index : baked.m_clientSideIndices)
+        {
+          chunk.indices.push_back(base + index);
+        }
+      }
+
+      m_sources[ntt->m_id] = transform;
+    }
+
+    // Sort by material to minimize state changes.
+    std::stable_sort
+    (
+      chunks.begin(),
+      chunks.end(),
+      [](const Chunk& a, const Chunk& b) -> bool
+      {
+        return a.material.get() < b.material.get();
+      }
+    );
+
+    // Uvs are baked, chunks are drawn with identity uv transforms.
+    std::unordered_map<Material*, MaterialPtr> bakedMaterials;
+    for (Chunk& chunk : chunks)
+    {
+      MaterialPtr material = chunk.material;
+      if (material->m_uvTransform != Vec4(0.0f, 0.0f, 1.0f, 1.0f))
+      {
+        MaterialPtr& baked = bakedMaterials[material.get()];
+        if (baked == nullptr)
+        {
+          baked = MaterialPtr(material->GetCopy());
+          baked->m_uvTransform = Vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        }
+        material = baked;
+      }
+
+      Drawable* drawable = new Drawable();
+      drawable->m_mesh->m_clientSideVertices.swap(chunk.vertices);
+      drawable->m_mesh->m_clientSideIndices.swap(chunk.indices);
+      drawable->m_mesh->m_material = material;
+      drawable->m_mesh->CalculateAABoundingBox();
+      m_chunks.push_back(drawable);
+    }
+  }
+
+  void StaticBatch::Clear()
+  {
+    for (Drawable* chunk : m_chunks)
+    {
+      SafeDel(chunk);
+    }
+    m_chunks.clear();
+    m_sources.clear();
+  }
+
+  bool StaticBatch::IsBuilt() const
+  {
+    return !m_sources.empty();
+  }
+
+  bool StaticBatch::Contains(EntityId id) const
+  {
+    return m_sources.find(id) != m_sources.end();
+  }
+
+  bool StaticBatch::IsModified(Entity* entity) const
+  {
+    auto source = m_sources.find(entity->m_id);
+    if (source == m_sources.end())
+    {
+      return false;
+    }
+
+    return source->second != entity->m_node->GetTransform(TransformationSpace::TS_WORLD);
+  }
+
+  const std::unordered_map<EntityId, Mat4>& StaticBatch::GetSources() const
+  {
+    return m_sources;
+  }
+
+  void StaticBatch::Render(Renderer* renderer, Camera* cam, const LightRawPtrArray& lights)
+  {
+    Mat4 projectView = cam->GetData().projection * cam->GetViewMatrix();
+    Frustum frustum = ExtractFrustum(projectView);
+
+    for (Drawable* chunk : m_chunks)
+    {
+      // Chunks are in world space, their nodes are identity.
+      if (FrustumBoxIntersection(frustum, chunk->m_mesh->m_aabb) == IntersectResult::Outside)
+      {
+        continue;
+      }
+
+      renderer->Render(chunk, cam, lights);
+    }
+  }
+
+}
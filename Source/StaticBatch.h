@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Types.h"
+#include <unordered_map>
+
+namespace ToolKit
+{
+
+  class Drawable;
+  class Renderer;
+  class Camera;
+
+  // Merges the geometry of static entities. World transforms are baked into the vertices and meshes sharing a material
+  // are merged into chunks, split over a uniform grid so each chunk can be frustum culled. Source entities are not modified.
+  class StaticBatch
+  {
+  public:
+    StaticBatch();
+    ~StaticBatch();
+
+    void Build(const EntityRawPtrArray& entities); // Merges static, non skinned drawables. Clears the previous build.
+    void Clear();
+    bool IsBuilt() const;
+    bool Contains(EntityId id) const;
+    bool IsModified(Entity* entity) const; // True if the entity is merged and moved after the build.
+    const std::unordered_map<EntityId, Mat4>& GetSources() const;
+    void Render(Renderer* renderer, Camera* cam, const LightRawPtrArray& lights);
+
+  public:
+    float m_chunkSize = 50.0f;
+    uint m_maxChunkVertexCount = 65536;
+    std::vector<Drawable*> m_chunks; // Sorted by material.
+
+  private:
+    std::unordered_map<EntityId, Mat4> m_sources; // Merged entities and their world transforms at the build time.
+  };
+
+}
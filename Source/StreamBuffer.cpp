@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include "StreamBuffer.h"
+#include <cstring>
+#include "GlCaptureHooks.h"
+#include "Logger.h"
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  StreamBuffer::StreamBuffer(GLenum target, uint regionSize)
+  {
+    m_target = target;
+    m_regionSize = regionSize;
+  }
+
+  StreamBuffer::~StreamBuffer()
+  {
+    for (GLsync& fence : m_fences)
+    {
+      if (fence != nullptr)
+      {
+        glDeleteSync(fence);
+        fence = nullptr;
+      }
+    }
+
+    glDeleteBuffers(1, &m_id);
+  }
+
+  uint StreamBuffer::Write(const void* data, uint size, uint alignment)
+  {
+    if (m_id == 0)
+    {
+      glGenBuffers(1, &m_id);
+      Allocate(m_regionSize);
+    }
+
+    uint base = m_region * m_regionSize;
+    uint start = (base + m_offset + alignment - 1) / alignment * alignment;
+    if (start + size > base + m_regionSize)
+    {
+      // Draws issued from the old storage are kept alive by the driver.
+      Allocate(glm::max(m_regionSize * 2, size + alignment));
+      base = 0;
+      start = 0;
+    }
+
+    glBindBuffer(m_target, m_id);
+    void* dest = nullptr;
+    if (IsFenceSupported() && !m_mapFailed)
+    {
+      // Region is known to be free, no need for the driver to synchronize.
+      GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+      dest = glMapBufferRange(m_target, start, size, access);
+      if (dest == nullptr)
+      {
+        // A driver that refuses once keeps refusing, don't retry each write.
+        m_mapFailed = true;
+        Logger::GetInstance()->Log("Stream buffer: glMapBufferRange failed with error " + std::to_string(glGetError()) + ", using glBufferSubData from now on.");
+      }
+    }
+
+    if (dest != nullptr)
+    {
+      memcpy(dest, data, size);
+      glUnmapBuffer(m_target);
+    }
+    else
+    {
+      glBufferSubData(m_target, start, size, data);
+    }
+
+    m_offset = start + size - base;
+    return start;
+  }
+
+  void StreamBuffer::NextFrame()
+  {
+    if (m_id == 0)
+    {
+      return;
+    }
+
+    if (IsFenceSupported())
+    {
+      m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    m_region = (m_region + 1) % m_regionCount;
+    m_offset = 0;
+
+    if (IsFenceSupported())
+    {
+      WaitRegion(m_region);
+    }
+    else if (m_region == 0)
+    {
+      glBindBuffer(m_target, m_id);
+      glBufferData(m_target, m_regionSize * m_regionCount, nullptr, GL_STREAM_DRAW);
+    }
+  }
+
+  bool StreamBuffer::IsFenceSupported()
+  {
+    return GLEW_VERSION_3_2 || GLEW_ARB_sync;
+  }
+
+  void StreamBuffer::Allocate(uint regionSize)
+  {
+    for (uint i = 0; i < m_regionCount; i++)
+    {
+      if (m_fences[i] != nullptr)
+      {
+        glDeleteSync(m_fences[i]);
+        m_fences[i] = nullptr;
+      }
+    }
+
+    m_regionSize = regionSize;
+    m_region = 0;
+    m_offset = 0;
+
+    glBindBuffer(m_target, m_id);
+    glBufferData(m_target, m_regionSize * m_regionCount, nullptr, GL_STREAM_DRAW);
+  }
+
+  void StreamBuffer::WaitRegion(uint region)
+  {
+    GLsync& fence = m_fences[region];
+    if (fence == nullptr)
+    {
+      return;
+    }
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+      m_fenceWaitCount++;
+      const GLuint64 timeout = 100000000; // 100 ms.
+      do
+      {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+      } while (result == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Types.h"
+#include "GL/glew.h"
+
+namespace ToolKit
+{
+
+  // Persistent buffer for geometry that is rewritten every frame. The buffer is split into m_regionCount regions,
+  // each frame writes into the next one. A region is rewritten only after the gpu is done with the frame that used it:
+  // with sync objects the cpu waits on the region's fence, otherwise the storage is orphaned at each wrap.
+  // Grows, by orphaning, when a frame doesn't fit into a region.
+  class StreamBuffer
+  {
+  public:
+    StreamBuffer(GLenum target, uint regionSize);
+    ~StreamBuffer();
+
+    uint Write(const void* data, uint size, uint alignment = 4); // Returns the byte offset of the data. Leaves the buffer bound.
+    void NextFrame(); // Call once the frame's draws are issued.
+    static bool IsFenceSupported();
+
+  public:
+    GLuint m_id = 0;
+    static const uint m_regionCount = 3;
+    uint m_fenceWaitCount = 0; // Times the cpu blocked on a region still in use.
+
+  private:
+    void Allocate(uint regionSize);
+    void WaitRegion(uint region);
+
+  private:
+    GLenum m_target;
+    uint m_regionSize;
+    uint m_region = 0;
+    uint m_offset = 0; // Write position in the current region.
+    bool m_mapFailed = false; // Writes go through glBufferSubData after the first failed map.
+    GLsync m_fences[m_regionCount] = {};
+  };
+
+}
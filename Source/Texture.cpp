@@ -2,6 +2,7 @@
 #include "Texture.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "Stb/stb_image.h"
+#include "GlCaptureHooks.h"
 #include "DebugNew.h"
 
 namespace ToolKit
@@ -15,6 +15,7 @@ namespace ToolKit
   void Main::Init()
   {
     Logger::GetInstance()->Log("ToolKit Initialization");
+    m_jobSystem.Init();
     m_animationMan.Init();
     m_textureMan.Init();
     m_meshMan.Init();
@@ -23,6 +24,7 @@ namespace ToolKit
     m_audioMan.Init();
     m_shaderMan.Init();
     m_materialManager.Init();
+    m_prefabMan.Init();
 
     m_initiated = true;
   }
@@ -30,6 +32,7 @@ namespace ToolKit
   void Main::Uninit()
   {
     m_animationPlayer.m_records.clear();
+    m_prefabMan.Uninit(); // Templates hold meshes.
     m_animationMan.Uninit();
     m_textureMan.Uninit();
     m_meshMan.Uninit();
@@ -38,12 +41,18 @@ namespace ToolKit
     m_audioMan.Uninit();
     m_shaderMan.Uninit();
     m_materialManager.Uninit();
+    m_jobSystem.Uninit();
 
     m_initiated = false;
   }
 
   Main::Main()
   {
+    // Pools are function statics. Created while the instance is constructed, they are destroyed after it, so the
+    // resources the managers still hold at exit are freed into live pools.
+    Node::GetPool();
+    Entity::GetPool();
+    Mesh::GetPool();
   }
 
   Main* Main::GetInstance()
@@ -66,6 +75,11 @@ namespace ToolKit
     return &Main::GetInstance()->m_audioMan;
   }
 
+  JobSystem* GetJobSystem()
+  {
+    return &Main::GetInstance()->m_jobSystem;
+  }
+
   MaterialManager* GetMaterialManager()
   {
     return &Main::GetInstance()->m_materialManager;
@@ -76,6 +90,11 @@ namespace ToolKit
     return &Main::GetInstance()->m_meshMan;
   }
 
+  PrefabManager* GetPrefabManager()
+  {
+    return &Main::GetInstance()->m_prefabMan;
+  }
+
   ShaderManager* GetShaderManager()
   {
     return &Main::GetInstance()->m_shaderMan;
@@ -171,4 +190,11 @@ namespace ToolKit
     return path;
   }
 
+  String PrefabPath(const String& file)
+  {
+    String path = "..\\Resources\\Prefabs\\";
+    path += file;
+    return path;
+  }
+
 }
@@ -1,21 +1,38 @@
 #pragma once
 
 #include "Animation.h"
+#include "AnimationCompression.h"
 #include "Audio.h"
+#include "Benchmark.h"
+#include "BVH.h"
 #include "Directional.h"
 #include "Drawable.h"
 #include "Entity.h"
+#include "FramePipeline.h"
+#include "FrameGraph.h"
+#include "GlCapture.h"
+#include "Headless.h"
+#include "JobSystem.h"
+#include "LightClusters.h"
 #include "Material.h"
 #include "Mesh.h"
 #include "Node.h"
+#include "ObjectPool.h"
+#include "OcclusionCulling.h"
+#include "Prefab.h"
 #include "Primative.h"
 #include "RenderState.h"
 #include "Renderer.h"
 #include "Shader.h"
+#include "SpatialHash.h"
 #include "SpriteSheet.h"
+#include "StaticBatch.h"
+#include "StreamBuffer.h"
 #include "StateMachine.h"
 #include "Surface.h"
 #include "Texture.h"
+#include "TransformSystem.h"
+#include "TriangleBVH.h"
 #include "Types.h"
 
 namespace ToolKit
@@ -43,8 +60,10 @@ namespace ToolKit
     AnimationManager m_animationMan;
     AnimationPlayer m_animationPlayer;
     AudioManager m_audioMan;
+    JobSystem m_jobSystem;
     MaterialManager m_materialManager;
     MeshManager m_meshMan;
+    PrefabManager m_prefabMan;
     ShaderManager m_shaderMan;
     SkinMeshManager m_skinMeshMan;
     SpriteSheetManager m_spriteSheetMan;
@@ -56,8 +75,10 @@ namespace ToolKit
   AnimationManager* GetAnimationManager();
   AnimationPlayer* GetAnimationPlayer();
   AudioManager* GetAudioManager();
+  JobSystem* GetJobSystem();
   MaterialManager* GetMaterialManager();
   MeshManager* GetMeshManager();
+  PrefabManager* GetPrefabManager();
   ShaderManager* GetShaderManager();
   SkinMeshManager* GetSkinMeshManager();
   SpriteSheetManager* GetSpriteSheetManager();
@@ -74,5 +95,6 @@ namespace ToolKit
   String ShaderPath(const String& file);
   String MaterialPath(const String& file);
   String ScenePath(const String& file);
+  String PrefabPath(const String& file);
 
 }
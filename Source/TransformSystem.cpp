@@ -0,0 +1,393 @@
+#include "stdafx.h"
+#include "TransformSystem.h"
+#include "Node.h"
+#include "ToolKit.h"
+#include <chrono>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  TransformSystem::~TransformSystem()
+  {
+    for (Node* node : m_nodes)
+    {
+      if (node != nullptr)
+      {
+        node->m_transformSystem = nullptr;
+      }
+    }
+  }
+
+  TransformSystem::Handle TransformSystem::Create(Handle parent)
+  {
+    Handle handle = (Handle)m_indices.size();
+    if (!m_freeHandles.empty())
+    {
+      handle = m_freeHandles.back();
+      m_freeHandles.pop_back();
+    }
+    else
+    {
+      m_indices.push_back(-1);
+    }
+
+    int index = (int)m_handles.size();
+    m_indices[handle] = index;
+
+    m_translations.push_back(Vec3());
+    m_orientations.push_back(Quaternion());
+    m_scales.push_back(Vec3(1.0f));
+    m_worlds.push_back(Mat4());
+    m_parents.push_back(parent == InvalidHandle ? -1 : m_indices[parent]);
+    m_flags.push_back(Dirty);
+    m_nodes.push_back(nullptr);
+    m_handles.push_back(handle);
+
+    // Tasks are rebuilt.
+    m_orderDirty = true;
+    return handle;
+  }
+
+  void TransformSystem::Destroy(Handle handle)
+  {
+    // The slot is dropped by the next reorder, children pointing to it become roots there.
+    int index = m_indices[handle];
+    assert(index != -1);
+    if (m_nodes[index] != nullptr)
+    {
+      m_nodes[index]->m_transformSystem = nullptr;
+      m_nodes[index] = nullptr;
+    }
+
+    m_handles[index] = InvalidHandle;
+    m_indices[handle] = -1;
+    m_freeHandles.push_back(handle);
+    m_orderDirty = true;
+  }
+
+  void TransformSystem::SetLocal(Handle handle, const Vec3& translation, const Quaternion& orientation, const Vec3& scale)
+  {
+    int index = m_indices[handle];
+    m_translations[index] = translation;
+    m_orientations[index] = orientation;
+    m_scales[index] = scale;
+    m_flags[index] |= Dirty;
+  }
+
+  void TransformSystem::SetParent(Handle handle, Handle parent)
+  {
+    int index = m_indices[handle];
+    int parentIndex = parent == InvalidHandle ? -1 : m_indices[parent];
+    if (m_parents[index] != parentIndex)
+    {
+      m_parents[index] = parentIndex;
+      m_flags[index] |= Dirty;
+      m_orderDirty = true;
+    }
+  }
+
+  void TransformSystem::SetInheritance(Handle handle, bool inheritScale, bool inheritOnlyTranslate)
+  {
+    uint8& flags = m_flags[m_indices[handle]];
+    flags = Dirty | (inheritScale ? InheritScale : 0) | (inheritOnlyTranslate ? InheritOnlyTranslate : 0);
+  }
+
+  const Mat4& TransformSystem::GetWorld(Handle handle) const
+  {
+    return m_worlds[m_indices[handle]];
+  }
+
+  uint TransformSystem::GetCount() const
+  {
+    return (uint)(m_indices.size() - m_freeHandles.size());
+  }
+
+  void TransformSystem::Add(Node* node)
+  {
+    while (node->m_parent != nullptr)
+    {
+      node = node->m_parent;
+    }
+
+    AddTree(node);
+  }
+
+  void TransformSystem::AddTree(Node* node)
+  {
+    assert(node->m_transformSystem == nullptr || node->m_transformSystem == this);
+    if (node->m_transformSystem == nullptr)
+    {
+      Handle handle = Create();
+      m_nodes[m_indices[handle]] = node;
+      node->m_transformSystem = this;
+      node->m_transformHandle = handle;
+      Sync(node);
+    }
+
+    for (Node* child : node->m_children)
+    {
+      AddTree(child);
+    }
+  }
+
+  void TransformSystem::Remove(Node* node)
+  {
+    assert(node->m_transformSystem == this);
+    Destroy(node->m_transformHandle);
+  }
+
+  void TransformSystem::Sync(Node* node)
+  {
+    int index = m_indices[node->m_transformHandle];
+    m_translations[index] = node->m_translation;
+    m_orientations[index] = node->m_orientation;
+    m_scales[index] = node->m_scale;
+    m_flags[index] = Dirty | (node->m_inheritScale ? InheritScale : 0) | (node->m_inheritOnlyTranslate ? InheritOnlyTranslate : 0);
+
+    // Parents are added before their children, an untracked parent is only seen while a tree is being added.
+    int parentIndex = -1;
+    if (node->m_parent != nullptr && node->m_parent->m_transformSystem == this)
+    {
+      parentIndex = m_indices[node->m_parent->m_transformHandle];
+    }
+
+    if (m_parents[index] != parentIndex)
+    {
+      m_parents[index] = parentIndex;
+      m_orderDirty = true;
+    }
+  }
+
+  void TransformSystem::Update()
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (m_orderDirty)
+    {
+      Reorder();
+    }
+
+    std::vector<uint> updated(m_tasks.size(), 0);
+    auto UpdateTaskFn = [this, &updated](const Range& range) -> void
+    {
+      uint count = 0;
+      for (uint i = range.begin; i < range.end; i++)
+      {
+        int parent = m_parents[i];
+        uint8 flags = m_flags[i];
+        if (parent != -1 && (m_flags[parent] & Dirty))
+        {
+          flags |= Dirty;
+          m_flags[i] = flags;
+        }
+
+        if (!(flags & Dirty))
+        {
+          continue;
+        }
+
+        Mat4 ps;
+        if (parent != -1)
+        {
+          ps = m_worlds[parent];
+          if (flags & InheritOnlyTranslate)
+          {
+            ps = glm::translate(Mat4(), Vec3(ps[3]));
+          }
+          else if (!(flags & InheritScale))
+          {
+            ps[0].xyz = glm::normalize(Vec3(ps[0]));
+            ps[1].xyz = glm::normalize(Vec3(ps[1]));
+            ps[2].xyz = glm::normalize(Vec3(ps[2]));
+          }
+        }
+
+        // Same as translate * rotate * scale, without the full products.
+        const Vec3& scale = m_scales[i];
+        Mat4 ts = glm::toMat4(m_orientations[i]);
+        ts[0] *= scale.x;
+        ts[1] *= scale.y;
+        ts[2] *= scale.z;
+        ts[3] = Vec4(m_translations[i], 1.0f);
+
+        m_worlds[i] = ps * ts;
+        count++;
+
+        // Parents are written earlier in the same task, their world versions are final here.
+        if (Node* node = m_nodes[i])
+        {
+          node->m_parentCache = ps;
+          node->m_worldCache = m_worlds[i];
+          node->m_worldVersion++;
+          node->m_worldLocalVersion = node->m_localVersion;
+          node->m_worldParentVersion = node->m_parent != nullptr ? node->m_parent->m_worldVersion : 0;
+          node->m_validatedEpoch = Node::m_epoch;
+        }
+      }
+
+      // Children check their parent's flag, cleared once the whole range is done.
+      for (uint i = range.begin; i < range.end; i++)
+      {
+        m_flags[i] &= ~Dirty;
+      }
+
+      updated[&range - m_tasks.data()] = count;
+    };
+
+    auto UpdateTasksFn = [this, &UpdateTaskFn](uint begin, uint end) -> void
+    {
+      for (uint i = begin; i < end; i++)
+      {
+        UpdateTaskFn(m_tasks[i]);
+      }
+    };
+
+    if (m_parallel)
+    {
+      GetJobSystem()->ParallelFor((uint)m_tasks.size(), UpdateTasksFn, 1, "UpdateTransforms");
+    }
+    else
+    {
+      UpdateTasksFn(0, (uint)m_tasks.size());
+    }
+
+    m_stats.count = (uint)m_handles.size();
+    m_stats.tasks = (uint)m_tasks.size();
+    m_stats.updated = 0;
+    for (uint count : updated)
+    {
+      m_stats.updated += count;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.updateMs = std::chrono::duration<float, std::milli>(end - start).count();
+  }
+
+  const TransformSystem::Stats& TransformSystem::GetStats() const
+  {
+    return m_stats;
+  }
+
+  void TransformSystem::Reorder()
+  {
+    uint count = (uint)m_handles.size();
+    auto AliveFn = [this](int index) -> bool
+    {
+      return index != -1 && m_handles[index] != InvalidHandle;
+    };
+
+    // Children lists, packed.
+    std::vector<uint> childStart(count + 1, 0);
+    for (uint i = 0; i < count; i++)
+    {
+      if (AliveFn(i) && AliveFn(m_parents[i]))
+      {
+        childStart[m_parents[i] + 1]++;
+      }
+    }
+
+    for (uint i = 0; i < count; i++)
+    {
+      childStart[i + 1] += childStart[i];
+    }
+
+    std::vector<uint> children(childStart[count]);
+    std::vector<uint> fill(childStart.begin(), childStart.end() - 1);
+    for (uint i = 0; i < count; i++)
+    {
+      if (AliveFn(i) && AliveFn(m_parents[i]))
+      {
+        children[fill[m_parents[i]]++] = i;
+      }
+    }
+
+    // Depth first from every root keeps subtrees contiguous.
+    std::vector<uint> order;
+    order.reserve(count);
+    std::vector<uint> stack;
+    m_tasks.clear();
+    Range task = { 0, 0 };
+    for (uint i = 0; i < count; i++)
+    {
+      if (!AliveFn(i) || AliveFn(m_parents[i]))
+      {
+        continue;
+      }
+
+      // Parent removed.
+      if (m_parents[i] != -1)
+      {
+        m_parents[i] = -1;
+        m_flags[i] |= Dirty;
+      }
+
+      stack.push_back(i);
+      while (!stack.empty())
+      {
+        uint index = stack.back();
+        stack.pop_back();
+        order.push_back(index);
+        for (uint c = childStart[index + 1]; c > childStart[index]; c--)
+        {
+          stack.push_back(children[c - 1]);
+        }
+      }
+
+      task.end = (uint)order.size();
+      if (task.end - task.begin >= m_minTaskSize)
+      {
+        m_tasks.push_back(task);
+        task.begin = task.end;
+      }
+    }
+
+    if (task.end > task.begin)
+    {
+      m_tasks.push_back(task);
+    }
+
+    // Permute.
+    std::vector<int> newIndices(count, -1);
+    for (uint i = 0; i < (uint)order.size(); i++)
+    {
+      newIndices[order[i]] = (int)i;
+    }
+
+    auto PermuteFn = [&order](auto& values) -> void
+    {
+      std::remove_reference_t<decltype(values)> permuted;
+      permuted.reserve(order.size());
+      for (uint index : order)
+      {
+        permuted.push_back(values[index]);
+      }
+      values.swap(permuted);
+    };
+
+    PermuteFn(m_translations);
+    PermuteFn(m_orientations);
+    PermuteFn(m_scales);
+    PermuteFn(m_worlds);
+    PermuteFn(m_parents);
+    PermuteFn(m_flags);
+    PermuteFn(m_nodes);
+    PermuteFn(m_handles);
+
+    for (int& parent : m_parents)
+    {
+      if (parent != -1)
+      {
+        parent = newIndices[parent];
+      }
+    }
+
+    for (uint i = 0; i < (uint)m_handles.size(); i++)
+    {
+      m_indices[m_handles[i]] = (int)i;
+    }
+
+    m_orderDirty = false;
+  }
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+
+namespace ToolKit
+{
+
+  // Flat storage for large transform hierarchies. Local translation, orientation, scale and world matrices are kept in
+  // arrays ordered parent before child, with every root's subtree contiguous. Update recomputes the dirty world
+  // matrices in one linear pass, subtrees are grouped into tasks and run on worker threads.
+  // Entries are created directly through handles, or mirror Nodes added with Add. Tracked nodes push their changes
+  // here and get their world caches written back by Update, so their world queries stay O(1) after it.
+  // The FramePipeline mirrors the hierarchies of the drawables. Animation jobs Sync their nodes concurrently, which is
+  // safe as Sync only writes the node's own entry while its parent stays the same. Structural changes (Create,
+  // Destroy, Add, Remove, reparenting) and Update must not overlap anything else.
+  class TransformSystem
+  {
+  public:
+    typedef uint Handle;
+    static const Handle InvalidHandle = (Handle)-1;
+
+    struct Stats
+    {
+      uint count = 0;
+      uint updated = 0;
+      uint tasks = 0;
+      float updateMs = 0.0f;
+    };
+
+  public:
+    ~TransformSystem();
+
+    Handle Create(Handle parent = InvalidHandle);
+    void Destroy(Handle handle); // Children become roots.
+    void SetLocal(Handle handle, const Vec3& translation, const Quaternion& orientation, const Vec3& scale);
+    void SetParent(Handle handle, Handle parent);
+    void SetInheritance(Handle handle, bool inheritScale, bool inheritOnlyTranslate);
+    const Mat4& GetWorld(Handle handle) const; // As of the last Update.
+    uint GetCount() const;
+
+    void Add(Node* node); // Tracks the whole hierarchy the node is in.
+    void Remove(Node* node); // Called by the Node destructor.
+    void Sync(Node* node); // Called by Node when its local transform or parent changes. See the thread notes above.
+
+    void Update();
+    const Stats& GetStats() const;
+
+  public:
+    bool m_parallel = true;
+    uint m_minTaskSize = 2048; // Consecutive root subtrees are grouped until a task has this many entries.
+
+  private:
+    enum Flags : uint8
+    {
+      Dirty = 1,
+      InheritScale = 2,
+      InheritOnlyTranslate = 4
+    };
+
+    struct Range
+    {
+      uint begin;
+      uint end;
+    };
+
+    void AddTree(Node* node);
+    void Reorder();
+
+  private:
+    // Per entry, in hierarchy order.
+    std::vector<Vec3> m_translations;
+    std::vector<Quaternion> m_orientations;
+    std::vector<Vec3> m_scales;
+    std::vector<Mat4> m_worlds;
+    std::vector<int> m_parents; // Index, -1 for roots.
+    std::vector<uint8> m_flags;
+    std::vector<Node*> m_nodes; // Null for entries created with handles.
+    std::vector<Handle> m_handles;
+
+    std::vector<int> m_indices; // Handle to index, -1 for free handles.
+    std::vector<Handle> m_freeHandles;
+    std::vector<Range> m_tasks;
+    std::atomic<bool> m_orderDirty { false }; // Also set by Sync.
+    Stats m_stats;
+  };
+
+}
@@ -0,0 +1,363 @@
+#include "stdafx.h"
+#include "TriangleBVH.h"
+#include "Mesh.h"
+#include <algorithm>
+#include "DebugNew.h"
+
+namespace ToolKit
+{
+
+  static const uint LeafFlag = 0x80000000;
+  static const uint LeafCountBits = 3;
+  static const uint LeafCountMask = (1 << LeafCountBits) - 1;
+
+  static float AreaOf(const BoundingBox& box)
+  {
+    Vec3 d = box.max - box.min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+
+  static void Grow(BoundingBox& box, const BoundingBox& other)
+  {
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+  }
+
+  // Distance where the ray enters the box, 0 if it starts inside, FLT_MAX if it misses.
+  static float RayEntry(const Vec3& origin, const Vec3& invDir, const BoundingBox& box)
+  {
+    Vec3 t1 = (box.min - origin) * invDir;
+    Vec3 t2 = (box.max - origin) * invDir;
+    Vec3 tNear = glm::min(t1, t2);
+    Vec3 tFar = glm::max(t1, t2);
+
+    float tmin = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+    float tmax = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+    return tmin <= tmax ? tmin : FLT_MAX;
+  }
+
+  void TriangleBVH::Build(const VertexArray& vertices, const std::vector<uint>& indices)
+  {
+    m_positions.clear();
+    m_indices.clear();
+    m_nodes.clear();
+    m_depth = 0;
+
+    uint triangleCount = (uint)indices.size() / 3;
+    if (triangleCount == 0)
+    {
+      return;
+    }
+
+    assert(triangleCount < (LeafFlag >> LeafCountBits) && "Too many triangles.");
+
+    m_positions.reserve(vertices.size());
+    for (const Vertex& v : vertices)
+    {
+      m_positions.push_back(v.pos);
+    }
+
+    std::vector<BoundingBox> boxes(triangleCount);
+    Vec3Array centroids(triangleCount);
+    std::vector<uint> triangles(triangleCount);
+    BoundingBox bounds;
+    for (uint i = 0; i < triangleCount; i++)
+    {
+      BoundingBox& box = boxes[i];
+      for (uint j = 0; j < 3; j++)
+      {
+        const Vec3& pos = m_positions[indices[i * 3 + j]];
+        box.min = glm::min(box.min, pos);
+        box.max = glm::max(box.max, pos);
+      }
+
+      centroids[i] = (box.min + box.max) * 0.5f;
+      triangles[i] = i;
+      Grow(bounds, box);
+    }
+
+    // Slightly over the extent so that the last step reaches the bounds despite rounding.
+    m_origin = bounds.min;
+    m_scale = (bounds.max - bounds.min) * (1.0f + 1e-5f) / 65535.0f;
+
+    std::vector<BuildNode> nodes;
+    nodes.reserve(triangleCount * 2);
+    nodes.emplace_back();
+    nodes[0].count = triangleCount;
+    m_depth = Split(nodes, 0, triangles, boxes, centroids);
+
+    m_indices.resize(triangles.size() * 3);
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+      for (uint j = 0; j < 3; j++)
+      {
+        m_indices[i * 3 + j] = indices[triangles[i] * 3 + j];
+      }
+    }
+
+    m_nodes.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      const BuildNode& node = nodes[i];
+      Quantize(node.box, m_nodes[i]);
+      if (node.count > 0)
+      {
+        m_nodes[i].data = LeafFlag | (node.first << LeafCountBits) | (node.count - 1);
+      }
+      else
+      {
+        m_nodes[i].data = node.left;
+      }
+    }
+  }
+
+  bool TriangleBVH::RayCast(const Ray& ray, float& t) const
+  {
+    if (m_nodes.empty())
+    {
+      return false;
+    }
+
+    Vec3 invDir = 1.0f / ray.direction;
+    float rootEntry = RayEntry(ray.position, invDir, Dequantize(m_nodes[0]));
+    if (rootEntry == FLT_MAX)
+    {
+      return false;
+    }
+
+    float closest = FLT_MAX;
+    std::vector<std::pair<uint, float>> stack;
+    stack.reserve(m_depth + 1);
+    stack.push_back({ 0, rootEntry });
+    while (!stack.empty())
+    {
+      std::pair<uint, float> top = stack.back();
+      stack.pop_back();
+
+      // Closer hit found after the push.
+      if (top.second >= closest)
+      {
+        continue;
+      }
+
+      const QuantizedNode& node = m_nodes[top.first];
+      if (node.data & LeafFlag)
+      {
+        uint first = (node.data & ~LeafFlag) >> LeafCountBits;
+        uint count = (node.data & LeafCountMask) + 1;
+        for (uint i = first; i < first + count; i++)
+        {
+          float dist = FLT_MAX;
+          const uint* tri = &m_indices[i * 3];
+          if (RayTriangleIntersection(ray, m_positions[tri[0]], m_positions[tri[1]], m_positions[tri[2]], dist))
+          {
+            closest = glm::min(closest, dist);
+          }
+        }
+        continue;
+      }
+
+      uint nearChild = node.data;
+      uint farChild = node.data + 1;
+      float nearEntry = RayEntry(ray.position, invDir, Dequantize(m_nodes[nearChild]));
+      float farEntry = RayEntry(ray.position, invDir, Dequantize(m_nodes[farChild]));
+      if (farEntry < nearEntry)
+      {
+        std::swap(nearChild, farChild);
+        std::swap(nearEntry, farEntry);
+      }
+
+      // Nearer child goes on top.
+      if (farEntry < closest)
+      {
+        stack.push_back({ farChild, farEntry });
+      }
+
+      if (nearEntry < closest)
+      {
+        stack.push_back({ nearChild, nearEntry });
+      }
+    }
+
+    if (closest == FLT_MAX)
+    {
+      return false;
+    }
+
+    t = closest;
+    return true;
+  }
+
+  bool TriangleBVH::IsEmpty() const
+  {
+    return m_nodes.empty();
+  }
+
+  TriangleBVH::Stats TriangleBVH::GetStats() const
+  {
+    Stats stats;
+    stats.triangles = (uint)m_indices.size() / 3;
+    stats.nodes = (uint)m_nodes.size();
+    stats.depth = m_depth;
+    stats.bytes = m_positions.size() * sizeof(Vec3) + m_indices.size() * sizeof(uint) + m_nodes.size() * sizeof(QuantizedNode);
+    return stats;
+  }
+
+  uint TriangleBVH::Split(std::vector<BuildNode>& nodes, uint index, std::vector<uint>& triangles, const std::vector<BoundingBox>& boxes, const Vec3Array& centroids)
+  {
+    uint first = nodes[index].first;
+    uint count = nodes[index].count;
+
+    BoundingBox box;
+    BoundingBox centroidBox;
+    for (uint i = first; i < first + count; i++)
+    {
+      Grow(box, boxes[triangles[i]]);
+      centroidBox.min = glm::min(centroidBox.min, centroids[triangles[i]]);
+      centroidBox.max = glm::max(centroidBox.max, centroids[triangles[i]]);
+    }
+    nodes[index].box = box;
+
+    if (count <= MaxLeafSize)
+    {
+      return 1;
+    }
+
+    Vec3 extent = centroidBox.max - centroidBox.min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    // Binned surface area heuristic, a traversal step costs as much as a triangle test.
+    uint mid = 0;
+    if (extent[axis] > 0.0f)
+    {
+      const int binCount = 16;
+      BoundingBox bins[binCount];
+      uint counts[binCount] = {};
+      float scale = binCount / extent[axis];
+      float axisMin = centroidBox.min[axis];
+      auto BinOfFn = [&centroids, scale, axisMin, axis](uint triangle) -> int
+      {
+        return glm::min((int)((centroids[triangle][axis] - axisMin) * scale), binCount - 1);
+      };
+
+      for (uint i = first; i < first + count; i++)
+      {
+        int bin = BinOfFn(triangles[i]);
+        counts[bin]++;
+        Grow(bins[bin], boxes[triangles[i]]);
+      }
+
+      float rightAreas[binCount] = {};
+      uint rightCounts[binCount] = {};
+      BoundingBox accumulated;
+      uint accumulatedCount = 0;
+      for (int bin = binCount - 1; bin > 0; bin--)
+      {
+        Grow(accumulated, bins[bin]);
+        accumulatedCount += counts[bin];
+        rightAreas[bin] = accumulatedCount > 0 ? AreaOf(accumulated) : 0.0f;
+        rightCounts[bin] = accumulatedCount;
+      }
+
+      float bestCost = FLT_MAX;
+      int bestSplit = -1;
+      accumulated = BoundingBox();
+      accumulatedCount = 0;
+      for (int bin = 1; bin < binCount; bin++)
+      {
+        Grow(accumulated, bins[bin - 1]);
+        accumulatedCount += counts[bin - 1];
+        if (accumulatedCount == 0 || rightCounts[bin] == 0)
+        {
+          continue;
+        }
+
+        float cost = AreaOf(accumulated) * accumulatedCount + rightAreas[bin] * rightCounts[bin];
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestSplit = bin;
+        }
+      }
+
+      float area = AreaOf(box);
+      bool worthSplitting = area <= 0.0f || 1.0f + bestCost / area < (float)count;
+      if (bestSplit != -1 && (worthSplitting || count > LeafCountMask + 1))
+      {
+        auto split = std::partition
+        (
+          triangles.begin() + first,
+          triangles.begin() + first + count,
+          [&BinOfFn, bestSplit](uint triangle) -> bool
+          {
+            return BinOfFn(triangle) < bestSplit;
+          }
+        );
+        mid = (uint)(split - triangles.begin());
+      }
+    }
+
+    if (mid == 0)
+    {
+      if (count <= LeafCountMask + 1)
+      {
+        return 1;
+      }
+
+      // Too many triangles for a leaf, split in half.
+      mid = first + count / 2;
+      std::nth_element
+      (
+        triangles.begin() + first,
+        triangles.begin() + mid,
+        triangles.begin() + first + count,
+        [&centroids, axis](uint a, uint b) -> bool
+        {
+          return centroids[a][axis] < centroids[b][axis];
+        }
+      );
+    }
+
+    uint left = (uint)nodes.size();
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[left].first = first;
+    nodes[left].count = mid - first;
+    nodes[left + 1].first = mid;
+    nodes[left + 1].count = first + count - mid;
+    nodes[index].left = left;
+    nodes[index].count = 0;
+
+    uint leftDepth = Split(nodes, left, triangles, boxes, centroids);
+    uint rightDepth = Split(nodes, left + 1, triangles, boxes, centroids);
+    return 1 + glm::max(leftDepth, rightDepth);
+  }
+
+  void TriangleBVH::Quantize(const BoundingBox& box, QuantizedNode& node) const
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      if (m_scale[i] <= 0.0f)
+      {
+        node.min[i] = 0;
+        node.max[i] = 0;
+        continue;
+      }
+
+      // Rounded outwards by a step more, covering the float error of the conversions.
+      float low = glm::floor((box.min[i] - m_origin[i]) / m_scale[i]) - 1.0f;
+      float high = glm::ceil((box.max[i] - m_origin[i]) / m_scale[i]) + 1.0f;
+      node.min[i] = (uint16_t)glm::clamp(low, 0.0f, 65535.0f);
+      node.max[i] = (uint16_t)glm::clamp(high, 0.0f, 65535.0f);
+    }
+  }
+
+  BoundingBox TriangleBVH::Dequantize(const QuantizedNode& node) const
+  {
+    BoundingBox box;
+    box.min = m_origin + Vec3(node.min[0], node.min[1], node.min[2]) * m_scale;
+    box.max = m_origin + Vec3(node.max[0], node.max[1], node.max[2]) * m_scale;
+    return box;
+  }
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Types.h"
+#include "MathUtil.h"
+#include <cstdint>
+
+namespace ToolKit
+{
+
+  // Static bounding volume hierarchy over the triangles of a single mesh, built once with the surface area heuristic and
+  // used for closest hit ray queries. Keeps its own copy of the positions and the triangle indices in leaf order, so it
+  // stays usable after the mesh flushes its client side arrays. Node bounds are quantized to 16 bits relative to the mesh
+  // bounds, rounded outwards, which keeps a node in 16 bytes.
+  class TriangleBVH
+  {
+  public:
+    struct Stats
+    {
+      uint triangles = 0;
+      uint nodes = 0;
+      uint depth = 0;
+      size_t bytes = 0;
+    };
+
+  public:
+    void Build(const VertexArray& vertices, const std::vector<uint>& indices); // Triangles are read from the indices.
+    bool RayCast(const Ray& ray, float& t) const; // Closest hit with t > 0.
+    bool IsEmpty() const;
+    Stats GetStats() const;
+
+  public:
+    static const uint MaxLeafSize = 4;
+
+  private:
+    struct QuantizedNode
+    {
+      uint16_t min[3];
+      uint16_t max[3];
+      uint data; // Leafs: high bit, first triangle << 3 and triangle count - 1. Internal nodes: left child, right is next.
+    };
+
+    struct BuildNode
+    {
+      BoundingBox box;
+      uint left = 0;
+      uint first = 0;
+      uint count = 0;
+    };
+
+    uint Split(std::vector<BuildNode>& nodes, uint index, std::vector<uint>& triangles, const std::vector<BoundingBox>& boxes, const Vec3Array& centroids); // Returns the subtree depth.
+    void Quantize(const BoundingBox& box, QuantizedNode& node) const;
+    BoundingBox Dequantize(const QuantizedNode& node) const;
+
+  private:
+    Vec3Array m_positions;
+    std::vector<uint> m_indices; // Three per triangle, in leaf order.
+    std::vector<QuantizedNode> m_nodes; // Root first, siblings are adjacent.
+    Vec3 m_origin;
+    Vec3 m_scale; // Bounds extent per quantization step.
+    uint m_depth = 0;
+  };
+
+}
@@ -23,6 +23,7 @@ namespace ToolKit
   typedef unsigned char UByte;
   typedef unsigned int uint;
   typedef unsigned char uint8;
+  typedef unsigned short uint16;
   typedef unsigned long EntityId;
   typedef unsigned long NodeId;
   typedef unsigned long SceneId;
@@ -30,6 +31,7 @@ namespace ToolKit
   typedef std::string String;
   typedef std::vector<String> StringArray;
   typedef glm::ivec2 IVec2;
+  typedef glm::ivec3 IVec3;
   typedef glm::vec2 Vec2;
   typedef std::vector<Vec2> Vec2Array;
   typedef glm::vec3 Vec3;
@@ -48,6 +50,9 @@ namespace ToolKit
   typedef std::vector<ShaderPtr> ShaderPtrArray;
   typedef std::shared_ptr<class Program> ProgramPtr;
   typedef std::shared_ptr<class SkinMesh> SkinMeshPtr;
+  typedef std::shared_ptr<class GpuBuffer> GpuBufferPtr;
+  typedef std::shared_ptr<class TriangleBVH> TriangleBVHPtr;
+  typedef std::shared_ptr<class Prefab> PrefabPtr;
   typedef std::vector<MeshPtr> MeshPtrArray;
   typedef std::vector<class Mesh*> MeshRawPtrArray;
   typedef std::vector<const class Mesh*> MeshRawCPtrArray;
@@ -57,7 +62,7 @@ namespace ToolKit
   typedef std::vector<EntityId> EntityIdArray;
   typedef std::vector<class Node*> NodePtrArray;
   typedef std::vector<class Vertex> VertexArray;
-  typedef std::vector<class Face> FaceArray;
+  typedef std::vector<int> KeyCursor; // Last key index per animation track, see Animation::GetCurrentPose.
   typedef rapidxml::xml_document<> XmlDocument;
   typedef rapidxml::xml_node<> XmlNode;
   typedef rapidxml::xml_attribute<> XmlAttribute;
@@ -101,6 +106,8 @@ namespace ToolKit
   const static String XmlEntityNameAttr("n");
   const static String XmlEntityTagAttr("ta");
   const static String XmlEntityTypeAttr("t");
+  const static String XmlEntityStaticAttr("st");
+  const static String XmlDrawableOccluderAttr("oc");
   const static String XmlSceneElement("S");
   const static String XmlParamterElement("P");
   const static String XmlParamterValAttr("v");
@@ -116,6 +123,9 @@ namespace ToolKit
   static const String XmlTranslateElement("T");
   static const String XmlRotateElement("R");
   static const String XmlScaleElement("S");
+  static const String XmlPrefabElement("PF");
+  static const String XmlPrefabOverrideElement("O");
+  static const String XmlPrefabPartAttr("p");
 
   enum class AxisLabel
   {
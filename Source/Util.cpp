@@ -5,6 +5,7 @@
 #include "DebugNew.h"
 
 #include <fstream>
+#include <unordered_set>
 #include <filesystem>
 
 namespace ToolKit
@@ -91,6 +92,103 @@ namespace ToolKit
     return f.good();
   }
 
+  bool WritePng(const String& file, int width, int height, const uint8* rgba)
+  {
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::binary);
+    if (!out.is_open())
+    {
+      return false;
+    }
+
+    static uint crcTable[256] = {};
+    if (crcTable[1] == 0)
+    {
+      for (uint i = 0; i < 256; i++)
+      {
+        uint c = i;
+        for (int k = 0; k < 8; k++)
+        {
+          c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[i] = c;
+      }
+    }
+
+    auto PushUintFn = [](std::vector<uint8>& data, uint val) -> void
+    {
+      data.push_back((uint8)(val >> 24));
+      data.push_back((uint8)(val >> 16));
+      data.push_back((uint8)(val >> 8));
+      data.push_back((uint8)val);
+    };
+
+    auto WriteChunkFn = [&out, &PushUintFn](const char* type, const std::vector<uint8>& data) -> void
+    {
+      std::vector<uint8> chunk;
+      PushUintFn(chunk, (uint)data.size());
+      chunk.insert(chunk.end(), type, type + 4);
+      chunk.insert(chunk.end(), data.begin(), data.end());
+
+      // Over the type and the data.
+      uint crc = 0xFFFFFFFFu;
+      for (size_t i = 4; i < chunk.size(); i++)
+      {
+        crc = crcTable[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+      }
+      PushUintFn(chunk, crc ^ 0xFFFFFFFFu);
+
+      out.write((const char*)chunk.data(), chunk.size());
+    };
+
+    const uint8 signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    out.write((const char*)signature, sizeof(signature));
+
+    // 8 bit rgba, no interlacing.
+    std::vector<uint8> header;
+    PushUintFn(header, (uint)width);
+    PushUintFn(header, (uint)height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+    WriteChunkFn("IHDR", header);
+
+    // Scanlines without filtering, in stored deflate blocks.
+    size_t rowSize = (size_t)width * 4;
+    std::vector<uint8> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+      raw.push_back(0);
+      raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+    }
+
+    std::vector<uint8> zlib = { 0x78, 0x01 };
+    size_t offset = 0;
+    do
+    {
+      uint len = (uint)glm::min(raw.size() - offset, (size_t)65535);
+      zlib.push_back(offset + len == raw.size() ? 1 : 0);
+      zlib.push_back((uint8)len);
+      zlib.push_back((uint8)(len >> 8));
+      zlib.push_back((uint8)~len);
+      zlib.push_back((uint8)(~len >> 8));
+      zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + len);
+      offset += len;
+    } while (offset < raw.size());
+
+    uint a = 1;
+    uint b = 0;
+    for (uint8 byte : raw)
+    {
+      a = (a + byte) % 65521;
+      b = (b + a) % 65521;
+    }
+    PushUintFn(zlib, (b << 16) | a);
+    WriteChunkFn("IDAT", zlib);
+
+    WriteChunkFn("IEND", std::vector<uint8>());
+
+    return out.good();
+  }
+
   void DecomposePath(const String fullPath, String* path, String* name, String* ext)
   {
     String normal = fullPath;
@@ -275,44 +373,50 @@ namespace ToolKit
     return false;
   }
 
-  void RootsOnly(const EntityRawPtrArray& entities, EntityRawPtrArray& roots, Entity* child)
+  void GetRootEntities(const EntityRawPtrArray& entities, EntityRawPtrArray& roots)
   {
-    auto AddUnique = [&roots](Entity* e)
+    std::unordered_set<Entity*> members(entities.begin(), entities.end());
+    std::unordered_set<Entity*> added(roots.begin(), roots.end());
+
+    // Topmost ancestor that is still in the entities, shared by the whole chain below it.
+    std::unordered_map<Entity*, Entity*> rootOf;
+    rootOf.reserve(entities.size());
+    EntityRawPtrArray chain;
+
+    for (Entity* e : entities)
     {
       assert(e != nullptr);
 
-      bool unique = std::find(roots.begin(), roots.end(), e) == roots.end();
-      if (unique)
+      Entity* root = e;
+      chain.clear();
+      while (true)
       {
-        roots.push_back(e);
+        auto known = rootOf.find(root);
+        if (known != rootOf.end())
+        {
+          root = known->second;
+          break;
+        }
+
+        chain.push_back(root);
+        Node* parent = root->m_node->m_parent;
+        if (parent == nullptr || members.find(parent->m_entity) == members.end())
+        {
+          break;
+        }
+        root = parent->m_entity;
       }
-    };
 
-    Node* parent = child->m_node->m_parent;
-    if (parent != nullptr)
-    {
-      Entity* parentEntity = parent->m_entity;
-      if (std::find(entities.begin(), entities.end(), parentEntity) != entities.end())
+      for (Entity* visited : chain)
       {
-        RootsOnly(entities, roots, parentEntity);
+        rootOf[visited] = root;
       }
-      else
+
+      if (added.insert(root).second)
       {
-        AddUnique(child);
+        roots.push_back(root);
       }
     }
-    else
-    {
-      AddUnique(child);
-    }
-  }
-
-  void GetRootEntities(const EntityRawPtrArray& entities, EntityRawPtrArray& roots)
-  {
-    for (Entity* e : entities)
-    {
-      RootsOnly(entities, roots, e);
-    }
   }
 
 }
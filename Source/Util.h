@@ -19,6 +19,7 @@ namespace ToolKit
   void WriteAttr(XmlNode* node, XmlDocument* doc, const String& name, const String& val);
 
   bool CheckFile(const String& path);
+  bool WritePng(const String& file, int width, int height, const uint8* rgba); // Rows from top to bottom. Not compressed.
   void DecomposePath(const String fullPath, String* path, String* name, String* ext);
   void NormalizePath(String& path);
   char GetPathSeparator();
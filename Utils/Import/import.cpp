@@ -69,6 +69,7 @@ void ClearForbidden(std::string& str)
 unordered_map<string, BoneNode> g_skeletonMap;
 const aiScene* g_scene = nullptr;
 static unsigned int g_lastId = 1;
+float g_animTolerance = 0.0f; // Written into the animations, zero leaves them uncompressed.
 
 void TrunckToFileName(string& fullPath)
 {
@@ -151,8 +152,15 @@ void PrintAnims_(const aiScene* scene, string file)
     oFile.open(path, ios::out);
     assert(oFile.good());
 
+    // All the keys are written, with a tolerance the runtime reduces and quantizes them on load, in a single pass
+    // measured against the source keys.
     double fps = anim->mTicksPerSecond == 0 ? 24.0 : anim->mTicksPerSecond;
-    oFile << "<anim fps=\"" + to_string(fps) + "\" duration=\"" + to_string(anim->mDuration / fps) + "\">\n";
+    oFile << "<anim fps=\"" + to_string(fps) + "\" duration=\"" + to_string(anim->mDuration / fps) + "\"";
+    if (g_animTolerance > 0.0f)
+    {
+      oFile << " tolerance=\"" + to_string(g_animTolerance) + "\"";
+    }
+    oFile << ">\n";
 
     for (unsigned int j = 0; j < anim->mNumChannels; j++)
     {
@@ -604,7 +612,7 @@ int main(int argc, char* argv[])
   {
     if (argc < 2)
     {
-      cout << "usage: Import 'fileToImport.format' <op> -t 'importTo' <op> -s 1.0\n";
+      cout << "usage: Import 'fileToImport.format' <op> -t 'importTo' <op> -s 1.0 <op> -c 0.001\n";
       throw (-1);
     }
 
@@ -626,6 +634,12 @@ int main(int argc, char* argv[])
         float scale = (float)std::atof(argv[i + 1]);
         importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, scale);
       }
+
+      // Animation compression tolerance, in units for translation and scale, radians for rotation.
+      if (arg == "-c")
+      {
+        g_animTolerance = (float)std::atof(argv[i + 1]);
+      }
     }
 
     if (!dest.empty())